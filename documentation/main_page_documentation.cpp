@@ -30,7 +30,10 @@
  * `setup()` function that is called once, followed by a `loop()` function that
  * runs in an infinite loop, forever. These links are to the functions in the
  * main.cpp file, and are the starting point for the code. In essence, this is
- * the top-level Arduino code, the same as any other Arduino sketch.
+ * the top-level Arduino code, the same as any other Arduino sketch. The rest of
+ * the main channel is in src/main/, declared in main_channel.h: the
+ * supervision of the other channels, the command schedule and sequences, and
+ * the parameter table.
  *
  * It could be possible to put all our code into this one file, but this would
  * be a massive file that would be hard to read and maintain. In addition, we
@@ -71,6 +74,12 @@
  *  - It sends packets to the RPi.
  *  - It receives packets from the RPi.
  *  - It can command the RPi to power down.
+ * - \link Artemis::Channels::STORAGE::storage_channel() storage_channel():
+ * \endlink Manages the telemetry log on the built-in SD card.
+ *  - It recovers the telemetry log after a reset.
+ *  - It writes beacons stored by other channels to the SD card in whole
+ * sectors.
+ *  - It streams pages of stored records matching log queries from the ground.
  *
  * As the descriptions show, each channel runs independently, sharing
  * information in the form of PacketComm packets inserted into each others'
@@ -80,6 +89,197 @@
  * interrupted at any time. Further information is given in the multithreading
  * section.
  *
+ * Sensor readings are shared differently. Each device publishes the values it
+ * reads to the telemetry point store in telemetry_points.h, which keeps the
+ * latest value and timestamp of every point. Any channel can read a point
+ * without touching the sensor's bus.
+ *
+ * In deployment mode, the main channel sends beacons as the beacon plan in
+ * beacon_plan.h schedules them. Each entry of the plan names a device beacon,
+ * or a point beacon carrying up to six chosen telemetry points, with its
+ * period and priority. The ground can change entries with a
+ * CommandBeaconPlan packet, and the plan is saved in EEPROM across resets.
+ *
+ * Each channel runs on a stack of fixed size, set in artemis_defs.h. The
+ * stacks are painted before the channels start and scanned every
+ * STACK_SCAN_INTERVAL, so that the most each channel has used is sent in the
+ * stack beacon, and a warning is printed when a channel nears the end of its
+ * stack.
+ *
+ * Heap allocations are counted by heap_track.h under a tag for each channel,
+ * and for call sites such as the packet queues. The heap beacon carries the
+ * bytes in use, the peak, the free bytes and the largest free block, and the
+ * allocation count of each tag. A tag whose count does not change between
+ * beacons has not allocated, which shows that a loop is allocation-free.
+ *
+ * The threads take turns in a fixed order, each running until it sleeps,
+ * yields or uses up its time slice. A channel's priority is the length of its
+ * slice, set in artemis_defs.h: the radio and the PDU are given the longest,
+ * and the test and debug log channels the shortest, so a channel that becomes
+ * ready waits at most the sum of the other slices for its turn. A channel
+ * waiting on its radio yields between checks rather than spinning out its
+ * slice. A timer samples the running thread every millisecond, and the CPU
+ * beacon carries the share of samples each thread took since the last one.
+ * It is not in the default beacon plan, and can be added to it with a
+ * CommandBeaconPlan packet.
+ *
+ * The main channel supervises the others with supervisor.h. Each channel
+ * counts a heartbeat every pass of its loop, and one that misses its deadline
+ * in artemis_defs.h, or whose thread ends, is killed and started again with
+ * an empty packet queue. Each shared mutex records the thread holding it, so
+ * only the mutexes the killed channel was holding are unlocked. Each restart
+ * without a heartbeat in between doubles the time the channel is given, and a
+ * channel that stalls five times in a row is left alone, except the radio,
+ * which is restarted for as long as it stalls. The restart beacon, sent after
+ * each restart, carries the number of restarts of each channel and the cause
+ * of its last.
+ *
+ * The processor's clock is chosen by clock_governor.h. An idle thread yields
+ * at every turn, so the gaps between its turns are the time other threads
+ * spent working. Every GOVERNOR_WINDOW the governor raises the clock to
+ * 450 MHz if the window was busy, and lowers it a step, to 150 then 24 MHz,
+ * after several windows that would stay quiet at the lower clock. Work that
+ * needs the processor, such as streaming a log query, requests a boost to
+ * raise the clock before it starts. The governor's decisions can be checked
+ * on a simulated load trace with the native build's `governor` command.
+ *
+ * With the CYCLIC_EXECUTIVE build flag, the main channel runs its work from
+ * the static schedule in main.cpp rather than in a loop with a delay. Each
+ * 100 ms minor frame routes packets twice and samples the GPS, checks the
+ * beacon plan and supervises the channels at fixed offsets, and ten minor
+ * frames make a major frame. The release times are counted from startup, so
+ * they do not drift with how long the tasks take. The executive beacon
+ * carries each task's longest run, the number of times it overran its frame
+ * and the number of frames skipped.
+ *
+ * Commands can be uploaded ahead of time with a CommandSchedule packet, each
+ * tagged with the log time, to the millisecond, it is due at. The command
+ * schedule in command_schedule.h keeps them in a heap ordered by time, and
+ * the main channel sends each to itself once it is due, as if it had just
+ * come from the ground. The ground can add several commands in one packet,
+ * delete them by the ids they were given, and list the schedule. The schedule
+ * is saved on the SD card after every change. After a reset, log time runs on
+ * from the newest record in the telemetry log, so no command is sent until
+ * the ground has set the log time with CommandLogTime. Commands that came due
+ * while the Teensy was off are then sent at once.
+ *
+ * Operations of several steps can instead be uploaded as command sequences,
+ * run on board by command_sequence.h. A sequence is a short bytecode program
+ * that sends commands, waits for a time, for a telemetry point to cross a
+ * value or for a packet such as a reply, and branches on whether its last
+ * wait or check succeeded. Four sequences are kept on the SD card. They are
+ * uploaded in parts with CommandSequence packets, checked against their CRC
+ * and started from the ground or from the command schedule, and the ground is
+ * told when a sequence ends.
+ *
+ * Every command from the ground, including scheduled ones, is numbered as it
+ * reaches the main channel and acknowledged with command_ack.h. A command run
+ * by the main channel is acknowledged as executed, rejected or failed, with a
+ * result code and the time it took. A command handed to the PDU or storage
+ * channel is first acknowledged as accepted, and completed by that channel
+ * once it has run; the commands of a type are completed in the order they
+ * were handed over, and any left after a minute are failed as timed out.
+ * Acknowledgments wait up to a second so that several share a DataCommandAck
+ * packet, and a run of commands that all executed successfully is sent as a
+ * DataAckBitmap of their numbers.
+ *
+ * The flight software's tunable values, such as the read interval, the heater
+ * threshold, the PDU's timing, the queue size and the radio's frequency and
+ * power, are kept in parameter_table.h. Each has a type, a range and a
+ * default, and channels read them with a single load. CommandParameter
+ * packets report them, change them in RAM, commit them to EEPROM with a CRC,
+ * or return them to their defaults. An uncommitted change is undone by a
+ * reset, and a saved table that fails its CRC or range checks is ignored. A
+ * new radio frequency is tried for RADIO_TRIAL_TIMEOUT, and the radio goes
+ * back to the previous one unless the ground confirms it. Only a confirmed
+ * frequency is committed.
+ *
+ * A new flight software image can be uploaded from the ground or the
+ * Raspberry Pi with CommandFirmware packets, handled by the storage channel
+ * with firmware_stage.h. Each chunk is checked against its CRC-32 and written
+ * straight to a staging area on the SD card, along with its CRC-32 and a bit
+ * marking it as arrived, so the image is never held in RAM and an upload cut
+ * short by a reset is resumed where it stopped. Once every chunk has arrived,
+ * each is read back and checked again, a chunk damaged on the card is marked
+ * as missing to be sent again, and the CRC-32 of the whole image is checked.
+ * A verified image is then activated, which marks it in the staging area's
+ * header to be installed. The Teensy refuses to activate an image, as it
+ * cannot yet boot one with a known-good image to fall back to, so images are
+ * only staged there. The native build installs an activated image to a file.
+ *
+ * @section Native Running on Linux
+ * The `native` environment in platformio.ini builds the whole FSW for Linux,
+ * with `setup()`, `loop()` and every channel unchanged. The Teensy's libraries
+ * are replaced by thin stand-ins in the native/ directory:
+ *  - Each channel runs on a std::thread, with the same thread IDs as on the
+ * Teensy.
+ *  - The serial ports and the radio are buffers, which a host program can fill
+ * with incoming bytes and drain of outgoing ones.
+ *  - The SD card is a directory, named by the `ARTEMIS_SD` environment variable
+ * or `sdcard` by default.
+ *  - The sensors give steady, plausible readings, and the GPS has no fix.
+ *
+ * The channels run truly in parallel and time slices are not kept, so timing
+ * on Linux only roughly follows the Teensy.
+ *
+ * Running the program with `bench` times the hot packet paths in isolation:
+ * the queues, wrapping and SLIP framing, each device's read(), routing and
+ * hexdumps. It can be given the name of one benchmark and the number of
+ * operations to time:
+ * @verbatim
+
+.pio/build/native/program bench route_ground 100000
+
+@endverbatim
+
+ * The results are printed as JSON, with the nanoseconds, cycles and heap
+ * allocations of each operation. The native build replaces operator new so
+ * that the heap tracker counts allocations as it does on the Teensy.
+ *
+ * With the PACKET_TRACE flag, every frame the Teensy receives from the radio,
+ * the PDU and the Raspberry Pi is recorded, with its time and channel, in
+ * `trace.bin` on the SD card (see packet_trace.h). Running the program with
+ * `replay` gives the frames of one startup in a trace back to the flight
+ * software at the times they were received:
+ * @verbatim
+
+.pio/build/native/program replay trace.bin 0 > replay.json
+
+@endverbatim
+
+ * The second argument picks the startup, counting from 0. The replay runs on
+ * a virtual clock: time only passes when every thread is asleep, and the
+ * threads run one at a time in the order they are due to wake, so a trace is
+ * replayed the same way every time. Every frame given and sent is printed as
+ * a line of JSON with its virtual time, and each frame sent has the latency
+ * since the last frame given. Debug messages are printed to stderr.
+ *
+ * Running the program with `fuzz` gives arbitrary bytes to the functions that
+ * parse what the Teensy receives: the RFM23 channel's receive, the Raspberry
+ * Pi channel's SLIP framing, the PDU's replies to a ping, a switch change and
+ * a status request, and the main router. `fuzz seed` writes valid frames for
+ * each target to start a corpus from, and a target is then run on files, or
+ * on stdin as AFL expects:
+ * @verbatim
+
+.pio/build/native/program fuzz seed corpus
+.pio/build/native/program fuzz router corpus/router/*.bin
+
+@endverbatim
+
+ * Each input runs on the virtual clock with no threads started, so the
+ * delays it causes are added up rather than waited out. An input that would
+ * hold a channel up for more than 10 seconds aborts the program, as does a
+ * crash, so fuzzers report both. The `fuzz` environment builds with the
+ * address and undefined behaviour sanitizers, and has the flags for a
+ * libFuzzer build, which runs the target named by `ARTEMIS_FUZZ_TARGET`.
+ *
+ * Apart from the device drivers, the helpers and the profiler, the libraries
+ * in lib/ have no Arduino dependencies. They use only the C++ standard
+ * library, so that the ground tools in ground/ can be built with them for the
+ * host, and so that checks such as `log-check` and `compact-check` can run
+ * them there.
+ *
  * @section BuildFlags PlatformIO Build Flags
  * This section describes the PlatformIO build flags and their uses.
  *
@@ -104,6 +304,16 @@ build_flags = DEBUG_PRINT
  * |----------|----------|
  * | TESTS | Enable to run tests on the satellite. |
  *
+ * @subsection TelemetryFlags Telemetry Flags
+ * These flags change how telemetry is sent and stored on the SD card.
+ *
+ * | Flag Name | Function |
+ * |----------|----------|
+ * | TELEMETRY_ARCHIVE | Enable to store beacons in compressed archive |
+ * | | blocks. Use `log-dump` on the ground to decode them. |
+ * | COMPACT_BEACONS | Enable to send and store beacons as scaled integers, |
+ * | | with the ranges and precision given in beacon_schema.h. |
+ *
  * @subsection DebugFlags Debug Flags
  * If you've used Arduino before, you might be familiar with the
  * `Serial.print()` style of debugging. We use the same method of debugging
@@ -111,6 +321,18 @@ build_flags = DEBUG_PRINT
  * statements over the Serial connection established over USB to the Terminal
  * in VSCode.
  *
+ * Debug statements are not printed by the thread that makes them. Their
+ * arguments are written to a small ring buffer for each thread (see
+ * debug_log.h), and a low priority thread prints them in order when the other
+ * threads are idle. Printing a debug statement therefore never waits on the
+ * Serial connection. If a ring fills up, new statements are dropped and a
+ * count of them is printed instead.
+ *
+ * Each debug statement has a level, from Error to Rapid. Levels below the
+ * DEBUG_LOG_FLOOR flag are removed from the binary. The remaining levels can
+ * be lowered for each channel in flight with a CommandLogLevel packet, which
+ * the Teensy answers with the level of every channel.
+ *
  * Multiple flags are available for use, depending on what statements you'd like
  * to print.
  * | Flag Name | Function |
@@ -119,7 +341,17 @@ build_flags = DEBUG_PRINT
  * | DEBUG_PRINT_RAPID | Enable to print messages that will are generated |
  * | | rapidly, such as polling requests. |
  * | DEBUG_PRINT_HEXDUMP | Enable to print hexdumps to the serial console. |
+ * | DEBUG_LOG_FLOOR | Set to a level, such as `DEBUG_LOG_FLOOR=Info`, to |
+ * | | remove less important messages. Follows DEBUG_PRINT and |
+ * | | DEBUG_PRINT_RAPID if not set. |
  * | DEBUG_MEMORY | Enable to print memory capacity messages to the serial |
  * | | console. |
+ * | PROFILER | Enable to time the zones listed in profiler.h, such as |
+ * | | packet routing and device reads. A CommandProfile packet |
+ * | | reports, resets or prints the times. |
+ * | HEAP_TRACKING | Enable to count heap allocations by tag for the heap |
+ * | | beacon. Must be used with the `-Wl,--wrap` flag after it. |
+ * | PACKET_TRACE | Enable to record every frame received in `trace.bin` on |
+ * | | the SD card, to be replayed by the native build. |
  *
  */
\ No newline at end of file
@@ -0,0 +1,224 @@
+/**
+ * @file archive_bench.cpp
+ * @brief The telemetry archive benchmark.
+ *
+ * This file defines a ground tool that measures the telemetry archive format
+ * on synthetic orbit data.
+ */
+#include "ground.h"
+#include <beacon_schema.h>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <telemetry_archive.h>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace Ground {
+using Artemis::Storage::archive_header;
+using Artemis::Storage::ArchiveEncoder;
+
+namespace {
+/** @brief The period, in seconds, of the synthetic orbit. */
+const double ORBIT_PERIOD = 92.0 * 60.0;
+
+/**
+ * @brief The shape of a synthetic beacon.
+ *
+ * Every float field follows the orbit with its own phase, plus noise, and is
+ * quantized to the resolution of the sensor it stands in for.
+ */
+struct synthetic_beacon {
+  /** @brief The name printed in the results. */
+  const char *name;
+  /** @brief The BeaconType of the beacon. */
+  uint8_t     type;
+  /** @brief The number of float fields after deci. */
+  uint8_t     floats;
+  /** @brief The number of byte fields after the floats. */
+  uint8_t     bytes;
+  /** @brief The mean value of each float field. */
+  double      offset;
+  /** @brief The amplitude of each float field over an orbit. */
+  double      amplitude;
+  /** @brief The standard deviation of the noise on each float field. */
+  double      noise;
+  /** @brief The resolution of each float field. */
+  double      resolution;
+};
+
+/** @brief The beacons of the satellite, shaped like their real sensors. */
+const synthetic_beacon beacons[] = {
+    {"temperature", 1, 8, 0, 10.0, 15.0, 0.3, 3300.0 / 1024.0 / 10.0},
+    {   "current1", 2, 4, 0, 40.0, 30.0, 0.5, 0.1},
+    {   "current2", 3, 6, 0, 40.0, 30.0, 0.5, 0.1},
+    {        "imu", 4, 7, 0,  0.0,  0.2, 0.01, 0.061e-3 * 9.80665},
+    {        "mag", 5, 3, 0,  0.0, 30.0, 0.2, 100.0 / 6842.0},
+    {        "gps", 6, 5, 1,  0.0, 51.6, 0.0, 1e-6},
+    {     "switch", 7, 0, 13, 0.0,  0.0, 0.0, 1.0},
+};
+
+/** @brief A small, fixed-seed generator so every run sees the same data. */
+uint32_t random_state = 0x2545F491;
+
+uint32_t random_next() {
+  random_state ^= random_state << 13;
+  random_state ^= random_state >> 17;
+  random_state ^= random_state << 5;
+  return random_state;
+}
+
+/** @brief Approximately normal noise with a standard deviation of 1. */
+double random_noise() {
+  double sum = 0;
+  for (int i = 0; i < 12; i++) {
+    sum += random_next() / 4294967296.0;
+  }
+  return sum - 6.0;
+}
+
+/** @brief A timer in cycles where the host has a cycle counter. */
+uint64_t timer_now() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+#endif
+}
+
+/**
+ * @brief Generate a beacon at a time.
+ *
+ * @param shape The shape of the beacon.
+ * @param t The time, in seconds since the start of the run.
+ * @param record The buffer that will carry the beacon.
+ * @return uint16_t The size of the beacon.
+ */
+uint16_t generate(const synthetic_beacon &shape, uint32_t t, uint8_t *record) {
+  // deci is the uptime in milliseconds, read with a little scheduling jitter.
+  const uint32_t deci = t * 1000 + random_next() % 10;
+  uint16_t       size = 0;
+  record[size++]      = shape.type;
+  memcpy(&record[size], &deci, sizeof(deci));
+  size += sizeof(deci);
+  record[size++] = BEACON_SCHEMA_VERSION;
+  for (uint8_t i = 0; i < shape.floats; i++) {
+    const double angle = 2 * M_PI * t / ORBIT_PERIOD + i;
+    const double value = shape.offset + shape.amplitude * sin(angle) +
+                         shape.noise * random_noise();
+    const float quantized =
+        (float)(lrint(value / shape.resolution) * shape.resolution);
+    memcpy(&record[size], &quantized, sizeof(quantized));
+    size += sizeof(quantized);
+  }
+  for (uint8_t i = 0; i < shape.bytes; i++) {
+    // Switches and satellite counts change rarely.
+    record[size++] = (t / 3600 + i) % 3 == 0 && random_next() % 64 == 0;
+  }
+  return size;
+}
+} // namespace
+
+/**
+ * @brief Measure the telemetry archive format on synthetic orbit data.
+ *
+ * A day of each beacon is generated at its usual interval, archived, decoded
+ * again and compared. The results are printed as CSV, with the encoding time
+ * in cycles per beacon on hosts with a cycle counter and nanoseconds
+ * otherwise.
+ *
+ * @param argc The number of arguments.
+ * @param argv Optionally, the length of the run and the beacon interval, in
+ * seconds.
+ * @return int 0 if every beacon decoded correctly, 1 otherwise.
+ */
+int archive_bench(int argc, char **argv) {
+  const uint32_t duration = argc > 0 ? strtoul(argv[0], nullptr, 0) : 86400;
+  const uint32_t interval = argc > 1 ? strtoul(argv[1], nullptr, 0) : 20;
+  if (interval == 0) {
+    fprintf(stderr, "archive-bench: interval must be at least 1 second\n");
+    return 1;
+  }
+
+  static ArchiveEncoder encoder;
+  static uint8_t decoded[ARCHIVE_BLOCK_RECORDS * ARCHIVE_MAX_RECORD_SIZE];
+  bool           ok             = true;
+  uint64_t       total_raw      = 0;
+  uint64_t       total_archived = 0;
+
+  printf("beacon,count,raw_bytes,archived_bytes,ratio,encode_per_beacon,"
+         "decode_per_beacon\n");
+  for (const synthetic_beacon &shape : beacons) {
+    std::vector<uint8_t> raw;
+    std::vector<uint8_t> archived;
+    uint8_t              record[ARCHIVE_MAX_RECORD_SIZE];
+    uint16_t             size  = 0;
+    uint32_t             count = 0;
+    for (uint32_t t = 0; t < duration; t += interval) {
+      size = generate(shape, t, record);
+      raw.insert(raw.end(), record, record + size);
+      count++;
+    }
+
+    // Each block is stored with its size, as the telemetry log does.
+    uint64_t elapsed = 0;
+    for (uint32_t i = 0; i <= count; i++) {
+      const uint64_t start = timer_now();
+      const bool     block = i < count ? encoder.add(&raw[i * size], size)
+                                       : encoder.flush();
+      elapsed += timer_now() - start;
+      if (block) {
+        const uint16_t block_size = encoder.block_size();
+        archived.push_back(block_size & 0xFF);
+        archived.push_back(block_size >> 8);
+        archived.insert(archived.end(), encoder.block(),
+                        encoder.block() + block_size);
+      }
+    }
+
+    uint64_t decode_elapsed = 0;
+    uint32_t position       = 0;
+    uint32_t decoded_count  = 0;
+    while (position + 2 <= archived.size()) {
+      const uint16_t block_size = archived[position] | archived[position + 1]
+                                                           << 8;
+      position += 2;
+      archive_header header;
+      const uint64_t start = timer_now();
+      const int32_t  n     = Artemis::Storage::decode_archive_block(
+          &archived[position], block_size, header, decoded, sizeof(decoded));
+      decode_elapsed += timer_now() - start;
+      if (n < 0 || header.record_size != size ||
+          memcmp(decoded, &raw[decoded_count * size], n * size) != 0) {
+        fprintf(stderr, "archive-bench: %s block %u did not decode\n",
+                shape.name, (unsigned)decoded_count / ARCHIVE_BLOCK_RECORDS);
+        ok = false;
+        break;
+      }
+      decoded_count += n;
+      position += block_size;
+    }
+    if (decoded_count != count) {
+      fprintf(stderr, "archive-bench: %s decoded %u of %u beacons\n",
+              shape.name, (unsigned)decoded_count, (unsigned)count);
+      ok = false;
+    }
+
+    printf("%s,%u,%u,%u,%.2f,%.1f,%.1f\n", shape.name, (unsigned)count,
+           (unsigned)raw.size(), (unsigned)archived.size(),
+           (double)raw.size() / archived.size(), (double)elapsed / count,
+           (double)decode_elapsed / count);
+    total_raw += raw.size();
+    total_archived += archived.size();
+  }
+  printf("total,,%u,%u,%.2f,,\n", (unsigned)total_raw,
+         (unsigned)total_archived, (double)total_raw / total_archived);
+  return ok ? 0 : 1;
+}
+} // namespace Ground
@@ -0,0 +1,159 @@
+/**
+ * @file beacon_decode.cpp
+ * @brief The beacon schema and decode tools.
+ *
+ * This file defines ground tools that print the beacon schema and decode the
+ * beacons of a telemetry log into named, scaled fields.
+ */
+#include "ground.h"
+#include <beacon_schema.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+namespace Ground {
+using Artemis::Beacons::beacon_descriptor;
+using Artemis::Beacons::field_descriptor;
+
+namespace {
+/** @brief The names of each FieldType. */
+const char *const field_type_names[] = {"uint8", "int8",  "uint16", "int16",
+                                        "uint32", "int32", "float"};
+
+/**
+ * @brief Find the description of a beacon by name.
+ *
+ * @param name The name of the beacon's structure, such as imubeacon.
+ * @return const beacon_descriptor* The description, or nullptr if there is
+ * no such beacon.
+ */
+const beacon_descriptor *find_beacon_by_name(const char *name) {
+  for (uint8_t i = 0; i < Artemis::Beacons::beacon_descriptor_count; i++) {
+    if (strcmp(Artemis::Beacons::beacon_descriptors[i].name, name) == 0) {
+      return &Artemis::Beacons::beacon_descriptors[i];
+    }
+  }
+  return nullptr;
+}
+} // namespace
+
+/**
+ * @brief Print the beacon schema as JSON.
+ *
+ * This lets ground software outside this repository follow the schema
+ * without copying it by hand.
+ *
+ * @param argc The number of arguments.
+ * @param argv No arguments are used.
+ * @return int 0.
+ */
+int beacon_schema(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  printf("{\"version\": %d, \"beacons\": [", BEACON_SCHEMA_VERSION);
+  for (uint8_t i = 0; i < Artemis::Beacons::beacon_descriptor_count; i++) {
+    const beacon_descriptor &beacon = Artemis::Beacons::beacon_descriptors[i];
+    printf("%s\n  {\"type\": %u, \"name\": \"%s\", \"size\": %u, "
+           "\"fields\": [",
+           i ? "," : "", (unsigned)beacon.type, beacon.name,
+           (unsigned)beacon.size);
+    for (uint8_t f = 0; f < beacon.field_count; f++) {
+      const field_descriptor &field = beacon.fields[f];
+      printf("%s\n    {\"name\": \"%s\", \"type\": \"%s\", \"offset\": %u, "
+             "\"count\": %u, \"scale\": %.17g, \"bias\": %.17g, "
+             "\"unit\": \"%s\"}",
+             f ? "," : "", field.name,
+             field_type_names[(uint8_t)field.type], (unsigned)field.offset,
+             (unsigned)field.count, field.scale, field.bias, field.unit);
+    }
+    printf("]}");
+  }
+  printf("\n]}\n");
+  return 0;
+}
+
+/**
+ * @brief Print one type of beacon from a telemetry log as CSV.
+ *
+ * Every field is scaled into its unit, and array fields are printed one
+ * column per value. The beacons are collected first and decoded a column at
+ * a time.
+ *
+ * @param argc The number of arguments.
+ * @param argv The data file, the index file, the name of the beacon, and
+ * optionally the start and end times in seconds of log time.
+ * @return int 0 on success, 1 on failure.
+ */
+int beacon_decode(int argc, char **argv) {
+  if (argc < 3) {
+    fprintf(stderr, "beacon-decode: expected a data file, an index file and "
+                    "a beacon name\n");
+    return 1;
+  }
+  const beacon_descriptor *beacon = find_beacon_by_name(argv[2]);
+  if (beacon == nullptr) {
+    fprintf(stderr, "beacon-decode: unknown beacon %s\n", argv[2]);
+    return 1;
+  }
+  const uint32_t start = argc > 3 ? strtoul(argv[3], nullptr, 0) : 0;
+  const uint32_t end   = argc > 4 ? strtoul(argv[4], nullptr, 0) : UINT32_MAX;
+
+  std::vector<uint32_t> times;
+  std::vector<uint8_t>  beacons;
+  uint32_t              rejected = 0;
+  const bool            read =
+      read_log("beacon-decode", argv[0], argv[1], start, end,
+               [&](uint32_t timestamp, uint8_t type, const uint8_t *payload,
+                   int32_t length) {
+                 if (type != (uint8_t)beacon->type) {
+                   return;
+                 }
+                 if (Artemis::Beacons::check_beacon(payload, length) !=
+                     beacon) {
+                   rejected++;
+                   return;
+                 }
+                 times.push_back(timestamp);
+                 beacons.insert(beacons.end(), payload, payload + length);
+               });
+  if (!read) {
+    return 1;
+  }
+  if (rejected > 0) {
+    fprintf(stderr,
+            "beacon-decode: skipped %u beacons of another schema version\n",
+            (unsigned)rejected);
+  }
+
+  // Decode every value of every beacon, a column at a time.
+  const uint32_t                   count = times.size();
+  std::vector<std::vector<double>> columns;
+  printf("time");
+  for (uint8_t f = 0; f < beacon->field_count; f++) {
+    const field_descriptor &field = beacon->fields[f];
+    for (uint8_t e = 0; e < field.count; e++) {
+      if (field.count > 1) {
+        printf(",%s[%u]", field.name, (unsigned)e);
+      } else {
+        printf(",%s", field.name);
+      }
+      if (field.unit[0] != '\0') {
+        printf(" (%s)", field.unit);
+      }
+      columns.emplace_back(count);
+      Artemis::Beacons::decode_column(field, e, beacons.data(), count,
+                                      beacon->size, columns.back().data());
+    }
+  }
+  printf("\n");
+  for (uint32_t i = 0; i < count; i++) {
+    printf("%u", (unsigned)times[i]);
+    for (const std::vector<double> &column : columns) {
+      printf(",%.9g", column[i]);
+    }
+    printf("\n");
+  }
+  return 0;
+}
+} // namespace Ground
@@ -0,0 +1,180 @@
+/**
+ * @file compact_check.cpp
+ * @brief The compact beacon check tool.
+ *
+ * This file defines a ground tool that checks every compact beacon field
+ * round-trips within its stated precision.
+ */
+#include "ground.h"
+#include <beacon_schema.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace Ground {
+using Artemis::Beacons::beacon_descriptor;
+using Artemis::Beacons::field_descriptor;
+using Artemis::Beacons::FieldType;
+
+namespace {
+/** @brief The number of random beacons checked for each compact beacon. */
+const uint32_t CHECK_TRIALS = 100000;
+
+/** @brief The lowest and highest integer of each FieldType. */
+const double field_limits[][2] = {
+    {            0,          255},
+    {         -128,          127},
+    {            0,        65535},
+    {       -32768,        32767},
+    {            0, 4294967295.0},
+    {-2147483648.0,   2147483647},
+    {            0,            0},
+};
+
+/** @brief A fixed-seed generator so every run checks the same values. */
+uint32_t random_state = 0x9E3779B9;
+
+/** @brief A random value from 0 up to 1. */
+double   random_unit() {
+  random_state ^= random_state << 13;
+  random_state ^= random_state >> 17;
+  random_state ^= random_state << 5;
+  return random_state / 4294967296.0;
+}
+
+/**
+ * @brief Find a field of a beacon by name.
+ *
+ * @param beacon The description of the beacon.
+ * @param name The name of the field.
+ * @return const field_descriptor* The field, or nullptr if there is none.
+ */
+const field_descriptor *find_field(const beacon_descriptor *beacon,
+                                   const char              *name) {
+  for (uint8_t f = 0; f < beacon->field_count; f++) {
+    if (strcmp(beacon->fields[f].name, name) == 0) {
+      return &beacon->fields[f];
+    }
+  }
+  return nullptr;
+}
+
+/**
+ * @brief Store a value in a field of a full beacon.
+ *
+ * @param field The field of the full beacon.
+ * @param element The index of the value, for array fields.
+ * @param beacon A pointer to the full beacon.
+ * @param value The value to be stored.
+ */
+void set_field(const field_descriptor &field, uint8_t element, uint8_t *beacon,
+               double value) {
+  if (field.type == FieldType::Float) {
+    const float f = value;
+    memcpy(&beacon[field.offset + element * sizeof(f)], &f, sizeof(f));
+  } else {
+    beacon[field.offset + element] = lrint(fmin(fmax(value, 0), 255));
+  }
+}
+
+/**
+ * @brief Check a compact beacon against the full beacon it is made from.
+ *
+ * Random values within each field's range are checked, along with the ends
+ * of the range, values beyond them and NaN, which must clamp.
+ *
+ * @tparam Source The full beacon.
+ * @tparam Compact The compact beacon.
+ * @return true Every value was within half a step of the value stored.
+ * @return false A value was not.
+ */
+template <typename Source, typename Compact> bool check() {
+  const beacon_descriptor *source =
+      Artemis::Beacons::find_beacon((uint8_t)Source().type);
+  const beacon_descriptor *compact =
+      Artemis::Beacons::find_beacon((uint8_t)Compact().type);
+  bool ok = true;
+
+  // Skip the type, deci and version, which are copied unchanged.
+  for (uint8_t f = 3; f < compact->field_count; f++) {
+    const field_descriptor &field = compact->fields[f];
+    const field_descriptor *from  = find_field(source, field.name);
+    const double           *limit = field_limits[(uint8_t)field.type];
+    const double            min   = limit[0] * field.scale + field.bias;
+    const double            max   = limit[1] * field.scale + field.bias;
+    const double            step  = field.scale;
+    double                  worst = 0;
+
+    for (uint32_t trial = 0; trial < CHECK_TRIALS; trial++) {
+      for (uint8_t e = 0; e < field.count; e++) {
+        Source in;
+        double value;
+        double expected;
+        switch (trial) {
+          case 0:
+            value = expected = min;
+            break;
+          case 1:
+            value = expected = max;
+            break;
+          case 2:
+            value    = min - (max - min);
+            expected = min;
+            break;
+          case 3:
+            value    = max + (max - min);
+            expected = max;
+            break;
+          case 4:
+            value    = NAN;
+            expected = min;
+            break;
+          default:
+            value    = min + (max - min) * random_unit();
+            expected = value;
+            break;
+        }
+        set_field(*from, e, (uint8_t *)&in, value);
+        if (!isnan(value)) {
+          // Compare against the value as the full beacon stores it.
+          expected = Artemis::Beacons::field_value(*from, (uint8_t *)&in, e);
+          expected = fmin(fmax(expected, min), max);
+        }
+        const Compact out     = Artemis::Beacons::compact(in);
+        const double  decoded = Artemis::Beacons::field_value(
+            field, (const uint8_t *)&out, e);
+        worst = fmax(worst, fabs(decoded - expected));
+      }
+    }
+
+    // Allow for rounding in the single precision used for small fields.
+    const bool passed = worst <= step * 0.51;
+    printf("%s,%s,%.9g,%.9g,%.9g,%s\n", compact->name, field.name, min, max,
+           worst, passed ? "ok" : "FAILED");
+    ok = ok && passed;
+  }
+  return ok;
+}
+} // namespace
+
+/**
+ * @brief Check every compact beacon field round-trips within its precision.
+ *
+ * The results are printed as CSV, with the largest error of each field.
+ *
+ * @param argc The number of arguments.
+ * @param argv No arguments are used.
+ * @return int 0 if every field passed, 1 otherwise.
+ */
+int compact_check(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  bool ok = true;
+  printf("beacon,field,min,max,max_error,result\n");
+#define COMPACT_CHECK(id, type_name, name, source, fields)                     \
+  ok = check<Artemis::Beacons::source, Artemis::Beacons::name>() && ok;
+  ARTEMIS_COMPACT_BEACONS(COMPACT_CHECK)
+#undef COMPACT_CHECK
+  return ok ? 0 : 1;
+}
+} // namespace Ground
@@ -0,0 +1,330 @@
+/**
+ * @file firmware_check.cpp
+ * @brief The firmware staging check tool.
+ *
+ * This file defines a ground tool that runs uploads through the firmware
+ * staging area on files of the host, including uploads cut short, resumed
+ * and corrupted in storage, and checks what each leaves behind.
+ */
+#include "ground.h"
+#include <checksum.h>
+#include <firmware_stage.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+namespace Ground {
+using Artemis::Storage::DeviceTarget;
+using Artemis::Storage::FileBlockDevice;
+using Artemis::Storage::firmware_status;
+using Artemis::Storage::FirmwareStage;
+using Artemis::Storage::FirmwareState;
+using Artemis::Storage::StageResult;
+
+namespace {
+/** @brief The size, in bytes, of the image uploaded. */
+const uint32_t       IMAGE_SIZE = 300037;
+/** @brief The size, in bytes, of each chunk of the image. */
+const uint16_t       CHUNK_SIZE = 500;
+/** @brief The number of chunks in the image. */
+const uint16_t       CHUNKS     = (IMAGE_SIZE + CHUNK_SIZE - 1) / CHUNK_SIZE;
+
+/** @brief The image uploaded. */
+std::vector<uint8_t> image(IMAGE_SIZE);
+/** @brief The CRC-32 of the image. */
+uint32_t             image_crc = 0;
+/** @brief The path of the staging area's file. */
+char                 stage_path[] = "firmware-check-stage-XXXXXX";
+/** @brief The path of the file the image is installed to. */
+char                 target_path[] = "firmware-check-target-XXXXXX";
+
+/** @brief A fixed-seed generator so every run uploads the same image. */
+uint32_t             random_state = 0x9E3779B9;
+/** @brief The number of steps an install has reported. */
+uint32_t             install_steps = 0;
+
+/** @brief A random byte. */
+uint8_t              random_byte() {
+  random_state ^= random_state << 13;
+  random_state ^= random_state >> 17;
+  random_state ^= random_state << 5;
+  return random_state >> 24;
+}
+
+/**
+ * @brief Print the result of a check.
+ *
+ * @param name The name of the check.
+ * @param passed Whether the check passed.
+ * @return bool passed.
+ */
+bool report(const char *name, bool passed) {
+  printf("%s,%s\n", name, passed ? "ok" : "FAILED");
+  return passed;
+}
+
+/** @brief Count a step of an install, as the storage channel's heartbeat. */
+void count_step() { install_steps++; }
+
+/** @brief The size of a chunk of the image. */
+uint16_t chunk_length(uint16_t index) {
+  const uint32_t start = (uint32_t)index * CHUNK_SIZE;
+  return IMAGE_SIZE - start < CHUNK_SIZE ? IMAGE_SIZE - start : CHUNK_SIZE;
+}
+
+/**
+ * @brief Write a chunk of the image, as the storage channel does.
+ *
+ * @param stage The staging area.
+ * @param index The index of the chunk.
+ * @return StageResult The result of the write.
+ */
+StageResult write_chunk(FirmwareStage &stage, uint16_t index) {
+  const uint8_t *chunk = image.data() + (uint32_t)index * CHUNK_SIZE;
+  const uint16_t size  = chunk_length(index);
+  return stage.write(index, Helpers::crc32(chunk, size), chunk, size);
+}
+
+/**
+ * @brief Grow the staging area until it holds the image.
+ *
+ * @param stage The staging area.
+ * @return uint32_t The number of steps taken, or 0 if a step failed.
+ */
+uint32_t grow_all(FirmwareStage &stage) {
+  uint32_t steps = 0;
+  while (stage.growing()) {
+    if (stage.grow() != StageResult::Ok) {
+      return 0;
+    }
+    steps++;
+  }
+  return steps;
+}
+
+/**
+ * @brief Begin an upload, and check it leaves the image to be grown in
+ * steps.
+ *
+ * @param stage The staging area.
+ * @param device The device holding the staging area.
+ * @return true A chunk past the end of the device was refused, and the
+ * device grew in more than one step, across a reset.
+ * @return false It did not.
+ */
+bool check_begin(FirmwareStage &stage, FileBlockDevice &device) {
+  const StageResult begun = stage.begin(IMAGE_SIZE, CHUNK_SIZE, image_crc);
+  bool              ok    = report("begin", begun == StageResult::Ok &&
+                                                device.size() ==
+                                                    FIRMWARE_CRC_OFFSET);
+  ok = report("write before grown",
+              write_chunk(stage, CHUNKS - 1) == StageResult::NotReady) &&
+       ok;
+  // A reset part way through growing leaves the device short of the image.
+  stage.grow();
+  stage.grow();
+  FirmwareStage reopened(&device);
+  ok = report("reopen while growing",
+              reopened.open() && reopened.growing() &&
+                  reopened.state() == FirmwareState::Receiving) &&
+       ok;
+  const uint32_t steps = grow_all(reopened);
+  ok = report("grow in steps",
+              steps > 1 &&
+                  device.size() == FIRMWARE_IMAGE_OFFSET + IMAGE_SIZE) &&
+       ok;
+  return stage.open() && ok;
+}
+
+/**
+ * @brief Upload half of the image, and find it again after a reset.
+ *
+ * @param stage The staging area.
+ * @param device The device holding the staging area.
+ * @return true The chunks written were found, and the first missing one was
+ * reported.
+ * @return false They were not.
+ */
+bool check_partial(FirmwareStage &stage, FileBlockDevice &device) {
+  bool ok = true;
+  for (uint16_t index = 0; index < CHUNKS; index += 2) {
+    ok = write_chunk(stage, index) == StageResult::Ok && ok;
+  }
+  ok = report("write half", ok && stage.received() == (CHUNKS + 1) / 2);
+  ok = report("verify partial", stage.verify() == StageResult::WrongState) &&
+       ok;
+
+  FirmwareStage   reopened(&device);
+  firmware_status status;
+  ok = report("reopen partial",
+              reopened.open() && reopened.received() == (CHUNKS + 1) / 2 &&
+                  reopened.status(0, status) && status.first_missing == 1 &&
+                  status.window[0] == 0x55) &&
+       ok;
+  return ok;
+}
+
+/**
+ * @brief Resume the upload cut short, and finish it.
+ *
+ * @param stage The staging area, reopened after the partial upload.
+ * @return true The upload was resumed with its chunks kept, and verified.
+ * @return false It was not.
+ */
+bool check_resume(FirmwareStage &stage) {
+  const StageResult begun = stage.begin(IMAGE_SIZE, CHUNK_SIZE, image_crc);
+  bool              ok    = report("resume", begun == StageResult::Ok &&
+                                                 stage.received() ==
+                                                     (CHUNKS + 1) / 2 &&
+                                                 !stage.growing());
+  ok = report("bad chunk crc",
+              stage.write(1, 0, image.data() + CHUNK_SIZE, CHUNK_SIZE) ==
+                  StageResult::BadCrc) &&
+       ok;
+  for (uint16_t index = 1; index < CHUNKS; index += 2) {
+    ok = write_chunk(stage, index) == StageResult::Ok && ok;
+  }
+  ok = report("write rest", ok && stage.received() == CHUNKS);
+  ok = report("verify resumed", stage.verify() == StageResult::Ok &&
+                                    stage.state() == FirmwareState::Verified) &&
+       ok;
+  return ok;
+}
+
+/**
+ * @brief Corrupt a chunk on the device, and check verify() asks for it again.
+ *
+ * @param stage The staging area, holding a whole upload.
+ * @param device The device holding the staging area.
+ * @return true The chunk was found and marked as missing, and the upload
+ * verified once it was sent again.
+ * @return false It was not.
+ */
+bool check_corrupt(FirmwareStage &stage, FileBlockDevice &device) {
+  const uint16_t corrupted = CHUNKS / 3;
+  // An image whose chunks all arrive intact can still fail as a whole.
+  bool           ok        = stage.begin(IMAGE_SIZE, CHUNK_SIZE,
+                                         image_crc ^ 1) == StageResult::Ok;
+  ok = grow_all(stage) > 0 && ok;
+  for (uint16_t index = 0; index < CHUNKS; index++) {
+    ok = write_chunk(stage, index) == StageResult::Ok && ok;
+  }
+  ok = report("verify wrong image crc",
+              ok && stage.verify() == StageResult::BadCrc &&
+                  stage.state() == FirmwareState::Failed) &&
+       ok;
+
+  ok = stage.begin(IMAGE_SIZE, CHUNK_SIZE, image_crc) == StageResult::Ok &&
+       grow_all(stage) > 0 && ok;
+  for (uint16_t index = 0; index < CHUNKS; index++) {
+    ok = write_chunk(stage, index) == StageResult::Ok && ok;
+  }
+  const uint32_t offset =
+      FIRMWARE_IMAGE_OFFSET + (uint32_t)corrupted * CHUNK_SIZE + 7;
+  uint8_t byte;
+  ok = device.read(offset, &byte, 1) && ok;
+  byte ^= 0x10;
+  ok = device.write(offset, &byte, 1) && device.sync() && ok;
+
+  firmware_status status;
+  ok = report("verify corrupted",
+              stage.verify() == StageResult::BadCrc &&
+                  stage.received() == CHUNKS - 1 &&
+                  stage.state() == FirmwareState::Receiving &&
+                  stage.status(0, status) &&
+                  status.first_missing == corrupted) &&
+       ok;
+  ok = report("verify resent",
+              write_chunk(stage, corrupted) == StageResult::Ok &&
+                  stage.verify() == StageResult::Ok) &&
+       ok;
+  return ok;
+}
+
+/**
+ * @brief Install the verified image to a file.
+ *
+ * @param stage The staging area, holding a verified image.
+ * @return true The file holds the image, and the image was left Verified as
+ * the file cannot be booted.
+ * @return false It was not.
+ */
+bool check_install(FirmwareStage &stage) {
+  FileBlockDevice device;
+  DeviceTarget    target(&device);
+  bool            ok = device.open(target_path);
+  ok = report("install before activate",
+              stage.install(target) == StageResult::WrongState) &&
+       ok;
+  ok = stage.activate() == StageResult::Ok && ok;
+
+  install_steps = 0;
+  const StageResult    result = stage.install(target, count_step);
+  std::vector<uint8_t> installed(IMAGE_SIZE);
+  ok = report("install",
+              result == StageResult::NotSupported &&
+                  stage.state() == FirmwareState::Verified &&
+                  install_steps == 2u * CHUNKS &&
+                  device.size() == IMAGE_SIZE &&
+                  device.read(0, installed.data(), IMAGE_SIZE) &&
+                  installed == image) &&
+       ok;
+  return ok;
+}
+} // namespace
+
+/**
+ * @brief Check uploads through the firmware staging area.
+ *
+ * The results are printed as CSV. The staging area and the image installed
+ * are kept in temporary files in the working directory, which are removed.
+ *
+ * @param argc The number of arguments.
+ * @param argv No arguments are used.
+ * @return int 0 if every check passed, 1 otherwise.
+ */
+int firmware_check(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  for (uint8_t &byte : image) {
+    byte = random_byte();
+  }
+  image_crc = Helpers::crc32(image.data(), image.size());
+  const int stage_file  = mkstemp(stage_path);
+  const int target_file = mkstemp(target_path);
+  if (stage_file < 0 || target_file < 0) {
+    fprintf(stderr, "firmware-check: cannot create temporary files\n");
+    return 1;
+  }
+  close(stage_file);
+  close(target_file);
+
+  bool            ok = true;
+  FileBlockDevice device;
+  FirmwareStage   stage(&device);
+  printf("check,result\n");
+  if (!device.open(stage_path)) {
+    fprintf(stderr, "firmware-check: cannot open %s\n", stage_path);
+    ok = false;
+  } else {
+    ok = report("open empty", !stage.open()) && ok;
+    ok = check_begin(stage, device) && ok;
+    ok = check_partial(stage, device) && ok;
+    FirmwareStage resumed(&device);
+    ok = resumed.open() && ok;
+    ok = check_resume(resumed) && ok;
+    ok = check_corrupt(resumed, device) && ok;
+    ok = check_install(resumed) && ok;
+    ok = report("abort", resumed.abort() == StageResult::Ok &&
+                             !resumed.open() &&
+                             device.size() < FIRMWARE_BITMAP_OFFSET) &&
+         ok;
+  }
+  device.close();
+  remove(stage_path);
+  remove(target_path);
+  return ok ? 0 : 1;
+}
+} // namespace Ground
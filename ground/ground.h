@@ -0,0 +1,37 @@
+/**
+ * @file ground.h
+ * @brief The header file for the ground tools.
+ *
+ * This file contains declarations of the ground tools, host commands used to
+ * work with data produced by the flight software.
+ */
+#ifndef _GROUND_H
+#define _GROUND_H
+
+#include <functional>
+#include <stdint.h>
+
+/** @brief Host-side tools used by the ground station. */
+namespace Ground {
+/**
+ * @brief A function called with each record of a telemetry log.
+ *
+ * The arguments are the time, type, payload and length of the record.
+ */
+using record_handler =
+    std::function<void(uint32_t, uint8_t, const uint8_t *, int32_t)>;
+
+bool read_log(const char *tool, const char *data_path, const char *index_path,
+              uint32_t start, uint32_t end, const record_handler &handler);
+
+int  log_dump(int argc, char **argv);
+int  log_query_tool(int argc, char **argv);
+int  archive_bench(int argc, char **argv);
+int  beacon_schema(int argc, char **argv);
+int  beacon_decode(int argc, char **argv);
+int  compact_check(int argc, char **argv);
+int  log_check(int argc, char **argv);
+int  firmware_check(int argc, char **argv);
+} // namespace Ground
+
+#endif // _GROUND_H
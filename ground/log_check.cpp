@@ -0,0 +1,189 @@
+/**
+ * @file log_check.cpp
+ * @brief The log level check tool.
+ *
+ * This file defines a ground tool that checks the debug log's levels filter
+ * messages as they should, and measures what a filtered message costs.
+ */
+#include "ground.h"
+#include <chrono>
+#include <debug_log.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace Ground {
+using Helpers::LogLevel;
+
+namespace {
+/** @brief The number of calls timed for each cost. */
+const uint32_t     TIMED_CALLS    = 10000000;
+
+/**
+ * @brief The most a message filtered at runtime may cost, in nanoseconds.
+ *
+ * A load and a predicted branch take about a nanosecond on a host. Anything
+ * near this limit means the arguments are being written or evaluated.
+ */
+const double       FILTERED_LIMIT = 5;
+
+/** @brief The ring written by the checks. */
+Helpers::DebugRing ring;
+
+/**
+ * @brief Write a message of a level, as print_log() does.
+ *
+ * @tparam level The level of the message.
+ * @tparam floor The least important level built in.
+ * @param count A value written with the message.
+ */
+template <LogLevel level, LogLevel floor> void write(uint32_t count) {
+  if (Helpers::log_enabled<level, floor>(Helpers::TEST)) {
+    Helpers::write_debug_log(ring, count, Helpers::TEST, "count=", count);
+  }
+}
+
+/**
+ * @brief Count the messages in the ring, emptying it.
+ *
+ * @return uint32_t The number of messages.
+ */
+uint32_t drain() {
+  uint8_t  record[DEBUG_LOG_RING_SIZE];
+  uint32_t count = 0;
+  while (ring.read(record, sizeof(record)) > 0) {
+    count++;
+  }
+  return count;
+}
+
+/**
+ * @brief Check a message of each level is written only when it should be.
+ *
+ * @tparam floor The least important level built in.
+ * @return true Every level was filtered as it should be.
+ * @return false It was not.
+ */
+template <LogLevel floor> bool check_levels() {
+  bool ok = true;
+  for (uint8_t runtime = (uint8_t)LogLevel::Off;
+       runtime <= (uint8_t)LogLevel::Rapid; runtime++) {
+    Helpers::set_log_level(Helpers::TEST, (LogLevel)runtime);
+    write<LogLevel::Error, floor>(0);
+    write<LogLevel::Warning, floor>(0);
+    write<LogLevel::Info, floor>(0);
+    write<LogLevel::Debug, floor>(0);
+    write<LogLevel::Rapid, floor>(0);
+    const uint32_t expected =
+        runtime < (uint8_t)floor ? runtime : (uint8_t)floor;
+    const uint32_t written = drain();
+    printf("levels,%u,%u,%u,%u,%s\n", (uint8_t)floor, runtime, expected,
+           written, written == expected ? "ok" : "FAILED");
+    ok = ok && written == expected;
+  }
+  Helpers::set_log_level(0, LogLevel::Rapid);
+  return ok;
+}
+
+/**
+ * @brief Check a character array is copied, and a debug_literal is not.
+ *
+ * The array is changed after the message is written, as a buffer on the
+ * stack would be, and must be printed as it was.
+ *
+ * @return true The message was printed as written.
+ * @return false It was not.
+ */
+bool check_strings() {
+  char buffer[16] = "before";
+  Helpers::write_debug_log(ring, 0, Helpers::TEST, buffer,
+                           Helpers::debug_literal{",literal"});
+  strcpy(buffer, "after!");
+  uint8_t        record[DEBUG_LOG_RING_SIZE];
+  char           line[DEBUG_LOG_LINE_SIZE];
+  const uint16_t size = ring.read(record, sizeof(record));
+  const bool     ok =
+      size > 0 && Helpers::render_debug_log(record, size, line, sizeof(line)) &&
+      strstr(line, "before,literal") != nullptr;
+  printf("strings,%s\n", ok ? "ok" : "FAILED");
+  return ok;
+}
+
+/**
+ * @brief Time a message of a level.
+ *
+ * @tparam level The level of the message.
+ * @tparam floor The least important level built in.
+ * @return double The time of each message, in nanoseconds.
+ */
+template <LogLevel level, LogLevel floor> double time_calls() {
+  const auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < TIMED_CALLS; i++) {
+    write<level, floor>(i);
+    if ((i & 0xF) == 0) {
+      drain();
+    }
+  }
+  const auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         TIMED_CALLS;
+}
+
+/**
+ * @brief Time the loop of time_calls() without a message, to subtract it.
+ *
+ * @return double The time of each loop, in nanoseconds.
+ */
+double time_loop() {
+  const auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < TIMED_CALLS; i++) {
+    if ((i & 0xF) == 0) {
+      drain();
+    }
+  }
+  const auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         TIMED_CALLS;
+}
+} // namespace
+
+/**
+ * @brief Check the debug log's levels, and time filtered messages.
+ *
+ * The results are printed as CSV. The level checks give the floor, the
+ * runtime level and the number of levels expected and written. The timings
+ * give the nanoseconds of each message, less the loop around it.
+ *
+ * @param argc The number of arguments.
+ * @param argv No arguments are used.
+ * @return int 0 if every check passed, 1 otherwise.
+ */
+int log_check(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  bool ok = true;
+  printf("check,floor,runtime,expected,written,result\n");
+  ok = check_levels<LogLevel::Rapid>() && ok;
+  ok = check_levels<LogLevel::Info>() && ok;
+  ok = check_levels<LogLevel::Off>() && ok;
+
+  printf("check,result\n");
+  ok = check_strings() && ok;
+
+  printf("check,case,ns_per_message,result\n");
+  const double loop = time_loop();
+  const double removed = time_calls<LogLevel::Rapid, LogLevel::Info>() - loop;
+  Helpers::set_log_level(Helpers::TEST, LogLevel::Info);
+  const double filtered =
+      time_calls<LogLevel::Rapid, LogLevel::Rapid>() - loop;
+  Helpers::set_log_level(Helpers::TEST, LogLevel::Rapid);
+  const double written =
+      time_calls<LogLevel::Rapid, LogLevel::Rapid>() - loop;
+  printf("cost,below floor,%.2f,%s\n", removed,
+         removed < FILTERED_LIMIT ? "ok" : "FAILED");
+  printf("cost,below runtime level,%.2f,%s\n", filtered,
+         filtered < FILTERED_LIMIT ? "ok" : "FAILED");
+  printf("cost,written,%.2f,\n", written);
+  ok = ok && removed < FILTERED_LIMIT && filtered < FILTERED_LIMIT;
+  return ok ? 0 : 1;
+}
+} // namespace Ground
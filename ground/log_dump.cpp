@@ -0,0 +1,123 @@
+/**
+ * @file log_dump.cpp
+ * @brief The telemetry log dump tool.
+ *
+ * This file defines a ground tool that prints the records of a telemetry log
+ * copied from the satellite's SD card.
+ */
+#include "ground.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <telemetry_archive.h>
+#include <telemetry_log.h>
+
+namespace Ground {
+using Artemis::Storage::archive_header;
+using Artemis::Storage::FileBlockDevice;
+using Artemis::Storage::TelemetryLog;
+
+namespace {
+/**
+ * @brief Print a record, or a beacon from an archive block, as a line of CSV.
+ *
+ * @param timestamp The time of the record.
+ * @param type The type of the record.
+ * @param payload The payload of the record.
+ * @param length The length of the payload.
+ */
+void print_record(uint32_t timestamp, uint8_t type, const uint8_t *payload,
+                  int32_t length) {
+  printf("%u,%u,", (unsigned)timestamp, (unsigned)type);
+  for (int32_t i = 0; i < length; i++) {
+    printf("%02x", payload[i]);
+  }
+  printf("\n");
+}
+} // namespace
+
+/**
+ * @brief Read the records of a telemetry log within a time range.
+ *
+ * The log is opened read-only, so a damaged tail is reported but left in
+ * place. Archive blocks are decoded, and each of their beacons is passed on
+ * with the time of the block.
+ *
+ * @param tool The name of the tool, used in error messages.
+ * @param data_path The path of the log's data file.
+ * @param index_path The path of the log's index file.
+ * @param start The earliest record time, in seconds of log time.
+ * @param end The latest record time, in seconds of log time.
+ * @param handler The function called with each record.
+ * @return true The log has been read.
+ * @return false The log could not be opened.
+ */
+bool read_log(const char *tool, const char *data_path, const char *index_path,
+              uint32_t start, uint32_t end, const record_handler &handler) {
+  FileBlockDevice data;
+  FileBlockDevice index;
+  if (!data.open(data_path, false) || !index.open(index_path, false)) {
+    fprintf(stderr, "%s: failed to open log files\n", tool);
+    return false;
+  }
+  const uint32_t file_size = data.size();
+  TelemetryLog   log(&data, &index);
+  if (!log.open(false)) {
+    fprintf(stderr, "%s: failed to read log\n", tool);
+    return false;
+  }
+  if (log.stored_size() < file_size) {
+    fprintf(stderr, "%s: ignoring %u damaged bytes at end of log\n", tool,
+            (unsigned)(file_size - log.stored_size()));
+  }
+
+  uint32_t                    offset = log.find(start);
+  TelemetryLog::record_header header;
+  uint8_t                     payload[TELEMETRY_LOG_MAX_PAYLOAD];
+  int32_t                     length;
+  archive_header              archive;
+  uint8_t beacons[ARCHIVE_BLOCK_RECORDS * ARCHIVE_MAX_RECORD_SIZE];
+  while ((length = log.read(offset, header, payload, sizeof(payload))) >= 0) {
+    if (header.timestamp < start) {
+      continue;
+    }
+    if (header.timestamp > end) {
+      break;
+    }
+    if (!(header.type & TELEMETRY_LOG_TYPE_ARCHIVED)) {
+      handler(header.timestamp, header.type, payload, length);
+      continue;
+    }
+    const int32_t count = Artemis::Storage::decode_archive_block(
+        payload, length, archive, beacons, sizeof(beacons));
+    if (count < 0) {
+      fprintf(stderr, "%s: invalid archive block at %u\n", tool,
+              (unsigned)header.timestamp);
+      continue;
+    }
+    for (int32_t i = 0; i < count; i++) {
+      handler(header.timestamp, archive.type,
+              &beacons[i * archive.record_size], archive.record_size);
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Print the records of a telemetry log, optionally within a time range.
+ *
+ * @param argc The number of arguments.
+ * @param argv The data file, the index file, and optionally the start and end
+ * times in seconds of log time.
+ * @return int 0 on success, 1 on failure.
+ */
+int log_dump(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "log-dump: expected a data file and an index file\n");
+    return 1;
+  }
+  const uint32_t start = argc > 2 ? strtoul(argv[2], nullptr, 0) : 0;
+  const uint32_t end   = argc > 3 ? strtoul(argv[3], nullptr, 0) : UINT32_MAX;
+  return read_log("log-dump", argv[0], argv[1], start, end, print_record) ? 0
+                                                                          : 1;
+}
+} // namespace Ground
@@ -0,0 +1,99 @@
+/**
+ * @file log_query.cpp
+ * @brief The telemetry log query tool.
+ *
+ * This file defines a ground tool that builds a log query command and runs it
+ * against a telemetry log copied from the satellite's SD card, showing the
+ * page the satellite would return.
+ */
+#include "ground.h"
+#include <log_query.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace Ground {
+using Artemis::Storage::FileBlockDevice;
+using Artemis::Storage::log_page;
+using Artemis::Storage::log_query;
+using Artemis::Storage::LogQuery;
+using Artemis::Storage::TelemetryLog;
+
+/**
+ * @brief Build a log query command and run one page of it against a log.
+ *
+ * The command's data bytes are printed first, ready to be uplinked. The
+ * records of the page follow, then the page reply with the resume token.
+ *
+ * @param argc The number of arguments.
+ * @param argv The data file, the index file, the start and end times, and
+ * optionally the type mask, decimation, page size, resume offset and resume
+ * phase.
+ * @return int 0 on success, 1 on failure.
+ */
+int log_query_tool(int argc, char **argv) {
+  if (argc < 4) {
+    fprintf(stderr, "log-query: expected a data file, an index file, a start "
+                    "time and an end time\n");
+    return 1;
+  }
+  log_query query;
+  query.start = strtoul(argv[2], nullptr, 0);
+  query.end   = strtoul(argv[3], nullptr, 0);
+  if (argc > 4) {
+    query.type_mask = strtoul(argv[4], nullptr, 0);
+  }
+  if (argc > 5) {
+    query.decimation = strtoul(argv[5], nullptr, 0);
+  }
+  if (argc > 6) {
+    query.page_size = strtoul(argv[6], nullptr, 0);
+  }
+  if (argc > 7) {
+    query.resume_offset = strtoul(argv[7], nullptr, 0);
+  }
+  if (argc > 8) {
+    query.resume_phase = strtoul(argv[8], nullptr, 0);
+  }
+
+  printf("command: ");
+  for (size_t i = 0; i < sizeof(query); i++) {
+    printf("%02x", ((const uint8_t *)&query)[i]);
+  }
+  printf("\n");
+
+  FileBlockDevice data;
+  FileBlockDevice index;
+  if (!data.open(argv[0], false) || !index.open(argv[1], false)) {
+    fprintf(stderr, "log-query: failed to open log files\n");
+    return 1;
+  }
+  TelemetryLog log(&data, &index);
+  if (!log.open(false)) {
+    fprintf(stderr, "log-query: failed to read log\n");
+    return 1;
+  }
+
+  LogQuery                    run(&log);
+  TelemetryLog::record_header header;
+  const uint8_t              *payload;
+  int32_t                     status;
+  run.begin(query);
+  while ((status = run.next(header, payload)) >= 0) {
+    if (status == 0) {
+      run.fill();
+      continue;
+    }
+    printf("%u,%u,", (unsigned)header.timestamp, (unsigned)header.type);
+    for (uint16_t i = 0; i < header.length; i++) {
+      printf("%02x", payload[i]);
+    }
+    printf("\n");
+  }
+
+  const log_page page = run.page();
+  printf("page: status=%u count=%u resume_offset=%u resume_phase=%u\n",
+         (unsigned)page.status, (unsigned)page.count,
+         (unsigned)page.resume_offset, (unsigned)page.resume_phase);
+  return 0;
+}
+} // namespace Ground
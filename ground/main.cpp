@@ -0,0 +1,65 @@
+/**
+ * @file main.cpp
+ * @brief The entry point of the ground tools.
+ *
+ * The ground tools are built for the host with `pio run -e ground`. Each tool
+ * is selected by the first argument, for example:
+ * @verbatim
+.pio/build/ground/program log-dump TLM.LOG TLM.IDX
+@endverbatim
+ */
+#include "ground.h"
+#include <stdio.h>
+#include <string.h>
+
+namespace {
+/** @brief The structure of a ground tool. */
+struct tool {
+  /** @brief The name used to select the tool. */
+  const char *name;
+  /** @brief The arguments taken by the tool. */
+  const char *usage;
+  /** @brief The function that runs the tool. */
+  int (*run)(int argc, char **argv);
+};
+
+/** @brief The available ground tools. */
+const tool tools[] = {
+    {"log-dump", "<data file> <index file> [start time] [end time]",
+     Ground::log_dump},
+    {"log-query",
+     "<data file> <index file> <start time> <end time> [type mask] "
+     "[decimation] [page size] [resume offset] [resume phase]",
+     Ground::log_query_tool},
+    {"archive-bench", "[duration] [interval]", Ground::archive_bench},
+    {"beacon-schema", "", Ground::beacon_schema},
+    {"beacon-decode",
+     "<data file> <index file> <beacon name> [start time] [end time]",
+     Ground::beacon_decode},
+    {"compact-check", "", Ground::compact_check},
+    {"log-check", "", Ground::log_check},
+    {"firmware-check", "", Ground::firmware_check},
+};
+} // namespace
+
+/**
+ * @brief Run the ground tool named by the first argument.
+ *
+ * @param argc The number of arguments.
+ * @param argv The arguments.
+ * @return int The exit status of the tool, or 1 if no tool was selected.
+ */
+int main(int argc, char **argv) {
+  if (argc >= 2) {
+    for (const tool &t : tools) {
+      if (strcmp(argv[1], t.name) == 0) {
+        return t.run(argc - 2, argv + 2);
+      }
+    }
+  }
+  fprintf(stderr, "usage:\n");
+  for (const tool &t : tools) {
+    fprintf(stderr, "  %s %s %s\n", argv[0], t.name, t.usage);
+  }
+  return 1;
+}
@@ -2,8 +2,9 @@
  * @file artemis_devices.h
  * @brief The declarations of the Artemis devices on the satellite.
  *
- * This file contains declarations of Artemis device classes and definitions of
- * beacons used by those devices.
+ * This file contains declarations of Artemis device classes and the beacons
+ * used by those devices. The beacons themselves are generated from the beacon
+ * schema.
  */
 #ifndef _ARTEMIS_DEVICES_H
 #define _ARTEMIS_DEVICES_H
@@ -12,6 +13,7 @@
 #include "config/artemis_defs.h"
 #include "helpers.h"
 #include "pdu.h"
+#include "telemetry_points.h"
 #include <Adafruit_GPS.h>
 #include <Adafruit_INA219.h>
 #include <Adafruit_LIS3MDL.h>
@@ -24,31 +26,31 @@
 namespace Artemis {
 /** @brief The devices and sensors in the satellite. */
 namespace Devices {
+  /**
+   * @brief Copy a beacon into a packet's data.
+   *
+   * With COMPACT_BEACONS, the compact form of the beacon is copied instead,
+   * for the beacons that have one.
+   *
+   * @param packet The packet that will carry the beacon.
+   * @param beacon The beacon.
+   */
+  template <typename T>
+  void set_beacon_data(PacketComm &packet, const T &beacon) {
+#ifdef COMPACT_BEACONS
+    const auto data = Beacons::compact(beacon);
+#else
+    const T &data = beacon;
+#endif
+    packet.data.resize(sizeof(data));
+    memcpy(packet.data.data(), &data, sizeof(data));
+  }
+
   /** @brief The satellite's magnetometer. */
   class Magnetometer {
   public:
-    /** @brief The structure of a magnetometer beacon. */
-    struct __attribute__((packed)) magbeacon {
-      /** @brief The type of beacon. */
-      BeaconType type = BeaconType::MagnetometerBeacon;
-      /** @brief A decimal identifier for the beacon. */
-      uint32_t   deci = 0;
-      /** @brief The magnetometer reading for the x axis. */
-      float      magx = 0;
-      /** @brief The magnetometer reading for the y axis. */
-      float      magy = 0;
-      /** @brief The magnetometer reading for the z axis. */
-      float      magz = 0;
-    };
-    /**<  A diagram of the struct is included below.
-     *
-     * @verbatim
-1 byte   4 bytes  4 bytes  4 bytes  4 bytes
-+--------+--------+--------+--------+--------+
-|  type  |  deci  |  magx  |  magy  |  magz  |
-+--------+--------+--------+--------+--------+
-       @endverbatim
-    */
+    /** @brief The magnetometer beacon, defined in beacon_schema.h. */
+    using magbeacon = Beacons::magbeacon;
 
     /**
      * @brief The core sensor object.
@@ -60,6 +62,7 @@ namespace Devices {
     Adafruit_LIS3MDL *magnetometer = new Adafruit_LIS3MDL();
 
     bool              setup(void);
+    bool              sample(uint32_t uptime);
     bool              read(uint32_t uptime);
 
   private:
@@ -70,40 +73,8 @@ namespace Devices {
   /** @brief The satellite's Inertial Measurement Unit (IMU). */
   class IMU {
   public:
-    /** @brief The structure of an IMU beacon. */
-    struct __attribute__((packed)) imubeacon {
-      /** @brief The type of beacon. */
-      BeaconType type    = BeaconType::IMUBeacon;
-      /** @brief A decimal identifier for the beacon. */
-      uint32_t   deci    = 0;
-      /** @brief The accelerometer reading for the x axis. */
-      float      accelx  = 0;
-      /** @brief The accelerometer reading for the y axis. */
-      float      accely  = 0;
-      /** @brief The accelerometer reading for the z axis. */
-      float      accelz  = 0;
-      /** @brief The gyroscope reading for the x axis. */
-      float      gyrox   = 0;
-      /** @brief The gyroscope reading for the x axis. */
-      float      gyroy   = 0;
-      /** @brief The gyroscope reading for the y axis. */
-      float      gyroz   = 0;
-      /** @brief The temperature, in Celsius, of the IMU. */
-      float      imutemp = 0;
-    };
-    /**<  A diagram of the struct is included below.
-     *
-     * @verbatim
-1 byte   4 bytes  4 bytes    4 bytes    4 bytes    4 bytes   4 bytes
-+--------+--------+----------+----------+----------+---------+---------+
-|  type  |  deci  |  accelx  |  accely  | accelz   |  gyrox  |  gyroy  |
-+--------+--------+----------+----------+----------+---------+---------+
-4 bytes   4 bytes
-+--------+---------+
-| gyroz  | imutemp |
-+--------+---------+
-       @endverbatim
-     */
+    /** @brief The IMU beacon, defined in beacon_schema.h. */
+    using imubeacon = Beacons::imubeacon;
 
     /**
      * @brief The core sensor object.
@@ -115,6 +86,7 @@ namespace Devices {
     Adafruit_LSM6DSOX *imu = new Adafruit_LSM6DSOX();
 
     bool               setup(void);
+    bool               sample(uint32_t uptime);
     bool               read(uint32_t uptime);
 
   private:
@@ -125,51 +97,11 @@ namespace Devices {
   /** @brief The current sensors on the satellite. */
   class CurrentSensors {
   public:
-    /** @brief The first current beacon structure. */
-    struct __attribute__((packed)) currentbeacon1 {
-      /** @brief The type of the beacon. */
-      BeaconType type = BeaconType::CurrentBeacon1;
-      /** @brief A decimal identifier for the beacon. */
-      uint32_t   deci = 0;
-      /** @brief The voltage data. */
-      float      busvoltage[ARTEMIS_CURRENT_BEACON_1_COUNT];
-      /** @brief The current data. */
-      float      current[ARTEMIS_CURRENT_BEACON_1_COUNT];
-    };
-    /**<  A diagram of the struct is included below.
-     *
-     * @verbatim
-1 byte 4 bytes 4*X bytes      4*X bytes
-+------+-------+--------------+-----------+
-| type | deci  | busvoltage[] | current[] |
-+------+-------+--------------+-----------+
-(Note: X = ARTEMIS_CURRENT_BEACON_1_COUNT)
-      @endverbatim
-    */
+    /** @brief The first current beacon, defined in beacon_schema.h. */
+    using currentbeacon1 = Beacons::currentbeacon1;
 
-    /** @brief The second current beacon structure. */
-    struct __attribute__((packed)) currentbeacon2 {
-      /** @brief The type of the beacon. */
-      BeaconType type = BeaconType::CurrentBeacon2;
-      /** @brief A decimal identifier for the beacon. */
-      uint32_t   deci = 0;
-      /** @brief The voltage data. */
-      float      busvoltage[ARTEMIS_CURRENT_SENSOR_COUNT -
-                       ARTEMIS_CURRENT_BEACON_1_COUNT];
-      /** @brief The current data. */
-      float      current[ARTEMIS_CURRENT_SENSOR_COUNT -
-                    ARTEMIS_CURRENT_BEACON_1_COUNT];
-    };
-    /**<  A diagram of the struct is included below.
-     *
-     * @verbatim
-1 byte 4 bytes 4*X bytes      4*X bytes
-+------+-------+--------------+-----------+
-| type | deci  | busvoltage[] | current[] |
-+------+-------+--------------+-----------+
-(Note: X = ARTEMIS_CURRENT_SENSOR_COUNT - ARTEMIS_CURRENT_BEACON_1_COUNT)
-@endverbatim
-     */
+    /** @brief The second current beacon, defined in beacon_schema.h. */
+    using currentbeacon2 = Beacons::currentbeacon2;
 
     /**
      * @brief Instantiation and mapping of core sensor objects.
@@ -188,6 +120,7 @@ namespace Devices {
     };
 
     bool setup(void);
+    void sample(uint32_t uptime);
     void read(uint32_t uptime);
 
   private:
@@ -202,27 +135,8 @@ namespace Devices {
   /** @brief The temperature sensors on the satellite. */
   class TemperatureSensors {
   public:
-    /** @brief The temperature beacon structure. */
-    struct __attribute__((packed)) temperaturebeacon {
-      /** @brief The type of the beacon. */
-      BeaconType type = BeaconType::TemperatureBeacon;
-      /** @brief A decimal identifier for the beacon. */
-      uint32_t   deci = 0;
-      /** @brief The temperature data for each TMP36 sensor. */
-      float      tmp36_tempC[ARTEMIS_TEMP_SENSOR_COUNT];
-      /** @brief The temperature of the Teensy's processor. */
-      float      teensy_tempC;
-    };
-    /**<  A diagram of the struct is included below.
-     *
-     * @verbatim
-1 byte  4 bytes 4*X bytes              4 bytes
-+-------+-------+----------------------+---------------------+
-| type  | deci  | tmp36_temperatureC[] | teensy_temperatureC |
-+-------+-------+----------------------+---------------------+
-(Note: X = ARTEMIS_TEMP_SENSOR_COUNT)
-    @endverbatim
-    */
+    /** @brief The temperature beacon, defined in beacon_schema.h. */
+    using temperaturebeacon = Beacons::temperaturebeacon;
 
     /** @brief Mapping of temperature sensor names and analog pins. */
     std::map<std::string, int> temp_sensors = {
@@ -236,40 +150,15 @@ namespace Devices {
     };
 
     void setup(void);
+    void sample(uint32_t uptime);
     void read(uint32_t uptime);
   };
 
   /** @brief The satellite's Global Positioning System (GPS). */
   class GPS {
   public:
-    /** @brief The GPS beacon structure. */
-    struct __attribute__((packed)) gpsbeacon {
-      /** @brief The type of the beacon. */
-      BeaconType type       = BeaconType::GPSBeacon;
-      /** @brief A decimal identifier for the beacon. */
-      uint32_t   deci       = 0;
-      /** @brief The latitude reading in decimal degrees. */
-      float      latitude   = 0;
-      /** @brief The longitude reading in decimal degrees. */
-      float      longitude  = 0;
-      /** @brief The ground speed reading, in knots. */
-      float      speed      = 0;
-      /** @brief The course from true north in degrees. */
-      float      angle      = 0;
-      /** @brief The altitude reading in meters above Mean Sea Level. */
-      float      altitude   = 0;
-      /** @brief The number of satellites in use. */
-      uint8_t    satellites = 0;
-    };
-    /**<  A diagram of the struct is included below.
-     *
-     * @verbatim
-1 byte 4 bytes 4 bytes    4 bytes     4 bytes 4 bytes 4 bytes    1 byte
-+------+-------+----------+-----------+-------+-------+----------+------------+
-| type | deci  | latitude | longitude | speed | angle | altitude | satellites |
-+------+-------+----------+-----------+-------+-------+----------+------------+
-    @endverbatim
-    */
+    /** @brief The GPS beacon, defined in beacon_schema.h. */
+    using gpsbeacon = Beacons::gpsbeacon;
 
     /**
      * @brief The core sensor object.
@@ -281,6 +170,7 @@ namespace Devices {
 
     bool          setup(void);
     void          update(void);
+    void          sample(uint32_t uptime);
     void          read(uint32_t uptime);
 
   private:
@@ -291,27 +181,10 @@ namespace Devices {
   /** @brief The switches on the PDU of the satellite. */
   class Switches {
   public:
-    /**
-     * @brief The PDU switches beacon structure.
-     */
-    struct __attribute__((packed)) switchbeacon {
-      /** @brief The type of the beacon. */
-      BeaconType type = BeaconType::SwitchBeacon;
-      /** @brief A decimal identifier for the beacon. */
-      uint32_t   deci = 0;
-      /** @brief The switch states.*/
-      uint8_t    sw[NUMBER_OF_SWITCHES + 1];
-    };
-    /**<  A diagram of the struct is included below.
-*
-* @verbatim
-1 byte  4 bytes 4*X bytes
-+-------+-------+------+
-| type  | deci  | sw[] |
-+-------+-------+------+
-(Note: X = NUMBER_OF_SWITCHES + 1)
-@endverbatim
-*/
+    /** @brief The PDU switches beacon, defined in beacon_schema.h. */
+    using switchbeacon = Beacons::switchbeacon;
+    static_assert(ARTEMIS_SWITCH_BEACON_COUNT == NUMBER_OF_SWITCHES + 1,
+                  "The switch beacon must hold every switch and the RPi");
   };
 } // namespace Devices
 } // namespace Artemis
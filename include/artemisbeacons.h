@@ -2,28 +2,14 @@
  * @file artemisbeacons.h
  * @brief Definition of Artemis beacon types.
  *
- * This file defines the types of beacons used throughout the satellite.
+ * This file defines the types of beacons used throughout the satellite. The
+ * types are generated, with the beacons, from the beacon schema.
  */
 #ifndef _ARTEMIS_BEACONS_H
 #define _ARTEMIS_BEACONS_H
 
 #include "config/artemis_defs.h"
+#include <beacon_schema.h>
 #include <cstdint>
 
-namespace Artemis {
-  namespace Devices {
-    /** @brief Enumeration of beacon types. */
-    enum class BeaconType : uint8_t {
-      None,
-      TemperatureBeacon,
-      CurrentBeacon1,
-      CurrentBeacon2,
-      IMUBeacon,
-      MagnetometerBeacon,
-      GPSBeacon,
-      SwitchBeacon,
-    };
-  } // namespace Devices
-} // namespace Artemis
-
 #endif // _ARTEMIS_BEACONS_H
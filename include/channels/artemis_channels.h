@@ -9,6 +9,8 @@
 #define _ARTEMIS_CHANNELS_H
 
 #include "config/artemis_defs.h"
+#include <firmware_stage.h>
+#include <telemetry_log.h>
 
 namespace Artemis {
 /**
@@ -24,6 +26,8 @@ namespace Channels {
     PDU_CHANNEL,
     RPI_CHANNEL,
     TEST_CHANNEL,
+    STORAGE_CHANNEL,
+    DEBUG_LOG_CHANNEL,
   };
 
   namespace RFM23 {
@@ -32,6 +36,8 @@ namespace Channels {
     void loop();
     void handle_queue();
     void receive_from_radio();
+    void update_tx_power();
+    void set_frequency(uint16_t frequency);
   } // namespace RFM23
 
   namespace PDU {
@@ -75,6 +81,38 @@ namespace Channels {
     void report_queue_size();
   } // namespace TEST
 
+  namespace STORAGE {
+    void storage_channel();
+    void setup();
+    void loop();
+    void handle_queue();
+    void start_log_query();
+    void stream_log_query();
+    void send_log_record(const Storage::TelemetryLog::record_header &header,
+                         const uint8_t                              *payload);
+    void send_log_fragment();
+    void send_log_page();
+    void handle_firmware();
+    void complete_firmware_command(Storage::StageResult result);
+    void report_firmware_status(uint8_t node, uint16_t window_start);
+    void update_firmware();
+#if !defined(__IMXRT1062__)
+    void install_firmware();
+#endif
+    void flush_log();
+    void store_beacon(PacketComm &packet);
+#ifdef TELEMETRY_ARCHIVE
+    void store_archive_block();
+#endif
+#ifdef PACKET_TRACE
+    void open_packet_trace();
+    void write_packet_trace();
+#endif
+    uint64_t log_time_ms();
+    bool     set_log_time(uint32_t seconds);
+    bool     log_time_synced();
+  } // namespace STORAGE
+
 } // namespace Channels
 } // namespace Artemis
 
@@ -8,16 +8,12 @@
 #define _ARTEMIS_DEFS_H
 
 #include <TeensyThreads.h>
+#include <command_ack.h>
+#include <helpers.h>
+#include <parameter_table.h>
 #include <support/configCosmosKernel.h>
 #include <support/packetcomm.h>
 
-/** The number of current sensor readings in the first current beacon. */
-#define ARTEMIS_CURRENT_BEACON_1_COUNT 2
-/** @brief The number of current sensors in the satellite. */
-#define ARTEMIS_CURRENT_SENSOR_COUNT   5
-
-/** @brief The number of temperature sensors in the satellite. */
-#define ARTEMIS_TEMP_SENSOR_COUNT      7
 /**
  * @brief The conversion factor between temperature and voltage.
  *
@@ -41,11 +37,131 @@ const float OFFSET_F         = 58.0;
  */
 const float MV_PER_ADC_UNIT  = 3300.0 / 1024.0;
 
-/** @brief The activation temperature, in Celsius, of the heater. */
-const float heater_threshold = -10.0;
+/**
+ * @brief The stack size, in bytes, of the RFM23 channel.
+ *
+ * The high-water mark of every channel's stack is sent in the stack beacon,
+ * so the stack sizes can be lowered to what the channels are seen to use,
+ * with some margin.
+ */
+#define RFM23_STACK_SIZE              4096
+/** @brief The stack size, in bytes, of the PDU channel. */
+#define PDU_STACK_SIZE                8192
+/** @brief The stack size, in bytes, of the Raspberry Pi channel. */
+#define RPI_STACK_SIZE                4096
+/** @brief The stack size, in bytes, of the storage channel. */
+#define STORAGE_STACK_SIZE            4096
+/** @brief The stack size, in bytes, of the test channel. */
+#define TEST_STACK_SIZE               4096
+/** @brief The stack size, in bytes, of the debug log channel. */
+#define DEBUG_LOG_STACK_SIZE          2048
+/** @brief The stack size, in bytes, of the clock governor's idle thread. */
+#define IDLE_STACK_SIZE               1024
+/**
+ * @brief The time slice, in milliseconds, of the RFM23 channel.
+ *
+ * The threads take turns in a fixed order, and each runs until it sleeps,
+ * yields or uses up its slice. A channel's priority is how long a slice it is
+ * given: a channel that becomes ready waits at most the sum of the other
+ * threads' slices for its turn, so the low priority channels are given short
+ * slices to bound that wait for the radio and the PDU.
+ */
+#define RFM23_TIME_SLICE              10
+/** @brief The time slice, in milliseconds, of the PDU channel. */
+#define PDU_TIME_SLICE                10
+/** @brief The time slice, in milliseconds, of the main thread. */
+#define MAIN_TIME_SLICE               5
+/** @brief The time slice, in milliseconds, of the Raspberry Pi channel. */
+#define RPI_TIME_SLICE                5
+/** @brief The time slice, in milliseconds, of the storage channel. */
+#define STORAGE_TIME_SLICE            5
+/** @brief The time slice, in milliseconds, of the test channel. */
+#define TEST_TIME_SLICE               2
+/** @brief The time slice, in milliseconds, of the debug log channel. */
+#define DEBUG_LOG_TIME_SLICE          1
+/**
+ * @brief The time slice, in milliseconds, of the clock governor's idle
+ * thread, which yields at every turn.
+ */
+#define IDLE_TIME_SLICE               1
+/**
+ * @brief The longest time, in milliseconds, the RFM23 channel may go without
+ * a heartbeat before it is restarted.
+ *
+ * Each deadline must be longer than the longest pass of the channel's loop,
+ * and than its setup up to the first heartbeat.
+ */
+#define RFM23_HEARTBEAT_DEADLINE      (30 * SECONDS)
+/** @brief The heartbeat deadline, in milliseconds, of the PDU channel. */
+#define PDU_HEARTBEAT_DEADLINE        (60 * SECONDS)
+/** @brief The heartbeat deadline, in milliseconds, of the RPi channel. */
+#define RPI_HEARTBEAT_DEADLINE        (60 * SECONDS)
+/** @brief The heartbeat deadline, in milliseconds, of the storage channel. */
+#define STORAGE_HEARTBEAT_DEADLINE    (60 * SECONDS)
+/** @brief The heartbeat deadline, in milliseconds, of the test channel. */
+#define TEST_HEARTBEAT_DEADLINE       (60 * SECONDS)
+/** @brief The heartbeat deadline, in milliseconds, of the debug log channel. */
+#define DEBUG_LOG_HEARTBEAT_DEADLINE  (30 * SECONDS)
+/** @brief The time, in milliseconds, between tries to start the RFM23. */
+#define RFM23_INIT_RETRY_INTERVAL     (1 * SECONDS)
+/**
+ * @brief The time, in milliseconds, the ground has to confirm a radio
+ * frequency being tried before the radio goes back to its previous one.
+ */
+#define RADIO_TRIAL_TIMEOUT           (600 * SECONDS)
+/** @brief The interval at which thread stacks are scanned. */
+#define STACK_SCAN_INTERVAL           (10 * SECONDS)
+/**
+ * @brief The interval at which a device is sampled while a command sequence
+ * waits on one of its telemetry points.
+ */
+#define SEQUENCE_SAMPLE_INTERVAL      (1 * SECONDS)
+
+/** @brief The path of the telemetry log's records on the SD card. */
+#define TELEMETRY_LOG_DATA_PATH       "/telemetry.log"
+/** @brief The path of the telemetry log's time index on the SD card. */
+#define TELEMETRY_LOG_INDEX_PATH      "/telemetry.idx"
+/** @brief The interval at which full sectors of telemetry are written out. */
+#define TELEMETRY_LOG_FLUSH_INTERVAL  (1 * SECONDS)
+/**
+ * @brief The longest time telemetry may wait in RAM before being written out.
+ *
+ * This bounds the telemetry lost on a reset when little telemetry is being
+ * produced and sectors fill slowly.
+ */
+#define TELEMETRY_LOG_MAX_BUFFER_TIME (300 * SECONDS)
+/**
+ * @brief The largest data, in bytes, sent in a log record packet.
+ *
+ * Larger records, such as archive blocks, are sent as several log fragment
+ * packets.
+ */
+#define TELEMETRY_LOG_RECORD_DATA     40
+
+#define PACKET_TRACE_PATH             "/trace.bin"
+#define PACKET_TRACE_FLUSH_INTERVAL   (1 * SECONDS)
 
-/** @brief The maximum number of packets that a queue can hold. */
-#define MAXQUEUESIZE 8
+/** @brief The address of the beacon plan in the Teensy's EEPROM. */
+#define BEACON_PLAN_EEPROM_ADDRESS    0
+/** @brief The address of the parameter table in the Teensy's EEPROM. */
+#define PARAMETER_EEPROM_ADDRESS      128
+/** @brief The path of the command schedule on the SD card. */
+#define COMMAND_SCHEDULE_PATH         "/schedule.bin"
+/** @brief The path of the command sequences on the SD card. */
+#define COMMAND_SEQUENCE_PATH         "/sequences.bin"
+/** @brief The path of the firmware staging area on the SD card. */
+#define FIRMWARE_STAGE_PATH           "/firmware.bin"
+/**
+ * @brief The path on the SD card that a firmware image is installed to, on
+ * builds other than the Teensy's.
+ */
+#define FIRMWARE_INSTALL_PATH         "/installed.bin"
+/**
+ * @brief The time, in milliseconds, from when a firmware image is activated,
+ * or from startup, to when it is installed, on builds other than the Teensy's.
+ * This gives the time to send the acknowledgment of the activation.
+ */
+#define FIRMWARE_INSTALL_DELAY        (10 * SECONDS)
 
 /** @brief Enumeration of Node ID. */
 enum class NODES : uint8_t {
@@ -54,6 +170,95 @@ enum class NODES : uint8_t {
   RPI_NODE_ID    = 3,
 };
 
+/**
+ * @brief Packet types specific to the Artemis flight software.
+ *
+ * These extend PacketComm::TypeId with values that micro-cosmos does not
+ * assign. Commands are numbered from 0xA00 and data from 0xA0.
+ */
+namespace ArtemisTypeId {
+/** @brief Request a page of records from the telemetry log. */
+constexpr PacketComm::TypeId CommandLogQuery   = (PacketComm::TypeId)0xA00;
+/** @brief Change or report an entry of the beacon plan. */
+constexpr PacketComm::TypeId CommandBeaconPlan = (PacketComm::TypeId)0xA01;
+/**
+ * @brief Change or report the runtime log levels.
+ *
+ * The data is a channel's Short_Name, or 0 for every channel, and a LogLevel.
+ * Without data, the levels are only reported.
+ */
+constexpr PacketComm::TypeId CommandLogLevel   = (PacketComm::TypeId)0xA02;
+/**
+ * @brief Report, reset or print the profiler's times.
+ *
+ * The data is a Helpers::ProfileAction. Without data, the times are reported.
+ */
+constexpr PacketComm::TypeId CommandProfile    = (PacketComm::TypeId)0xA03;
+/**
+ * @brief Add, delete or report time-tagged commands.
+ *
+ * The data is an Artemis::Commands::ScheduleAction, followed by the commands
+ * to add or the ids to delete.
+ */
+constexpr PacketComm::TypeId CommandSchedule   = (PacketComm::TypeId)0xA04;
+/**
+ * @brief Report or move forward the log time.
+ *
+ * The data is the new log time, in seconds, which must not be before the
+ * current one. Without data, the log time is only reported. Scheduled
+ * commands are held after a reset until the log time has been set.
+ */
+constexpr PacketComm::TypeId CommandLogTime    = (PacketComm::TypeId)0xA05;
+/**
+ * @brief Upload, start, stop or report command sequences.
+ *
+ * The data is an Artemis::Commands::SequenceAction, followed by its operands.
+ */
+constexpr PacketComm::TypeId CommandSequence   = (PacketComm::TypeId)0xA06;
+/**
+ * @brief Report, change or save the parameter table.
+ *
+ * The data is an Artemis::Parameters::ParameterAction, followed by its
+ * operands.
+ */
+constexpr PacketComm::TypeId CommandParameter  = (PacketComm::TypeId)0xA07;
+/**
+ * @brief Upload, check or install a new flight software image.
+ *
+ * The data is an Artemis::Storage::FirmwareAction, followed by its operands.
+ */
+constexpr PacketComm::TypeId CommandFirmware   = (PacketComm::TypeId)0xA08;
+/** @brief A record from the telemetry log. */
+constexpr PacketComm::TypeId DataLogRecord     = (PacketComm::TypeId)0xA0;
+/** @brief The end of a page of records from the telemetry log. */
+constexpr PacketComm::TypeId DataLogPage       = (PacketComm::TypeId)0xA1;
+/** @brief Part of a telemetry log record too large for one packet. */
+constexpr PacketComm::TypeId DataLogFragment   = (PacketComm::TypeId)0xA2;
+/** @brief An entry of the beacon plan. */
+constexpr PacketComm::TypeId DataBeaconPlan    = (PacketComm::TypeId)0xA3;
+/** @brief The runtime log level of each channel, indexed by Short_Name. */
+constexpr PacketComm::TypeId DataLogLevels     = (PacketComm::TypeId)0xA4;
+/** @brief The times of a profiled zone, a Helpers::profile_report. */
+constexpr PacketComm::TypeId DataProfile       = (PacketComm::TypeId)0xA5;
+/**
+ * @brief The number of commands in the command schedule, followed by a
+ * command in it, if any.
+ */
+constexpr PacketComm::TypeId DataSchedule      = (PacketComm::TypeId)0xA6;
+/** @brief The log time, in milliseconds, as a 64-bit count. */
+constexpr PacketComm::TypeId DataLogTime       = (PacketComm::TypeId)0xA7;
+/** @brief The state of the sequence engine, a Commands::sequence_status. */
+constexpr PacketComm::TypeId DataSequence      = (PacketComm::TypeId)0xA8;
+/** @brief Up to ACK_FRAME_RECORDS Commands::command_acks. */
+constexpr PacketComm::TypeId DataCommandAck    = (PacketComm::TypeId)0xA9;
+/** @brief The commands that executed with Ok, a Commands::ack_bitmap. */
+constexpr PacketComm::TypeId DataAckBitmap     = (PacketComm::TypeId)0xAA;
+/** @brief Up to eight Parameters::parameter_entry values. */
+constexpr PacketComm::TypeId DataParameter     = (PacketComm::TypeId)0xAB;
+/** @brief The state of a firmware upload, a Storage::firmware_status. */
+constexpr PacketComm::TypeId DataFirmware      = (PacketComm::TypeId)0xAC;
+} // namespace ArtemisTypeId
+
 /**
  * @brief The structure of a thread.
  *
@@ -119,26 +324,37 @@ extern std::deque<PacketComm>       main_queue;
 extern std::deque<PacketComm>       rfm23_queue;
 extern std::deque<PacketComm>       pdu_queue;
 extern std::deque<PacketComm>       rpi_queue;
+extern std::deque<PacketComm>       storage_queue;
 
-extern Threads::Mutex               main_queue_mtx;
-extern Threads::Mutex               rfm23_queue_mtx;
-extern Threads::Mutex               pdu_queue_mtx;
-extern Threads::Mutex               rpi_queue_mtx;
+extern Helpers::RecoverableMutex    main_queue_mtx;
+extern Helpers::RecoverableMutex    rfm23_queue_mtx;
+extern Helpers::RecoverableMutex    pdu_queue_mtx;
+extern Helpers::RecoverableMutex    rpi_queue_mtx;
+extern Helpers::RecoverableMutex    storage_queue_mtx;
 
-extern Threads::Mutex               spi1_mtx;
-extern Threads::Mutex               i2c1_mtx;
+extern Helpers::RecoverableMutex    spi1_mtx;
+extern Helpers::RecoverableMutex    i2c1_mtx;
+extern Helpers::RecoverableMutex    sd_mtx;
 
 extern bool                         deploymentmode;
+extern bool                         sdcardready;
 
 bool                                kill_thread(uint8_t channel_id);
 void PushQueue(PacketComm &packet, std::deque<PacketComm> &queue,
-               Threads::Mutex &mtx);
+               Helpers::RecoverableMutex &mtx);
 bool PullQueue(PacketComm &packet, std::deque<PacketComm> &queue,
-               Threads::Mutex &mtx);
+               Helpers::RecoverableMutex &mtx);
 
 void route_packet_to_main(PacketComm packet);
 void route_packet_to_rfm23(PacketComm packet);
 void route_packet_to_pdu(PacketComm packet);
 void route_packet_to_rpi(PacketComm packet);
+void route_packet_to_storage(PacketComm packet);
+
+void report_ack(const Artemis::Commands::command_ack &ack);
+void accept_command(const Artemis::Commands::command_ack &ack);
+void complete_command(const PacketComm            &command,
+                      Artemis::Commands::AckResult result);
+void send_acks();
 
 #endif // _ARTEMIS_DEFS_H
@@ -0,0 +1,79 @@
+/**
+ * @file main_channel.h
+ * @brief Declarations for the main channel.
+ *
+ * This file contains the declarations shared by the parts of the main channel.
+ * main.cpp sets up the Teensy and routes packets, and the files in src/main/
+ * supervise the other channels, run the command schedule and sequences, and
+ * keep the parameter table.
+ */
+#ifndef _MAIN_CHANNEL_H
+#define _MAIN_CHANNEL_H
+
+#include "artemis_devices.h"
+#include "channels/artemis_channels.h"
+#include <heap_track.h>
+#include <telemetry_points.h>
+
+// For setting Teensy Clock Frequency (only for Teensy 4.0 and 4.1)
+#if defined(__IMXRT1062__)
+extern "C" uint32_t set_arm_clock(uint32_t frequency);
+#endif
+
+/** @brief The packet the main channel is routing. */
+extern PacketComm    packet;
+/** @brief The time in milliseconds since the Teensy was started. */
+extern elapsedMillis uptime;
+
+// main.cpp
+void sample_source(Artemis::Telemetry::Source source);
+void reject_command(Artemis::Commands::AckResult result);
+void fail_command(Artemis::Commands::AckResult result);
+
+// supervision.cpp
+void setup_threads();
+int  launch_channel(uint8_t channel_id);
+void supervise_channels();
+void stop_channel(uint8_t channel_id);
+void monitor_stacks();
+void govern_clock();
+void send_stack_beacon();
+void send_cpu_beacon();
+void send_restart_beacon();
+
+// scheduling.cpp
+void load_command_schedule();
+void run_command_schedule();
+void handle_schedule();
+void load_sequences();
+void run_sequence();
+void observe_sequence(uint16_t type);
+void handle_sequence();
+
+// parameters.cpp
+void load_parameters();
+void check_radio_trial();
+void handle_parameters();
+
+/**
+ * @brief Helper function to send a beacon made by the main channel.
+ *
+ * The beacon is sent to the ground and stored in the telemetry log.
+ *
+ * @tparam T The type of the beacon.
+ * @param beacon The beacon.
+ */
+template <typename T> void send_local_beacon(const T &beacon) {
+  Helpers::HeapTagScope tag(Helpers::HeapTag::Beacons);
+  PacketComm            beaconpacket;
+  beaconpacket.header.nodeorig = (uint8_t)NODES::TEENSY_NODE_ID;
+  beaconpacket.header.nodedest = (uint8_t)NODES::GROUND_NODE_ID;
+  beaconpacket.header.type     = PacketComm::TypeId::DataObcBeacon;
+  Artemis::Devices::set_beacon_data(beaconpacket, beacon);
+  beaconpacket.header.chanin  = 0;
+  beaconpacket.header.chanout = Artemis::Channels::Channel_ID::RFM23_CHANNEL;
+  route_packet_to_rfm23(beaconpacket);
+  Artemis::Channels::STORAGE::store_beacon(beaconpacket);
+}
+
+#endif // _MAIN_CHANNEL_H
@@ -5,6 +5,7 @@
  * This file contains definitions for the PDU class.
  */
 #include <pdu.h>
+#include <profiler.h>
 
 namespace Artemis {
 namespace Devices {
@@ -29,7 +30,8 @@ namespace Devices {
    * @return false There was an error sending a packet to the PDU.
    */
   bool PDU::send(pdu_packet packet) {
-    char *ptr = (char *)&packet;
+    Helpers::ProfileScope profile(Helpers::ProfileZone::PDUSend);
+    char                 *ptr = (char *)&packet;
 
     print_hexdump(Helpers::PDU, "Sending to PDU: ", (uint8_t *)ptr,
                   sizeof(packet));
@@ -67,7 +69,10 @@ namespace Devices {
       return false;
     }
     String UART1_RX = serial->readString();
-    if (UART1_RX.length() <= 0) {
+    Helpers::trace_ingress(Helpers::TraceSource::PDU,
+                           (const uint8_t *)UART1_RX.c_str(),
+                           UART1_RX.length());
+    if (UART1_RX.length() < sizeof(pdu_packet)) {
       print_debug(Helpers::PDU, "Received serial string empty or corrupted");
       return false;
     }
@@ -75,8 +80,8 @@ namespace Devices {
     packet->sw       = (PDU_SW)(UART1_RX[1] - PDU_CMD_OFFSET);
     packet->sw_state = (uint8_t)(UART1_RX[2] - PDU_CMD_OFFSET);
 
-    print_hexdump(Helpers::PDU, "UART received: ", (uint8_t *)&packet,
-                  sizeof(packet));
+    print_hexdump(Helpers::PDU, "UART received: ", (uint8_t *)packet,
+                  sizeof(pdu_packet));
     return true;
   }
 
@@ -95,7 +100,10 @@ namespace Devices {
       return false;
     }
     String UART1_RX = serial->readString();
-    if (UART1_RX.length() <= 0) {
+    Helpers::trace_ingress(Helpers::TraceSource::PDU,
+                           (const uint8_t *)UART1_RX.c_str(),
+                           UART1_RX.length());
+    if (UART1_RX.length() < sizeof(pdu_telem)) {
       print_debug(Helpers::PDU, "Received serial string empty or corrupted");
       return false;
     }
@@ -147,7 +155,7 @@ namespace Devices {
    * if the switch hasn't been set.
    */
   bool PDU::set_switch(PDU_SW sw, PDU_SW_State state) {
-    if (switch_states[(uint8_t)sw - 2] == state) {
+    if (has_state(sw) && switch_states[(uint8_t)sw - 2] == state) {
       print_debug(Helpers::PDU, "Switch already set to desired state");
       return true;
     }
@@ -166,7 +174,9 @@ namespace Devices {
                     "Failed to receive set switch reply from PDU");
         return false;
       }
-      switch_states[(uint8_t)packet.sw - 2] = (PDU_SW_State)packet.sw_state;
+      if (has_state(packet.sw)) {
+        switch_states[(uint8_t)packet.sw - 2] = to_state(packet.sw_state);
+      }
     } else {
       pdu_telem replyPacket;
       if (!recv(&replyPacket)) {
@@ -175,7 +185,7 @@ namespace Devices {
         return false;
       }
       for (int i = 0; i < NUMBER_OF_SWITCHES; i++) {
-        switch_states[i] = (PDU_SW_State)replyPacket.sw_state[i];
+        switch_states[i] = to_state(replyPacket.sw_state[i]);
       }
     }
     return true;
@@ -229,9 +239,34 @@ namespace Devices {
     }
 
     for (int i = 0; i < NUMBER_OF_SWITCHES; i++) {
-      switch_states[i] = (PDU_SW_State)replyPacket.sw_state[i];
+      switch_states[i] = to_state(replyPacket.sw_state[i]);
     }
     return true;
   }
+
+  /**
+   * @brief Whether a switch has a state in switch_states.
+   *
+   * Only the switches from SW_3V3_1 on are kept, so All and the switches past
+   * NUMBER_OF_SWITCHES, such as BURN1, are not.
+   *
+   * @param sw The switch.
+   * @return true switch_states[(uint8_t)sw - 2] is the switch's state.
+   * @return false The switch has no state.
+   */
+  bool PDU::has_state(PDU_SW sw) {
+    return (uint8_t)sw >= (uint8_t)PDU_SW::SW_3V3_1 &&
+           (uint8_t)sw < (uint8_t)PDU_SW::SW_3V3_1 + NUMBER_OF_SWITCHES;
+  }
+
+  /**
+   * @brief The state of a switch as sent by the PDU.
+   *
+   * @param value The value sent, which is on if it is not 0.
+   * @return PDU_SW_State The state.
+   */
+  PDU::PDU_SW_State PDU::to_state(uint8_t value) {
+    return value != 0 ? PDU_SW_State::SWITCH_ON : PDU_SW_State::SWITCH_OFF;
+  }
 } // namespace Devices
 } // namespace Artemis
\ No newline at end of file
@@ -14,31 +14,25 @@
 #include <stdint.h>
 
 /** @brief The offset between PDU character values and ASCII values. */
-#define PDU_CMD_OFFSET            48
+#define PDU_CMD_OFFSET           48
 /** @brief The number of switches on the PDU. */
-#define NUMBER_OF_SWITCHES        12
+#define NUMBER_OF_SWITCHES       12
 
 /** @brief The time given to let the PDU warm up. */
-#define PDU_WARMUP_TIME           5 * SECONDS
-/** @brief The time given to let the PDU reply to a packet before retrying. */
-#define PDU_RETRY_INTERVAL        1 * SECONDS
+#define PDU_WARMUP_TIME          5 * SECONDS
 /** @brief The time given to keep the burn wire on. */
-#define BURN_WIRE_ON_TIME         5 * SECONDS
+#define BURN_WIRE_ON_TIME        5 * SECONDS
 /** @brief The time to wait before starting the deployment routine. */
-#define DEPLOYMENT_DELAY          5 * SECONDS
+#define DEPLOYMENT_DELAY         5 * SECONDS
 /**
  * @brief The length of the deployment.
  *
  * Flight: two weeks in milliseconds = 14 * 24 * 60 * 60 * 1000;
  * Testing: set desired deployment length in seconds
  */
-#define DEPLOYMENT_LENGTH         60 * SECONDS
+#define DEPLOYMENT_LENGTH        60 * SECONDS
 /** @brief The time to wait between iterations of the deployment loop. */
-#define DEPLOYMENT_LOOP_INTERVAL  10 * SECONDS
-/** @brief The interval at which to check the satellite's temperature. */
-#define HEATER_CHECK_INTERVAL     60 * SECONDS
-/** @brief The maximum time given to send a packet to the PDU. */
-#define PDU_COMMUNICATION_TIMEOUT 5 * SECONDS
+#define DEPLOYMENT_LOOP_INTERVAL 10 * SECONDS
 
 namespace Artemis {
 namespace Devices {
@@ -129,11 +123,14 @@ namespace Devices {
 
   private:
     /** @brief The serial connection used to communicate with the PDU. */
-    HardwareSerial *serial;
+    HardwareSerial     *serial;
 
-    bool            send(pdu_packet packet);
-    bool            recv(pdu_packet *packet);
-    bool            recv(pdu_telem *packet);
+    bool                send(pdu_packet packet);
+    bool                recv(pdu_packet *packet);
+    bool                recv(pdu_telem *packet);
+
+    static bool         has_state(PDU_SW sw);
+    static PDU_SW_State to_state(uint8_t value);
   };
 } // namespace Devices
 } // namespace Artemis
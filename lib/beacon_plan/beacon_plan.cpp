@@ -0,0 +1,210 @@
+/**
+ * @file beacon_plan.cpp
+ * @brief The beacon plan.
+ *
+ * This file contains definitions of the functions that check, schedule and
+ * compose the beacons of the beacon plan.
+ */
+#include <beacon_plan.h>
+#include <checksum.h>
+#include <stddef.h>
+#include <telemetry_points.h>
+
+namespace Artemis {
+namespace Beacons {
+  namespace {
+    /** @brief The device beacons of the default plan, in priority order. */
+    const BeaconType default_beacons[] = {
+        BeaconType::TemperatureBeacon, BeaconType::CurrentBeacon1,
+        BeaconType::IMUBeacon,         BeaconType::MagnetometerBeacon,
+        BeaconType::GPSBeacon,         BeaconType::SwitchBeacon,
+        BeaconType::StackBeacon,       BeaconType::HeapBeacon,
+    };
+
+    /** @brief The CRC-32 of a beacon plan, not including the CRC itself. */
+    uint32_t plan_crc(const beacon_plan &plan) {
+      return Helpers::crc32((const uint8_t *)&plan, offsetof(beacon_plan, crc));
+    }
+
+    /** @brief Whether a time has been reached, allowing for wrap-around. */
+    bool reached(uint32_t now, uint32_t time) {
+      return (int32_t)(now - time) >= 0;
+    }
+  } // namespace
+
+  /**
+   * @brief Follow a new beacon plan.
+   *
+   * Every entry is first due one period from now.
+   *
+   * @param new_plan The plan, which must have passed check_beacon_plan().
+   * @param now The uptime, in milliseconds.
+   */
+  void BeaconScheduler::set_plan(const beacon_plan &new_plan, uint32_t now) {
+    plan = new_plan;
+    for (uint8_t i = 0; i < BEACON_PLAN_ENTRIES; i++) {
+      due[i] = now + plan.entries[i].period * 1000;
+    }
+  }
+
+  /**
+   * @brief Change an entry of the beacon plan.
+   *
+   * The changed entry is due straight away, so the ground sees its effect.
+   *
+   * @param entry The number of the entry.
+   * @param value The new entry.
+   * @param now The uptime, in milliseconds.
+   * @return true The entry has been changed.
+   * @return false The entry does not exist or is not valid.
+   */
+  bool BeaconScheduler::set_entry(uint8_t entry, const beacon_plan_entry &value,
+                                  uint32_t now) {
+    if (entry >= BEACON_PLAN_ENTRIES || !check_beacon_plan_entry(value)) {
+      return false;
+    }
+    plan.entries[entry] = value;
+    seal_beacon_plan(plan);
+    due[entry] = now;
+    return true;
+  }
+
+  /**
+   * @brief Choose the next entry to send.
+   *
+   * The chosen entry is then scheduled one period later. An entry that has
+   * fallen more than a period behind skips the beacons it missed.
+   *
+   * @param now The uptime, in milliseconds.
+   * @return int8_t The number of the entry to send, or -1 if none are due.
+   */
+  int8_t BeaconScheduler::next(uint32_t now) {
+    int8_t chosen = -1;
+    for (uint8_t i = 0; i < BEACON_PLAN_ENTRIES; i++) {
+      const beacon_plan_entry &plan_entry = plan.entries[i];
+      if (plan_entry.beacon == BeaconType::None || !reached(now, due[i])) {
+        continue;
+      }
+      if (chosen < 0 || plan_entry.priority < plan.entries[chosen].priority) {
+        chosen = i;
+      }
+    }
+    if (chosen >= 0) {
+      const uint32_t period = plan.entries[chosen].period * 1000;
+      due[chosen] += period;
+      if (reached(now, due[chosen])) {
+        due[chosen] = now + period;
+      }
+    }
+    return chosen;
+  }
+
+  /**
+   * @brief Fill in the default beacon plan.
+   *
+   * The default plan sends every device beacon, one after another, at the
+   * same period.
+   *
+   * @param plan The plan to be filled in.
+   * @param period The time, in seconds, between each beacon.
+   */
+  void default_beacon_plan(beacon_plan &plan, uint16_t period) {
+    plan = beacon_plan();
+    for (uint8_t i = 0; i < sizeof(default_beacons) / sizeof(BeaconType); i++) {
+      plan.entries[i].beacon   = default_beacons[i];
+      plan.entries[i].period   = period;
+      plan.entries[i].priority = i;
+    }
+    seal_beacon_plan(plan);
+  }
+
+  /**
+   * @brief Set the version and CRC of a beacon plan after it has changed.
+   *
+   * @param plan The plan.
+   */
+  void seal_beacon_plan(beacon_plan &plan) {
+    plan.version = BEACON_PLAN_VERSION;
+    plan.crc     = plan_crc(plan);
+  }
+
+  /**
+   * @brief Check that a stored beacon plan is whole and can be followed.
+   *
+   * @param plan The plan.
+   * @return true The plan can be followed.
+   * @return false The plan is of another version, is corrupted, or has an
+   * entry that is not valid.
+   */
+  bool check_beacon_plan(const beacon_plan &plan) {
+    if (plan.version != BEACON_PLAN_VERSION || plan.crc != plan_crc(plan)) {
+      return false;
+    }
+    for (const beacon_plan_entry &plan_entry : plan.entries) {
+      if (!check_beacon_plan_entry(plan_entry)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /**
+   * @brief Check that an entry of the beacon plan can be followed.
+   *
+   * An entry must name a full beacon, not a compact one, and a period of at
+   * least a second. A point beacon must carry at least one existing point.
+   *
+   * @param plan_entry The entry.
+   * @return true The entry can be followed.
+   * @return false It cannot.
+   */
+  bool check_beacon_plan_entry(const beacon_plan_entry &plan_entry) {
+    switch (plan_entry.beacon) {
+      case BeaconType::None:
+        return true;
+#define BEACON_PLAN_BEACON(id, type, name, fields) case BeaconType::type:
+        ARTEMIS_BEACONS(BEACON_PLAN_BEACON)
+#undef BEACON_PLAN_BEACON
+        break;
+      default:
+        return false;
+    }
+    if (plan_entry.beacon == BeaconType::PointBeacon) {
+      if (plan_entry.count == 0 ||
+          plan_entry.count > ARTEMIS_POINT_BEACON_COUNT) {
+        return false;
+      }
+      for (uint8_t i = 0; i < plan_entry.count; i++) {
+        if (plan_entry.points[i] >= Telemetry::POINT_COUNT) {
+          return false;
+        }
+      }
+    }
+    return plan_entry.period > 0;
+  }
+
+  /**
+   * @brief Make a point beacon from the latest values of its points.
+   *
+   * Points that have never been published are sent as NaN.
+   *
+   * @param plan_entry The entry of the beacon plan, a PointBeacon.
+   * @param entry The number of the entry.
+   * @param uptime The time, in milliseconds, since the Teensy has been
+   * powered on.
+   * @return pointbeacon The beacon.
+   */
+  pointbeacon make_point_beacon(const beacon_plan_entry &plan_entry,
+                                uint8_t entry, uint32_t uptime) {
+    pointbeacon beacon;
+    beacon.deci  = uptime;
+    beacon.entry = entry;
+    beacon.count = plan_entry.count;
+    for (uint8_t i = 0; i < plan_entry.count; i++) {
+      beacon.point[i] = plan_entry.points[i];
+      beacon.value[i] = Telemetry::value(plan_entry.points[i]);
+    }
+    return beacon;
+  }
+} // namespace Beacons
+} // namespace Artemis
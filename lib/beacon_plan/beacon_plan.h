@@ -0,0 +1,115 @@
+/**
+ * @file beacon_plan.h
+ * @brief The header file for the beacon plan.
+ *
+ * This file contains declarations for the beacon plan, which chooses the
+ * beacons sent while in deployment mode, how often each is sent and which
+ * telemetry points go in point beacons. The plan can be changed from the
+ * ground and is kept across resets.
+ */
+#ifndef _BEACON_PLAN_H
+#define _BEACON_PLAN_H
+
+#include <beacon_schema.h>
+#include <stdint.h>
+
+/**
+ * @brief The version of the beacon plan.
+ *
+ * This must be increased whenever beacon_plan changes, so a stored plan of
+ * another layout is replaced by the default plan.
+ */
+#define BEACON_PLAN_VERSION 1
+/** @brief The number of entries in the beacon plan. */
+#define BEACON_PLAN_ENTRIES 8
+/** @brief The entry of a beacon_plan_update that restores the default plan. */
+#define BEACON_PLAN_DEFAULT 0xFF
+
+namespace Artemis {
+namespace Beacons {
+  /** @brief An entry in the beacon plan. */
+  struct __attribute__((packed)) beacon_plan_entry {
+    /**
+     * @brief The beacon to send.
+     *
+     * A device beacon is read from its device. A PointBeacon carries the
+     * points below. None leaves the entry unused.
+     */
+    BeaconType beacon   = BeaconType::None;
+    /** @brief The time, in seconds, between beacons. */
+    uint16_t   period   = 0;
+    /** @brief The priority of the beacon, from 0 as the highest. */
+    uint8_t    priority = 0;
+    /** @brief The number of points of a PointBeacon. */
+    uint8_t    count    = 0;
+    /** @brief The telemetry points of a PointBeacon. */
+    uint8_t    points[ARTEMIS_POINT_BEACON_COUNT]{};
+  };
+  /**<  A diagram of the struct is included below.
+   *
+   * @verbatim
+1 byte   2 bytes  1 byte     1 byte  6 bytes
++--------+--------+----------+-------+--------+
+| beacon | period | priority | count | points |
++--------+--------+----------+-------+--------+
+     @endverbatim
+   */
+
+  /** @brief The beacon plan, as it is kept across resets. */
+  struct __attribute__((packed)) beacon_plan {
+    /** @brief The layout of the plan, BEACON_PLAN_VERSION. */
+    uint8_t           version = BEACON_PLAN_VERSION;
+    /** @brief The entries of the plan. */
+    beacon_plan_entry entries[BEACON_PLAN_ENTRIES];
+    /** @brief The CRC-32 of the version and the entries. */
+    uint32_t          crc     = 0;
+  };
+
+  /**
+   * @brief The command that changes an entry of the beacon plan.
+   *
+   * The same structure reports an entry back to the ground. A command that
+   * only carries the entry number asks for that entry without changing it.
+   */
+  struct __attribute__((packed)) beacon_plan_update {
+    /** @brief The entry, or BEACON_PLAN_DEFAULT to restore the default. */
+    uint8_t           entry = 0;
+    /** @brief The new entry. */
+    beacon_plan_entry plan_entry;
+  };
+
+  /**
+   * @brief Chooses which entry of the beacon plan is sent next.
+   *
+   * Each entry is due one period after it was last sent. When several are
+   * due, the one with the highest priority is sent first, and the others wait
+   * for the next call, so a burst of beacons is spread out rather than
+   * filling the radio's queue.
+   */
+  class BeaconScheduler {
+  public:
+    void               set_plan(const beacon_plan &new_plan, uint32_t now);
+    bool               set_entry(uint8_t entry, const beacon_plan_entry &value,
+                                 uint32_t now);
+    int8_t             next(uint32_t now);
+
+    /** @brief The plan being followed. */
+    const beacon_plan &get_plan() const { return plan; }
+
+  private:
+    /** @brief The plan being followed. */
+    beacon_plan plan;
+    /** @brief The uptime, in milliseconds, when each entry is next due. */
+    uint32_t    due[BEACON_PLAN_ENTRIES] = {};
+  };
+
+  void        default_beacon_plan(beacon_plan &plan, uint16_t period);
+  void        seal_beacon_plan(beacon_plan &plan);
+  bool        check_beacon_plan(const beacon_plan &plan);
+  bool        check_beacon_plan_entry(const beacon_plan_entry &plan_entry);
+  pointbeacon make_point_beacon(const beacon_plan_entry &plan_entry,
+                                uint8_t entry, uint32_t uptime);
+} // namespace Beacons
+} // namespace Artemis
+
+#endif // _BEACON_PLAN_H
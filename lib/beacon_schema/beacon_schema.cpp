@@ -0,0 +1,219 @@
+/**
+ * @file beacon_schema.cpp
+ * @brief The beacon schema descriptors and decoder.
+ *
+ * This file contains the descriptor tables generated from the beacon schema
+ * and the functions used to decode beacons with them.
+ */
+#include <beacon_schema.h>
+#include <string.h>
+#include <type_traits>
+
+namespace Artemis {
+namespace Beacons {
+  namespace {
+    /** @brief The FieldType of a C++ type. */
+    template <typename T> constexpr FieldType field_type();
+    template <> constexpr FieldType field_type<uint8_t>() {
+      return FieldType::UInt8;
+    }
+    template <> constexpr FieldType field_type<int8_t>() {
+      return FieldType::Int8;
+    }
+    template <> constexpr FieldType field_type<uint16_t>() {
+      return FieldType::UInt16;
+    }
+    template <> constexpr FieldType field_type<int16_t>() {
+      return FieldType::Int16;
+    }
+    template <> constexpr FieldType field_type<uint32_t>() {
+      return FieldType::UInt32;
+    }
+    template <> constexpr FieldType field_type<int32_t>() {
+      return FieldType::Int32;
+    }
+    template <> constexpr FieldType field_type<float>() {
+      return FieldType::Float;
+    }
+    template <> constexpr FieldType field_type<BeaconType>() {
+      return FieldType::UInt8;
+    }
+
+#define BEACON_SCHEMA_DESCRIPTOR(S, name, count, scale, bias, unit)            \
+  {#name,                                                                      \
+   field_type<std::remove_extent<decltype(S::name)>::type>(),                  \
+   offsetof(S, name),                                                          \
+   count,                                                                      \
+   scale,                                                                      \
+   bias,                                                                       \
+   unit},
+#define BEACON_SCHEMA_FIELD(S, type, name, scale, unit)                        \
+  BEACON_SCHEMA_DESCRIPTOR(S, name, 1, scale, 0, unit)
+#define BEACON_SCHEMA_ARRAY(S, type, name, count, scale, unit)                 \
+  BEACON_SCHEMA_DESCRIPTOR(S, name, count, scale, 0, unit)
+#define BEACON_SCHEMA_RANGE(S, type, name, min, max, precision, unit)         \
+  BEACON_SCHEMA_DESCRIPTOR(S, name, 1, quantum<type>(min, max),                \
+                           quantum_offset<type>(min, max), unit)
+#define BEACON_SCHEMA_RANGE_ARRAY(S, type, name, count, min, max, precision,   \
+                                  unit)                                        \
+  BEACON_SCHEMA_DESCRIPTOR(S, name, count, quantum<type>(min, max),            \
+                           quantum_offset<type>(min, max), unit)
+#define BEACON_SCHEMA_HEADER(name)                                             \
+  BEACON_SCHEMA_DESCRIPTOR(name, type, 1, 1, 0, "")                            \
+  BEACON_SCHEMA_DESCRIPTOR(name, deci, 1, 1, 0, "ms")                          \
+  BEACON_SCHEMA_DESCRIPTOR(name, version, 1, 1, 0, "")
+#define BEACON_SCHEMA_FIELDS(id, type_name, name, fields)                      \
+  const field_descriptor name##_fields[] = {                                   \
+      BEACON_SCHEMA_HEADER(name)                                               \
+      fields(BEACON_SCHEMA_FIELD, BEACON_SCHEMA_ARRAY, name)};                 \
+  static_assert(sizeof(name) <= UINT8_MAX, #name " is too large");
+#define BEACON_SCHEMA_COMPACT_FIELDS(id, type_name, name, source, fields)      \
+  const field_descriptor name##_fields[] = {                                   \
+      BEACON_SCHEMA_HEADER(name)                                               \
+      fields(BEACON_SCHEMA_RANGE, BEACON_SCHEMA_RANGE_ARRAY, name)};
+    ARTEMIS_BEACONS(BEACON_SCHEMA_FIELDS)
+    ARTEMIS_COMPACT_BEACONS(BEACON_SCHEMA_COMPACT_FIELDS)
+#undef BEACON_SCHEMA_COMPACT_FIELDS
+#undef BEACON_SCHEMA_FIELDS
+#undef BEACON_SCHEMA_HEADER
+#undef BEACON_SCHEMA_RANGE_ARRAY
+#undef BEACON_SCHEMA_RANGE
+#undef BEACON_SCHEMA_ARRAY
+#undef BEACON_SCHEMA_FIELD
+#undef BEACON_SCHEMA_DESCRIPTOR
+
+    /** @brief The size of each FieldType, in bytes. */
+    const uint8_t field_sizes[] = {1, 1, 2, 2, 4, 4, 4};
+
+    /** @brief Decode a column of values of one C++ type. */
+    template <typename T>
+    void decode_values(const uint8_t *src, uint32_t count, uint32_t stride,
+                       double scale, double bias, double *values) {
+      for (uint32_t i = 0; i < count; i++) {
+        T value;
+        memcpy(&value, src, sizeof(value));
+        values[i] = value * scale + bias;
+        src += stride;
+      }
+    }
+  } // namespace
+
+#define BEACON_SCHEMA_BEACON(id, type_name, name, fields)                      \
+  {BeaconType::type_name, #name, sizeof(name),                                 \
+   sizeof(name##_fields) / sizeof(field_descriptor), name##_fields},
+#define BEACON_SCHEMA_COMPACT(id, type_name, name, source, fields)             \
+  BEACON_SCHEMA_BEACON(id, type_name, name, fields)
+  const beacon_descriptor beacon_descriptors[] = {
+      ARTEMIS_BEACONS(BEACON_SCHEMA_BEACON)
+          ARTEMIS_COMPACT_BEACONS(BEACON_SCHEMA_COMPACT)};
+#undef BEACON_SCHEMA_COMPACT
+#undef BEACON_SCHEMA_BEACON
+  const uint8_t beacon_descriptor_count =
+      sizeof(beacon_descriptors) / sizeof(beacon_descriptor);
+
+  /**
+   * @brief Find the description of a beacon type.
+   *
+   * @param type The BeaconType of the beacon.
+   * @return const beacon_descriptor* The description, or nullptr if the type
+   * is not in the schema.
+   */
+  const beacon_descriptor *find_beacon(uint8_t type) {
+    for (uint8_t i = 0; i < beacon_descriptor_count; i++) {
+      if ((uint8_t)beacon_descriptors[i].type == type) {
+        return &beacon_descriptors[i];
+      }
+    }
+    return nullptr;
+  }
+
+  /**
+   * @brief Check that a beacon can be decoded with this schema.
+   *
+   * Beacons of other schema versions are rejected, and must be decoded with
+   * the tools built from that version of the schema.
+   *
+   * @param beacon A pointer to the beacon.
+   * @param size The size of the beacon.
+   * @return const beacon_descriptor* The description of the beacon, or
+   * nullptr if its type, version or size does not match the schema.
+   */
+  const beacon_descriptor *check_beacon(const uint8_t *beacon, size_t size) {
+    if (size < sizeof(beacon_header)) {
+      return nullptr;
+    }
+    const beacon_descriptor *descriptor = find_beacon(beacon[0]);
+    if (descriptor == nullptr || descriptor->size != size ||
+        beacon[offsetof(beacon_header, version)] != BEACON_SCHEMA_VERSION) {
+      return nullptr;
+    }
+    return descriptor;
+  }
+
+  /**
+   * @brief Decode a value of a field of a beacon.
+   *
+   * @param field The description of the field.
+   * @param beacon A pointer to the beacon.
+   * @param element The index of the value, for array fields.
+   * @return double The value, in the field's unit.
+   */
+  double field_value(const field_descriptor &field, const uint8_t *beacon,
+                     uint8_t element) {
+    double value;
+    decode_column(field, element, beacon, 1, 0, &value);
+    return value;
+  }
+
+  /**
+   * @brief Decode a value of a field from many beacons of the same type.
+   *
+   * The beacons may be packed one after another, or spread out at any fixed
+   * stride. The type of the field is only checked once, so this can decode
+   * millions of values per second.
+   *
+   * @param field The description of the field.
+   * @param element The index of the value, for array fields.
+   * @param beacons A pointer to the first beacon.
+   * @param count The number of beacons.
+   * @param stride The distance, in bytes, between beacons.
+   * @param values The buffer that will carry the values, in the field's unit.
+   */
+  void decode_column(const field_descriptor &field, uint8_t element,
+                     const uint8_t *beacons, uint32_t count, uint32_t stride,
+                     double *values) {
+    const uint8_t *src =
+        beacons + field.offset + element * field_sizes[(uint8_t)field.type];
+    switch (field.type) {
+      case FieldType::UInt8:
+        decode_values<uint8_t>(src, count, stride, field.scale, field.bias,
+                               values);
+        break;
+      case FieldType::Int8:
+        decode_values<int8_t>(src, count, stride, field.scale, field.bias,
+                              values);
+        break;
+      case FieldType::UInt16:
+        decode_values<uint16_t>(src, count, stride, field.scale, field.bias,
+                                values);
+        break;
+      case FieldType::Int16:
+        decode_values<int16_t>(src, count, stride, field.scale, field.bias,
+                               values);
+        break;
+      case FieldType::UInt32:
+        decode_values<uint32_t>(src, count, stride, field.scale, field.bias,
+                                values);
+        break;
+      case FieldType::Int32:
+        decode_values<int32_t>(src, count, stride, field.scale, field.bias,
+                               values);
+        break;
+      case FieldType::Float:
+        decode_values<float>(src, count, stride, field.scale, field.bias,
+                             values);
+        break;
+    }
+  }
+} // namespace Beacons
+} // namespace Artemis
@@ -0,0 +1,431 @@
+/**
+ * @file beacon_schema.h
+ * @brief The beacon schema.
+ *
+ * This file is the single source of every beacon's layout. The beacon
+ * structures used by the flight software and the descriptor tables used by
+ * the ground decoder are both generated from the lists below, so they cannot
+ * drift apart.
+ */
+#ifndef _BEACON_SCHEMA_H
+#define _BEACON_SCHEMA_H
+
+#include <cmath>
+#include <limits>
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+
+/**
+ * @brief The version of the beacon schema.
+ *
+ * This must be increased whenever a beacon's fields change, so the ground can
+ * tell which layout a stored beacon uses.
+ */
+#define BEACON_SCHEMA_VERSION          1
+
+/** The number of current sensor readings in the first current beacon. */
+#define ARTEMIS_CURRENT_BEACON_1_COUNT 2
+/** @brief The number of current sensors in the satellite. */
+#define ARTEMIS_CURRENT_SENSOR_COUNT   5
+/** @brief The number of temperature sensors in the satellite. */
+#define ARTEMIS_TEMP_SENSOR_COUNT      7
+/** @brief The number of switch states in the switch beacon. */
+#define ARTEMIS_SWITCH_BEACON_COUNT    13
+/** @brief The number of telemetry points in a point beacon. */
+#define ARTEMIS_POINT_BEACON_COUNT     6
+/** @brief The number of thread stacks in a stack beacon. */
+#define ARTEMIS_STACK_BEACON_COUNT     7
+/** @brief The number of heap tags in a heap beacon. */
+#define ARTEMIS_HEAP_BEACON_COUNT      9
+/** @brief The number of threads in a CPU beacon. */
+#define ARTEMIS_CPU_BEACON_COUNT       7
+/** @brief The number of channels in a restart beacon. */
+#define ARTEMIS_RESTART_BEACON_COUNT   7
+/** @brief The number of tasks in an executive beacon. */
+#define ARTEMIS_EXECUTIVE_BEACON_COUNT 6
+
+/**
+ * @brief The fields of each beacon, after the common header.
+ *
+ * Each list is expanded with two macros: FIELD(S, type, name, scale, unit)
+ * for a single value and ARRAY(S, type, name, count, scale, unit) for an
+ * array. A stored value multiplied by its scale gives the value in its unit.
+ * S is passed through for the macros' own use.
+ */
+#define TEMPERATUREBEACON_FIELDS(FIELD, ARRAY, S)                              \
+  ARRAY(S, float, tmp36_tempC, ARTEMIS_TEMP_SENSOR_COUNT, 1, "degC")           \
+  FIELD(S, float, teensy_tempC, 1, "degC")
+#define CURRENTBEACON1_FIELDS(FIELD, ARRAY, S)                                 \
+  ARRAY(S, float, busvoltage, ARTEMIS_CURRENT_BEACON_1_COUNT, 1, "V")          \
+  ARRAY(S, float, current, ARTEMIS_CURRENT_BEACON_1_COUNT, 1, "mA")
+#define CURRENTBEACON2_FIELDS(FIELD, ARRAY, S)                                 \
+  ARRAY(S, float, busvoltage,                                                  \
+        ARTEMIS_CURRENT_SENSOR_COUNT - ARTEMIS_CURRENT_BEACON_1_COUNT, 1, "V") \
+  ARRAY(S, float, current,                                                     \
+        ARTEMIS_CURRENT_SENSOR_COUNT - ARTEMIS_CURRENT_BEACON_1_COUNT, 1, "mA")
+#define IMUBEACON_FIELDS(FIELD, ARRAY, S)                                      \
+  FIELD(S, float, accelx, 1, "m/s^2")                                          \
+  FIELD(S, float, accely, 1, "m/s^2")                                          \
+  FIELD(S, float, accelz, 1, "m/s^2")                                          \
+  FIELD(S, float, gyrox, 1, "rad/s")                                           \
+  FIELD(S, float, gyroy, 1, "rad/s")                                           \
+  FIELD(S, float, gyroz, 1, "rad/s")                                           \
+  FIELD(S, float, imutemp, 1, "degC")
+#define MAGBEACON_FIELDS(FIELD, ARRAY, S)                                      \
+  FIELD(S, float, magx, 1, "uT")                                               \
+  FIELD(S, float, magy, 1, "uT")                                               \
+  FIELD(S, float, magz, 1, "uT")
+#define GPSBEACON_FIELDS(FIELD, ARRAY, S)                                      \
+  FIELD(S, float, latitude, 1, "ddmm.mmmm")                                    \
+  FIELD(S, float, longitude, 1, "dddmm.mmmm")                                  \
+  FIELD(S, float, speed, 1, "knots")                                           \
+  FIELD(S, float, angle, 1, "deg")                                             \
+  FIELD(S, float, altitude, 1, "m")                                            \
+  FIELD(S, uint8_t, satellites, 1, "")
+#define SWITCHBEACON_FIELDS(FIELD, ARRAY, S)                                   \
+  ARRAY(S, uint8_t, sw, ARTEMIS_SWITCH_BEACON_COUNT, 1, "")
+/** @brief The telemetry points chosen by an entry of the beacon plan. */
+#define POINTBEACON_FIELDS(FIELD, ARRAY, S)                                    \
+  FIELD(S, uint8_t, entry, 1, "")                                              \
+  FIELD(S, uint8_t, count, 1, "")                                              \
+  ARRAY(S, uint8_t, point, ARTEMIS_POINT_BEACON_COUNT, 1, "")                  \
+  ARRAY(S, float, value, ARTEMIS_POINT_BEACON_COUNT, 1, "")
+#define STACKBEACON_FIELDS(FIELD, ARRAY, S)                                    \
+  ARRAY(S, uint8_t, channel, ARTEMIS_STACK_BEACON_COUNT, 1, "")                \
+  ARRAY(S, uint16_t, used, ARTEMIS_STACK_BEACON_COUNT, 1, "B")                 \
+  ARRAY(S, uint16_t, size, ARTEMIS_STACK_BEACON_COUNT, 1, "B")
+#define HEAPBEACON_FIELDS(FIELD, ARRAY, S)                                     \
+  FIELD(S, uint32_t, live, 1, "B")                                             \
+  FIELD(S, uint32_t, peak, 1, "B")                                             \
+  FIELD(S, uint32_t, free, 1, "B")                                             \
+  FIELD(S, uint32_t, largest, 1, "B")                                          \
+  ARRAY(S, uint16_t, allocs, ARTEMIS_HEAP_BEACON_COUNT, 1, "")
+/** @brief The share of the processor each thread used since the last one. */
+#define CPUBEACON_FIELDS(FIELD, ARRAY, S)                                      \
+  FIELD(S, uint32_t, samples, 1, "")                                           \
+  ARRAY(S, uint8_t, channel, ARTEMIS_CPU_BEACON_COUNT, 1, "")                  \
+  ARRAY(S, uint16_t, load, ARTEMIS_CPU_BEACON_COUNT, 0.1, "%")
+/** @brief The restarts of each supervised channel, and the last one's cause. */
+#define RESTARTBEACON_FIELDS(FIELD, ARRAY, S)                                  \
+  ARRAY(S, uint8_t, channel, ARTEMIS_RESTART_BEACON_COUNT, 1, "")              \
+  ARRAY(S, uint16_t, restarts, ARTEMIS_RESTART_BEACON_COUNT, 1, "")            \
+  ARRAY(S, uint8_t, cause, ARTEMIS_RESTART_BEACON_COUNT, 1, "")
+/** @brief The longest run and the overruns of each main channel task. */
+#define EXECUTIVEBEACON_FIELDS(FIELD, ARRAY, S)                                \
+  FIELD(S, uint16_t, skipped, 1, "")                                           \
+  ARRAY(S, uint32_t, worst, ARTEMIS_EXECUTIVE_BEACON_COUNT, 1, "us")           \
+  ARRAY(S, uint16_t, overruns, ARTEMIS_EXECUTIVE_BEACON_COUNT, 1, "")
+
+/**
+ * @brief The fields of each compact beacon, after the common header.
+ *
+ * Each list is expanded with RANGE(S, type, name, min, max, precision, unit)
+ * and RANGE_ARRAY(S, type, name, count, min, max, precision, unit). The value
+ * of the full beacon's field of the same name is stored as an integer of the
+ * given type, spread evenly from min to max. Values outside the range are
+ * clamped. The range must resolve the field to within precision, which is
+ * checked at compile time.
+ */
+#define COMPACTTEMPERATUREBEACON_FIELDS(RANGE, RANGE_ARRAY, S)                 \
+  RANGE_ARRAY(S, int16_t, tmp36_tempC, ARTEMIS_TEMP_SENSOR_COUNT, -60, 140,    \
+              0.01, "degC")                                                    \
+  RANGE(S, int8_t, teensy_tempC, -64, 127, 0.5, "degC")
+#define COMPACTCURRENTBEACON1_FIELDS(RANGE, RANGE_ARRAY, S)                    \
+  RANGE_ARRAY(S, uint16_t, busvoltage, ARTEMIS_CURRENT_BEACON_1_COUNT, 0, 32,  \
+              0.001, "V")                                                      \
+  RANGE_ARRAY(S, int16_t, current, ARTEMIS_CURRENT_BEACON_1_COUNT, -3200,      \
+              3200, 0.1, "mA")
+#define COMPACTCURRENTBEACON2_FIELDS(RANGE, RANGE_ARRAY, S)                    \
+  RANGE_ARRAY(S, uint16_t, busvoltage,                                         \
+              ARTEMIS_CURRENT_SENSOR_COUNT - ARTEMIS_CURRENT_BEACON_1_COUNT,   \
+              0, 32, 0.001, "V")                                               \
+  RANGE_ARRAY(S, int16_t, current,                                             \
+              ARTEMIS_CURRENT_SENSOR_COUNT - ARTEMIS_CURRENT_BEACON_1_COUNT,   \
+              -3200, 3200, 0.1, "mA")
+#define COMPACTIMUBEACON_FIELDS(RANGE, RANGE_ARRAY, S)                         \
+  RANGE(S, int16_t, accelx, -160, 160, 0.005, "m/s^2")                         \
+  RANGE(S, int16_t, accely, -160, 160, 0.005, "m/s^2")                         \
+  RANGE(S, int16_t, accelz, -160, 160, 0.005, "m/s^2")                         \
+  RANGE(S, int16_t, gyrox, -35, 35, 0.001, "rad/s")                            \
+  RANGE(S, int16_t, gyroy, -35, 35, 0.001, "rad/s")                            \
+  RANGE(S, int16_t, gyroz, -35, 35, 0.001, "rad/s")                            \
+  RANGE(S, int8_t, imutemp, -64, 127, 0.5, "degC")
+#define COMPACTMAGBEACON_FIELDS(RANGE, RANGE_ARRAY, S)                         \
+  RANGE(S, int16_t, magx, -400, 400, 0.01, "uT")                               \
+  RANGE(S, int16_t, magy, -400, 400, 0.01, "uT")                               \
+  RANGE(S, int16_t, magz, -400, 400, 0.01, "uT")
+#define COMPACTGPSBEACON_FIELDS(RANGE, RANGE_ARRAY, S)                         \
+  RANGE(S, int32_t, latitude, -9000, 9000, 0.0001, "ddmm.mmmm")                \
+  RANGE(S, int32_t, longitude, -18000, 18000, 0.0001, "dddmm.mmmm")            \
+  RANGE(S, uint16_t, speed, 0, 16384, 0.25, "knots")                           \
+  RANGE(S, uint16_t, angle, 0, 360, 0.01, "deg")                               \
+  RANGE(S, uint16_t, altitude, 0, 655350, 5, "m")                              \
+  RANGE(S, uint8_t, satellites, 0, 255, 0.5, "")
+
+/**
+ * @brief Every beacon, expanded with BEACON(id, type, name, fields).
+ *
+ * id is the beacon's BeaconType value, which must never be reused. type is
+ * the BeaconType name and name is the name of the generated structure.
+ */
+#define ARTEMIS_BEACONS(BEACON)                                                \
+  BEACON(1, TemperatureBeacon, temperaturebeacon, TEMPERATUREBEACON_FIELDS)    \
+  BEACON(2, CurrentBeacon1, currentbeacon1, CURRENTBEACON1_FIELDS)             \
+  BEACON(3, CurrentBeacon2, currentbeacon2, CURRENTBEACON2_FIELDS)             \
+  BEACON(4, IMUBeacon, imubeacon, IMUBEACON_FIELDS)                            \
+  BEACON(5, MagnetometerBeacon, magbeacon, MAGBEACON_FIELDS)                   \
+  BEACON(6, GPSBeacon, gpsbeacon, GPSBEACON_FIELDS)                            \
+  BEACON(7, SwitchBeacon, switchbeacon, SWITCHBEACON_FIELDS)                   \
+  BEACON(14, PointBeacon, pointbeacon, POINTBEACON_FIELDS)                     \
+  BEACON(15, StackBeacon, stackbeacon, STACKBEACON_FIELDS)                     \
+  BEACON(16, HeapBeacon, heapbeacon, HEAPBEACON_FIELDS)                        \
+  BEACON(17, CpuBeacon, cpubeacon, CPUBEACON_FIELDS)                           \
+  BEACON(18, RestartBeacon, restartbeacon, RESTARTBEACON_FIELDS)              \
+  BEACON(19, ExecutiveBeacon, executivebeacon, EXECUTIVEBEACON_FIELDS)
+
+/**
+ * @brief Every compact beacon, expanded with
+ * COMPACT(id, type, name, source, fields).
+ *
+ * source is the full beacon that the compact beacon is made from.
+ */
+#define ARTEMIS_COMPACT_BEACONS(COMPACT)                                       \
+  COMPACT(8, CompactTemperatureBeacon, compacttemperaturebeacon,               \
+          temperaturebeacon, COMPACTTEMPERATUREBEACON_FIELDS)                  \
+  COMPACT(9, CompactCurrentBeacon1, compactcurrentbeacon1, currentbeacon1,     \
+          COMPACTCURRENTBEACON1_FIELDS)                                        \
+  COMPACT(10, CompactCurrentBeacon2, compactcurrentbeacon2, currentbeacon2,    \
+          COMPACTCURRENTBEACON2_FIELDS)                                        \
+  COMPACT(11, CompactIMUBeacon, compactimubeacon, imubeacon,                   \
+          COMPACTIMUBEACON_FIELDS)                                             \
+  COMPACT(12, CompactMagnetometerBeacon, compactmagbeacon, magbeacon,          \
+          COMPACTMAGBEACON_FIELDS)                                             \
+  COMPACT(13, CompactGPSBeacon, compactgpsbeacon, gpsbeacon,                   \
+          COMPACTGPSBEACON_FIELDS)
+
+namespace Artemis {
+namespace Devices {
+  /** @brief Enumeration of beacon types. */
+  enum class BeaconType : uint8_t {
+    None = 0,
+#define BEACON_SCHEMA_TYPE(id, type, name, fields) type = id,
+#define BEACON_SCHEMA_COMPACT_TYPE(id, type, name, source, fields) type = id,
+    ARTEMIS_BEACONS(BEACON_SCHEMA_TYPE)
+    ARTEMIS_COMPACT_BEACONS(BEACON_SCHEMA_COMPACT_TYPE)
+#undef BEACON_SCHEMA_COMPACT_TYPE
+#undef BEACON_SCHEMA_TYPE
+  };
+} // namespace Devices
+
+/** @brief The beacon structures and descriptors generated from the schema. */
+namespace Beacons {
+  using Devices::BeaconType;
+
+  /**
+   * @brief The fields at the start of every beacon.
+   *
+   * The fields of each beacon follow, in the order of its list above.
+   */
+  struct __attribute__((packed)) beacon_header {
+    /** @brief The type of the beacon. */
+    BeaconType type    = BeaconType::None;
+    /** @brief A decimal identifier for the beacon. */
+    uint32_t   deci    = 0;
+    /** @brief The schema version of the beacon, BEACON_SCHEMA_VERSION. */
+    uint8_t    version = BEACON_SCHEMA_VERSION;
+  };
+  /**<  A diagram of the struct is included below.
+   *
+   * @verbatim
+1 byte 4 bytes  1 byte
++------+------+---------+--------+
+| type | deci | version | fields |
++------+------+---------+--------+
+    @endverbatim
+    */
+
+#define BEACON_SCHEMA_FIELD(S, type, name, scale, unit) type name = 0;
+#define BEACON_SCHEMA_ARRAY(S, type, name, count, scale, unit)                 \
+  type name[count] = {};
+#define BEACON_SCHEMA_STRUCT(id, type_name, name, fields)                      \
+  struct __attribute__((packed)) name {                                        \
+    BeaconType type    = BeaconType::type_name;                                \
+    uint32_t   deci    = 0;                                                    \
+    uint8_t    version = BEACON_SCHEMA_VERSION;                                \
+    fields(BEACON_SCHEMA_FIELD, BEACON_SCHEMA_ARRAY, name)                     \
+  };
+  ARTEMIS_BEACONS(BEACON_SCHEMA_STRUCT)
+#undef BEACON_SCHEMA_STRUCT
+#undef BEACON_SCHEMA_ARRAY
+#undef BEACON_SCHEMA_FIELD
+
+  /**
+   * @brief The value of one step of a compact field.
+   *
+   * @tparam T The integer type the field is stored as.
+   * @param min The value stored as the lowest integer.
+   * @param max The value stored as the highest integer.
+   */
+  template <typename T> constexpr double quantum(double min, double max) {
+    return (max - min) / ((double)std::numeric_limits<T>::max() -
+                          (double)std::numeric_limits<T>::min());
+  }
+
+  /**
+   * @brief The value of a stored 0 in a compact field.
+   *
+   * A stored integer q decodes to q * quantum() + quantum_offset(), which are
+   * the field's scale and bias.
+   *
+   * @tparam T The integer type the field is stored as.
+   * @param min The value stored as the lowest integer.
+   * @param max The value stored as the highest integer.
+   */
+  template <typename T>
+  constexpr double quantum_offset(double min, double max) {
+    return min - (double)std::numeric_limits<T>::min() * quantum<T>(min, max);
+  }
+
+  /**
+   * @brief Store a value in a compact field.
+   *
+   * The value is clamped to the range and rounded to the nearest step without
+   * branching, so it takes the same time for every value. NaN is stored as
+   * min. 32-bit fields are computed in double precision so every step can be
+   * reached.
+   *
+   * @tparam T The integer type the field is stored as.
+   * @param value The value to be stored.
+   * @param min The value stored as the lowest integer.
+   * @param max The value stored as the highest integer.
+   * @return T The stored integer.
+   */
+  template <typename T>
+  inline T quantize(double value, double min, double max) {
+    static_assert(sizeof(T) < 4 || std::is_signed<T>::value,
+                  "Unsigned 32-bit compact fields are not supported");
+    using real =
+        typename std::conditional<(sizeof(T) < 4), float, double>::type;
+    const real low  = std::numeric_limits<T>::min();
+    const real high = std::numeric_limits<T>::max();
+    const real step = (real)(1.0 / quantum<T>(min, max));
+    const real q    = ((real)value - (real)min) * step + low;
+    return (T)std::lrint(std::fmin(std::fmax(q, low), high));
+  }
+
+#define BEACON_SCHEMA_RANGE(S, type, name, min, max, precision, unit)          \
+  type name = 0;                                                               \
+  static_assert(quantum<type>(min, max) / 2 <= precision,                      \
+                #name " is stored less precisely than required");
+#define BEACON_SCHEMA_RANGE_ARRAY(S, type, name, count, min, max, precision,   \
+                                  unit)                                        \
+  type name[count] = {};                                                       \
+  static_assert(quantum<type>(min, max) / 2 <= precision,                      \
+                #name " is stored less precisely than required");
+#define BEACON_SCHEMA_STRUCT(id, type_name, name, source, fields)              \
+  struct __attribute__((packed)) name {                                        \
+    BeaconType type    = BeaconType::type_name;                                \
+    uint32_t   deci    = 0;                                                    \
+    uint8_t    version = BEACON_SCHEMA_VERSION;                                \
+    fields(BEACON_SCHEMA_RANGE, BEACON_SCHEMA_RANGE_ARRAY, name)               \
+  };
+  ARTEMIS_COMPACT_BEACONS(BEACON_SCHEMA_STRUCT)
+#undef BEACON_SCHEMA_STRUCT
+#undef BEACON_SCHEMA_RANGE_ARRAY
+#undef BEACON_SCHEMA_RANGE
+
+  /**
+   * @brief The compact form of a beacon that has none.
+   *
+   * This lets every beacon be passed through compact(). Overloads for the
+   * beacons that do have a compact form are generated below.
+   *
+   * @param beacon The beacon.
+   * @return T The same beacon.
+   */
+  template <typename T> inline T compact(const T &beacon) { return beacon; }
+
+#define BEACON_SCHEMA_RANGE(S, type, name, min, max, precision, unit)          \
+  out.name = quantize<type>(in.name, min, max);
+#define BEACON_SCHEMA_RANGE_ARRAY(S, type, name, count, min, max, precision,   \
+                                  unit)                                        \
+  for (uint8_t i = 0; i < count; i++) {                                        \
+    out.name[i] = quantize<type>(in.name[i], min, max);                        \
+  }
+#define BEACON_SCHEMA_COMPACT(id, type_name, name, source, fields)             \
+  inline name compact(const source &in) {                                      \
+    name out;                                                                  \
+    out.deci = in.deci;                                                        \
+    fields(BEACON_SCHEMA_RANGE, BEACON_SCHEMA_RANGE_ARRAY, name)               \
+    return out;                                                                \
+  }
+  ARTEMIS_COMPACT_BEACONS(BEACON_SCHEMA_COMPACT)
+#undef BEACON_SCHEMA_COMPACT
+#undef BEACON_SCHEMA_RANGE_ARRAY
+#undef BEACON_SCHEMA_RANGE
+
+  /** @brief Enumeration of the types a field can be stored as. */
+  enum class FieldType : uint8_t {
+    UInt8,
+    Int8,
+    UInt16,
+    Int16,
+    UInt32,
+    Int32,
+    Float,
+  };
+
+  /** @brief The description of a field of a beacon. */
+  struct field_descriptor {
+    /** @brief The name of the field. */
+    const char *name;
+    /** @brief The type the field is stored as. */
+    FieldType   type;
+    /** @brief The offset of the field from the start of the beacon. */
+    uint8_t     offset;
+    /** @brief The number of values in the field. */
+    uint8_t     count;
+    /**
+     * @brief The factor from a stored value to a value in the unit.
+     *
+     * A stored value v is v * scale + bias in the unit.
+     */
+    double      scale;
+    /** @brief The value in the unit of a stored 0. */
+    double      bias;
+    /** @brief The unit of the field. */
+    const char *unit;
+  };
+
+  /** @brief The description of a beacon. */
+  struct beacon_descriptor {
+    /** @brief The type of the beacon. */
+    BeaconType              type;
+    /** @brief The name of the beacon. */
+    const char             *name;
+    /** @brief The size of the beacon. */
+    uint8_t                 size;
+    /** @brief The number of fields in the beacon, including the header. */
+    uint8_t                 field_count;
+    /** @brief The fields of the beacon. */
+    const field_descriptor *fields;
+  };
+
+  /** @brief The descriptions of every beacon in the schema. */
+  extern const beacon_descriptor beacon_descriptors[];
+  /** @brief The number of beacons in the schema. */
+  extern const uint8_t           beacon_descriptor_count;
+
+  const beacon_descriptor       *find_beacon(uint8_t type);
+  const beacon_descriptor       *check_beacon(const uint8_t *beacon,
+                                              size_t         size);
+  double field_value(const field_descriptor &field, const uint8_t *beacon,
+                     uint8_t element = 0);
+  void   decode_column(const field_descriptor &field, uint8_t element,
+                       const uint8_t *beacons, uint32_t count, uint32_t stride,
+                       double *values);
+} // namespace Beacons
+} // namespace Artemis
+
+#endif // _BEACON_SCHEMA_H
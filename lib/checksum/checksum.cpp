@@ -0,0 +1,40 @@
+/**
+ * @file checksum.cpp
+ * @brief The checksum functions.
+ *
+ * This file contains definitions of checksum functions used to protect data
+ * stored or transferred by the flight software.
+ */
+#include <checksum.h>
+
+namespace Helpers {
+/**
+ * @brief Compute the CRC-32 (IEEE 802.3) of a region of memory.
+ *
+ * The checksum is computed four bits at a time using a 16 entry table, which
+ * keeps the table small while being several times faster than a bitwise
+ * implementation.
+ *
+ * A checksum can be computed incrementally by passing the result of the
+ * previous call back in as the starting value.
+ *
+ * @param src A pointer to the start of the region.
+ * @param size The number of bytes in the region.
+ * @param crc The checksum of the preceding data, or 0 to start a new checksum.
+ * @return uint32_t The checksum of all data seen so far.
+ */
+uint32_t crc32(const uint8_t *src, size_t size, uint32_t crc) {
+  static const uint32_t table[16] = {
+      0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4,
+      0x4DB26158, 0x5005713C, 0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+      0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+  };
+
+  crc = ~crc;
+  for (size_t i = 0; i < size; i++) {
+    crc = table[(crc ^ src[i]) & 0x0F] ^ (crc >> 4);
+    crc = table[(crc ^ (src[i] >> 4)) & 0x0F] ^ (crc >> 4);
+  }
+  return ~crc;
+}
+} // namespace Helpers
@@ -0,0 +1,18 @@
+/**
+ * @file checksum.h
+ * @brief The header file for checksum functions.
+ *
+ * This file contains declarations of checksum functions used to protect data
+ * stored or transferred by the flight software.
+ */
+#ifndef _CHECKSUM_H
+#define _CHECKSUM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace Helpers {
+uint32_t crc32(const uint8_t *src, size_t size, uint32_t crc = 0);
+} // namespace Helpers
+
+#endif // _CHECKSUM_H
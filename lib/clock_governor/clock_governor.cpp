@@ -0,0 +1,107 @@
+/**
+ * @file clock_governor.cpp
+ * @brief The processor clock governor.
+ *
+ * This file contains definitions of the functions that measure busy time and
+ * choose the processor's clock frequency.
+ */
+#include <atomic>
+#include <clock_governor.h>
+
+namespace Helpers {
+/**
+ * @brief The clock frequencies, in Hz, from lowest to highest.
+ *
+ * These are among the frequencies the i.MX RT1062's clock can be set to.
+ */
+const uint32_t governor_frequencies[GOVERNOR_LEVELS] = {24000000, 150000000,
+                                                        450000000};
+
+namespace {
+  /**
+   * @brief The busy time, in microseconds, since startup.
+   *
+   * It is only written by the idle thread, and wraps around.
+   */
+  volatile uint32_t     busy_us = 0;
+  /** @brief The time, in milliseconds, until which a boost was requested. */
+  std::atomic<uint32_t> boost_end{0};
+} // namespace
+
+/**
+ * @brief Count the time between two turns of the idle thread.
+ *
+ * Gaps longer than GOVERNOR_IDLE_GAP_US were spent in other threads' work,
+ * and are counted as busy time.
+ *
+ * @param gap_us The time, in microseconds, since the idle thread's last turn.
+ */
+void count_idle_gap(uint32_t gap_us) {
+  if (gap_us > GOVERNOR_IDLE_GAP_US) {
+    busy_us = busy_us + gap_us;
+  }
+}
+
+/**
+ * @brief The busy time counted by the idle thread.
+ *
+ * @return uint32_t The busy time, in microseconds since startup, which wraps
+ * around.
+ */
+uint32_t get_busy_us() { return busy_us; }
+
+/**
+ * @brief Keep the clock at its highest frequency for a while.
+ *
+ * This is called before work that needs the processor, such as a bulk
+ * transfer, so that it does not wait for the load to raise the clock. It can
+ * be called from any thread, and a longer boost already requested is kept.
+ *
+ * @param now The uptime, in milliseconds.
+ * @param duration The time, in milliseconds, to keep the clock high.
+ */
+void request_boost(uint32_t now, uint32_t duration) {
+  const uint32_t end  = now + duration;
+  uint32_t       last = boost_end.load();
+  while ((int32_t)(end - last) > 0 &&
+         !boost_end.compare_exchange_weak(last, end)) {
+  }
+}
+
+/**
+ * @brief Whether a boost is in effect.
+ *
+ * @param now The uptime, in milliseconds.
+ * @return true The clock must be kept at its highest frequency.
+ * @return false No boost has been requested until after now.
+ */
+bool boosted(uint32_t now) { return (int32_t)(boost_end.load() - now) > 0; }
+
+/**
+ * @brief Choose the clock frequency for the next window.
+ *
+ * @param load The load of the window that ended, in tenths of a percent, as
+ * measured at the current frequency.
+ * @param now The uptime, in milliseconds.
+ * @return uint8_t The level of the frequency to use.
+ */
+uint8_t ClockGovernor::update(uint16_t load, uint32_t now) {
+  if (boosted(now) || load > GOVERNOR_UP_PERMILLE) {
+    current = GOVERNOR_LEVELS - 1;
+    quiet   = 0;
+    return current;
+  }
+  if (current == 0 ||
+      (uint64_t)load * governor_frequencies[current] /
+              governor_frequencies[current - 1] >=
+          GOVERNOR_DOWN_PERMILLE) {
+    quiet = 0;
+    return current;
+  }
+  if (++quiet >= GOVERNOR_DOWN_WINDOWS) {
+    current--;
+    quiet = 0;
+  }
+  return current;
+}
+} // namespace Helpers
@@ -0,0 +1,82 @@
+/**
+ * @file clock_governor.h
+ * @brief The header file for the processor clock governor.
+ *
+ * This file contains declarations for the clock governor, which lowers the
+ * processor's clock while the satellite is idle and raises it again when it
+ * is busy. Busy time is measured by an idle thread that takes a turn every
+ * round of the scheduler: a turn that comes back late was delayed by a
+ * thread doing work.
+ */
+#ifndef _CLOCK_GOVERNOR_H
+#define _CLOCK_GOVERNOR_H
+
+#include <stdint.h>
+
+/** @brief The number of clock frequencies the governor chooses from. */
+#define GOVERNOR_LEVELS        3
+/** @brief The time, in milliseconds, over which the load is measured. */
+#define GOVERNOR_WINDOW        1000
+/**
+ * @brief The longest time, in microseconds, between two turns of the idle
+ * thread that is still taken to be idle.
+ *
+ * When every thread is waiting, a round of the scheduler only passes through
+ * each thread's check of its wake time, which takes a few microseconds.
+ */
+#define GOVERNOR_IDLE_GAP_US   100
+/** @brief The load, in tenths of a percent, above which the clock is raised. */
+#define GOVERNOR_UP_PERMILLE   700
+/**
+ * @brief The highest load, in tenths of a percent, the next lower clock may
+ * be expected to have for the clock to be lowered.
+ *
+ * It is well below GOVERNOR_UP_PERMILLE, so that a lowered clock is not
+ * raised again by the same load.
+ */
+#define GOVERNOR_DOWN_PERMILLE 400
+/** @brief The quiet windows in a row before the clock is lowered. */
+#define GOVERNOR_DOWN_WINDOWS  5
+/** @brief The time, in milliseconds, a boost lasts unless it is renewed. */
+#define GOVERNOR_BOOST_TIME    (2 * GOVERNOR_WINDOW)
+
+namespace Helpers {
+/**
+ * @brief The clock frequencies, in Hz, from lowest to highest.
+ *
+ * The clock starts at the highest, and the governor only lowers it once the
+ * satellite has been seen to be idle.
+ */
+extern const uint32_t governor_frequencies[GOVERNOR_LEVELS];
+
+void                  count_idle_gap(uint32_t gap_us);
+uint32_t              get_busy_us();
+void                  request_boost(uint32_t now, uint32_t duration);
+bool                  boosted(uint32_t now);
+
+/**
+ * @brief Chooses the clock frequency from the load of each window.
+ *
+ * The clock is raised to the highest frequency as soon as a window is busy,
+ * or while a boost is requested, and lowered one step at a time after
+ * GOVERNOR_DOWN_WINDOWS quiet windows. A window is quiet if its load, scaled
+ * to the next lower frequency, would still be below GOVERNOR_DOWN_PERMILLE.
+ */
+class ClockGovernor {
+public:
+  uint8_t  update(uint16_t load, uint32_t now);
+
+  /** @brief The level of the chosen frequency, from 0 for the lowest. */
+  uint8_t  level() const { return current; }
+  /** @brief The chosen frequency, in Hz. */
+  uint32_t frequency() const { return governor_frequencies[current]; }
+
+private:
+  /** @brief The level of the chosen frequency. */
+  uint8_t current = GOVERNOR_LEVELS - 1;
+  /** @brief The quiet windows in a row at this level. */
+  uint8_t quiet   = 0;
+};
+} // namespace Helpers
+
+#endif // _CLOCK_GOVERNOR_H
@@ -0,0 +1,183 @@
+/**
+ * @file command_ack.cpp
+ * @brief Command acknowledgments.
+ *
+ * This file contains definitions of the functions that collect command
+ * acknowledgments and pack them for sending.
+ */
+#include <command_ack.h>
+#include <string.h>
+
+namespace Artemis {
+namespace Commands {
+  namespace {
+    /** @brief Whether an acknowledgment can be sent in a bitmap. */
+    bool succeeded(const command_ack &ack) {
+      return ack.status == AckStatus::Executed && ack.result == AckResult::Ok;
+    }
+  } // namespace
+
+  /**
+   * @brief Queue an acknowledgment.
+   *
+   * A completion replaces the command's acknowledgment as accepted, if that
+   * has not been sent.
+   *
+   * @param ack The acknowledgment.
+   * @param now The uptime, in milliseconds.
+   */
+  void AckCollector::report(const command_ack &ack, uint32_t now) {
+    if (ack.status != AckStatus::Accepted) {
+      for (uint8_t i = 0; i < queued; i++) {
+        if (queue[i].number == ack.number &&
+            queue[i].status == AckStatus::Accepted) {
+          queue[i] = ack;
+          return;
+        }
+      }
+    }
+    if (queued == ACK_QUEUE_SIZE) {
+      memmove(queue, queue + 1, (ACK_QUEUE_SIZE - 1) * sizeof(command_ack));
+      queued--;
+    }
+    if (queued == 0) {
+      oldest = now;
+    }
+    queue[queued++] = ack;
+  }
+
+  /**
+   * @brief Accept a command handed to another channel, which completes it.
+   *
+   * If too many commands are waiting, the oldest is failed.
+   *
+   * @param ack The command's acknowledgment as accepted.
+   * @param now The uptime, in milliseconds.
+   */
+  void AckCollector::track(const command_ack &ack, uint32_t now) {
+    report(ack, now);
+    if (pending_count == ACK_PENDING_SIZE) {
+      complete(pending[0].type, AckResult::Timeout, now);
+    }
+    pending[pending_count++] = {ack.number, ack.type, now};
+  }
+
+  /**
+   * @brief Complete the oldest accepted command of a type.
+   *
+   * Channels run their commands in the order they receive them, so the
+   * oldest command of the type is the one that has run.
+   *
+   * @param type The PacketComm::TypeId of the command.
+   * @param result The result of the command.
+   * @param now The uptime, in milliseconds.
+   * @return true A command was completed.
+   * @return false No command of the type is waiting.
+   */
+  bool AckCollector::complete(uint16_t type, AckResult result, uint32_t now) {
+    for (uint8_t i = 0; i < pending_count; i++) {
+      if (pending[i].type != type) {
+        continue;
+      }
+      command_ack    ack;
+      const uint32_t elapsed = now - pending[i].start;
+      ack.number  = pending[i].number;
+      ack.type    = type;
+      ack.status  = result == AckResult::Ok ? AckStatus::Executed
+                                            : AckStatus::Failed;
+      ack.result  = result;
+      ack.time_ms = elapsed > UINT16_MAX ? UINT16_MAX : elapsed;
+      remove(i);
+      report(ack, now);
+      return true;
+    }
+    return false;
+  }
+
+  /**
+   * @brief Fail the accepted commands that have waited too long.
+   *
+   * @param now The uptime, in milliseconds.
+   */
+  void AckCollector::expire(uint32_t now) {
+    while (pending_count > 0 &&
+           now - pending[0].start >= ACK_PENDING_TIMEOUT) {
+      complete(pending[0].type, AckResult::Timeout, now);
+    }
+  }
+
+  /**
+   * @brief Whether acknowledgments are to be sent.
+   *
+   * @param now The uptime, in milliseconds.
+   * @return true A packet's worth is waiting, or the oldest has waited
+   * ACK_COALESCE_TIME.
+   * @return false They are to wait for more.
+   */
+  bool AckCollector::due(uint32_t now) const {
+    return queued >= ACK_FRAME_RECORDS ||
+           (queued > 0 && now - oldest >= ACK_COALESCE_TIME);
+  }
+
+  /**
+   * @brief Take the next packet of acknowledgments from the queue.
+   *
+   * If at least ACK_BITMAP_MIN commands within ACK_BITMAP_BITS of the first
+   * executed with Ok, they are sent as an ack_bitmap, without their times.
+   * Otherwise the oldest ACK_FRAME_RECORDS are sent as command_acks.
+   *
+   * @param dst The buffer for the packet's data, of at least
+   * ACK_FRAME_RECORDS command_acks.
+   * @param size The size of the packet's data.
+   * @return AckFrame The kind of packet.
+   */
+  AckFrame AckCollector::next_frame(uint8_t *dst, size_t &size) {
+    size = 0;
+    if (queued == 0) {
+      return AckFrame::None;
+    }
+    ack_bitmap bitmap;
+    uint8_t    count = 0;
+    for (uint8_t i = 0; i < queued; i++) {
+      if (!succeeded(queue[i])) {
+        continue;
+      }
+      if (count == 0) {
+        bitmap.first = queue[i].number;
+      }
+      if ((uint16_t)(queue[i].number - bitmap.first) < ACK_BITMAP_BITS) {
+        count++;
+      }
+    }
+    if (count >= ACK_BITMAP_MIN) {
+      uint8_t kept = 0;
+      for (uint8_t i = 0; i < queued; i++) {
+        const uint16_t bit = queue[i].number - bitmap.first;
+        if (succeeded(queue[i]) && bit < ACK_BITMAP_BITS) {
+          bitmap.bits[bit / 8] |= 1 << (bit % 8);
+        } else {
+          queue[kept++] = queue[i];
+        }
+      }
+      queued = kept;
+      memcpy(dst, &bitmap, sizeof(bitmap));
+      size = sizeof(bitmap);
+      return AckFrame::Bitmap;
+    }
+    const uint8_t records = queued < ACK_FRAME_RECORDS ? queued
+                                                       : ACK_FRAME_RECORDS;
+    memcpy(dst, queue, records * sizeof(command_ack));
+    memmove(queue, queue + records, (queued - records) * sizeof(command_ack));
+    queued -= records;
+    size    = records * sizeof(command_ack);
+    return AckFrame::Records;
+  }
+
+  /** @brief Remove an accepted command from those waiting. */
+  void AckCollector::remove(uint8_t index) {
+    pending_count--;
+    memmove(pending + index, pending + index + 1,
+            (pending_count - index) * sizeof(pending_command));
+  }
+} // namespace Commands
+} // namespace Artemis
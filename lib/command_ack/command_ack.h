@@ -0,0 +1,156 @@
+/**
+ * @file command_ack.h
+ * @brief The header file for command acknowledgments.
+ *
+ * This file contains declarations for the acknowledgments sent to the ground
+ * for each command it sends. A command is numbered when it reaches the main
+ * channel, and is acknowledged as executed, rejected or failed once it has
+ * been handled. A command handed to another channel is first acknowledged as
+ * accepted, and then completed by that channel. Acknowledgments are collected
+ * for a moment before they are sent, so that several share a packet, and
+ * many successful commands are sent as a bitmap of their numbers.
+ */
+#ifndef _COMMAND_ACK_H
+#define _COMMAND_ACK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** @brief The number of acknowledgments waiting to be sent. */
+#define ACK_QUEUE_SIZE      16
+/** @brief The number of accepted commands waiting for their channels. */
+#define ACK_PENDING_SIZE    8
+/** @brief The largest number of acknowledgments sent in one packet. */
+#define ACK_FRAME_RECORDS   5
+/** @brief The number of commands covered by a bitmap. */
+#define ACK_BITMAP_BITS     64
+/**
+ * @brief The fewest successful commands sent as a bitmap.
+ *
+ * Fewer are sent as full acknowledgments, which are smaller for so few.
+ */
+#define ACK_BITMAP_MIN      4
+/** @brief The longest time, in milliseconds, an acknowledgment waits. */
+#define ACK_COALESCE_TIME   1000
+/**
+ * @brief The time, in milliseconds, after which an accepted command that has
+ * not been completed is failed.
+ */
+#define ACK_PENDING_TIMEOUT 60000
+
+namespace Artemis {
+namespace Commands {
+  /** @brief Enumeration of the states a command is acknowledged in. */
+  enum class AckStatus : uint8_t {
+    /** @brief The command has been handed to the channel that runs it. */
+    Accepted,
+    /** @brief The command was not run. */
+    Rejected,
+    /** @brief The command ran. */
+    Executed,
+    /** @brief The command ran, but did not succeed. */
+    Failed,
+  };
+
+  /** @brief Enumeration of the results of a command. */
+  enum class AckResult : uint8_t {
+    Ok,
+    /** @brief The command's type is not handled. */
+    UnknownCommand,
+    /** @brief The command's data is too short or too long. */
+    BadLength,
+    /** @brief The command's data is not valid. */
+    BadValue,
+    /** @brief There was no room for what the command adds. */
+    NoSpace,
+    /** @brief The device did not answer in time. */
+    Timeout,
+    /** @brief The device or the SD card failed. */
+    DeviceError,
+  };
+
+  /** @brief The acknowledgment of a command. */
+  struct __attribute__((packed)) command_ack {
+    /** @brief The number of the command, counted from 0 at startup. */
+    uint16_t  number  = 0;
+    /** @brief The PacketComm::TypeId of the command. */
+    uint16_t  type    = 0;
+    /** @brief The state of the command. */
+    AckStatus status  = AckStatus::Executed;
+    /** @brief The result of the command. */
+    AckResult result  = AckResult::Ok;
+    /** @brief The time, in milliseconds, the command took, saturating. */
+    uint16_t  time_ms = 0;
+  };
+  /**<  A diagram of the struct is included below.
+   *
+   * @verbatim
+2 bytes  2 bytes  1 byte   1 byte   2 bytes
++--------+------+--------+--------+---------+
+| number | type | status | result | time_ms |
++--------+------+--------+--------+---------+
+     @endverbatim
+   */
+
+  /** @brief The commands, of consecutive numbers, that executed with Ok. */
+  struct __attribute__((packed)) ack_bitmap {
+    /** @brief The number of the first command. */
+    uint16_t first = 0;
+    /** @brief Bit i of byte i / 8 is set if command first + i executed. */
+    uint8_t  bits[ACK_BITMAP_BITS / 8]{};
+  };
+
+  /** @brief Enumeration of the kinds of packet acknowledgments are sent in. */
+  enum class AckFrame : uint8_t {
+    /** @brief No acknowledgments are to be sent. */
+    None,
+    /** @brief Up to ACK_FRAME_RECORDS command_acks. */
+    Records,
+    /** @brief An ack_bitmap. */
+    Bitmap,
+  };
+
+  /**
+   * @brief Collects acknowledgments until they are sent.
+   *
+   * An accepted command's acknowledgment is replaced by its completion if
+   * that comes before it is sent. If the queue fills, the oldest
+   * acknowledgment is dropped.
+   */
+  class AckCollector {
+  public:
+    void     report(const command_ack &ack, uint32_t now);
+    void     track(const command_ack &ack, uint32_t now);
+    bool     complete(uint16_t type, AckResult result, uint32_t now);
+    void     expire(uint32_t now);
+    bool     due(uint32_t now) const;
+    AckFrame next_frame(uint8_t *dst, size_t &size);
+
+  private:
+    /** @brief A command accepted and waiting for its channel. */
+    struct pending_command {
+      /** @brief The number of the command. */
+      uint16_t number;
+      /** @brief The PacketComm::TypeId of the command. */
+      uint16_t type;
+      /** @brief The uptime, in milliseconds, it was accepted. */
+      uint32_t start;
+    };
+
+    void            remove(uint8_t index);
+
+    /** @brief The acknowledgments waiting to be sent, oldest first. */
+    command_ack     queue[ACK_QUEUE_SIZE];
+    /** @brief The number of acknowledgments waiting. */
+    uint8_t         queued        = 0;
+    /** @brief The uptime, in milliseconds, the oldest one was queued. */
+    uint32_t        oldest        = 0;
+    /** @brief The accepted commands, oldest first. */
+    pending_command pending[ACK_PENDING_SIZE];
+    /** @brief The number of accepted commands. */
+    uint8_t         pending_count = 0;
+  };
+} // namespace Commands
+} // namespace Artemis
+
+#endif // _COMMAND_ACK_H
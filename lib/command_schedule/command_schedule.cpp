@@ -0,0 +1,229 @@
+/**
+ * @file command_schedule.cpp
+ * @brief The command schedule.
+ *
+ * This file contains definitions of the functions that add, remove, release
+ * and store the commands of the command schedule.
+ */
+#include <checksum.h>
+#include <command_schedule.h>
+#include <string.h>
+
+namespace Artemis {
+namespace Commands {
+  namespace {
+    /** @brief The CRC-32 of a schedule, not including the CRC itself. */
+    uint32_t schedule_crc(const command_schedule_image &image) {
+      return Helpers::crc32((const uint8_t *)&image,
+                            offsetof(command_schedule_image, crc));
+    }
+  } // namespace
+
+  /**
+   * @brief Add a command to the schedule.
+   *
+   * @param command The command, whose id is replaced by the one it is given.
+   * @return int32_t The id the command was given, or -1 if the schedule is
+   * full or the command is not valid.
+   */
+  int32_t CommandSchedule::add(const scheduled_command &command) {
+    if (image.count == COMMAND_SCHEDULE_SIZE ||
+        command.tag.size > COMMAND_SCHEDULE_DATA) {
+      return -1;
+    }
+    const uint8_t  index     = image.count++;
+    const uint16_t id        = image.next_id;
+    image.commands[index]    = command;
+    image.commands[index].id = id;
+    image.next_id            = id == 0xFFFF ? 1 : id + 1;
+    sift_up(index);
+    return id;
+  }
+
+  /**
+   * @brief Delete a command from the schedule.
+   *
+   * Finding the command takes O(n), as the heap is not ordered by id.
+   *
+   * @param id The id of the command.
+   * @return true The command has been deleted.
+   * @return false No command has the id.
+   */
+  bool CommandSchedule::remove(uint16_t id) {
+    for (uint8_t i = 0; i < image.count; i++) {
+      if (image.commands[i].id != id) {
+        continue;
+      }
+      image.commands[i] = image.commands[--image.count];
+      if (i < image.count) {
+        sift_up(i);
+        sift_down(i);
+      }
+      return true;
+    }
+    return false;
+  }
+
+  /** @brief Delete every command from the schedule. */
+  void CommandSchedule::clear() { image.count = 0; }
+
+  /**
+   * @brief Take the next command that is due.
+   *
+   * @param now The log time, in milliseconds.
+   * @param command The command taken.
+   * @return true A command was due, and has been taken out of the schedule.
+   * @return false No command is due.
+   */
+  bool CommandSchedule::pop_due(uint64_t now, scheduled_command &command) {
+    if (image.count == 0 || command_time(image.commands[0].tag) > now) {
+      return false;
+    }
+    command           = image.commands[0];
+    image.commands[0] = image.commands[--image.count];
+    sift_down(0);
+    return true;
+  }
+
+  /**
+   * @brief Replace the schedule with a stored one.
+   *
+   * The stored commands are put back in heap order, so a schedule whose order
+   * was lost is still taken in time order.
+   *
+   * @param stored The stored schedule.
+   * @return true The schedule has been replaced.
+   * @return false The stored schedule is of another version, is corrupted, or
+   * has a command that is not valid. The schedule is left unchanged.
+   */
+  bool CommandSchedule::load(const command_schedule_image &stored) {
+    if (stored.version != COMMAND_SCHEDULE_VERSION ||
+        stored.crc != schedule_crc(stored) ||
+        stored.count > COMMAND_SCHEDULE_SIZE || stored.next_id == 0) {
+      return false;
+    }
+    for (uint8_t i = 0; i < stored.count; i++) {
+      if (stored.commands[i].tag.size > COMMAND_SCHEDULE_DATA) {
+        return false;
+      }
+    }
+    image = stored;
+    for (uint8_t i = image.count / 2; i > 0; i--) {
+      sift_down(i - 1);
+    }
+    return true;
+  }
+
+  /**
+   * @brief Set the version and CRC of the schedule, so that it can be stored.
+   *
+   * @return const command_schedule_image& The schedule, to be stored.
+   */
+  const command_schedule_image &CommandSchedule::seal() {
+    image.version = COMMAND_SCHEDULE_VERSION;
+    image.crc     = schedule_crc(image);
+    return image;
+  }
+
+  /** @brief Whether the command at a is due before the one at b. */
+  bool CommandSchedule::before(uint8_t a, uint8_t b) const {
+    const uint64_t time_a = command_time(image.commands[a].tag);
+    const uint64_t time_b = command_time(image.commands[b].tag);
+    if (time_a != time_b) {
+      return time_a < time_b;
+    }
+    return image.commands[a].id < image.commands[b].id;
+  }
+
+  /** @brief Swap two commands of the heap. */
+  void CommandSchedule::swap(uint8_t a, uint8_t b) {
+    const scheduled_command command = image.commands[a];
+    image.commands[a]               = image.commands[b];
+    image.commands[b]               = command;
+  }
+
+  /** @brief Move a command towards the root until its parent is before it. */
+  void CommandSchedule::sift_up(uint8_t index) {
+    while (index > 0) {
+      const uint8_t parent = (index - 1) / 2;
+      if (!before(index, parent)) {
+        break;
+      }
+      swap(index, parent);
+      index = parent;
+    }
+  }
+
+  /** @brief Move a command down until it is before both of its children. */
+  void CommandSchedule::sift_down(uint8_t index) {
+    while (true) {
+      const uint8_t left     = 2 * index + 1;
+      const uint8_t right    = left + 1;
+      uint8_t       earliest = index;
+      if (left < image.count && before(left, earliest)) {
+        earliest = left;
+      }
+      if (right < image.count && before(right, earliest)) {
+        earliest = right;
+      }
+      if (earliest == index) {
+        break;
+      }
+      swap(index, earliest);
+      index = earliest;
+    }
+  }
+
+  /**
+   * @brief The log time a command is due at.
+   *
+   * @param tag The tag of the command.
+   * @return uint64_t The log time, in milliseconds.
+   */
+  uint64_t command_time(const command_tag &tag) {
+    return (uint64_t)tag.time * 1000 + tag.millis;
+  }
+
+  /**
+   * @brief Read a command, as uploaded from the ground.
+   *
+   * The command is a command_tag followed by its data.
+   *
+   * @param src A pointer to the command.
+   * @param size The number of bytes from src, which may hold further commands.
+   * @param command The command read, without an id.
+   * @return size_t The number of bytes of the command, or 0 if it is cut short
+   * or its data is too large.
+   */
+  size_t read_scheduled_command(const uint8_t *src, size_t size,
+                                scheduled_command &command) {
+    if (size < sizeof(command_tag)) {
+      return 0;
+    }
+    memcpy(&command.tag, src, sizeof(command_tag));
+    if (command.tag.size > COMMAND_SCHEDULE_DATA ||
+        size - sizeof(command_tag) < command.tag.size) {
+      return 0;
+    }
+    memcpy(command.data, src + sizeof(command_tag), command.tag.size);
+    return sizeof(command_tag) + command.tag.size;
+  }
+
+  /**
+   * @brief Write a command, as reported to the ground.
+   *
+   * The command is its id and command_tag followed by its data.
+   *
+   * @param command The command.
+   * @param dst A pointer to the buffer, of at least sizeof(scheduled_command)
+   * bytes.
+   * @return size_t The number of bytes written.
+   */
+  size_t write_scheduled_command(const scheduled_command &command,
+                                 uint8_t                 *dst) {
+    const size_t size = offsetof(scheduled_command, data) + command.tag.size;
+    memcpy(dst, &command, size);
+    return size;
+  }
+} // namespace Commands
+} // namespace Artemis
@@ -0,0 +1,138 @@
+/**
+ * @file command_schedule.h
+ * @brief The header file for the command schedule.
+ *
+ * This file contains declarations for the command schedule, which holds
+ * commands uploaded from the ground until the log time they are tagged with,
+ * when they are sent to the main channel as if they had just been received.
+ * The schedule is a binary heap ordered by time, so adding a command and
+ * taking the next one due each take O(log n).
+ */
+#ifndef _COMMAND_SCHEDULE_H
+#define _COMMAND_SCHEDULE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief The version of the command schedule.
+ *
+ * This must be increased whenever command_schedule_image changes, so a stored
+ * schedule of another layout is discarded.
+ */
+#define COMMAND_SCHEDULE_VERSION 1
+/** @brief The largest number of commands the schedule holds. */
+#define COMMAND_SCHEDULE_SIZE    32
+/**
+ * @brief The largest data, in bytes, of a scheduled command.
+ *
+ * A scheduled command is reported with its id and tag, which must fit in
+ * TELEMETRY_LOG_RECORD_DATA bytes along with the number of commands.
+ */
+#define COMMAND_SCHEDULE_DATA    24
+
+namespace Artemis {
+/** @brief Commands uploaded from the ground. */
+namespace Commands {
+  /** @brief Enumeration of the actions of a CommandSchedule packet. */
+  enum class ScheduleAction : uint8_t {
+    /** @brief Add the commands that follow, each a tag and its data. */
+    Add,
+    /** @brief Delete the commands whose 2-byte ids follow. */
+    Delete,
+    /** @brief Report every command in the schedule. */
+    List,
+    /** @brief Delete every command in the schedule. */
+    Clear,
+  };
+
+  /** @brief The time and packet header of a scheduled command. */
+  struct __attribute__((packed)) command_tag {
+    /** @brief The log time, in seconds, the command is due at. */
+    uint32_t time   = 0;
+    /** @brief The milliseconds after time the command is due at. */
+    uint16_t millis = 0;
+    /** @brief The node the command is addressed to. */
+    uint8_t  node   = 0;
+    /** @brief The PacketComm::TypeId of the command. */
+    uint16_t type   = 0;
+    /** @brief The number of bytes of data that follow. */
+    uint8_t  size   = 0;
+  };
+  /**<  A diagram of the struct is included below.
+   *
+   * @verbatim
+4 bytes  2 bytes  1 byte  2 bytes  1 byte
++------+--------+------+------+------+
+| time | millis | node | type | size |
++------+--------+------+------+------+
+     @endverbatim
+   */
+
+  /** @brief A command in the schedule. */
+  struct __attribute__((packed)) scheduled_command {
+    /** @brief The id the command was given when it was added, from 1. */
+    uint16_t    id = 0;
+    /** @brief The time and packet header of the command. */
+    command_tag tag;
+    /** @brief The data of the command, of which tag.size bytes are used. */
+    uint8_t     data[COMMAND_SCHEDULE_DATA]{};
+  };
+
+  /** @brief The command schedule, as it is kept across resets. */
+  struct __attribute__((packed)) command_schedule_image {
+    /** @brief The layout of the schedule, COMMAND_SCHEDULE_VERSION. */
+    uint8_t           version = COMMAND_SCHEDULE_VERSION;
+    /** @brief The id the next command added is given. */
+    uint16_t          next_id = 1;
+    /** @brief The number of commands in the schedule. */
+    uint8_t           count   = 0;
+    /** @brief The commands, in heap order. */
+    scheduled_command commands[COMMAND_SCHEDULE_SIZE];
+    /** @brief The CRC-32 of everything above. */
+    uint32_t          crc     = 0;
+  };
+
+  /**
+   * @brief Holds commands until they are due.
+   *
+   * Commands due at the same time are taken in the order they were added. A
+   * command that came due while the Teensy was off is taken as soon as the
+   * schedule is next checked with the time synced.
+   */
+  class CommandSchedule {
+  public:
+    int32_t                       add(const scheduled_command &command);
+    bool                          remove(uint16_t id);
+    void                          clear();
+    bool                          pop_due(uint64_t now,
+                                          scheduled_command &command);
+    bool                          load(const command_schedule_image &stored);
+    const command_schedule_image &seal();
+
+    /** @brief The number of commands in the schedule. */
+    uint8_t                       size() const { return image.count; }
+    /** @brief A command in the schedule, in no particular order. */
+    const scheduled_command      &get(uint8_t index) const {
+      return image.commands[index];
+    }
+
+  private:
+    bool                   before(uint8_t a, uint8_t b) const;
+    void                   swap(uint8_t a, uint8_t b);
+    void                   sift_up(uint8_t index);
+    void                   sift_down(uint8_t index);
+
+    /** @brief The schedule, whose crc is only set by seal(). */
+    command_schedule_image image;
+  };
+
+  uint64_t command_time(const command_tag &tag);
+  size_t   read_scheduled_command(const uint8_t *src, size_t size,
+                                  scheduled_command &command);
+  size_t   write_scheduled_command(const scheduled_command &command,
+                                   uint8_t                 *dst);
+} // namespace Commands
+} // namespace Artemis
+
+#endif // _COMMAND_SCHEDULE_H
@@ -0,0 +1,315 @@
+/**
+ * @file command_sequence.cpp
+ * @brief The command sequence engine.
+ *
+ * This file contains definitions of the functions that check and run
+ * command sequences.
+ */
+#include <command_sequence.h>
+#include <string.h>
+#include <telemetry_points.h>
+
+namespace Artemis {
+namespace Commands {
+  namespace {
+    /** @brief Read a 2-byte operand. */
+    uint16_t read16(const uint8_t *src) {
+      uint16_t value;
+      memcpy(&value, src, sizeof(value));
+      return value;
+    }
+
+    /** @brief Read a 4-byte operand. */
+    uint32_t read32(const uint8_t *src) {
+      uint32_t value;
+      memcpy(&value, src, sizeof(value));
+      return value;
+    }
+
+    /** @brief Whether a time has been reached, allowing for wrap-around. */
+    bool reached(uint32_t now, uint32_t time) {
+      return (int32_t)(now - time) >= 0;
+    }
+
+    /**
+     * @brief Compare a telemetry point with a value.
+     *
+     * @param operands The point, Comparison and value.
+     * @return true The comparison holds.
+     * @return false It does not, or the point has never been published.
+     */
+    bool test_point(const uint8_t *operands) {
+      Telemetry::point_value reading;
+      if (!Telemetry::read(read16(operands), reading)) {
+        return false;
+      }
+      float value;
+      memcpy(&value, operands + 3, sizeof(value));
+      switch ((Comparison)operands[2]) {
+        case Comparison::Below:
+          return reading.value < value;
+        case Comparison::Above:
+          return reading.value > value;
+        case Comparison::Equal:
+          return reading.value == value;
+      }
+      return false;
+    }
+  } // namespace
+
+  /**
+   * @brief Start running a sequence, in place of any sequence running.
+   *
+   * @param slot The slot of the sequence.
+   * @param sequence The sequence, which must have passed check_sequence().
+   * @param size The size of the sequence.
+   */
+  void SequenceEngine::start(uint8_t slot, const uint8_t *sequence,
+                             uint16_t size) {
+    code         = sequence;
+    length       = size;
+    pc           = 0;
+    running_slot = slot;
+    current      = SequenceState::Running;
+    flag         = false;
+    waiting      = false;
+  }
+
+  /** @brief Stop the sequence running, if any. */
+  void SequenceEngine::stop() {
+    if (current == SequenceState::Running) {
+      current = SequenceState::Stopped;
+    }
+  }
+
+  /**
+   * @brief Run the sequence until it sends a command, waits or ends.
+   *
+   * At most SEQUENCE_STEPS instructions are run, so this must be called
+   * again while the sequence is running, and straight away after it returns a
+   * command. It also returns on reaching an instruction that reads a
+   * telemetry point, before running it, so that the point's device can be
+   * sampled first.
+   *
+   * @param now The uptime, in milliseconds.
+   * @param command The command to be sent, which points into the sequence.
+   * @return true A command is to be sent.
+   * @return false No command is to be sent yet.
+   */
+  bool SequenceEngine::step(uint32_t now, sequence_command &command) {
+    for (uint8_t i = 0; i < SEQUENCE_STEPS; i++) {
+      if (current != SequenceState::Running) {
+        return false;
+      }
+      if (pc >= length) {
+        current = SequenceState::Done;
+        return false;
+      }
+      const uint8_t *operands = code + pc + 1;
+      const uint16_t next     = pc + instruction_size(code, length, pc);
+      switch ((SequenceOp)code[pc]) {
+        case SequenceOp::End: {
+          current = SequenceState::Done;
+          return false;
+        }
+        case SequenceOp::Send: {
+          command.node = operands[0];
+          command.type = read16(operands + 1);
+          command.size = operands[3];
+          command.data = operands + 4;
+          pc           = next;
+          return true;
+        }
+        case SequenceOp::Delay: {
+          if (!waiting) {
+            wait_end = now + read32(operands);
+            waiting  = true;
+          }
+          if (!reached(now, wait_end)) {
+            return false;
+          }
+          break;
+        }
+        case SequenceOp::WaitPoint: {
+          if (!waiting) {
+            wait_end = now + read32(operands + 7);
+            waiting  = true;
+            return false;
+          }
+          flag = test_point(operands);
+          if (!flag && !reached(now, wait_end)) {
+            return false;
+          }
+          break;
+        }
+        case SequenceOp::Check: {
+          if (!waiting) {
+            waiting = true;
+            return false;
+          }
+          flag = test_point(operands);
+          break;
+        }
+        case SequenceOp::WaitPacket: {
+          if (!waiting) {
+            wait_end = now + read32(operands + 2);
+            waiting  = true;
+            seen     = false;
+          }
+          flag = seen;
+          if (!flag && !reached(now, wait_end)) {
+            return false;
+          }
+          break;
+        }
+        case SequenceOp::Jump: {
+          pc = read16(operands);
+          continue;
+        }
+        case SequenceOp::JumpIf: {
+          pc = flag ? read16(operands) : next;
+          continue;
+        }
+        case SequenceOp::JumpUnless: {
+          pc = flag ? next : read16(operands);
+          continue;
+        }
+        case SequenceOp::Fail:
+        default: {
+          current = SequenceState::Failed;
+          return false;
+        }
+      }
+      waiting = false;
+      pc      = next;
+    }
+    return false;
+  }
+
+  /**
+   * @brief Tell the engine of a packet that reached the main channel.
+   *
+   * @param type The PacketComm::TypeId of the packet.
+   */
+  void SequenceEngine::observe(uint16_t type) {
+    if (current == SequenceState::Running && waiting &&
+        (SequenceOp)code[pc] == SequenceOp::WaitPacket &&
+        read16(code + pc + 1) == type) {
+      seen = true;
+    }
+  }
+
+  /**
+   * @brief The telemetry point the next instruction reads.
+   *
+   * Points are only published when their device is read, so the owner
+   * samples the point's device while the sequence waits on it.
+   *
+   * @return int32_t The point, or -1 if the next instruction reads none.
+   */
+  int32_t SequenceEngine::point() const {
+    if (current != SequenceState::Running || pc >= length) {
+      return -1;
+    }
+    const SequenceOp op = (SequenceOp)code[pc];
+    if (op != SequenceOp::WaitPoint && op != SequenceOp::Check) {
+      return -1;
+    }
+    return read16(code + pc + 1);
+  }
+
+  /**
+   * @brief The size of an instruction, with its operands.
+   *
+   * @param sequence The sequence.
+   * @param size The size of the sequence.
+   * @param offset The offset of the instruction.
+   * @return uint16_t The size of the instruction, or 0 if it is not a
+   * SequenceOp or is cut short by the end of the sequence.
+   */
+  uint16_t instruction_size(const uint8_t *sequence, uint16_t size,
+                            uint16_t offset) {
+    if (offset >= size) {
+      return 0;
+    }
+    uint16_t instruction;
+    switch ((SequenceOp)sequence[offset]) {
+      case SequenceOp::End:
+      case SequenceOp::Fail:
+        instruction = 1;
+        break;
+      case SequenceOp::Send:
+        if (size - offset < 5) {
+          return 0;
+        }
+        instruction = 5 + sequence[offset + 4];
+        break;
+      case SequenceOp::Delay:
+        instruction = 5;
+        break;
+      case SequenceOp::WaitPoint:
+        instruction = 12;
+        break;
+      case SequenceOp::Check:
+        instruction = 8;
+        break;
+      case SequenceOp::WaitPacket:
+        instruction = 7;
+        break;
+      case SequenceOp::Jump:
+      case SequenceOp::JumpIf:
+      case SequenceOp::JumpUnless:
+        instruction = 3;
+        break;
+      default:
+        return 0;
+    }
+    return size - offset < instruction ? 0 : instruction;
+  }
+
+  /**
+   * @brief Check that a sequence can be run.
+   *
+   * Every instruction must be whole, every comparison known, and every jump
+   * must land on an instruction or the end of the sequence.
+   *
+   * @param sequence The sequence.
+   * @param size The size of the sequence.
+   * @return true The sequence can be run.
+   * @return false It cannot.
+   */
+  bool check_sequence(const uint8_t *sequence, uint16_t size) {
+    if (size > SEQUENCE_SIZE) {
+      return false;
+    }
+    uint8_t starts[SEQUENCE_SIZE / 8 + 1] = {};
+    for (uint16_t offset = 0; offset < size;) {
+      const uint16_t instruction = instruction_size(sequence, size, offset);
+      if (instruction == 0) {
+        return false;
+      }
+      const SequenceOp op = (SequenceOp)sequence[offset];
+      if ((op == SequenceOp::WaitPoint || op == SequenceOp::Check) &&
+          sequence[offset + 3] > (uint8_t)Comparison::Equal) {
+        return false;
+      }
+      starts[offset / 8] |= 1 << (offset % 8);
+      offset += instruction;
+    }
+    starts[size / 8] |= 1 << (size % 8);
+    for (uint16_t offset = 0; offset < size;
+         offset += instruction_size(sequence, size, offset)) {
+      const SequenceOp op = (SequenceOp)sequence[offset];
+      if (op != SequenceOp::Jump && op != SequenceOp::JumpIf &&
+          op != SequenceOp::JumpUnless) {
+        continue;
+      }
+      const uint16_t target = read16(sequence + offset + 1);
+      if (target > size || !(starts[target / 8] & (1 << (target % 8)))) {
+        return false;
+      }
+    }
+    return true;
+  }
+} // namespace Commands
+} // namespace Artemis
@@ -0,0 +1,202 @@
+/**
+ * @file command_sequence.h
+ * @brief The header file for the command sequence engine.
+ *
+ * This file contains declarations for command sequences, which are short
+ * programs uploaded from the ground that send commands, wait and branch on
+ * board, so that an operation of several steps needs no ground contact
+ * between them. A sequence is a string of instructions, each a SequenceOp
+ * followed by its operands, little-endian.
+ */
+#ifndef _COMMAND_SEQUENCE_H
+#define _COMMAND_SEQUENCE_H
+
+#include <stdint.h>
+
+/** @brief The number of sequences kept on board. */
+#define SEQUENCE_SLOTS 4
+/** @brief The largest size, in bytes, of a sequence. */
+#define SEQUENCE_SIZE  256
+/**
+ * @brief The most instructions run each time the engine is stepped.
+ *
+ * This bounds the time a sequence that jumps without waiting can take from
+ * the main channel.
+ */
+#define SEQUENCE_STEPS 16
+
+namespace Artemis {
+namespace Commands {
+  /** @brief Enumeration of the actions of a CommandSequence packet. */
+  enum class SequenceAction : uint8_t {
+    /**
+     * @brief Write part of a sequence: the slot, the 2-byte offset and the
+     * bytes. The slot holds no sequence until it is committed.
+     */
+    Write,
+    /**
+     * @brief Check and keep a written sequence: the slot, the 2-byte length
+     * and the 4-byte CRC-32.
+     */
+    Commit,
+    /** @brief Start a sequence: the slot. */
+    Start,
+    /** @brief Stop the sequence running. */
+    Stop,
+    /** @brief Report the state of the sequence engine. */
+    Status,
+  };
+
+  /**
+   * @brief Enumeration of the instructions of a sequence.
+   *
+   * Each is followed by the operands listed. A wait sets the result to
+   * whether its condition was met before its timeout, in milliseconds.
+   */
+  enum class SequenceOp : uint8_t {
+    /** @brief End the sequence. */
+    End,
+    /**
+     * @brief Send a command: the node, 2-byte type and size of its data,
+     * followed by the data.
+     */
+    Send,
+    /** @brief Wait: the 4-byte time. */
+    Delay,
+    /**
+     * @brief Wait for a telemetry point: the 2-byte point, a Comparison, the
+     * 4-byte float value and the 4-byte timeout.
+     */
+    WaitPoint,
+    /**
+     * @brief Set the result from a telemetry point: the 2-byte point, a
+     * Comparison and the 4-byte float value.
+     */
+    Check,
+    /**
+     * @brief Wait for a packet to reach the main channel, such as the reply
+     * to a command sent: the 2-byte type and the 4-byte timeout.
+     */
+    WaitPacket,
+    /** @brief Continue from an offset: the 2-byte offset. */
+    Jump,
+    /** @brief Continue from an offset if the result is set. */
+    JumpIf,
+    /** @brief Continue from an offset unless the result is set. */
+    JumpUnless,
+    /** @brief End the sequence as failed. */
+    Fail,
+  };
+
+  /** @brief Enumeration of the comparisons of a telemetry point. */
+  enum class Comparison : uint8_t {
+    /** @brief The point is below the value. */
+    Below,
+    /** @brief The point is above the value. */
+    Above,
+    /** @brief The point is the value, such as a switch's state. */
+    Equal,
+  };
+
+  /** @brief Enumeration of the states of the sequence engine. */
+  enum class SequenceState : uint8_t {
+    /** @brief No sequence has been run. */
+    Idle,
+    /** @brief A sequence is running. */
+    Running,
+    /** @brief The sequence reached its end. */
+    Done,
+    /** @brief The sequence ran a Fail instruction. */
+    Failed,
+    /** @brief The sequence was stopped from the ground. */
+    Stopped,
+  };
+
+  /** @brief A command sent by a sequence. */
+  struct sequence_command {
+    /** @brief The node the command is addressed to. */
+    uint8_t        node;
+    /** @brief The PacketComm::TypeId of the command. */
+    uint16_t       type;
+    /** @brief The number of bytes of data. */
+    uint8_t        size;
+    /** @brief The data, within the sequence. */
+    const uint8_t *data;
+  };
+
+  /** @brief A sequence, as it is kept across resets. */
+  struct __attribute__((packed)) sequence_slot {
+    /** @brief The size of the sequence, or 0 if the slot holds none. */
+    uint16_t length = 0;
+    /** @brief The CRC-32 of the sequence. */
+    uint32_t crc    = 0;
+    /** @brief The sequence. */
+    uint8_t  code[SEQUENCE_SIZE]{};
+  };
+
+  /** @brief The state of the sequence engine, as reported to the ground. */
+  struct __attribute__((packed)) sequence_status {
+    /** @brief The slot of the sequence running or last run. */
+    uint8_t  slot     = 0;
+    /** @brief The SequenceState of the engine. */
+    uint8_t  state    = 0;
+    /** @brief The offset of the instruction running or last run. */
+    uint16_t position = 0;
+    /** @brief The result of the last wait or check. */
+    uint8_t  result   = 0;
+    /** @brief The length of the sequence in each slot, 0 for none. */
+    uint16_t lengths[SEQUENCE_SLOTS]{};
+  };
+
+  /**
+   * @brief Runs a sequence.
+   *
+   * The engine is stepped by its owner, which sends the commands it returns
+   * and tells it of the packets it sees. It does not copy the sequence, which
+   * must not change while it runs.
+   */
+  class SequenceEngine {
+  public:
+    void          start(uint8_t slot, const uint8_t *sequence, uint16_t size);
+    void          stop();
+    bool          step(uint32_t now, sequence_command &command);
+    void          observe(uint16_t type);
+    int32_t       point() const;
+
+    /** @brief The state of the engine. */
+    SequenceState state() const { return current; }
+    /** @brief The slot of the sequence running or last run. */
+    uint8_t       slot() const { return running_slot; }
+    /** @brief The offset of the instruction running or last run. */
+    uint16_t      position() const { return pc; }
+    /** @brief The result of the last wait or check. */
+    bool          result() const { return flag; }
+
+  private:
+    /** @brief The sequence. */
+    const uint8_t *code         = nullptr;
+    /** @brief The size of the sequence. */
+    uint16_t       length       = 0;
+    /** @brief The offset of the next instruction. */
+    uint16_t       pc           = 0;
+    /** @brief The slot of the sequence. */
+    uint8_t        running_slot = 0;
+    /** @brief The state of the engine. */
+    SequenceState  current      = SequenceState::Idle;
+    /** @brief The result of the last wait or check. */
+    bool           flag         = false;
+    /** @brief Whether the instruction at pc is a wait that has started. */
+    bool           waiting      = false;
+    /** @brief Whether the packet being waited for has been seen. */
+    bool           seen         = false;
+    /** @brief The uptime, in milliseconds, the current wait ends at. */
+    uint32_t       wait_end     = 0;
+  };
+
+  uint16_t instruction_size(const uint8_t *sequence, uint16_t size,
+                            uint16_t offset);
+  bool     check_sequence(const uint8_t *sequence, uint16_t size);
+} // namespace Commands
+} // namespace Artemis
+
+#endif // _COMMAND_SEQUENCE_H
@@ -0,0 +1,65 @@
+/**
+ * @file cpu_monitor.cpp
+ * @brief The thread CPU time monitor.
+ *
+ * This file contains definitions of the functions that count samples of the
+ * running thread and turn them into each thread's share of the processor.
+ */
+#include <cpu_monitor.h>
+
+namespace Helpers {
+namespace {
+  /**
+   * @brief The samples taken of each thread, since startup.
+   *
+   * They are written from an interrupt, and wrap around.
+   */
+  volatile uint32_t samples[CPU_MONITOR_THREADS];
+} // namespace
+
+/**
+ * @brief Count a sample of the running thread.
+ *
+ * This is called from the sampling timer's interrupt.
+ *
+ * @param thread_id The ID of the thread that was interrupted.
+ */
+void count_cpu_sample(uint8_t thread_id) {
+  samples[thread_id % CPU_MONITOR_THREADS]++;
+}
+
+/**
+ * @brief The samples taken of a thread.
+ *
+ * @param thread_id The ID of the thread.
+ * @return uint32_t The samples since startup, which wrap around.
+ */
+uint32_t get_cpu_samples(uint8_t thread_id) {
+  return samples[thread_id % CPU_MONITOR_THREADS];
+}
+
+/** @brief End the window, and keep the samples each thread took in it. */
+void CpuLoad::update() {
+  total = 0;
+  for (uint8_t i = 0; i < CPU_MONITOR_THREADS; i++) {
+    const uint32_t now = get_cpu_samples(i);
+    taken[i]           = now - start[i];
+    start[i]           = now;
+    total += taken[i];
+  }
+}
+
+/**
+ * @brief The share of the last window a thread ran for.
+ *
+ * @param thread_id The ID of the thread.
+ * @return uint16_t The share, in tenths of a percent, or 0 if no samples were
+ * taken.
+ */
+uint16_t CpuLoad::permille(uint8_t thread_id) const {
+  if (total == 0) {
+    return 0;
+  }
+  return (uint64_t)taken[thread_id % CPU_MONITOR_THREADS] * 1000 / total;
+}
+} // namespace Helpers
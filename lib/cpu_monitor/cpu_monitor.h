@@ -0,0 +1,47 @@
+/**
+ * @file cpu_monitor.h
+ * @brief The header file for the thread CPU time monitor.
+ *
+ * This file contains declarations for the CPU time monitor, which estimates
+ * how much of the processor each thread uses. A timer interrupt samples the
+ * running thread at a fixed rate, and the share of samples that land in a
+ * thread is the share of time it ran.
+ */
+#ifndef _CPU_MONITOR_H
+#define _CPU_MONITOR_H
+
+#include <stdint.h>
+
+/** @brief The number of thread IDs counted, as in TeensyThreads. */
+#define CPU_MONITOR_THREADS   16
+/** @brief The time, in microseconds, between samples of the running thread. */
+#define CPU_MONITOR_SAMPLE_US 1000
+
+namespace Helpers {
+void     count_cpu_sample(uint8_t thread_id);
+uint32_t get_cpu_samples(uint8_t thread_id);
+
+/**
+ * @brief The share of samples each thread took over a window of time.
+ *
+ * Each call to update() ends a window and starts the next.
+ */
+class CpuLoad {
+public:
+  void     update();
+  uint16_t permille(uint8_t thread_id) const;
+
+  /** @brief The number of samples taken in the last window. */
+  uint32_t samples() const { return total; }
+
+private:
+  /** @brief The samples of each thread when the window started. */
+  uint32_t start[CPU_MONITOR_THREADS] = {};
+  /** @brief The samples of each thread in the last window. */
+  uint32_t taken[CPU_MONITOR_THREADS] = {};
+  /** @brief The samples of every thread in the last window. */
+  uint32_t total                      = 0;
+};
+} // namespace Helpers
+
+#endif // _CPU_MONITOR_H
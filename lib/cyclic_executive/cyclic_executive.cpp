@@ -0,0 +1,108 @@
+/**
+ * @file cyclic_executive.cpp
+ * @brief The cyclic executive.
+ *
+ * This file contains definitions of the functions that release the slots of
+ * a schedule and keep the run times of their tasks.
+ */
+#include <cyclic_executive.h>
+
+namespace Helpers {
+/**
+ * @brief Construct a new cyclic executive.
+ *
+ * @param schedule The schedule, which must outlive the executive.
+ * @param count The number of slots in the schedule.
+ */
+CyclicExecutive::CyclicExecutive(const executive_slot *schedule, uint8_t count)
+    : table(schedule), slots(count) {}
+
+/**
+ * @brief Start the first minor frame.
+ *
+ * @param now The uptime, in milliseconds.
+ */
+void CyclicExecutive::start(uint32_t now) {
+  frame_start = now;
+  frame       = 0;
+  position    = 0;
+}
+
+/**
+ * @brief Find the slot to run now.
+ *
+ * Once the minor frame has ended, the slots of it that have not run are
+ * dropped, and the next frame starts.
+ *
+ * @param now The uptime, in milliseconds.
+ * @return int8_t The slot, or -1 if none is due yet.
+ */
+int8_t CyclicExecutive::next(uint32_t now) {
+  if (now - frame_start >= EXECUTIVE_MINOR_FRAME) {
+    const uint32_t frames = (now - frame_start) / EXECUTIVE_MINOR_FRAME;
+    skipped_frames += frames - 1;
+    frame_start += frames * EXECUTIVE_MINOR_FRAME;
+    frame    = (frame + frames) % EXECUTIVE_MINOR_FRAMES;
+    position = 0;
+  }
+  for (; position < slots; position++) {
+    const executive_slot &slot = table[position];
+    if (frame % slot.every != slot.phase) {
+      continue;
+    }
+    if (now - frame_start < slot.offset) {
+      return -1;
+    }
+    return position++;
+  }
+  return -1;
+}
+
+/**
+ * @brief The time until the next slot is due.
+ *
+ * @param now The uptime, in milliseconds.
+ * @return uint32_t The time, in milliseconds, until the next slot of the
+ * minor frame, or until the next frame if none is left.
+ */
+uint32_t CyclicExecutive::wait(uint32_t now) const {
+  uint32_t release = frame_start + EXECUTIVE_MINOR_FRAME;
+  for (uint8_t i = position; i < slots; i++) {
+    if (frame % table[i].every == table[i].phase) {
+      release = frame_start + table[i].offset;
+      break;
+    }
+  }
+  return (int32_t)(release - now) > 0 ? release - now : 0;
+}
+
+/**
+ * @brief Keep the run time of a slot's task.
+ *
+ * A task still running when its minor frame ended has overrun it.
+ *
+ * @param slot The slot, as returned by next().
+ * @param elapsed_us The time, in microseconds, the task ran for.
+ * @param now The uptime, in milliseconds, when it finished.
+ */
+void CyclicExecutive::finish(uint8_t slot, uint32_t elapsed_us, uint32_t now) {
+  executive_task &stats = tasks[table[slot].task % EXECUTIVE_TASKS];
+  stats.runs++;
+  if (elapsed_us > stats.worst_us) {
+    stats.worst_us = elapsed_us;
+  }
+  if (now - frame_start >= EXECUTIVE_MINOR_FRAME) {
+    stats.overruns++;
+  }
+}
+
+/**
+ * @brief Get the run times of a task.
+ *
+ * @param task The task, below EXECUTIVE_TASKS.
+ * @return const executive_task& The run times.
+ */
+const executive_task &CyclicExecutive::get_task(uint8_t task) const {
+  return tasks[task % EXECUTIVE_TASKS];
+}
+} // namespace Helpers
@@ -0,0 +1,91 @@
+/**
+ * @file cyclic_executive.h
+ * @brief The header file for the cyclic executive.
+ *
+ * This file contains declarations for the cyclic executive, which runs tasks
+ * from a static schedule at fixed times. Time is divided into minor frames of
+ * EXECUTIVE_MINOR_FRAME, and EXECUTIVE_MINOR_FRAMES of them make a major
+ * frame, after which the schedule repeats. Each slot of the schedule runs a
+ * task at an offset into the minor frames it is in. Release times are counted
+ * from when the executive started, so they do not drift with the time the
+ * tasks take.
+ */
+#ifndef _CYCLIC_EXECUTIVE_H
+#define _CYCLIC_EXECUTIVE_H
+
+#include <stdint.h>
+
+/** @brief The length, in milliseconds, of a minor frame. */
+#define EXECUTIVE_MINOR_FRAME  100
+/** @brief The number of minor frames in a major frame. */
+#define EXECUTIVE_MINOR_FRAMES 10
+/** @brief The number of tasks whose run times are kept. */
+#define EXECUTIVE_TASKS        8
+
+namespace Helpers {
+/** @brief A slot of the schedule. */
+struct executive_slot {
+  /** @brief The time, in milliseconds, into the minor frame it runs at. */
+  uint8_t offset;
+  /** @brief The number of minor frames between runs, from 1 for every one. */
+  uint8_t every;
+  /** @brief The first minor frame it runs in, below every. */
+  uint8_t phase;
+  /** @brief The task it runs, below EXECUTIVE_TASKS. */
+  uint8_t task;
+};
+
+/** @brief The run times of a task. */
+struct executive_task {
+  /** @brief The number of times it ran. */
+  uint32_t runs     = 0;
+  /** @brief The longest time, in microseconds, it ran for. */
+  uint32_t worst_us = 0;
+  /** @brief The number of times it was still running when its frame ended. */
+  uint16_t overruns = 0;
+};
+
+/**
+ * @brief Releases the slots of a schedule at their times.
+ *
+ * The slots must be in order of their offsets, and each slot's every must
+ * divide EXECUTIVE_MINOR_FRAMES. If the tasks fall so far behind that a whole
+ * minor frame passes, the frames missed are skipped rather than run late, and
+ * counted as overruns of the executive.
+ */
+class CyclicExecutive {
+public:
+  CyclicExecutive(const executive_slot *schedule, uint8_t count);
+
+  void                  start(uint32_t now);
+  int8_t                next(uint32_t now);
+  uint32_t              wait(uint32_t now) const;
+  void                  finish(uint8_t slot, uint32_t elapsed_us,
+                               uint32_t now);
+
+  /** @brief The task a slot runs. */
+  uint8_t               task(uint8_t slot) const { return table[slot].task; }
+  const executive_task &get_task(uint8_t task) const;
+
+  /** @brief The number of minor frames skipped. */
+  uint16_t              skipped() const { return skipped_frames; }
+
+private:
+  /** @brief The schedule. */
+  const executive_slot *table;
+  /** @brief The number of slots in the schedule. */
+  uint8_t               slots;
+  /** @brief The uptime, in milliseconds, the current minor frame started. */
+  uint32_t              frame_start    = 0;
+  /** @brief The current minor frame, from 0. */
+  uint8_t               frame          = 0;
+  /** @brief The next slot of the schedule to be checked in the frame. */
+  uint8_t               position       = 0;
+  /** @brief The number of minor frames skipped. */
+  uint16_t              skipped_frames = 0;
+  /** @brief The run times of each task. */
+  executive_task        tasks[EXECUTIVE_TASKS];
+};
+} // namespace Helpers
+
+#endif // _CYCLIC_EXECUTIVE_H
@@ -0,0 +1,289 @@
+/**
+ * @file debug_log.cpp
+ * @brief The deferred debug log.
+ *
+ * This file contains definitions of the debug log's ring buffer and of the
+ * function that turns a debug message back into text.
+ */
+#include <debug_log.h>
+#include <stdarg.h>
+#include <stdio.h>
+
+namespace Helpers {
+namespace {
+  /** @brief The mask that turns a position into an index of a ring. */
+  const uint32_t RING_MASK = DEBUG_LOG_RING_SIZE - 1;
+  static_assert((DEBUG_LOG_RING_SIZE & RING_MASK) == 0,
+                "DEBUG_LOG_RING_SIZE must be a power of two");
+
+  /** @brief A line of text being built, which is cut off when it is full. */
+  struct line_writer {
+    char    *line;
+    uint16_t max_size;
+    uint16_t length;
+
+    /** @brief Append formatted text to the line. */
+    void     append(const char *format, ...) {
+      if (length + 1 >= max_size) {
+        return;
+      }
+      va_list args;
+      va_start(args, format);
+      const int written =
+          vsnprintf(&line[length], max_size - length, format, args);
+      va_end(args);
+      if (written > 0) {
+        length += written < max_size - length ? written
+                                              : max_size - length - 1;
+      }
+    }
+  };
+
+  /** @brief The prefix of each channel's messages. */
+  const char *channel_prefix(Short_Name channel) {
+    switch (channel) {
+      case PDU:
+        return "[PDU ] ";
+      case RFM23:
+        return "[RM23] ";
+      case RPI:
+        return "[R-PI] ";
+      case MAIN:
+        return "[MAIN] ";
+      case TEST:
+        return "[TEST] ";
+      case STORAGE:
+        return "[STOR] ";
+      default:
+        return "[????] ";
+    }
+  }
+} // namespace
+
+std::atomic<LogLevel> log_levels[DEBUG_LOG_CHANNELS] = {
+    {LogLevel::Rapid}, {LogLevel::Rapid}, {LogLevel::Rapid}, {LogLevel::Rapid},
+    {LogLevel::Rapid}, {LogLevel::Rapid}, {LogLevel::Rapid}, {LogLevel::Rapid},
+};
+
+/**
+ * @brief Change the log level of a channel.
+ *
+ * @param channel The Short_Name of the channel, or 0 for every channel.
+ * @param level The least important level to print.
+ * @return true The log level has been changed.
+ * @return false The channel or level does not exist.
+ */
+bool set_log_level(uint8_t channel, LogLevel level) {
+  if (channel >= DEBUG_LOG_CHANNELS || level > LogLevel::Rapid) {
+    return false;
+  }
+  for (uint8_t i = 0; i < DEBUG_LOG_CHANNELS; i++) {
+    if (channel == 0 || channel == i) {
+      log_levels[i].store(level, std::memory_order_relaxed);
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Start writing a debug message.
+ *
+ * @param size The size of the whole message.
+ * @return true There is room, and the message can be written with put().
+ * @return false The ring is full, and the message has been counted as
+ * dropped.
+ */
+bool DebugRing::begin(uint32_t size) {
+  cursor = head.load(std::memory_order_relaxed);
+  if (DEBUG_LOG_RING_SIZE - (cursor - tail.load(std::memory_order_acquire)) <
+      size) {
+    dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Write part of a debug message.
+ *
+ * @param src A pointer to the data to be written.
+ * @param size The number of bytes to write.
+ */
+void DebugRing::put(const void *src, uint16_t size) {
+  const uint8_t *bytes = (const uint8_t *)src;
+  const uint32_t start = cursor & RING_MASK;
+  const uint32_t first = size < DEBUG_LOG_RING_SIZE - start
+                             ? size
+                             : DEBUG_LOG_RING_SIZE - start;
+  memcpy(&buffer[start], bytes, first);
+  memcpy(buffer, &bytes[first], size - first);
+  cursor += size;
+}
+
+/** @brief Finish writing a debug message, handing it to the reader. */
+void DebugRing::end() { head.store(cursor, std::memory_order_release); }
+
+/**
+ * @brief Look at the header of the oldest debug message.
+ *
+ * @param header The header of the message.
+ * @return true There is a message.
+ * @return false The ring is empty.
+ */
+bool DebugRing::peek(log_record_header &header) const {
+  const uint32_t position = tail.load(std::memory_order_relaxed);
+  if (position == head.load(std::memory_order_acquire)) {
+    return false;
+  }
+  copy_out(position, &header, sizeof(header));
+  return true;
+}
+
+/**
+ * @brief Take the oldest debug message out of the ring.
+ *
+ * @param record The buffer that will hold the message.
+ * @param max_size The size of the buffer.
+ * @return uint16_t The size of the message, or 0 if the ring is empty. A
+ * message larger than the buffer is dropped.
+ */
+uint16_t DebugRing::read(uint8_t *record, uint16_t max_size) {
+  log_record_header header;
+  if (!peek(header)) {
+    return 0;
+  }
+  const uint32_t position = tail.load(std::memory_order_relaxed);
+  if (header.size <= max_size) {
+    copy_out(position, record, header.size);
+  }
+  tail.store(position + header.size, std::memory_order_release);
+  return header.size <= max_size ? header.size : 0;
+}
+
+/**
+ * @brief Copy bytes out of the ring.
+ *
+ * @param position The position of the first byte.
+ * @param dst A pointer to where the bytes will be copied.
+ * @param size The number of bytes.
+ */
+void DebugRing::copy_out(uint32_t position, void *dst, uint16_t size) const {
+  uint8_t       *bytes = (uint8_t *)dst;
+  const uint32_t start = position & RING_MASK;
+  const uint32_t first = size < DEBUG_LOG_RING_SIZE - start
+                             ? size
+                             : DEBUG_LOG_RING_SIZE - start;
+  memcpy(bytes, &buffer[start], first);
+  memcpy(&bytes[first], buffer, size - first);
+}
+
+/**
+ * @brief Turn a debug message into the text print_debug() prints.
+ *
+ * The arguments are printed one after another, as they would be by
+ * std::ostream. Bytes are printed in hex, skipping spaces and line endings
+ * sent to the PDU.
+ *
+ * @param record A pointer to the message.
+ * @param size The size of the message.
+ * @param line The buffer that will hold the text.
+ * @param max_size The size of the buffer. Longer text is cut off.
+ * @return uint16_t The length of the text.
+ */
+uint16_t render_debug_log(const uint8_t *record, uint16_t size, char *line,
+                          uint16_t max_size) {
+  log_record_header header;
+  line_writer       text = {line, max_size, 0};
+  if (max_size == 0) {
+    return 0;
+  }
+  line[0] = '\0';
+  if (size < sizeof(header)) {
+    return 0;
+  }
+  memcpy(&header, record, sizeof(header));
+  text.append("%s", channel_prefix(header.channel));
+
+  uint16_t position = sizeof(header);
+  while (position < size) {
+    const LogArg kind = (LogArg)record[position++];
+    if (kind == LogArg::String || kind == LogArg::Bytes) {
+      const uint8_t count = record[position++];
+      for (uint8_t i = 0; i < count && position + i < size; i++) {
+        const uint8_t byte = record[position + i];
+        if (kind == LogArg::String) {
+          text.append("%c", byte);
+        } else if (header.channel != PDU ||
+                   (byte != 0x20 && byte != 0x0D && byte != 0x0A)) {
+          text.append("%02x ", byte);
+        }
+      }
+      position += count;
+      continue;
+    }
+
+    const uint16_t value_size = kind == LogArg::Literal
+                                    ? sizeof(const char *)
+                                    : log_value_size(kind);
+    if (position + value_size > size) {
+      break;
+    }
+    const uint8_t *value = &record[position];
+    position += value_size;
+    switch (kind) {
+      case LogArg::Literal: {
+        const char *literal;
+        memcpy(&literal, value, sizeof(literal));
+        text.append("%s", literal);
+        break;
+      }
+      case LogArg::Char: {
+        text.append("%c", value[0]);
+        break;
+      }
+      case LogArg::Int32: {
+        int32_t number;
+        memcpy(&number, value, sizeof(number));
+        text.append("%ld", (long)number);
+        break;
+      }
+      case LogArg::UInt32: {
+        uint32_t number;
+        memcpy(&number, value, sizeof(number));
+        text.append("%lu", (unsigned long)number);
+        break;
+      }
+      case LogArg::Int64: {
+        int64_t number;
+        memcpy(&number, value, sizeof(number));
+        text.append("%lld", (long long)number);
+        break;
+      }
+      case LogArg::UInt64: {
+        uint64_t number;
+        memcpy(&number, value, sizeof(number));
+        text.append("%llu", (unsigned long long)number);
+        break;
+      }
+      case LogArg::Float: {
+        float number;
+        memcpy(&number, value, sizeof(number));
+        text.append("%g", number);
+        break;
+      }
+      case LogArg::Double: {
+        double number;
+        memcpy(&number, value, sizeof(number));
+        text.append("%g", number);
+        break;
+      }
+      default: {
+        // An unknown kind has no known size, so nothing after it can be read.
+        position = size;
+        break;
+      }
+    }
+  }
+  return text.length;
+}
+} // namespace Helpers
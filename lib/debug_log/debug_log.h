@@ -0,0 +1,405 @@
+/**
+ * @file debug_log.h
+ * @brief The header file for the deferred debug log.
+ *
+ * This file contains declarations for the deferred debug log. A debug message
+ * is written to a ring buffer as its raw arguments, which takes a few cycles
+ * and never blocks, and is turned into text later by a thread that has
+ * nothing better to do.
+ */
+#ifndef _DEBUG_LOG_H
+#define _DEBUG_LOG_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <type_traits>
+
+/** @brief The size, in bytes, of each ring. This must be a power of two. */
+#define DEBUG_LOG_RING_SIZE 1024
+/** @brief The largest text, in bytes, of one debug message. */
+#define DEBUG_LOG_LINE_SIZE 1024
+/** @brief The longest string, in bytes, copied into a debug message. */
+#define DEBUG_LOG_MAX_STRING 255
+/** @brief The number of channels with a runtime log level. */
+#define DEBUG_LOG_CHANNELS   8
+
+#if defined(DEBUG_PRINT) || defined(DEBUG_PRINT_RAPID) ||                      \
+    defined(DEBUG_PRINT_HEXDUMP) || defined(DEBUG_LOG_FLOOR)
+/** @brief Defined when any debug messages are printed. */
+#define DEBUG_LOG_ENABLED
+#endif
+
+/**
+ * @brief The least important LogLevel built into the binary.
+ *
+ * Messages below this level are removed by the compiler. It can be set with
+ * a build flag such as `-D DEBUG_LOG_FLOOR=Info`, and otherwise follows the
+ * DEBUG_PRINT flags.
+ */
+#ifndef DEBUG_LOG_FLOOR
+#if defined(DEBUG_PRINT) && defined(DEBUG_PRINT_RAPID)
+#define DEBUG_LOG_FLOOR Rapid
+#elif defined(DEBUG_PRINT)
+#define DEBUG_LOG_FLOOR Debug
+#else
+#define DEBUG_LOG_FLOOR Off
+#endif
+#endif
+
+namespace Helpers {
+/** @brief Enumeration of channels calling helper functions. */
+enum Short_Name : uint8_t {
+  RFM23 = 1,
+  PDU,
+  RPI,
+  MAIN,
+  TEST,
+  STORAGE,
+};
+static_assert(STORAGE < DEBUG_LOG_CHANNELS,
+              "DEBUG_LOG_CHANNELS must cover every Short_Name");
+
+/**
+ * @brief Enumeration of the levels of debug messages, from the most to the
+ * least important.
+ */
+enum class LogLevel : uint8_t {
+  /** @brief No messages. Only used as a log level, never for a message. */
+  Off,
+  Error,
+  Warning,
+  Info,
+  /** @brief The level of print_debug(). */
+  Debug,
+  /** @brief The level of print_debug_rapid(). */
+  Rapid,
+};
+
+/** @brief The least important LogLevel built into the binary. */
+constexpr LogLevel log_floor = LogLevel::DEBUG_LOG_FLOOR;
+
+/**
+ * @brief The least important LogLevel printed for each channel.
+ *
+ * These can be changed while running, and start at LogLevel::Rapid so that
+ * only log_floor applies.
+ */
+extern std::atomic<LogLevel> log_levels[DEBUG_LOG_CHANNELS];
+
+/**
+ * @brief Whether a message of a level is printed for a channel.
+ *
+ * A level below the floor is false at compile time, so the message it guards
+ * is removed. Otherwise this is one load and one branch.
+ *
+ * @tparam level The level of the message.
+ * @tparam floor The least important level built into the binary.
+ * @param channel The Short_Name of the channel writing the message.
+ */
+template <LogLevel level, LogLevel floor = log_floor>
+inline bool log_enabled(Short_Name channel) {
+  return level <= floor &&
+         level <= log_levels[channel].load(std::memory_order_relaxed);
+}
+
+bool set_log_level(uint8_t channel, LogLevel level);
+
+/** @brief Enumeration of the kinds of argument in a debug message. */
+enum class LogArg : uint8_t {
+  /** @brief A string wrapped in debug_literal, stored as its address. */
+  Literal,
+  /** @brief Any other string, stored as a length and its characters. */
+  String,
+  /** @brief Bytes printed in hex, stored as a length and the bytes. */
+  Bytes,
+  Char,
+  Int32,
+  UInt32,
+  Int64,
+  UInt64,
+  Float,
+  Double,
+};
+
+/** @brief The fields at the start of every debug message in a ring. */
+struct __attribute__((packed)) log_record_header {
+  /** @brief The size of the message, including this header. */
+  uint16_t   size;
+  /** @brief The time the message was written, in microseconds. */
+  uint32_t   timestamp;
+  /** @brief The channel that wrote the message. */
+  Short_Name channel;
+};
+/**<  A diagram of a debug message is included below.
+ *
+ * @verbatim
+2 bytes 4 bytes     1 byte    1 byte  n bytes      1 byte
++------+-----------+---------+-------+------------+-------+-----+
+| size | timestamp | channel | kind  | argument   | kind  | ... |
++------+-----------+---------+-------+------------+-------+-----+
+   @endverbatim
+ */
+
+/** @brief A region of memory to be printed in hex. */
+struct debug_bytes {
+  const uint8_t *data;
+  uint8_t        size;
+};
+
+/**
+ * @brief A string that stays in memory while the program runs, such as a
+ * string literal, stored as its address rather than copied.
+ */
+struct debug_literal {
+  const char *text;
+};
+
+/**
+ * @brief A ring buffer of debug messages.
+ *
+ * Each ring has one writer and one reader, so neither needs a lock: the
+ * writer only moves head and the reader only moves tail. A message that does
+ * not fit is dropped and counted rather than waiting for the reader.
+ */
+class DebugRing {
+public:
+  bool     begin(uint32_t size);
+  void     put(const void *src, uint16_t size);
+  void     end();
+  bool     peek(log_record_header &header) const;
+  uint16_t read(uint8_t *record, uint16_t max_size);
+
+  /**
+   * @brief Take the number of messages dropped since the last call.
+   *
+   * @return uint32_t The number of messages dropped.
+   */
+  uint32_t take_dropped() { return dropped.exchange(0); }
+
+private:
+  void                  copy_out(uint32_t position, void *dst,
+                                 uint16_t size) const;
+
+  /** @brief The messages. */
+  uint8_t               buffer[DEBUG_LOG_RING_SIZE];
+  /** @brief The position after the last whole message. */
+  std::atomic<uint32_t> head{0};
+  /** @brief The position of the oldest message. */
+  std::atomic<uint32_t> tail{0};
+  /** @brief The position the writer is writing at. */
+  uint32_t              cursor = 0;
+  /** @brief The number of messages dropped because the ring was full. */
+  std::atomic<uint32_t> dropped{0};
+};
+
+/**
+ * @brief How each type of argument is stored in a debug message.
+ *
+ * Each specialization gives the size of an argument in the ring and writes
+ * it there. Arguments are stored as they are passed, and only formatted when
+ * the message is printed.
+ *
+ * @tparam T The type of the argument.
+ */
+template <typename T, typename = void> struct log_arg;
+
+/** @brief Strings wrapped in debug_literal are stored as their address. */
+template <> struct log_arg<debug_literal> {
+  static uint16_t size(const debug_literal &) {
+    return 1 + sizeof(const char *);
+  }
+  static void put(DebugRing &ring, const debug_literal &arg) {
+    const LogArg kind = LogArg::Literal;
+    ring.put(&kind, sizeof(kind));
+    ring.put(&arg.text, sizeof(arg.text));
+  }
+};
+
+/**
+ * @brief Character arrays are copied up to their first null or their end.
+ *
+ * A string literal and a buffer on the stack are both character arrays, and
+ * the buffer may be gone or changed when the message is printed.
+ */
+template <size_t N> struct log_arg<char[N]> {
+  static uint8_t length(const char *arg) {
+    const size_t max = N < DEBUG_LOG_MAX_STRING ? N : DEBUG_LOG_MAX_STRING;
+    return strnlen(arg, max);
+  }
+  static uint16_t size(const char *arg) { return 2 + length(arg); }
+  static void     put(DebugRing &ring, const char *arg) {
+    const LogArg  kind  = LogArg::String;
+    const uint8_t count = length(arg);
+    ring.put(&kind, sizeof(kind));
+    ring.put(&count, sizeof(count));
+    ring.put(arg, count);
+  }
+};
+
+/** @brief Other strings are copied, as they may be gone when printed. */
+template <> struct log_arg<const char *> {
+  static uint8_t length(const char *arg) {
+    const size_t length = strlen(arg);
+    return length < DEBUG_LOG_MAX_STRING ? length : DEBUG_LOG_MAX_STRING;
+  }
+  static uint16_t size(const char *arg) { return 2 + length(arg); }
+  static void     put(DebugRing &ring, const char *arg) {
+    const LogArg  kind   = LogArg::String;
+    const uint8_t count  = length(arg);
+    ring.put(&kind, sizeof(kind));
+    ring.put(&count, sizeof(count));
+    ring.put(arg, count);
+  }
+};
+template <> struct log_arg<char *> : log_arg<const char *> {};
+template <> struct log_arg<std::string> {
+  static uint16_t size(const std::string &arg) {
+    return log_arg<const char *>::size(arg.c_str());
+  }
+  static void put(DebugRing &ring, const std::string &arg) {
+    log_arg<const char *>::put(ring, arg.c_str());
+  }
+};
+
+/** @brief Bytes to be printed in hex are copied. */
+template <> struct log_arg<debug_bytes> {
+  static uint16_t size(const debug_bytes &arg) { return 2 + arg.size; }
+  static void     put(DebugRing &ring, const debug_bytes &arg) {
+    const LogArg kind = LogArg::Bytes;
+    ring.put(&kind, sizeof(kind));
+    ring.put(&arg.size, sizeof(arg.size));
+    ring.put(arg.data, arg.size);
+  }
+};
+
+/** @brief The size, in bytes, of a number stored as a kind of argument. */
+constexpr uint16_t log_value_size(LogArg kind) {
+  return kind == LogArg::Char                                    ? 1
+         : kind == LogArg::Int64 || kind == LogArg::UInt64 ||
+                 kind == LogArg::Double
+             ? 8
+             : 4;
+}
+
+/**
+ * @brief Numbers and enumerations are stored as their value.
+ *
+ * As with std::ostream, single byte integers are printed as characters.
+ */
+template <typename T>
+struct log_arg<T, typename std::enable_if<std::is_arithmetic<T>::value ||
+                                          std::is_enum<T>::value>::type> {
+  /** @brief The arithmetic type of T, or of its values if it is an enum. */
+  using base = typename std::conditional<std::is_enum<T>::value,
+                                         std::underlying_type<T>,
+                                         std::common_type<T>>::type::type;
+
+  /** @brief How the value is stored. */
+  static constexpr LogArg kind() {
+    return std::is_floating_point<base>::value
+               ? (sizeof(base) == 4 ? LogArg::Float : LogArg::Double)
+           : sizeof(base) == 1 && !std::is_same<base, bool>::value
+               ? LogArg::Char
+           : std::is_signed<base>::value
+               ? (sizeof(base) <= 4 ? LogArg::Int32 : LogArg::Int64)
+               : (sizeof(base) <= 4 ? LogArg::UInt32 : LogArg::UInt64);
+  }
+
+  static uint16_t size(const T &) { return 1 + log_value_size(kind()); }
+
+  static void put(DebugRing &ring, const T &arg) {
+    const LogArg stored = kind();
+    const base   value  = (base)arg;
+    ring.put(&stored, sizeof(stored));
+    switch (stored) {
+      case LogArg::Char:
+        put_as<char>(ring, value);
+        break;
+      case LogArg::Int32:
+        put_as<int32_t>(ring, value);
+        break;
+      case LogArg::UInt32:
+        put_as<uint32_t>(ring, value);
+        break;
+      case LogArg::Int64:
+        put_as<int64_t>(ring, value);
+        break;
+      case LogArg::UInt64:
+        put_as<uint64_t>(ring, value);
+        break;
+      case LogArg::Float:
+        put_as<float>(ring, value);
+        break;
+      default:
+        put_as<double>(ring, value);
+        break;
+    }
+  }
+
+  template <typename U> static void put_as(DebugRing &ring, base value) {
+    const U stored = (U)value;
+    ring.put(&stored, sizeof(stored));
+  }
+};
+
+/** @brief The size of no arguments. */
+inline uint16_t log_args_size() { return 0; }
+
+/**
+ * @brief The size of a debug message's arguments in a ring.
+ *
+ * @tparam Arg The type of the first argument.
+ * @tparam Args The types of the remaining arguments.
+ */
+template <typename Arg, typename... Args>
+uint16_t log_args_size(const Arg &arg, const Args &...args) {
+  return log_arg<Arg>::size(arg) + log_args_size(args...);
+}
+
+/** @brief Write no arguments. */
+inline void put_log_args(DebugRing &) {}
+
+/**
+ * @brief Write a debug message's arguments to a ring.
+ *
+ * @tparam Arg The type of the first argument.
+ * @tparam Args The types of the remaining arguments.
+ */
+template <typename Arg, typename... Args>
+void put_log_args(DebugRing &ring, const Arg &arg, const Args &...args) {
+  log_arg<Arg>::put(ring, arg);
+  put_log_args(ring, args...);
+}
+
+/**
+ * @brief Write a debug message to a ring.
+ *
+ * The message is dropped if the ring is full.
+ *
+ * @tparam Args The types of the arguments.
+ * @param ring The ring of the calling thread.
+ * @param timestamp The time, in microseconds.
+ * @param channel The Short_Name of the channel writing the message.
+ * @param args The arguments, printed one after another.
+ */
+template <typename... Args>
+void write_debug_log(DebugRing &ring, uint32_t timestamp, Short_Name channel,
+                     const Args &...args) {
+  const uint32_t size = sizeof(log_record_header) + log_args_size(args...);
+  if (!ring.begin(size)) {
+    return;
+  }
+  const log_record_header header = {(uint16_t)size, timestamp, channel};
+  ring.put(&header, sizeof(header));
+  put_log_args(ring, args...);
+  ring.end();
+}
+
+uint16_t render_debug_log(const uint8_t *record, uint16_t size, char *line,
+                          uint16_t max_size);
+} // namespace Helpers
+
+#endif // _DEBUG_LOG_H
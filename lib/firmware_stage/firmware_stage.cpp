@@ -0,0 +1,502 @@
+/**
+ * @file firmware_stage.cpp
+ * @brief The FirmwareStage class.
+ *
+ * This file contains definitions for the FirmwareStage class, which stages a
+ * firmware image uploaded in chunks, and for the targets it installs images
+ * to.
+ */
+#include <checksum.h>
+#include <firmware_stage.h>
+#include <string.h>
+
+namespace Artemis {
+namespace Storage {
+  static_assert(FIRMWARE_MAX_SIZE <= (uint32_t)FIRMWARE_MAX_CHUNKS *
+                                         FIRMWARE_CHUNK_MAX,
+                "The largest image must fit in the largest chunks");
+  static_assert(FIRMWARE_IMAGE_OFFSET % BLOCK_DEVICE_SECTOR_SIZE == 0,
+                "The image must start on a sector boundary");
+
+  namespace {
+    /** @brief The CRC-32 of a header, without its CRC field. */
+    uint32_t header_crc(const firmware_header &header) {
+      return Helpers::crc32((const uint8_t *)&header,
+                            offsetof(firmware_header, crc));
+    }
+
+    /**
+     * @brief The number of chunks an image is split into, or 0 if the image
+     * or chunk size is not allowed.
+     */
+    uint32_t count_chunks(uint32_t image_size, uint16_t chunk_size) {
+      if (image_size == 0 || image_size > FIRMWARE_MAX_SIZE ||
+          chunk_size == 0 || chunk_size > FIRMWARE_CHUNK_MAX) {
+        return 0;
+      }
+      const uint32_t count = (image_size + chunk_size - 1) / chunk_size;
+      return count <= FIRMWARE_MAX_CHUNKS ? count : 0;
+    }
+  } // namespace
+
+  /**
+   * @brief Construct a new FirmwareStage object.
+   *
+   * @param stage_device The device that will hold the staging area.
+   */
+  FirmwareStage::FirmwareStage(BlockDevice *stage_device)
+      : device(stage_device) {}
+
+  /**
+   * @brief Open the staging area, finding any upload left by a reset.
+   *
+   * @return true The staging area holds an upload, and the chunks that have
+   * arrived have been counted.
+   * @return false It holds none, or its header is damaged, and it is empty.
+   */
+  bool FirmwareStage::open() {
+    header         = firmware_header();
+    chunk_count    = 0;
+    received_count = 0;
+
+    firmware_header stored;
+    if (!device->read(0, (uint8_t *)&stored, sizeof(stored)) ||
+        stored.version != FIRMWARE_STAGE_VERSION ||
+        stored.crc != header_crc(stored) ||
+        stored.state == (uint8_t)FirmwareState::Empty ||
+        stored.state > (uint8_t)FirmwareState::Activated) {
+      return false;
+    }
+    const uint32_t count = count_chunks(stored.image_size, stored.chunk_size);
+    const uint32_t size  = device->size();
+    // Only an upload still being received may be short of its image, as the
+    // device is grown while chunks arrive.
+    if (count == 0 || size < FIRMWARE_CRC_OFFSET ||
+        (stored.state != (uint8_t)FirmwareState::Receiving &&
+         size < FIRMWARE_IMAGE_OFFSET + stored.image_size)) {
+      return false;
+    }
+
+    const uint32_t bitmap_size = (count + 7) / 8;
+    for (uint32_t offset = 0; offset < bitmap_size; offset += sizeof(buffer)) {
+      const uint32_t size = bitmap_size - offset < sizeof(buffer)
+                                ? bitmap_size - offset
+                                : sizeof(buffer);
+      if (!device->read(FIRMWARE_BITMAP_OFFSET + offset, buffer, size)) {
+        received_count = 0;
+        return false;
+      }
+      for (uint32_t i = 0; i < size; i++) {
+        received_count += __builtin_popcount(buffer[i]);
+      }
+    }
+    header      = stored;
+    chunk_count = count;
+    grown_size  = size;
+    return true;
+  }
+
+  /**
+   * @brief Start an upload, or resume the same upload cut short.
+   *
+   * Any other upload is discarded. Only the header and the cleared bitmap
+   * are written here, and the rest of the device is grown by grow().
+   *
+   * @param image_size The size, in bytes, of the image.
+   * @param chunk_size The size, in bytes, of every chunk but the last.
+   * @param image_crc The CRC-32 of the image.
+   * @return StageResult Ok if the upload can be written.
+   */
+  StageResult FirmwareStage::begin(uint32_t image_size, uint16_t chunk_size,
+                                   uint32_t image_crc) {
+    const uint32_t count = count_chunks(image_size, chunk_size);
+    if (count == 0) {
+      return StageResult::BadSize;
+    }
+    if (state() == FirmwareState::Receiving &&
+        header.image_size == image_size && header.chunk_size == chunk_size &&
+        header.image_crc == image_crc) {
+      return StageResult::Ok;
+    }
+
+    header         = firmware_header();
+    chunk_count    = 0;
+    received_count = 0;
+    // Cutting the device back to the header clears the bitmap as it grows
+    // again. A reset before the header is saved leaves it too short to open.
+    if (device->size() > FIRMWARE_BITMAP_OFFSET &&
+        !device->truncate(FIRMWARE_BITMAP_OFFSET)) {
+      return StageResult::DeviceError;
+    }
+    if (!extend(FIRMWARE_CRC_OFFSET)) {
+      return StageResult::DeviceError;
+    }
+
+    header.state      = (uint8_t)FirmwareState::Receiving;
+    header.chunk_size = chunk_size;
+    header.image_size = image_size;
+    header.image_crc  = image_crc;
+    if (!save_header()) {
+      header = firmware_header();
+      return StageResult::DeviceError;
+    }
+    chunk_count = count;
+    return StageResult::Ok;
+  }
+
+  /**
+   * @brief Write a chunk of the image.
+   *
+   * The chunk is written to the device directly, along with its CRC-32 and
+   * its bit in the bitmap, before the device is synced.
+   *
+   * @param index The index of the chunk in the image.
+   * @param crc The CRC-32 of the chunk, as sent.
+   * @param chunk A pointer to the chunk.
+   * @param size The size of the chunk, which must be the chunk size, or the
+   * rest of the image for the last chunk.
+   * @return StageResult Ok if the chunk has been written, or NotReady if the
+   * device has not yet grown to hold it.
+   */
+  StageResult FirmwareStage::write(uint16_t index, uint32_t crc,
+                                   const uint8_t *chunk, uint16_t size) {
+    if (state() != FirmwareState::Receiving) {
+      return StageResult::WrongState;
+    }
+    if (index >= chunk_count) {
+      return StageResult::BadIndex;
+    }
+    if (size != chunk_length(index)) {
+      return StageResult::BadSize;
+    }
+    if (Helpers::crc32(chunk, size) != crc) {
+      return StageResult::BadCrc;
+    }
+    const uint32_t offset =
+        FIRMWARE_IMAGE_OFFSET + (uint32_t)index * header.chunk_size;
+    if (offset + size > grown_size) {
+      return StageResult::NotReady;
+    }
+    if (!device->write(offset, chunk, size) ||
+        !device->write(FIRMWARE_CRC_OFFSET + 4 * (uint32_t)index,
+                       (const uint8_t *)&crc, sizeof(crc)) ||
+        !mark(index, true) || !device->sync()) {
+      return StageResult::DeviceError;
+    }
+    return StageResult::Ok;
+  }
+
+  /**
+   * @brief Grow the device a step toward holding the whole image.
+   *
+   * At most FIRMWARE_GROW_STEP bytes are written, so this can be called
+   * between other uses of the device until growing() is false.
+   *
+   * @return StageResult Ok if the device has grown, or has no more to grow.
+   */
+  StageResult FirmwareStage::grow() {
+    if (!growing()) {
+      return StageResult::Ok;
+    }
+    const uint32_t end  = FIRMWARE_IMAGE_OFFSET + header.image_size;
+    const uint32_t step = grown_size + FIRMWARE_GROW_STEP;
+    return extend(step < end ? step : end) ? StageResult::Ok
+                                           : StageResult::DeviceError;
+  }
+
+  /**
+   * @brief Check an upload once every chunk has arrived.
+   *
+   * Every chunk is read back, one at a time, and checked against the CRC-32
+   * it arrived with. A chunk that fails is marked as missing, to be sent
+   * again. If all pass, the CRC-32 of the image is checked, and the staging
+   * area is Verified or Failed.
+   *
+   * @return StageResult Ok if the image has been verified.
+   */
+  StageResult FirmwareStage::verify() {
+    if (state() != FirmwareState::Receiving || received_count != chunk_count) {
+      return StageResult::WrongState;
+    }
+    uint32_t image_crc = 0;
+    bool     intact    = true;
+    for (uint16_t index = 0; index < chunk_count; index++) {
+      const uint16_t length = chunk_length(index);
+      uint32_t       crc;
+      if (!device->read(FIRMWARE_IMAGE_OFFSET +
+                            (uint32_t)index * header.chunk_size,
+                        buffer, length) ||
+          !device->read(FIRMWARE_CRC_OFFSET + 4 * (uint32_t)index,
+                        (uint8_t *)&crc, sizeof(crc))) {
+        return StageResult::DeviceError;
+      }
+      if (Helpers::crc32(buffer, length) != crc) {
+        if (!mark(index, false)) {
+          return StageResult::DeviceError;
+        }
+        intact = false;
+        continue;
+      }
+      image_crc = Helpers::crc32(buffer, length, image_crc);
+    }
+    if (!intact) {
+      return device->sync() ? StageResult::BadCrc : StageResult::DeviceError;
+    }
+
+    const bool matched = image_crc == header.image_crc;
+    header.state =
+        (uint8_t)(matched ? FirmwareState::Verified : FirmwareState::Failed);
+    if (!save_header()) {
+      return StageResult::DeviceError;
+    }
+    return matched ? StageResult::Ok : StageResult::BadCrc;
+  }
+
+  /**
+   * @brief Mark a verified image to be installed.
+   *
+   * @return StageResult Ok if the image has been marked.
+   */
+  StageResult FirmwareStage::activate() {
+    if (state() != FirmwareState::Verified) {
+      return StageResult::WrongState;
+    }
+    header.state = (uint8_t)FirmwareState::Activated;
+    if (!save_header()) {
+      header.state = (uint8_t)FirmwareState::Verified;
+      return StageResult::DeviceError;
+    }
+    return StageResult::Ok;
+  }
+
+  /**
+   * @brief Install an activated image, and boot it.
+   *
+   * The image is copied to the target a chunk at a time, then read back from
+   * it and checked against the CRC-32 of the image. The staging area is left
+   * Activated while the image boots, so that the image staged is not lost if
+   * the boot is cut short. If it cannot be installed, the image is left
+   * Verified, to be activated again or discarded.
+   *
+   * @param target Where the image is installed.
+   * @param progress Called after each chunk is copied or checked, such as to
+   * count a heartbeat, or nullptr.
+   * @return StageResult The result, if the image was not booted:
+   * NotSupported if it was copied and checked, but the target cannot boot
+   * it.
+   */
+  StageResult FirmwareStage::install(FirmwareTarget &target,
+                                     void (*progress)()) {
+    if (state() != FirmwareState::Activated) {
+      return StageResult::WrongState;
+    }
+    StageResult result    = StageResult::Ok;
+    uint32_t    image_crc = 0;
+    if (!target.prepare(header.image_size)) {
+      result = StageResult::BadSize;
+    }
+    for (uint16_t index = 0; index < chunk_count && result == StageResult::Ok;
+         index++) {
+      const uint32_t offset = (uint32_t)index * header.chunk_size;
+      const uint16_t length = chunk_length(index);
+      if (!device->read(FIRMWARE_IMAGE_OFFSET + offset, buffer, length) ||
+          !target.program(offset, buffer, length)) {
+        result = StageResult::DeviceError;
+      }
+      if (progress != nullptr) {
+        progress();
+      }
+    }
+    for (uint16_t index = 0; index < chunk_count && result == StageResult::Ok;
+         index++) {
+      const uint16_t length = chunk_length(index);
+      if (!target.read((uint32_t)index * header.chunk_size, buffer, length)) {
+        result = StageResult::DeviceError;
+        break;
+      }
+      image_crc = Helpers::crc32(buffer, length, image_crc);
+      if (progress != nullptr) {
+        progress();
+      }
+    }
+    if (result == StageResult::Ok && image_crc != header.image_crc) {
+      result = StageResult::BadCrc;
+    }
+
+    if (result == StageResult::Ok && !target.boot(header.image_size)) {
+      result = StageResult::NotSupported;
+    }
+    header.state = (uint8_t)FirmwareState::Verified;
+    return save_header() ? result : StageResult::DeviceError;
+  }
+
+  /**
+   * @brief Discard the upload, and free the space it used.
+   *
+   * @return StageResult Ok if the staging area is empty.
+   */
+  StageResult FirmwareStage::abort() {
+    header         = firmware_header();
+    chunk_count    = 0;
+    received_count = 0;
+    grown_size     = 0;
+    if (!device->truncate(0) || !save_header()) {
+      return StageResult::DeviceError;
+    }
+    return StageResult::Ok;
+  }
+
+  /**
+   * @brief Report the state of the upload.
+   *
+   * @param window_start The first chunk whose bit is reported.
+   * @param status The status.
+   * @return true The status has been filled in.
+   * @return false The bitmap could not be read.
+   */
+  bool FirmwareStage::status(uint16_t window_start, firmware_status &status) {
+    status               = firmware_status();
+    status.state         = header.state;
+    status.chunk_size    = header.chunk_size;
+    status.image_size    = header.image_size;
+    status.received      = received_count;
+    status.first_missing = chunk_count;
+    status.window_start  = window_start;
+    if (state() != FirmwareState::Receiving) {
+      return true;
+    }
+
+    const uint32_t bitmap_size = (chunk_count + 7) / 8;
+    for (uint32_t offset = 0;
+         offset < bitmap_size && status.first_missing == chunk_count;
+         offset += sizeof(buffer)) {
+      const uint32_t size = bitmap_size - offset < sizeof(buffer)
+                                ? bitmap_size - offset
+                                : sizeof(buffer);
+      if (!device->read(FIRMWARE_BITMAP_OFFSET + offset, buffer, size)) {
+        return false;
+      }
+      for (uint32_t i = 0; i < size; i++) {
+        if (buffer[i] != 0xFF) {
+          const uint32_t index = 8 * (offset + i) + __builtin_ctz(~buffer[i]);
+          if (index < chunk_count) {
+            status.first_missing = index;
+          }
+          break;
+        }
+      }
+    }
+    if (window_start < chunk_count) {
+      const uint32_t first = window_start / 8;
+      const uint32_t size  = bitmap_size - first < sizeof(status.window)
+                                 ? bitmap_size - first
+                                 : sizeof(status.window);
+      if (!device->read(FIRMWARE_BITMAP_OFFSET + first, buffer, size + 1)) {
+        return false;
+      }
+      if (first + size == bitmap_size) {
+        buffer[size] = 0;
+      }
+      const uint8_t shift = window_start % 8;
+      for (uint32_t i = 0; i < size; i++) {
+        status.window[i] =
+            (buffer[i] >> shift) | (buffer[i + 1] << (8 - shift));
+      }
+    }
+    return true;
+  }
+
+  /** @brief Write the header, and sync the device. */
+  bool FirmwareStage::save_header() {
+    header.version = FIRMWARE_STAGE_VERSION;
+    header.crc     = header_crc(header);
+    return device->write(0, (const uint8_t *)&header, sizeof(header)) &&
+           device->sync();
+  }
+
+  /**
+   * @brief Grow the device with zeros, and sync it.
+   *
+   * @param end The size the device is grown to, in bytes.
+   * @return true The device is at least end bytes.
+   * @return false The device could not be written.
+   */
+  bool FirmwareStage::extend(uint32_t end) {
+    memset(buffer, 0, sizeof(buffer));
+    uint32_t size = device->size();
+    while (size < end) {
+      const uint32_t length =
+          end - size < sizeof(buffer) ? end - size : sizeof(buffer);
+      if (!device->write(size, buffer, length)) {
+        grown_size = device->size();
+        return false;
+      }
+      size += length;
+    }
+    grown_size = size;
+    return device->sync();
+  }
+
+  /**
+   * @brief Mark a chunk as arrived or missing, without syncing the device.
+   *
+   * @param index The index of the chunk.
+   * @param arrived Whether the chunk has arrived.
+   * @return true The bitmap has been written.
+   * @return false The bitmap could not be read or written.
+   */
+  bool FirmwareStage::mark(uint16_t index, bool arrived) {
+    const uint32_t offset = FIRMWARE_BITMAP_OFFSET + index / 8;
+    const uint8_t  bit    = 1 << (index % 8);
+    uint8_t        bits;
+    if (!device->read(offset, &bits, 1)) {
+      return false;
+    }
+    if (((bits & bit) != 0) == arrived) {
+      return true;
+    }
+    bits = arrived ? bits | bit : bits & ~bit;
+    if (!device->write(offset, &bits, 1)) {
+      return false;
+    }
+    received_count += arrived ? 1 : -1;
+    return true;
+  }
+
+  /** @brief The size of a chunk of the image being uploaded. */
+  uint16_t FirmwareStage::chunk_length(uint16_t index) const {
+    const uint32_t start = (uint32_t)index * header.chunk_size;
+    return header.image_size - start < header.chunk_size
+               ? header.image_size - start
+               : header.chunk_size;
+  }
+
+  /**
+   * @brief Construct a new DeviceTarget object.
+   *
+   * @param target_device The device the image is copied to.
+   */
+  DeviceTarget::DeviceTarget(BlockDevice *target_device)
+      : device(target_device) {}
+
+  bool DeviceTarget::prepare(uint32_t size) {
+    (void)size;
+    return device->truncate(0);
+  }
+
+  bool DeviceTarget::program(uint32_t offset, const uint8_t *src,
+                             size_t size) {
+    return device->write(offset, src, size);
+  }
+
+  bool DeviceTarget::read(uint32_t offset, uint8_t *dst, size_t size) {
+    return device->sync() && device->read(offset, dst, size);
+  }
+
+  /** @brief The image cannot be booted, so it is only kept on the device. */
+  bool DeviceTarget::boot(uint32_t size) {
+    (void)size;
+    return false;
+  }
+} // namespace Storage
+} // namespace Artemis
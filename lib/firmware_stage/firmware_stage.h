@@ -0,0 +1,293 @@
+/**
+ * @file firmware_stage.h
+ * @brief The header file for the FirmwareStage class.
+ *
+ * This file contains declarations for the firmware staging area, which
+ * receives a new flight software image in chunks from the ground or the
+ * Raspberry Pi. Chunks are written straight to a block device as they arrive,
+ * so the image is never held in RAM, and which chunks have arrived is kept on
+ * the device so that an upload can be resumed after a reset. A verified image
+ * is installed by copying it to a FirmwareTarget, which then boots it. No
+ * target can yet boot an image on the Teensy, where images are only staged.
+ */
+#ifndef _FIRMWARE_STAGE_H
+#define _FIRMWARE_STAGE_H
+
+#include <block_device.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** @brief The version of the staging area's layout. */
+#define FIRMWARE_STAGE_VERSION 1
+/** @brief The largest image, in bytes, that can be staged. */
+#define FIRMWARE_MAX_SIZE      (2 * 1024 * 1024)
+/** @brief The most chunks an image can be split into. */
+#define FIRMWARE_MAX_CHUNKS    32768
+/** @brief The largest chunk, in bytes. */
+#define FIRMWARE_CHUNK_MAX     BLOCK_DEVICE_SECTOR_SIZE
+/** @brief The number of chunks whose state is given in a firmware_status. */
+#define FIRMWARE_STATUS_WINDOW 128
+/** @brief The offset of the bitmap of received chunks. */
+#define FIRMWARE_BITMAP_OFFSET BLOCK_DEVICE_SECTOR_SIZE
+/** @brief The size, in bytes, of the bitmap of received chunks. */
+#define FIRMWARE_BITMAP_SIZE   (FIRMWARE_MAX_CHUNKS / 8)
+/** @brief The offset of the CRC-32 of each chunk. */
+#define FIRMWARE_CRC_OFFSET    (FIRMWARE_BITMAP_OFFSET + FIRMWARE_BITMAP_SIZE)
+/** @brief The offset of the image. */
+#define FIRMWARE_IMAGE_OFFSET  (FIRMWARE_CRC_OFFSET + 4 * FIRMWARE_MAX_CHUNKS)
+/** @brief The most bytes the staging area is grown by in a call to grow(). */
+#define FIRMWARE_GROW_STEP     (16 * BLOCK_DEVICE_SECTOR_SIZE)
+
+namespace Artemis {
+namespace Storage {
+  /** @brief Enumeration of the actions of a CommandFirmware packet. */
+  enum class FirmwareAction : uint8_t {
+    /**
+     * @brief Start an upload: the 4-byte image size, the 2-byte chunk size
+     * and the 4-byte CRC-32 of the image. An upload of the same image that
+     * was cut short is resumed instead.
+     */
+    Begin,
+    /**
+     * @brief Write a chunk: the 2-byte index, the 4-byte CRC-32 of the chunk
+     * and the chunk.
+     */
+    Write,
+    /** @brief Check every chunk and the whole image once all have arrived. */
+    Verify,
+    /**
+     * @brief Mark a verified image to be installed. It is installed shortly
+     * after, once the command has been acknowledged. This is refused on the
+     * Teensy, which cannot yet boot an image safely.
+     */
+    Activate,
+    /** @brief Discard the upload. */
+    Abort,
+    /** @brief Report the upload: optionally, the 2-byte first chunk shown. */
+    Status,
+  };
+
+  /** @brief Enumeration of the states of the staging area. */
+  enum class FirmwareState : uint8_t {
+    /** @brief No image is being uploaded. */
+    Empty,
+    /** @brief Chunks are being written. */
+    Receiving,
+    /** @brief Every chunk and the whole image have been checked. */
+    Verified,
+    /**
+     * @brief Every chunk was intact, but the image did not match its CRC-32.
+     * A new upload must be begun.
+     */
+    Failed,
+    /** @brief The image is waiting to be installed. */
+    Activated,
+  };
+
+  /** @brief Enumeration of the results of changing the staging area. */
+  enum class StageResult : uint8_t {
+    Ok,
+    /** @brief The staging area is not in a state that allows the change. */
+    WrongState,
+    /** @brief The chunk is not part of the image. */
+    BadIndex,
+    /** @brief The image, chunk or chunk size is of a size not allowed. */
+    BadSize,
+    /** @brief A chunk or the image did not match its CRC-32. */
+    BadCrc,
+    /** @brief The device could not be read or written. */
+    DeviceError,
+    /**
+     * @brief The staging area has not yet grown to hold the chunk, which
+     * should be sent again later.
+     */
+    NotReady,
+    /** @brief The target cannot boot the image. */
+    NotSupported,
+  };
+
+  /** @brief The header at the start of the staging area. */
+  struct __attribute__((packed)) firmware_header {
+    /** @brief The FIRMWARE_STAGE_VERSION the header was written with. */
+    uint8_t  version    = FIRMWARE_STAGE_VERSION;
+    /** @brief The FirmwareState of the staging area. */
+    uint8_t  state      = (uint8_t)FirmwareState::Empty;
+    /** @brief The size, in bytes, of every chunk but the last. */
+    uint16_t chunk_size = 0;
+    /** @brief The size, in bytes, of the image. */
+    uint32_t image_size = 0;
+    /** @brief The CRC-32 of the image. */
+    uint32_t image_crc  = 0;
+    /** @brief The CRC-32 of the fields above. */
+    uint32_t crc        = 0;
+  };
+  /**<  A diagram of the staging area is included below.
+   *
+   * @verbatim
+0        FIRMWARE_BITMAP_OFFSET  FIRMWARE_CRC_OFFSET  FIRMWARE_IMAGE_OFFSET
++--------+-----------------------+--------------------+---------------------+
+| header | 1 bit per chunk       | CRC-32 per chunk   | image               |
++--------+-----------------------+--------------------+---------------------+
+     @endverbatim
+   *
+   * Space is kept for FIRMWARE_MAX_CHUNKS chunks, so the layout does not
+   * depend on the image.
+   */
+
+  /**
+   * @brief Where a verified image is installed.
+   *
+   * The image is copied to the target and checked there before boot() puts
+   * it in place of the running software.
+   */
+  class FirmwareTarget {
+  public:
+    virtual ~FirmwareTarget() {}
+
+    /**
+     * @brief Make room for an image, discarding any copied before.
+     *
+     * @param size The size of the image, in bytes.
+     * @return true The image can be copied.
+     * @return false There is no room for the image.
+     */
+    virtual bool prepare(uint32_t size)                                    = 0;
+
+    /**
+     * @brief Copy part of the image.
+     *
+     * @param offset The offset of the bytes in the image.
+     * @param src A pointer to the bytes.
+     * @param size The number of bytes.
+     * @return true The bytes have been copied.
+     * @return false The bytes could not be copied.
+     */
+    virtual bool program(uint32_t offset, const uint8_t *src, size_t size) = 0;
+
+    /**
+     * @brief Read back part of the image copied.
+     *
+     * @param offset The offset of the bytes in the image.
+     * @param dst A pointer to the buffer that will hold the bytes.
+     * @param size The number of bytes.
+     * @return true The bytes have been read.
+     * @return false The bytes could not be read.
+     */
+    virtual bool read(uint32_t offset, uint8_t *dst, size_t size)          = 0;
+
+    /**
+     * @brief Put the image copied in place of the running software, and
+     * start it.
+     *
+     * @param size The size of the image, in bytes.
+     * @return false The target cannot boot the image. Otherwise, this does
+     * not return.
+     */
+    virtual bool boot(uint32_t size)                                       = 0;
+  };
+
+  /**
+   * @brief A block device standing in for the Teensy's flash, which an image
+   * is copied to and checked on but cannot be booted from.
+   */
+  class DeviceTarget : public FirmwareTarget {
+  public:
+    DeviceTarget(BlockDevice *target_device);
+
+    bool         prepare(uint32_t size) override;
+    bool         program(uint32_t offset, const uint8_t *src,
+                         size_t size) override;
+    bool         read(uint32_t offset, uint8_t *dst, size_t size) override;
+    bool         boot(uint32_t size) override;
+
+  private:
+    /** @brief The device the image is copied to. */
+    BlockDevice *device;
+  };
+
+  /** @brief The state of an upload, as reported to the ground. */
+  struct __attribute__((packed)) firmware_status {
+    /** @brief The FirmwareState of the staging area. */
+    uint8_t  state         = 0;
+    /** @brief The size, in bytes, of every chunk but the last. */
+    uint16_t chunk_size    = 0;
+    /** @brief The size, in bytes, of the image. */
+    uint32_t image_size    = 0;
+    /** @brief The number of chunks that have arrived. */
+    uint16_t received      = 0;
+    /** @brief The first chunk that has not arrived, or the number of chunks. */
+    uint16_t first_missing = 0;
+    /** @brief The first chunk shown in window. */
+    uint16_t window_start  = 0;
+    /** @brief One bit per chunk from window_start, set if it has arrived. */
+    uint8_t  window[FIRMWARE_STATUS_WINDOW / 8]{};
+  };
+
+  /**
+   * @brief An area of a block device where a firmware image is staged.
+   *
+   * Each chunk is checked against its CRC-32 as it arrives and written to
+   * its place in the image, and its CRC-32 and a bit marking it as arrived
+   * are written alongside. Chunks may arrive in any order and more than once.
+   * Once all have arrived, verify() reads every chunk back against its
+   * CRC-32, so a chunk corrupted in storage is marked as missing again, and
+   * checks the CRC-32 of the whole image.
+   *
+   * The device is grown to hold the image a step at a time by grow(), as the
+   * SD card cannot write past the end of a file, and writing the whole image
+   * at once would keep the card from other channels for seconds.
+   *
+   * The staging area does not lock itself. Callers sharing it between threads
+   * must hold a mutex around every call.
+   */
+  class FirmwareStage {
+  public:
+    FirmwareStage(BlockDevice *stage_device);
+
+    bool          open();
+    StageResult   begin(uint32_t image_size, uint16_t chunk_size,
+                        uint32_t image_crc);
+    StageResult   write(uint16_t index, uint32_t crc, const uint8_t *chunk,
+                        uint16_t size);
+    StageResult   grow();
+    StageResult   verify();
+    StageResult   activate();
+    StageResult   install(FirmwareTarget &target, void (*progress)() = nullptr);
+    StageResult   abort();
+    bool          status(uint16_t window_start, firmware_status &status);
+
+    /** @brief The state of the staging area. */
+    FirmwareState state() const { return (FirmwareState)header.state; }
+    /** @brief Whether the device has yet to grow to hold the image. */
+    bool          growing() const {
+      return state() == FirmwareState::Receiving &&
+             grown_size < FIRMWARE_IMAGE_OFFSET + header.image_size;
+    }
+    /** @brief The number of chunks in the image being uploaded. */
+    uint16_t      chunks() const { return chunk_count; }
+    /** @brief The number of chunks that have arrived. */
+    uint16_t      received() const { return received_count; }
+
+  private:
+    bool            save_header();
+    bool            extend(uint32_t end);
+    bool            mark(uint16_t index, bool arrived);
+    uint16_t        chunk_length(uint16_t index) const;
+
+    /** @brief The device holding the staging area. */
+    BlockDevice    *device;
+    /** @brief The header of the staging area. */
+    firmware_header header;
+    /** @brief The number of chunks in the image being uploaded. */
+    uint16_t        chunk_count    = 0;
+    /** @brief The number of chunks that have arrived. */
+    uint16_t        received_count = 0;
+    /** @brief The size, in bytes, of the device. */
+    uint32_t        grown_size     = 0;
+    /** @brief A chunk, or a sector of the bitmap, read from the device. */
+    uint8_t         buffer[FIRMWARE_CHUNK_MAX];
+  };
+} // namespace Storage
+} // namespace Artemis
+
+#endif // _FIRMWARE_STAGE_H
@@ -0,0 +1,173 @@
+/**
+ * @file heap_track.cpp
+ * @brief The heap allocation tracker.
+ *
+ * This file contains definitions of the functions that tag, count and report
+ * heap allocations.
+ */
+#include <heap_track.h>
+
+namespace Helpers {
+namespace {
+  /**
+   * @brief The magic of a header for a block of a size.
+   *
+   * Mixing in the size means a stray pair of bytes must match the size next
+   * to it as well, so an untracked block is rarely taken for a tracked one.
+   */
+  uint16_t header_magic(uint32_t size) {
+    return HEAP_HEADER_MAGIC ^ (uint16_t)size ^ (uint16_t)(size >> 16);
+  }
+
+  /** @brief The allocations of each tag. */
+  heap_tag_stats        tags[HEAP_TAGS];
+  /** @brief The bytes held by every tracked block. */
+  std::atomic<uint32_t> live{0};
+  /** @brief The most bytes ever held by tracked blocks. */
+  std::atomic<uint32_t> peak{0};
+  /** @brief The number of allocations that failed. */
+  std::atomic<uint32_t> failures{0};
+  /** @brief The current tag of each thread. */
+  HeapTag               thread_tags[HEAP_TRACK_THREADS];
+  /** @brief Gets the ID of the running thread. */
+  uint8_t (*current_thread)() = nullptr;
+
+  /** @brief The current tag of the running thread. */
+  HeapTag &current_tag() {
+    const uint8_t thread = current_thread == nullptr ? 0 : current_thread();
+    return thread_tags[thread % HEAP_TRACK_THREADS];
+  }
+} // namespace
+
+/**
+ * @brief Set how the tracker finds the running thread.
+ *
+ * Until this is called, every allocation is made under the tag of thread 0.
+ *
+ * @param thread_id Returns the ID of the running thread.
+ */
+void set_heap_thread(uint8_t (*thread_id)()) { current_thread = thread_id; }
+
+/**
+ * @brief Set the tag a thread allocates under.
+ *
+ * @param thread The ID of the thread.
+ * @param tag The tag.
+ */
+void set_thread_heap_tag(uint8_t thread, HeapTag tag) {
+  thread_tags[thread % HEAP_TRACK_THREADS] = tag;
+}
+
+/**
+ * @brief Change the tag the running thread allocates under.
+ *
+ * @param tag The new tag.
+ * @return HeapTag The previous tag.
+ */
+HeapTag swap_heap_tag(HeapTag tag) {
+  HeapTag &current  = current_tag();
+  HeapTag  previous = current;
+  current           = tag;
+  return previous;
+}
+
+/**
+ * @brief Count a newly allocated block.
+ *
+ * @param block The block, at least HEAP_HEADER_SIZE bytes larger than
+ * requested, or nullptr if the allocation failed.
+ * @param size The size requested, in bytes.
+ * @param offset Where the header goes in the block, in bytes. This must be a
+ * multiple of HEAP_HEADER_SIZE below HEAP_MAX_ALIGNMENT, and is only given
+ * for an aligned block.
+ * @return void* The memory after the block's header, or nullptr.
+ */
+void *track_alloc(void *block, size_t size, size_t offset) {
+  if (block == nullptr) {
+    failures.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+  heap_header *header = (heap_header *)((uint8_t *)block + offset);
+  header->size        = size;
+  header->tag         = current_tag();
+  header->offset      = offset / HEAP_HEADER_SIZE;
+  header->magic       = header_magic(size);
+
+  heap_tag_stats &tag_stats = tags[(uint8_t)header->tag % HEAP_TAGS];
+  tag_stats.allocs.fetch_add(1, std::memory_order_relaxed);
+  tag_stats.live.fetch_add(size, std::memory_order_relaxed);
+  const uint32_t now = live.fetch_add(size, std::memory_order_relaxed) + size;
+  // A race between threads can only make the peak a little low.
+  if (now > peak.load(std::memory_order_relaxed)) {
+    peak.store(now, std::memory_order_relaxed);
+  }
+  return header + 1;
+}
+
+/**
+ * @brief Count a block about to be freed.
+ *
+ * @param ptr The memory returned by track_alloc().
+ * @return void* The block to free, including its header, or ptr itself if it
+ * was not allocated by the tracker.
+ */
+void *track_free(void *ptr) {
+  heap_header *header = tracked_header(ptr);
+  if (header == nullptr) {
+    return ptr;
+  }
+  heap_tag_stats &tag_stats = tags[(uint8_t)header->tag % HEAP_TAGS];
+  tag_stats.frees.fetch_add(1, std::memory_order_relaxed);
+  tag_stats.live.fetch_sub(header->size, std::memory_order_relaxed);
+  live.fetch_sub(header->size, std::memory_order_relaxed);
+  header->magic = 0;
+  return (uint8_t *)header - header->offset * HEAP_HEADER_SIZE;
+}
+
+/**
+ * @brief The header of a tracked block.
+ *
+ * Blocks allocated around the tracker have no header.
+ *
+ * @param ptr The memory returned by track_alloc().
+ * @return heap_header* The header, or nullptr if ptr is not tracked.
+ */
+heap_header *tracked_header(void *ptr) {
+  if (ptr == nullptr) {
+    return nullptr;
+  }
+  heap_header *header = (heap_header *)ptr - 1;
+  return header->magic == header_magic(header->size) ? header : nullptr;
+}
+
+/**
+ * @brief The bytes held by every tracked block.
+ *
+ * @return uint32_t The bytes, not including the headers.
+ */
+uint32_t heap_live() { return live.load(std::memory_order_relaxed); }
+
+/**
+ * @brief The most bytes ever held by tracked blocks.
+ *
+ * @return uint32_t The bytes, not including the headers.
+ */
+uint32_t heap_peak() { return peak.load(std::memory_order_relaxed); }
+
+/**
+ * @brief The number of allocations that failed.
+ *
+ * @return uint32_t The number of allocations.
+ */
+uint32_t heap_failures() { return failures.load(std::memory_order_relaxed); }
+
+/**
+ * @brief The allocations counted for a tag.
+ *
+ * @param tag The tag.
+ * @return const heap_tag_stats& The allocations.
+ */
+const heap_tag_stats &get_heap_tag(HeapTag tag) {
+  return tags[(uint8_t)tag % HEAP_TAGS];
+}
+} // namespace Helpers
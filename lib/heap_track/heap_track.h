@@ -0,0 +1,126 @@
+/**
+ * @file heap_track.h
+ * @brief The header file for the heap allocation tracker.
+ *
+ * This file contains declarations for the heap tracker, which counts the
+ * allocations made by each part of the flight software. Every block allocated
+ * is given a small header holding its size and the tag of its allocator, so
+ * that the bytes it held can be returned to that tag when it is freed.
+ *
+ * Each thread allocates under its own current tag, which start_channel() sets
+ * to the thread's Channel_ID. A HeapTagScope can change it for a call site,
+ * such as the packet queues. The counts are kept with atomics in static
+ * storage, so tracking can be left on in flight, and are sent in the heap
+ * beacon. A tag whose allocation count stays the same from beacon to beacon
+ * has not allocated in between.
+ *
+ * On the Teensy, newlib's allocator is wrapped by the linker (see
+ * heap_wrap.cpp), which also catches the allocations of operator new and of
+ * the C library.
+ */
+#ifndef _HEAP_TRACK_H
+#define _HEAP_TRACK_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+/** @brief The number of heap tags. */
+#define HEAP_TAGS          9
+/** @brief The number of threads whose current tag is kept. */
+#define HEAP_TRACK_THREADS 16
+/** @brief The size of the header before each tracked block, in bytes. */
+#define HEAP_HEADER_SIZE   8
+/**
+ * @brief The value marking a block header written by the tracker, before it
+ * is mixed with the block's size.
+ */
+#define HEAP_HEADER_MAGIC  0xA75C
+/** @brief The largest alignment, in bytes, of a tracked block. */
+#define HEAP_MAX_ALIGNMENT (256 * HEAP_HEADER_SIZE)
+
+namespace Helpers {
+/**
+ * @brief Enumeration of heap tags.
+ *
+ * The tags of the channels have the same values as Channel_ID.
+ */
+enum class HeapTag : uint8_t {
+  /** @brief The main channel, and anything allocated before the threads. */
+  Main,
+  RFM23,
+  PDU,
+  RPI,
+  Test,
+  Storage,
+  DebugLog,
+  /** @brief Packets pushed to the channel queues. */
+  Queues,
+  /** @brief Beacons made by the main channel. */
+  Beacons,
+};
+
+/** @brief The header before each tracked block. */
+struct heap_header {
+  /** @brief The size requested for the block, in bytes. */
+  uint32_t size;
+  /** @brief The HeapTag the block was allocated under. */
+  HeapTag  tag;
+  /**
+   * @brief The distance from the start of the allocator's block to the
+   * header, in units of HEAP_HEADER_SIZE. Only an aligned block has one.
+   */
+  uint8_t  offset;
+  /**
+   * @brief HEAP_HEADER_MAGIC, mixed with the size, if the tracker allocated
+   * the block.
+   */
+  uint16_t magic;
+};
+static_assert(sizeof(heap_header) == HEAP_HEADER_SIZE,
+              "A heap header must keep blocks 8 byte aligned");
+
+/** @brief The allocations counted for a tag. */
+struct heap_tag_stats {
+  /** @brief The number of blocks allocated. */
+  std::atomic<uint32_t> allocs{0};
+  /** @brief The number of blocks freed. */
+  std::atomic<uint32_t> frees{0};
+  /** @brief The bytes held by the tag's blocks. */
+  std::atomic<uint32_t> live{0};
+};
+
+void                  set_heap_thread(uint8_t (*thread_id)());
+void                  set_thread_heap_tag(uint8_t thread, HeapTag tag);
+HeapTag               swap_heap_tag(HeapTag tag);
+void                 *track_alloc(void *block, size_t size, size_t offset = 0);
+void                 *track_free(void *ptr);
+heap_header          *tracked_header(void *ptr);
+uint32_t              heap_live();
+uint32_t              heap_peak();
+uint32_t              heap_failures();
+const heap_tag_stats &get_heap_tag(HeapTag tag);
+uint32_t              heap_free();
+uint32_t              heap_largest_free();
+
+/**
+ * @brief Allocates under a tag from its construction to the end of its scope.
+ *
+ * For example, `HeapTagScope tag(HeapTag::Queues);` in PushQueue() counts the
+ * packets copied into a queue against the queues, rather than the channel
+ * that pushed them.
+ */
+class HeapTagScope {
+public:
+  /** @brief Start allocating under a tag. */
+  explicit HeapTagScope(HeapTag tag) : previous(swap_heap_tag(tag)) {}
+  /** @brief Go back to the previous tag. */
+  ~HeapTagScope() { swap_heap_tag(previous); }
+
+private:
+  /** @brief The tag before the scope. */
+  HeapTag previous;
+};
+} // namespace Helpers
+
+#endif // _HEAP_TRACK_H
@@ -0,0 +1,186 @@
+/**
+ * @file heap_wrap.cpp
+ * @brief The Teensy's allocator, wrapped by the heap tracker.
+ *
+ * This file contains the wrappers of newlib's reentrant allocator functions,
+ * which the HEAP_TRACKING build flag enables. They are linked in place of the
+ * originals by the `-Wl,--wrap` build flag next to it in platformio.ini, so
+ * malloc(), operator new, strdup() and the rest of the C library all allocate
+ * through them. It also contains the functions that measure the free heap.
+ *
+ * The wrap also redirects the calls newlib's own realloc and memalign make to
+ * malloc and free, which would hand them blocks with a header in front. So
+ * neither is called: both are built here from the real malloc and free.
+ */
+#include <heap_track.h>
+
+#if defined(__IMXRT1062__)
+#include <malloc.h>
+#include <reent.h>
+#include <string.h>
+
+extern unsigned long _heap_end;
+extern char         *__brkval;
+
+#ifdef HEAP_TRACKING
+extern "C" {
+void *__real__malloc_r(struct _reent *reent, size_t size);
+void  __real__free_r(struct _reent *reent, void *ptr);
+
+void *__wrap__malloc_r(struct _reent *reent, size_t size) {
+  if (size > SIZE_MAX - HEAP_HEADER_SIZE) {
+    return Helpers::track_alloc(nullptr, size);
+  }
+  return Helpers::track_alloc(
+      __real__malloc_r(reent, size + HEAP_HEADER_SIZE), size);
+}
+
+void __wrap__free_r(struct _reent *reent, void *ptr) {
+  __real__free_r(reent, Helpers::track_free(ptr));
+}
+
+void *__wrap__calloc_r(struct _reent *reent, size_t count, size_t size) {
+  if (size != 0 && count > SIZE_MAX / size) {
+    return Helpers::track_alloc(nullptr, 0);
+  }
+  void *ptr = __wrap__malloc_r(reent, count * size);
+  if (ptr != nullptr) {
+    memset(ptr, 0, count * size);
+  }
+  return ptr;
+}
+
+void *__wrap__realloc_r(struct _reent *reent, void *ptr, size_t size) {
+  if (ptr == nullptr) {
+    return __wrap__malloc_r(reent, size);
+  }
+  // Blocks allocated around the tracker have no header to give their size.
+  Helpers::heap_header *header = Helpers::tracked_header(ptr);
+  const size_t          old_size =
+      header != nullptr ? header->size : _malloc_usable_size_r(reent, ptr);
+  // The old block is kept if the new one cannot be allocated.
+  void *moved = __wrap__malloc_r(reent, size);
+  if (moved == nullptr) {
+    return nullptr;
+  }
+  memcpy(moved, ptr, old_size < size ? old_size : size);
+  __wrap__free_r(reent, ptr);
+  return moved;
+}
+
+void *__wrap__memalign_r(struct _reent *reent, size_t alignment,
+                         size_t size) {
+  if (alignment <= HEAP_HEADER_SIZE) {
+    return __wrap__malloc_r(reent, size);
+  }
+  if ((alignment & (alignment - 1)) != 0 || alignment > HEAP_MAX_ALIGNMENT ||
+      size > SIZE_MAX - alignment) {
+    return Helpers::track_alloc(nullptr, size);
+  }
+  // The header goes just before the first aligned address that leaves room
+  // for it. Blocks are 8 byte aligned, so it is a whole number of headers in,
+  // and at most alignment - HEAP_HEADER_SIZE bytes.
+  uint8_t *block = (uint8_t *)__real__malloc_r(reent, size + alignment);
+  if (block == nullptr) {
+    return Helpers::track_alloc(nullptr, size);
+  }
+  const uintptr_t aligned =
+      ((uintptr_t)block + HEAP_HEADER_SIZE + alignment - 1) & ~(alignment - 1);
+  return Helpers::track_alloc(block, size,
+                              aligned - HEAP_HEADER_SIZE - (uintptr_t)block);
+}
+}
+#endif
+
+extern "C" {
+/**
+ * @brief A chunk of newlib's allocator, as laid out in mallocr.c.
+ *
+ * A free chunk is linked into the bin of its size by fd and bk.
+ */
+struct malloc_chunk {
+  size_t        prev_size;
+  size_t        size;
+  malloc_chunk *fd;
+  malloc_chunk *bk;
+};
+
+/** @brief The bins of newlib's allocator, as pairs of fd and bk pointers. */
+extern malloc_chunk *__malloc_av_[];
+}
+
+namespace {
+/** @brief The number of bins in newlib's allocator. */
+const uint16_t MALLOC_BINS      = 128;
+/** @brief The bits of a chunk's size that are flags. */
+const size_t   MALLOC_SIZE_BITS = 3;
+
+/**
+ * @brief A bin of newlib's allocator, as its bin_at() macro finds it.
+ *
+ * The bin's pointers are placed where a chunk's fd and bk would be, so that
+ * a bin is the head of a list of chunks.
+ *
+ * @param index The index of the bin. Bin 0 holds the top chunk.
+ * @return malloc_chunk* The bin.
+ */
+malloc_chunk *malloc_bin(uint16_t index) {
+  return (malloc_chunk *)((char *)&__malloc_av_[2 * index + 2] -
+                          2 * sizeof(size_t));
+}
+
+/** @brief The size of a chunk, in bytes, including its header. */
+size_t chunk_size(const malloc_chunk *chunk) {
+  return chunk->size & ~MALLOC_SIZE_BITS;
+}
+} // namespace
+#endif
+
+namespace Helpers {
+/**
+ * @brief The bytes of the heap that are free.
+ *
+ * This counts both the free blocks inside the heap and the space above it
+ * that it has not yet grown into.
+ *
+ * @return uint32_t The bytes, or 0 on the host.
+ */
+uint32_t heap_free() {
+#if defined(__IMXRT1062__)
+  return (char *)&_heap_end - __brkval + mallinfo().fordblks;
+#else
+  return 0;
+#endif
+}
+
+/**
+ * @brief The largest block that can be allocated from the heap.
+ *
+ * Comparing this with heap_free() shows how fragmented the heap is. The free
+ * chunks in newlib's bins are walked with the allocator locked, as
+ * mallinfo() does, so nothing is allocated to find them. The top chunk can
+ * also grow into the space above the heap.
+ *
+ * @return uint32_t The size of the block, in bytes, or 0 on the host.
+ */
+uint32_t heap_largest_free() {
+#if defined(__IMXRT1062__)
+  __malloc_lock(_REENT);
+  size_t largest = chunk_size(malloc_bin(0)->fd) + (char *)&_heap_end -
+                   __brkval;
+  for (uint16_t index = 1; index < MALLOC_BINS; index++) {
+    malloc_chunk *bin = malloc_bin(index);
+    for (malloc_chunk *chunk = bin->bk; chunk != bin; chunk = chunk->bk) {
+      if (chunk_size(chunk) > largest) {
+        largest = chunk_size(chunk);
+      }
+    }
+  }
+  __malloc_unlock(_REENT);
+  // Each block carries its size in front of it.
+  return largest > sizeof(size_t) ? largest - sizeof(size_t) : 0;
+#else
+  return 0;
+#endif
+}
+} // namespace Helpers
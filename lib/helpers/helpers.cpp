@@ -5,17 +5,75 @@
  * This file contains definitions of helper functions used for debugging the
  * flight software.
  */
+#include <IntervalTimer.h>
+#include <TeensyThreads.h>
+#include <channels/artemis_channels.h>
+#include <clock_governor.h>
+#include <cpu_monitor.h>
 #include <helpers.h>
+#include <supervisor.h>
 
 namespace Helpers {
+namespace {
+  /** @brief The timer that samples the running thread. */
+  IntervalTimer     cpu_timer;
+  /**
+   * @brief Every RecoverableMutex.
+   *
+   * These are zero before any constructor runs, so a mutex defined in any
+   * file can list itself.
+   */
+  RecoverableMutex *mutexes[RECOVERABLE_MUTEXES];
+  /** @brief The number of mutexes listed. */
+  uint8_t           mutex_count = 0;
+
+#ifdef DEBUG_LOG_ENABLED
+  /** @brief The debug rings, one for each thread ID. */
+  DebugRing rings[DEBUG_LOG_RINGS];
+  /** @brief The message being printed by drain_debug_log(). */
+  uint8_t   record[DEBUG_LOG_RING_SIZE];
+  /** @brief The text of the message being printed by drain_debug_log(). */
+  char      line[DEBUG_LOG_LINE_SIZE];
+#endif
+#ifdef PACKET_TRACE
+  /**
+   * @brief The trace buffers.
+   *
+   * Frames are recorded in one while the other is written to the SD card.
+   */
+  TraceBuffer    trace_buffers[2];
+  /** @brief The trace buffer frames are recorded in. */
+  uint8_t        trace_active      = 0;
+  /** @brief The mutex for the trace buffer frames are recorded in. */
+  RecoverableMutex trace_mtx;
+  /** @brief The time, in microseconds since startup, of the trace. */
+  uint64_t       trace_time        = 0;
+  /** @brief The value of micros() when trace_time was last updated. */
+  uint32_t       trace_last_micros = 0;
+
+  /**
+   * @brief The time now, in microseconds since startup.
+   *
+   * micros() wraps after about 71 minutes, so the time is accumulated into a
+   * 64-bit counter. This must be called with trace_mtx held, and is called at
+   * least once per PACKET_TRACE_FLUSH_INTERVAL by take_packet_trace().
+   */
+  uint64_t       trace_now() {
+    const uint32_t now = micros();
+    trace_time += (uint32_t)(now - trace_last_micros);
+    trace_last_micros = now;
+    return trace_time;
+  }
+#endif
+} // namespace
+
 /**
  * @brief Connects to a computer over USB Serial for debugging.
  *
  * @param baud The baud rate of the Serial connection to the host computer.
  */
 void connect_serial_debug(long baud) {
-#if defined(DEBUG_PRINT) || defined(DEBUG_PRINT_RAPID) ||                      \
-    defined(DEBUG_PRINT_HEXDUMP)
+#ifdef DEBUG_LOG_ENABLED
   Serial.begin(baud);
   print_debug(MAIN, "Connected to Serial Console.");
 #endif
@@ -32,17 +90,213 @@ void connect_serial_debug(long baud) {
 void print_hexdump(Short_Name channel, const char *msg, uint8_t *src,
                    uint8_t size) {
 #ifdef DEBUG_PRINT_HEXDUMP
-  std::ostringstream oss;
-  oss << msg;
-  for (uint8_t i = 0; i < size; i++) {
-    if (channel == Short_Name::PDU &&
-        (src[i] == 0x20 || src[i] == 0x0D || src[i] == 0x0A)) {
-      continue;
+  print_debug(channel, msg, debug_bytes{src, size});
+#endif
+}
+
+/**
+ * @brief The debug ring of the calling thread.
+ *
+ * @return DebugRing& The ring.
+ */
+DebugRing &debug_ring() {
+#ifdef DEBUG_LOG_ENABLED
+  return rings[threads.id() % DEBUG_LOG_RINGS];
+#else
+  static DebugRing ring;
+  return ring;
+#endif
+}
+
+/**
+ * @brief Print every debug message waiting in the debug rings.
+ *
+ * Messages from different threads are printed in the order they were
+ * written. Messages dropped because a ring was full are counted.
+ */
+void drain_debug_log() {
+#ifdef DEBUG_LOG_ENABLED
+  for (DebugRing &ring : rings) {
+    const uint32_t dropped = ring.take_dropped();
+    if (dropped > 0) {
+      print_debug(MAIN, "Dropped ", dropped, " debug messages.");
+    }
+  }
+
+  while (true) {
+    DebugRing        *oldest = nullptr;
+    log_record_header oldest_header;
+    for (DebugRing &ring : rings) {
+      log_record_header header;
+      if (ring.peek(header) &&
+          (oldest == nullptr ||
+           (int32_t)(header.timestamp - oldest_header.timestamp) < 0)) {
+        oldest        = &ring;
+        oldest_header = header;
+      }
+    }
+    if (oldest == nullptr) {
+      return;
+    }
+    const uint16_t size = oldest->read(record, sizeof(record));
+    if (render_debug_log(record, size, line, sizeof(line)) > 0) {
+      Serial.println(line);
     }
-    oss << std::hex << std::setw(2) << std::setfill('0')
-        << static_cast<int>(src[i]) << " ";
   }
-  print_debug(channel, oss.str().c_str());
 #endif
 }
+
+/**
+ * @brief The thread that prints debug messages.
+ *
+ * This thread is given the smallest time slice, so it only prints when the
+ * other threads have little to do.
+ */
+void debug_log_channel() {
+  while (true) {
+    drain_debug_log();
+    heartbeat(Artemis::Channels::Channel_ID::DEBUG_LOG_CHANNEL);
+    threads.delay(10);
+  }
+}
+
+/**
+ * @brief Start sampling the running thread every CPU_MONITOR_SAMPLE_US.
+ *
+ * The sampling interrupt is given the lowest priority, so that it does not
+ * delay the radio's or the thread scheduler's.
+ *
+ * @return true The samples are being taken.
+ * @return false There is no timer left to take them, as on the host.
+ */
+bool start_cpu_monitor() {
+  if (!cpu_timer.begin([]() { count_cpu_sample(threads.id()); },
+                       CPU_MONITOR_SAMPLE_US)) {
+    return false;
+  }
+  cpu_timer.priority(255);
+  return true;
+}
+
+/**
+ * @brief The idle thread, which measures how long the other threads are busy.
+ *
+ * It only yields, so its turns come one round of the scheduler apart. When
+ * every other thread is waiting, a round takes a few microseconds, and any
+ * longer gap between turns was spent in a thread's work.
+ */
+void idle_thread() {
+  uint32_t last = micros();
+  while (true) {
+    threads.yield();
+    const uint32_t now = micros();
+    count_idle_gap(now - last);
+    last = now;
+  }
+}
+
+#ifdef PACKET_TRACE
+/**
+ * @brief Record a frame received by the Teensy in the packet trace.
+ *
+ * The frame is only copied into RAM, so this can be called from any channel.
+ *
+ * @param source Where the frame arrived.
+ * @param frame The frame, as received.
+ * @param size The size of the frame, in bytes.
+ */
+void trace_ingress(TraceSource source, const uint8_t *frame, uint16_t size) {
+  MutexScope lock(trace_mtx);
+  trace_buffers[trace_active].record(trace_now(), source, frame, size);
+}
+
+/**
+ * @brief Take the frames recorded since the last call, to be written out.
+ *
+ * Frames are recorded in the other buffer until the next call, so the
+ * buffer returned must be written out before then. If frames were dropped,
+ * the next buffer starts with a TraceSource::Dropped record.
+ *
+ * @return TraceBuffer& The frames.
+ */
+TraceBuffer &take_packet_trace() {
+  MutexScope lock(trace_mtx);
+  TraceBuffer   &full    = trace_buffers[trace_active];
+  TraceBuffer   &next    = trace_buffers[1 - trace_active];
+  const uint32_t dropped = full.take_dropped();
+  trace_active           = 1 - trace_active;
+  next.clear();
+  if (dropped > 0) {
+    next.record(trace_now(), TraceSource::Dropped, (const uint8_t *)&dropped,
+                sizeof(dropped));
+  } else {
+    trace_now();
+  }
+  return full;
+}
+#endif
+
+/** @brief List a mutex, so that it can be recovered from a killed thread. */
+RecoverableMutex::RecoverableMutex() {
+  if (mutex_count < RECOVERABLE_MUTEXES) {
+    mutexes[mutex_count++] = this;
+  }
+}
+
+/**
+ * @brief Lock the mutex, and record the running thread as holding it.
+ *
+ * @param timeout_ms The longest time to wait, in milliseconds, or 0 to wait
+ * until the mutex is free.
+ * @return int 1 if the mutex was locked, or 0 if the wait timed out.
+ */
+int RecoverableMutex::lock(unsigned int timeout_ms) {
+  const int locked = mtx.lock(timeout_ms);
+  if (locked) {
+    owner.store(threads.id());
+  }
+  return locked;
+}
+
+/** @brief Unlock the mutex, which the running thread must hold. */
+void RecoverableMutex::unlock() {
+  owner.store(-1);
+  mtx.unlock();
+}
+
+/**
+ * @brief Unlock the mutex if a killed thread was holding it.
+ *
+ * @param thread_id The ID of the killed thread.
+ * @return true The thread was holding the mutex, and it has been unlocked.
+ * @return false The mutex was free or held by another thread, and is left
+ * as it was.
+ */
+bool RecoverableMutex::recover(int thread_id) {
+  int held = thread_id;
+  if (!owner.compare_exchange_strong(held, -1)) {
+    return false;
+  }
+  mtx.unlock();
+  return true;
+}
+
+/**
+ * @brief Unlock every mutex a killed thread was holding.
+ *
+ * This must be called after the thread is killed and before another thread
+ * is given its ID.
+ *
+ * @param thread_id The ID of the killed thread.
+ * @return uint8_t The number of mutexes unlocked.
+ */
+uint8_t recover_mutexes(int thread_id) {
+  uint8_t recovered = 0;
+  for (uint8_t i = 0; i < mutex_count; i++) {
+    if (mutexes[i]->recover(thread_id)) {
+      recovered++;
+    }
+  }
+  return recovered;
+}
 } // namespace Helpers
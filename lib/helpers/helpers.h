@@ -13,122 +13,130 @@
 
 #include "support/configCosmosKernel.h"
 #include <Arduino.h>
+#include <TeensyThreads.h>
+#include <atomic>
+#include <debug_log.h>
+#include <packet_trace.h>
 #include <stdint.h>
 
 extern unsigned long _heap_start;
 extern unsigned long _heap_end;
 extern char         *__brkval;
 
-/** @brief Helper functions and debugging tools. */
-namespace Helpers {
-/** @brief Enumeration of channels calling helper functions. */
-enum Short_Name : uint8_t {
-  RFM23 = 1,
-  PDU,
-  RPI,
-  MAIN,
-  TEST,
-};
+/**
+ * @brief The number of debug rings.
+ *
+ * Each thread writes to the ring of its thread ID, so threads never share a
+ * ring's writing end.
+ */
+#define DEBUG_LOG_RINGS     16
 
-void connect_serial_debug(long baud);
-void print_hexdump(Short_Name channel, const char *msg, uint8_t *src,
-                   uint8_t size);
+/** @brief The most mutexes that can be recovered from a killed thread. */
+#define RECOVERABLE_MUTEXES 16
 
+/** @brief Helper functions and debugging tools. */
+namespace Helpers {
 /**
- * @brief Base case of the recursive debug print.
+ * @brief A mutex that records which thread holds it.
  *
- * @tparam Arg The generic type of the argument to be appended to the stream.
- * @param oss The output stream containing the string to be printed.
- * @param arg The argument to be added to the ouput string.
+ * A thread killed while holding a mutex never unlocks it. Every
+ * RecoverableMutex is listed as it is constructed, so that recover_mutexes()
+ * can unlock the ones a killed thread held and leave those held by live
+ * threads alone.
  */
-template <typename Arg> void print_args(std::ostream &oss, const Arg &arg) {
-#ifdef DEBUG_PRINT
-  oss << arg;
+class RecoverableMutex {
+public:
+  RecoverableMutex();
+  int  lock(unsigned int timeout_ms = 0);
+  void unlock();
+  bool recover(int thread_id);
+
+private:
+  /** @brief The mutex. */
+  Threads::Mutex   mtx;
+  /** @brief The ID of the thread holding the mutex, or -1 if it is free. */
+  std::atomic<int> owner{-1};
+};
+
+/** @brief Locks a RecoverableMutex for the rest of its scope. */
+class MutexScope {
+public:
+  explicit MutexScope(RecoverableMutex &m) : mtx(m) { mtx.lock(); }
+  ~MutexScope() { mtx.unlock(); }
+
+private:
+  /** @brief The locked mutex. */
+  RecoverableMutex &mtx;
+};
+
+uint8_t    recover_mutexes(int thread_id);
+void       connect_serial_debug(long baud);
+void       print_hexdump(Short_Name channel, const char *msg, uint8_t *src,
+                         uint8_t size);
+DebugRing &debug_ring();
+void       drain_debug_log();
+void       debug_log_channel();
+bool       start_cpu_monitor();
+void       idle_thread();
+#ifdef PACKET_TRACE
+void         trace_ingress(TraceSource source, const uint8_t *frame,
+                           uint16_t size);
+TraceBuffer &take_packet_trace();
+#else
+/** @brief Without the PACKET_TRACE build flag, frames are not traced. */
+inline void trace_ingress(TraceSource, const uint8_t *, uint16_t) {}
 #endif
-}
 
 /**
- * @brief Recursive case of the recursive debug print.
+ * @brief Helper function to print debug messages of a level.
  *
- * This function, in combination with its base case version, recursively goes
- * through each argument passed into it, appends the first argument to the
- * output stream, then passes the remaining arguments to the next iteration of
- * the function. This repeats until the base case is reached and the complete
- * output stream is built.
+ * The arguments are appended to each other as if they were each passed into
+ * std::ostream. For example,
+ * `print_log<LogLevel::Info>(MAIN, "Hello World! int=", int)` and
+ * `print_log<LogLevel::Error>(MAIN, "This ", "is ", "a ", "test ")` are both
+ * valid uses of this function.
  *
- * Practically, this function can be called with an arbitrary number of
- * arguments. The arguments are appended to each other as if they were each
- * passed into std::ostream.
+ * The message is not printed here. Its arguments are written to the calling
+ * thread's debug ring, and debug_log_channel() prints them later, so calling
+ * this function costs a few microseconds and never waits on the Serial
+ * connection. Messages below log_floor are removed at compile time, and
+ * messages below the channel's runtime log level cost a single branch.
  *
- * For example,
- * `print_args("Hello World! int=", int)` and
- * `print_args("This ", "is ", "a ", "test ")` are both valid uses of this
- * function.
- *
- * @tparam Arg The generic type of the argument to be appended to the stream.
- * @tparam Args The generic type of the remaining arguments.
- * @param oss The output stream containing the string to be printed.
- * @param arg The argument to be added to the ouput string.
- * @param args The remaining arguments.
+ * @tparam level The LogLevel of the message.
+ * @tparam Args The generic type of arguments to be printed.
+ * @param channel The Short_Name of the channel calling this function.
+ * @param args The arguments to be printed.
  */
-template <typename Arg, typename... Args>
-void print_args(std::ostream &oss, const Arg &arg, const Args &...args) {
-  oss << arg;
-  print_args(oss, args...);
+template <LogLevel level, typename... Args>
+void print_log(Short_Name channel, const Args &...args) {
+  if (log_enabled<level>(channel)) {
+    write_debug_log(debug_ring(), micros(), channel, args...);
+  }
 }
 
 /**
  * @brief Helper function to print debug messages.
  *
- * @tparam Args The generic type of arguments to be appended to the stream.
+ * @tparam Args The generic type of arguments to be printed.
  * @param channel The Short_Name of the channel calling this function.
- * @param args The arguments to be added to the output string.
+ * @param args The arguments to be printed.
  */
 template <typename... Args>
 void print_debug(Short_Name channel, const Args &...args) {
-#ifdef DEBUG_PRINT
-  std::ostringstream oss;
-
-  switch (channel) {
-    case PDU:
-      oss << "[PDU ] ";
-      break;
-    case RFM23:
-      oss << "[RM23] ";
-      break;
-    case RPI:
-      oss << "[R-PI] ";
-      break;
-    case MAIN:
-      oss << "[MAIN] ";
-      break;
-    case TEST:
-      oss << "[TEST] ";
-      break;
-    default:
-      oss << "[????] ";
-      break;
-  }
-
-  print_args(oss, args...);
-
-  Serial.println(oss.str().c_str());
-#endif
+  print_log<LogLevel::Debug>(channel, args...);
 }
 
 /**
  * @brief Helper function to print debug messages quickly.
  *
- * @tparam Args The generic type of arguments to be appended to the stream.
+ * @tparam Args The generic type of arguments to be printed.
  * @param channel The Short_Name of the channel calling this function.
- * @param args The arguments to be added to the output string.
+ * @param args The arguments to be printed.
  */
 template <typename... Args>
 void print_debug_rapid(Short_Name channel, const Args &...args) {
-#ifdef DEBUG_PRINT_RAPID
-  print_debug(channel, args...);
-#endif
+  print_log<LogLevel::Rapid>(channel, args...);
 }
 } // namespace Helpers
 
-#endif // _HELPERS_H
\ No newline at end of file
+#endif // _HELPERS_H
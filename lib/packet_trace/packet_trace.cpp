@@ -0,0 +1,92 @@
+/**
+ * @file packet_trace.cpp
+ * @brief The packet trace format.
+ *
+ * This file contains definitions of the functions that write and read trace
+ * records.
+ */
+#include <packet_trace.h>
+#include <string.h>
+
+namespace Helpers {
+/**
+ * @brief Add a record to the buffer.
+ *
+ * @param time_us The time the frame arrived, in microseconds since startup.
+ * @param source Where the frame arrived.
+ * @param frame The frame.
+ * @param size The size of the frame, in bytes.
+ * @return true The record was added.
+ * @return false The buffer is full, and the record was dropped.
+ */
+bool TraceBuffer::record(uint64_t time_us, TraceSource source,
+                         const uint8_t *frame, uint16_t size) {
+  if (sizeof(trace_record_header) + size > sizeof(buffer) - used) {
+    dropped++;
+    return false;
+  }
+  trace_record_header header;
+  header.time_us  = time_us;
+  header.size     = size;
+  header.source   = source;
+  header.reserved = 0;
+  memcpy(buffer + used, &header, sizeof(header));
+  if (size > 0) {
+    memcpy(buffer + used + sizeof(header), frame, size);
+  }
+  used += sizeof(header) + size;
+  return true;
+}
+
+/** @brief Remove every record from the buffer. */
+void TraceBuffer::clear() { used = 0; }
+
+/**
+ * @brief Construct a new TraceReader object.
+ *
+ * @param trace The trace, starting with its trace_file_header.
+ * @param size The size of the trace, in bytes.
+ */
+TraceReader::TraceReader(const uint8_t *trace, uint32_t size)
+    : trace(trace), size(size), position(sizeof(trace_file_header)) {}
+
+/**
+ * @brief Check the trace's file header.
+ *
+ * @return true The trace is in a format this reader understands.
+ * @return false It is not.
+ */
+bool TraceReader::valid() const {
+  if (size < sizeof(trace_file_header)) {
+    return false;
+  }
+  trace_file_header header;
+  memcpy(&header, trace, sizeof(header));
+  return header.magic == PACKET_TRACE_MAGIC &&
+         header.version == PACKET_TRACE_VERSION;
+}
+
+/**
+ * @brief Read the next record.
+ *
+ * A record cut short by the end of the trace, as left by a reset while it
+ * was being written, ends the trace.
+ *
+ * @param header The record's header.
+ * @param frame The record's frame, which points into the trace.
+ * @return true A record was read.
+ * @return false There are no more records.
+ */
+bool TraceReader::next(trace_record_header &header, const uint8_t *&frame) {
+  if (position > size || size - position < sizeof(header)) {
+    return false;
+  }
+  memcpy(&header, trace + position, sizeof(header));
+  if (size - position - sizeof(header) < header.size) {
+    return false;
+  }
+  frame     = trace + position + sizeof(header);
+  position += sizeof(header) + header.size;
+  return true;
+}
+} // namespace Helpers
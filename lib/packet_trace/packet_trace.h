@@ -0,0 +1,128 @@
+/**
+ * @file packet_trace.h
+ * @brief The header file for the packet trace format.
+ *
+ * This file contains declarations for packet traces, which record every
+ * frame received by the Teensy with the time and channel it arrived on. A
+ * trace on the SD card can be replayed through the flight software by the
+ * native build to reproduce a fault.
+ */
+#ifndef _PACKET_TRACE_H
+#define _PACKET_TRACE_H
+
+#include <stdint.h>
+
+/** @brief The size, in bytes, of each trace buffer. */
+#define PACKET_TRACE_BUFFER_SIZE 4096
+/** @brief The first bytes of every trace file, "ATRC". */
+#define PACKET_TRACE_MAGIC       0x43525441
+/** @brief The version of the trace format. */
+#define PACKET_TRACE_VERSION     1
+
+namespace Helpers {
+/**
+ * @brief Enumeration of the sources of traced frames.
+ *
+ * The channels match their Channel_ID.
+ */
+enum class TraceSource : uint8_t {
+  /** @brief A frame received by the RFM23 radio. */
+  RFM23   = 1,
+  /** @brief A reply read from the PDU's serial connection. */
+  PDU     = 2,
+  /** @brief A SLIP frame read from the Raspberry Pi's serial connection. */
+  RPI     = 3,
+  /** @brief The Teensy started. The record has no bytes. */
+  Startup = 0xFE,
+  /**
+   * @brief Frames missing from the trace.
+   *
+   * The record's bytes are the number of frames dropped because a buffer was
+   * full, as a uint32_t.
+   */
+  Dropped = 0xFF,
+};
+
+/** @brief The fields at the start of every trace file. */
+struct __attribute__((packed)) trace_file_header {
+  /** @brief PACKET_TRACE_MAGIC. */
+  uint32_t magic    = PACKET_TRACE_MAGIC;
+  /** @brief PACKET_TRACE_VERSION. */
+  uint16_t version  = PACKET_TRACE_VERSION;
+  uint16_t reserved = 0;
+};
+
+/** @brief The fields at the start of every record in a trace. */
+struct __attribute__((packed)) trace_record_header {
+  /** @brief The time the frame arrived, in microseconds since startup. */
+  uint64_t    time_us;
+  /** @brief The size of the frame, in bytes. */
+  uint16_t    size;
+  /** @brief Where the frame arrived. */
+  TraceSource source;
+  uint8_t     reserved;
+};
+/**<  A diagram of a record is included below.
+ *
+ * @verbatim
+8 bytes   2 bytes 1 byte   1 byte     size bytes
++---------+------+--------+----------+-------+
+| time_us | size | source | reserved | frame |
++---------+------+--------+----------+-------+
+   @endverbatim
+ */
+
+/**
+ * @brief Collects trace records to be written out together.
+ *
+ * A record that does not fit is dropped and counted. The buffer is not
+ * locked, so its users must share it under a mutex.
+ */
+class TraceBuffer {
+public:
+  bool           record(uint64_t time_us, TraceSource source,
+                        const uint8_t *frame, uint16_t size);
+  void           clear();
+
+  /** @brief The records. */
+  const uint8_t *data() const { return buffer; }
+  /** @brief The size, in bytes, of the records. */
+  uint16_t       size() const { return used; }
+  /**
+   * @brief Take the number of records dropped since the last call.
+   *
+   * @return uint32_t The number of records dropped.
+   */
+  uint32_t       take_dropped() {
+    const uint32_t count = dropped;
+    dropped              = 0;
+    return count;
+  }
+
+private:
+  /** @brief The records. */
+  uint8_t  buffer[PACKET_TRACE_BUFFER_SIZE];
+  /** @brief The size, in bytes, of the records. */
+  uint16_t used    = 0;
+  /** @brief The number of records dropped because the buffer was full. */
+  uint32_t dropped = 0;
+};
+
+/** @brief Reads the records of a trace in order. */
+class TraceReader {
+public:
+  TraceReader(const uint8_t *trace, uint32_t size);
+  bool valid() const;
+  bool next(trace_record_header &header, const uint8_t *&frame);
+
+private:
+  /** @brief The trace, starting with its trace_file_header. */
+  const uint8_t *trace;
+  /** @brief The size of the trace, in bytes. */
+  uint32_t       size;
+  /** @brief The position of the next record. */
+  uint32_t       position;
+};
+} // namespace Helpers
+
+#endif // _PACKET_TRACE_H
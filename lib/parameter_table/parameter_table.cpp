@@ -0,0 +1,141 @@
+/**
+ * @file parameter_table.cpp
+ * @brief The parameter table.
+ *
+ * This file contains definitions of the functions that change, check, save and
+ * load the parameters.
+ */
+#include <checksum.h>
+#include <parameter_table.h>
+
+namespace Artemis {
+namespace Parameters {
+  static_assert(sizeof(parameter_definitions) /
+                        sizeof(parameter_definitions[0]) ==
+                    PARAMETER_COUNT,
+                "Every parameter must have a definition");
+
+  std::atomic<uint32_t> parameter_values[PARAMETER_COUNT];
+
+  namespace {
+    /** @brief A parameter's value as the float its range is given in. */
+    float as_float(uint8_t id, uint32_t value) {
+      if (parameter_definitions[id].type == ParameterType::Unsigned) {
+        return value;
+      }
+      float result;
+      memcpy(&result, &value, sizeof(result));
+      return result;
+    }
+
+    /** @brief Whether a value is in a parameter's range. */
+    bool valid(uint8_t id, uint32_t value) {
+      const float number = as_float(id, value);
+      return number >= parameter_definitions[id].minimum &&
+             number <= parameter_definitions[id].maximum;
+    }
+
+    /** @brief A parameter's default value. */
+    uint32_t initial(uint8_t id) {
+      const float number = parameter_definitions[id].initial;
+      if (parameter_definitions[id].type == ParameterType::Unsigned) {
+        return number;
+      }
+      uint32_t result;
+      memcpy(&result, &number, sizeof(result));
+      return result;
+    }
+
+    /** @brief The CRC-32 of an image, without its CRC field. */
+    uint32_t image_crc(const parameter_image &image) {
+      return Helpers::crc32((const uint8_t *)&image,
+                            offsetof(parameter_image, crc));
+    }
+
+    /**
+     * @brief Gives the parameters their defaults before setup() runs, so that
+     * none is ever read as 0.
+     */
+    struct defaults {
+      defaults() { reset(); }
+    } set_defaults;
+  } // namespace
+
+  /**
+   * @brief Change a parameter.
+   *
+   * @param id The ParameterId of the parameter.
+   * @param value The value, as a uint32_t or a float.
+   * @return true The parameter has been changed.
+   * @return false The parameter does not exist, or the value is out of its
+   * range.
+   */
+  bool set(uint8_t id, uint32_t value) {
+    if (id >= PARAMETER_COUNT || !valid(id, value)) {
+      return false;
+    }
+    parameter_values[id].store(value, std::memory_order_relaxed);
+    return true;
+  }
+
+  /**
+   * @brief The value of a parameter of any type, for reporting it.
+   *
+   * @param id The ParameterId of the parameter, which must exist.
+   * @return uint32_t The value, as a uint32_t or a float.
+   */
+  uint32_t get_raw(uint8_t id) {
+    return parameter_values[id].load(std::memory_order_relaxed);
+  }
+
+  /** @brief Return every parameter to its default. */
+  void reset() {
+    for (uint8_t id = 0; id < PARAMETER_COUNT; id++) {
+      parameter_values[id].store(initial(id), std::memory_order_relaxed);
+    }
+  }
+
+  /**
+   * @brief Use the parameters of an image read from EEPROM.
+   *
+   * @param image The image.
+   * @return true The image is whole and every value is in range, and has been
+   * used.
+   * @return false It is not, and the parameters are unchanged.
+   */
+  bool load(const parameter_image &image) {
+    if (image.version != PARAMETER_TABLE_VERSION ||
+        image.count != PARAMETER_COUNT || image.crc != image_crc(image)) {
+      return false;
+    }
+    for (uint8_t id = 0; id < PARAMETER_COUNT; id++) {
+      if (!valid(id, image.values[id])) {
+        return false;
+      }
+    }
+    for (uint8_t id = 0; id < PARAMETER_COUNT; id++) {
+      parameter_values[id].store(image.values[id], std::memory_order_relaxed);
+    }
+    return true;
+  }
+
+  /**
+   * @brief Make an image of the parameters, to be written to EEPROM.
+   *
+   * @param image The image.
+   * @param kept A parameter to be saved with the value given in place of its
+   * current one, or nullptr to save every current value.
+   */
+  void seal(parameter_image &image, const parameter_entry *kept) {
+    image.version = PARAMETER_TABLE_VERSION;
+    image.count   = PARAMETER_COUNT;
+    for (uint8_t id = 0; id < PARAMETER_COUNT; id++) {
+      image.values[id] = get_raw(id);
+    }
+    if (kept != nullptr && kept->id < PARAMETER_COUNT) {
+      image.values[kept->id] = kept->value;
+    }
+    image.crc = image_crc(image);
+  }
+} // namespace Parameters
+} // namespace Artemis
@@ -0,0 +1,195 @@
+/**
+ * @file parameter_table.h
+ * @brief The header file for the parameter table.
+ *
+ * This file contains declarations for the parameter table, which holds the
+ * flight software's tunable values so that they can be changed from the
+ * ground without reflashing. Each parameter has a type, a range and a default.
+ * Reading one is a single load from an array, and changes are kept in RAM
+ * until they are committed to EEPROM, protected by a CRC.
+ */
+#ifndef _PARAMETER_TABLE_H
+#define _PARAMETER_TABLE_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/** @brief The version of the parameter table's layout in EEPROM. */
+#define PARAMETER_TABLE_VERSION 1
+
+namespace Artemis {
+namespace Parameters {
+  /**
+   * @brief Enumeration of the parameters.
+   *
+   * Times are in milliseconds. Unless noted, a change takes effect the next
+   * time the parameter is used.
+   */
+  enum class ParameterId : uint8_t {
+    /**
+     * @brief How old a device's readings may be before it is read again, and
+     * the interval of the default beacon plan.
+     */
+    ReadInterval,
+    /** @brief The temperature, in Celsius, below which the heater is on. */
+    HeaterThreshold,
+    /** @brief The interval at which the satellite's temperature is checked. */
+    HeaterCheckInterval,
+    /** @brief The time given to let the PDU reply before retrying. */
+    PduRetryInterval,
+    /** @brief The maximum time given to send a packet to the PDU. */
+    PduCommunicationTimeout,
+    /**
+     * @brief The maximum number of packets that a queue can hold. A smaller
+     * size takes effect as packets are next pushed into each queue.
+     */
+    QueueSize,
+    /**
+     * @brief The radio's center frequency, in MHz. This takes effect when it
+     * is tried with ParameterAction::TryRadio, and is only committed once the
+     * trial has been confirmed.
+     */
+    RadioFrequency,
+    /** @brief The radio's transmit power, an RH_RF22_RF23BP_TXPOW value. */
+    RadioTxPower,
+    Count,
+  };
+
+  /** @brief The number of parameters. */
+  constexpr uint8_t PARAMETER_COUNT = (uint8_t)ParameterId::Count;
+
+  /** @brief Enumeration of the types of a parameter. */
+  enum class ParameterType : uint8_t {
+    Unsigned,
+    Float,
+  };
+
+  /** @brief Enumeration of the actions of a CommandParameter packet. */
+  enum class ParameterAction : uint8_t {
+    /** @brief Report parameters: their ids, or none for every parameter. */
+    Get,
+    /**
+     * @brief Change parameters: each a parameter_entry. The changes are lost
+     * on a reset unless they are committed.
+     */
+    Set,
+    /**
+     * @brief Save the parameters to EEPROM. RadioFrequency is saved as the
+     * frequency the radio is on, and not while a trial is running.
+     */
+    Commit,
+    /** @brief Return every parameter to its default, without saving. */
+    Reset,
+    /**
+     * @brief Restart the radio on the RadioFrequency parameter. The radio and
+     * the parameter go back to the previous frequency after
+     * RADIO_TRIAL_TIMEOUT unless the trial is confirmed.
+     */
+    TryRadio,
+    /** @brief Keep the frequency being tried, without saving. */
+    ConfirmRadio,
+  };
+
+  /** @brief The type, range and default of a parameter. */
+  struct parameter_definition {
+    /** @brief The type of the parameter. */
+    ParameterType type;
+    /** @brief The least value allowed. */
+    float         minimum;
+    /** @brief The greatest value allowed. */
+    float         maximum;
+    /** @brief The value used when none has been saved. */
+    float         initial;
+  };
+
+  /** @brief The definitions of the parameters, indexed by ParameterId. */
+  constexpr parameter_definition parameter_definitions[PARAMETER_COUNT] = {
+      {ParameterType::Unsigned, 1000, 3600000, 20000},
+      {   ParameterType::Float,  -40,      40,   -10},
+      {ParameterType::Unsigned, 1000, 3600000, 60000},
+      {ParameterType::Unsigned,  100,   10000,  1000},
+      {ParameterType::Unsigned, 1000,   20000,  5000},
+      {ParameterType::Unsigned,    2,      32,     8},
+      {ParameterType::Unsigned,  420,     450,   433},
+      {ParameterType::Unsigned,    5,       7,     7},
+  };
+
+  /**
+   * @brief A parameter of a known type.
+   *
+   * @tparam T The type of the parameter's value.
+   */
+  template <typename T> struct parameter {
+    /** @brief The id of the parameter. */
+    ParameterId id;
+  };
+
+  constexpr parameter<uint32_t> ReadInterval{ParameterId::ReadInterval};
+  constexpr parameter<float>    HeaterThreshold{ParameterId::HeaterThreshold};
+  constexpr parameter<uint32_t> HeaterCheckInterval{
+      ParameterId::HeaterCheckInterval};
+  constexpr parameter<uint32_t> PduRetryInterval{ParameterId::PduRetryInterval};
+  constexpr parameter<uint32_t> PduCommunicationTimeout{
+      ParameterId::PduCommunicationTimeout};
+  constexpr parameter<uint32_t> QueueSize{ParameterId::QueueSize};
+  constexpr parameter<uint32_t> RadioFrequency{ParameterId::RadioFrequency};
+  constexpr parameter<uint32_t> RadioTxPower{ParameterId::RadioTxPower};
+
+  /** @brief The type, range and default of a parameter. */
+  template <typename T>
+  constexpr const parameter_definition &definition(parameter<T> param) {
+    return parameter_definitions[(uint8_t)param.id];
+  }
+
+  /** @brief A parameter and its value, as sent to and from the ground. */
+  struct __attribute__((packed)) parameter_entry {
+    /** @brief The ParameterId of the parameter. */
+    uint8_t  id    = 0;
+    /** @brief The value, as a uint32_t or a float. */
+    uint32_t value = 0;
+  };
+
+  /** @brief The parameters, as they are kept in EEPROM. */
+  struct __attribute__((packed)) parameter_image {
+    /** @brief The PARAMETER_TABLE_VERSION the image was written with. */
+    uint8_t  version = PARAMETER_TABLE_VERSION;
+    /** @brief The number of parameters. */
+    uint8_t  count   = PARAMETER_COUNT;
+    /** @brief The value of each parameter. */
+    uint32_t values[PARAMETER_COUNT]{};
+    /** @brief The CRC-32 of the fields above. */
+    uint32_t crc     = 0;
+  };
+
+  /**
+   * @brief The value of each parameter, as a uint32_t or a float.
+   *
+   * These are read by every channel and changed by the main channel.
+   */
+  extern std::atomic<uint32_t> parameter_values[PARAMETER_COUNT];
+
+  /** @brief The value of an unsigned parameter. */
+  inline uint32_t get(parameter<uint32_t> param) {
+    return parameter_values[(uint8_t)param.id].load(std::memory_order_relaxed);
+  }
+
+  /** @brief The value of a float parameter. */
+  inline float get(parameter<float> param) {
+    const uint32_t value =
+        parameter_values[(uint8_t)param.id].load(std::memory_order_relaxed);
+    float result;
+    memcpy(&result, &value, sizeof(result));
+    return result;
+  }
+
+  bool     set(uint8_t id, uint32_t value);
+  uint32_t get_raw(uint8_t id);
+  void     reset();
+  bool     load(const parameter_image &image);
+  void     seal(parameter_image &image, const parameter_entry *kept = nullptr);
+} // namespace Parameters
+} // namespace Artemis
+
+#endif // _PARAMETER_TABLE_H
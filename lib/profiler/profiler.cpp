@@ -0,0 +1,129 @@
+/**
+ * @file profiler.cpp
+ * @brief The hot path profiler.
+ *
+ * This file contains definitions of the functions that record, clear and
+ * report the times of profiled zones.
+ */
+#include <profiler.h>
+
+namespace Helpers {
+namespace {
+  /** @brief The times of each zone. */
+  profile_stats stats[PROFILE_ZONE_COUNT];
+
+  /** @brief The name of each zone. */
+  const char   *zone_names[] = {
+#define PROFILE_ZONE_NAME(name) #name,
+      PROFILE_ZONES(PROFILE_ZONE_NAME)
+#undef PROFILE_ZONE_NAME
+  };
+
+  /** @brief The histogram bin of a time. */
+  uint8_t bin(uint32_t ticks) {
+    return ticks == 0 ? 0 : 31 - __builtin_clz(ticks);
+  }
+} // namespace
+
+/**
+ * @brief The number of cycles in a microsecond.
+ *
+ * @return uint16_t The CPU's frequency in MHz on the Teensy, or 1000 on the
+ * host.
+ */
+uint16_t profile_cycles_per_us() {
+#if defined(__IMXRT1062__)
+  return F_CPU_ACTUAL / 1000000;
+#else
+  return 1000;
+#endif
+}
+
+/**
+ * @brief Record a run of a zone.
+ *
+ * The clock governor changes the clock frequency while the satellite runs,
+ * so a run is converted to nanoseconds at the frequency it started at. A run
+ * the frequency changed during is left out, as its cycles were not all of
+ * the same length.
+ *
+ * @param zone The zone.
+ * @param cycles The time, in cycles, the zone ran.
+ * @param cycles_per_us The clock frequency, in MHz, when the zone started.
+ */
+void record_profile(ProfileZone zone, uint32_t cycles,
+                    uint16_t cycles_per_us) {
+  if (cycles_per_us != profile_cycles_per_us()) {
+    return;
+  }
+  const uint32_t ns =
+      cycles / cycles_per_us * PROFILE_TICKS_PER_US +
+      cycles % cycles_per_us * PROFILE_TICKS_PER_US / cycles_per_us;
+
+  profile_stats &zone_stats = stats[(uint8_t)zone];
+  zone_stats.calls++;
+  zone_stats.total += ns;
+  if (ns > zone_stats.max) {
+    zone_stats.max = ns;
+  }
+  zone_stats.histogram[bin(ns)]++;
+}
+
+/** @brief Clear the times of every zone. */
+void reset_profile() {
+  for (profile_stats &zone_stats : stats) {
+    zone_stats = profile_stats();
+  }
+}
+
+/**
+ * @brief The times recorded for a zone.
+ *
+ * @param zone The zone.
+ * @return const profile_stats& The times.
+ */
+const profile_stats &get_profile(ProfileZone zone) {
+  return stats[(uint8_t)zone];
+}
+
+/**
+ * @brief The name of a zone.
+ *
+ * @param zone The zone.
+ * @return const char* The name, as given in PROFILE_ZONES.
+ */
+const char *profile_zone_name(ProfileZone zone) {
+  return zone_names[(uint8_t)zone];
+}
+
+/**
+ * @brief Make the report of a zone sent to the ground.
+ *
+ * @param zone The zone.
+ * @return profile_report The report.
+ */
+profile_report make_profile_report(ProfileZone zone) {
+  const profile_stats &zone_stats = stats[(uint8_t)zone];
+  profile_report       report;
+  report.zone         = (uint8_t)zone;
+  report.ticks_per_us = PROFILE_TICKS_PER_US;
+  report.calls        = zone_stats.calls;
+  report.total        = zone_stats.total;
+  report.max          = zone_stats.max;
+
+  const uint8_t last  = bin(zone_stats.max);
+  report.first_bin =
+      last >= PROFILE_REPORT_BINS ? last - PROFILE_REPORT_BINS + 1 : 0;
+  uint32_t counts[PROFILE_REPORT_BINS] = {};
+  for (uint8_t i = 0; i < PROFILE_BINS; i++) {
+    const uint8_t sent = i > report.first_bin ? i - report.first_bin : 0;
+    if (sent < PROFILE_REPORT_BINS) {
+      counts[sent] += zone_stats.histogram[i];
+    }
+  }
+  for (uint8_t i = 0; i < PROFILE_REPORT_BINS; i++) {
+    report.bins[i] = counts[i] < 0xFFFF ? counts[i] : 0xFFFF;
+  }
+  return report;
+}
+} // namespace Helpers
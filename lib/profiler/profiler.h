@@ -0,0 +1,177 @@
+/**
+ * @file profiler.h
+ * @brief The header file for the hot path profiler.
+ *
+ * This file contains declarations for the profiler, which times zones of code
+ * such as packet routing and device reads. Each zone keeps a call count, the
+ * total and longest times, and a histogram of times by powers of two, in
+ * static storage. Times are kept in nanoseconds. On the Teensy, they are
+ * counted in cycles of the Cortex-M7 DWT cycle counter, which the Teensy's
+ * startup code enables, and converted at the clock frequency the run started
+ * at. Built for the host, they are counted in nanoseconds of
+ * std::chrono::steady_clock.
+ */
+#ifndef _PROFILER_H
+#define _PROFILER_H
+
+#include <stdint.h>
+
+#if defined(__IMXRT1062__)
+#include <Arduino.h>
+#else
+#include <chrono>
+#endif
+
+/** @brief The number of histogram bins, one for each bit of a time. */
+#define PROFILE_BINS         32
+/** @brief The number of histogram bins sent in a profile_report. */
+#define PROFILE_REPORT_BINS  12
+/** @brief The number of ticks, nanoseconds, in a microsecond. */
+#define PROFILE_TICKS_PER_US 1000
+
+/**
+ * @brief The list of profiled zones.
+ *
+ * Each zone is given as `ZONE(name)`.
+ */
+#define PROFILE_ZONES(ZONE)                                                    \
+  ZONE(RoutePackets)                                                           \
+  ZONE(PDUSend)                                                                \
+  ZONE(RFM23Recv)                                                              \
+  ZONE(SLIPUnPacketize)                                                        \
+  ZONE(TemperatureRead)                                                        \
+  ZONE(CurrentRead)                                                            \
+  ZONE(IMURead)                                                                \
+  ZONE(MagnetometerRead)                                                       \
+  ZONE(GPSRead)
+
+namespace Helpers {
+/** @brief Enumeration of profiled zones. */
+enum class ProfileZone : uint8_t {
+#define PROFILE_ZONE_ENUM(name) name,
+  PROFILE_ZONES(PROFILE_ZONE_ENUM)
+#undef PROFILE_ZONE_ENUM
+};
+
+/** @brief The number of profiled zones. */
+#define PROFILE_ZONE_ONE(name) +1
+const uint8_t PROFILE_ZONE_COUNT = 0 PROFILE_ZONES(PROFILE_ZONE_ONE);
+#undef PROFILE_ZONE_ONE
+
+/** @brief Enumeration of the actions of a CommandProfile packet. */
+enum class ProfileAction : uint8_t {
+  /** @brief Send a profile_report of every zone to the ground. */
+  Report,
+  /** @brief Clear every zone. */
+  Reset,
+  /** @brief Print every zone to the debug serial port. */
+  Print,
+};
+
+/** @brief The times recorded for a zone. */
+struct profile_stats {
+  /** @brief The number of times the zone has run. */
+  uint32_t calls = 0;
+  /** @brief The total time, in nanoseconds, the zone has run. */
+  uint64_t total = 0;
+  /** @brief The longest time, in nanoseconds, the zone has run. */
+  uint32_t max   = 0;
+  /**
+   * @brief The number of runs by time.
+   *
+   * Bin n counts runs of 2^n up to 2^(n+1) nanoseconds. Bin 0 also counts
+   * runs of no time.
+   */
+  uint32_t histogram[PROFILE_BINS]{};
+};
+
+/**
+ * @brief The times of a zone, as sent to the ground.
+ *
+ * Only PROFILE_REPORT_BINS bins of the histogram are sent, ending with the
+ * slowest bin that has counts. Faster runs are added to the first bin sent.
+ */
+struct __attribute__((packed)) profile_report {
+  /** @brief The ProfileZone. */
+  uint8_t  zone;
+  /** @brief The bin of the histogram sent first. */
+  uint8_t  first_bin;
+  /** @brief The number of ticks in a microsecond, PROFILE_TICKS_PER_US. */
+  uint16_t ticks_per_us;
+  /** @brief The number of times the zone has run. */
+  uint32_t calls;
+  /** @brief The total time, in ticks, the zone has run. */
+  uint64_t total;
+  /** @brief The longest time, in ticks, the zone has run. */
+  uint32_t max;
+  /** @brief The bins of the histogram, which stop counting at 65535. */
+  uint16_t bins[PROFILE_REPORT_BINS];
+};
+/**<  A diagram of the struct is included below.
+ *
+ * @verbatim
+1 byte 1 byte      2 bytes        4 bytes 8 bytes 4 bytes 24 bytes
++------+-----------+--------------+-------+-------+-------+------+
+| zone | first_bin | ticks_per_us | calls | total | max   | bins |
++------+-----------+--------------+-------+-------+-------+------+
+   @endverbatim
+ */
+
+/**
+ * @brief The time now, in cycles of the processor's clock.
+ *
+ * @return uint32_t The time, which wraps around.
+ */
+inline uint32_t profile_cycles() {
+#if defined(__IMXRT1062__)
+  return ARM_DWT_CYCCNT;
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+#endif
+}
+
+uint16_t             profile_cycles_per_us();
+void                 record_profile(ProfileZone zone, uint32_t cycles,
+                                    uint16_t cycles_per_us);
+void                 reset_profile();
+const profile_stats &get_profile(ProfileZone zone);
+const char          *profile_zone_name(ProfileZone zone);
+profile_report       make_profile_report(ProfileZone zone);
+
+/**
+ * @brief Times a zone from its construction to the end of its scope.
+ *
+ * For example, `ProfileScope profile(ProfileZone::PDUSend);` at the start of
+ * PDU::send() times every return from it. Without the PROFILER build flag,
+ * this does nothing.
+ *
+ * A zone should only be run by one thread, as its times are not locked.
+ */
+class ProfileScope {
+public:
+#ifdef PROFILER
+  /** @brief Start timing a zone. */
+  explicit ProfileScope(ProfileZone zone)
+      : zone(zone), cycles_per_us(profile_cycles_per_us()),
+        start(profile_cycles()) {}
+  /** @brief Stop timing the zone and record its time. */
+  ~ProfileScope() {
+    record_profile(zone, profile_cycles() - start, cycles_per_us);
+  }
+
+private:
+  /** @brief The zone being timed. */
+  ProfileZone zone;
+  /** @brief The clock frequency, in MHz, when the zone started. */
+  uint16_t    cycles_per_us;
+  /** @brief The time, in cycles, the zone started. */
+  uint32_t    start;
+#else
+  explicit ProfileScope(ProfileZone) {}
+#endif
+};
+} // namespace Helpers
+
+#endif // _PROFILER_H
@@ -4,6 +4,7 @@
  *
  * This file contains definitions for the RFM23 radio class.
  */
+#include <profiler.h>
 #include <rfm23.h>
 
 namespace Artemis {
@@ -29,11 +30,11 @@ namespace Devices {
    * @todo The function puts the rfm23 into sleep mode, then idle mode. Is this
    * intended? idle overrides sleep.
    */
-  bool RFM23::init(rfm23_config cfg, Threads::Mutex *mtx) {
+  bool RFM23::init(rfm23_config cfg, Helpers::RecoverableMutex *mtx) {
     config  = cfg;
     spi_mtx = mtx;
 
-    Threads::Scope lock(*spi_mtx);
+    Helpers::MutexScope lock(*spi_mtx);
     SPI1.setMISO(config.pins.spi_miso);
     SPI1.setMOSI(config.pins.spi_mosi);
     SPI1.setSCK(config.pins.spi_sck);
@@ -74,10 +75,21 @@ namespace Devices {
 
   /** @brief Resets the radio. */
   void RFM23::reset() {
-    Threads::Scope lock(*spi_mtx);
+    Helpers::MutexScope lock(*spi_mtx);
     rfm23.reset();
   }
 
+  /**
+   * @brief Change the transmit power.
+   *
+   * @param power The transmit power, set as a macro.
+   */
+  void RFM23::set_tx_power(uint8_t power) {
+    Helpers::MutexScope lock(*spi_mtx);
+    config.tx_power = power;
+    rfm23.setTxPower(power);
+  }
+
   /**
    * @brief Sends a packet through the radio.
    *
@@ -108,7 +120,7 @@ namespace Devices {
 
     print_hexdump(Helpers::RFM23, "Radio Sending: ", packet.wrapped.data(),
                   packet.wrapped.size());
-    Threads::Scope lock(*spi_mtx);
+    Helpers::MutexScope lock(*spi_mtx);
     if (!rfm23.send(packet.wrapped.data(), packet.wrapped.size())) {
       print_debug(Helpers::RFM23, "Failed to queue outgoing packet to radio");
       return false;
@@ -136,17 +148,20 @@ namespace Devices {
    * use setGpioReversed().
    */
   int32_t RFM23::recv(PacketComm &packet, uint16_t timeout) {
+    Helpers::ProfileScope profile(Helpers::ProfileZone::RFM23Recv);
     digitalWrite(config.pins.rx_on, LOW);
     digitalWrite(config.pins.tx_on, HIGH);
 
-    Threads::Scope lock(*spi_mtx);
-    if (rfm23.waitAvailableTimeout(timeout)) {
+    Helpers::MutexScope lock(*spi_mtx);
+    if (wait_available(timeout)) {
       packet.wrapped.resize(0);
       packet.wrapped.resize(RH_RF22_MAX_MESSAGE_LEN);
       uint8_t bytes_recieved = packet.wrapped.size();
       if (rfm23.recv(packet.wrapped.data(), &bytes_recieved)) {
         packet.wrapped.resize(bytes_recieved);
-        if (packet.Unwrap() < 0) {
+        Helpers::trace_ingress(Helpers::TraceSource::RFM23,
+                               packet.wrapped.data(), bytes_recieved);
+        if (!packet.Unwrap()) {
           print_debug(Helpers::RFM23,
                       "Data was received, but not in packetcomm format.");
           return -1;
@@ -158,5 +173,27 @@ namespace Devices {
     rfm23.setModeIdle();
     return -1;
   }
+
+  /**
+   * @brief Wait for the radio to receive a frame.
+   *
+   * RadioHead's waitAvailableTimeout() spins until a frame arrives, which
+   * keeps the channel running to the end of every time slice it is given.
+   * This yields to the other threads between checks instead.
+   *
+   * @param timeout The time to wait, in milliseconds.
+   * @return true A frame is waiting to be read.
+   * @return false None arrived in time.
+   */
+  bool RFM23::wait_available(uint16_t timeout) {
+    const uint32_t start = millis();
+    while (!rfm23.available()) {
+      if (millis() - start >= timeout) {
+        return false;
+      }
+      threads.yield();
+    }
+    return true;
+  }
 } // namespace Devices
 } // namespace Artemis
\ No newline at end of file
@@ -51,8 +51,9 @@ namespace Devices {
 
     RFM23(uint8_t slaveSelectPin, uint8_t interruptPin,
           RHGenericSPI &spi = hardware_spi1);
-    bool    init(rfm23_config cfg, Threads::Mutex *mtx);
+    bool    init(rfm23_config cfg, Helpers::RecoverableMutex *mtx);
     void    reset();
+    void    set_tx_power(uint8_t power);
     bool    send(PacketComm &packet);
     int32_t recv(PacketComm &packet, uint16_t timeout);
 
@@ -64,11 +65,13 @@ namespace Devices {
      * RH_RF22](http://www.airspayce.com/mikem/arduino/RadioHead/classRH__RF22.html)
      * object.
      */
-    RH_RF22         rfm23;
+    RH_RF22                    rfm23;
     /** @brief The mutex used to lock the SPI interface to the radio. */
-    Threads::Mutex *spi_mtx;
+    Helpers::RecoverableMutex *spi_mtx;
     /** @brief The configuration of the RFM23 class. */
-    rfm23_config    config;
+    rfm23_config               config;
+
+    bool                       wait_available(uint16_t timeout);
   };
 } // namespace Devices
 } // namespace Artemis
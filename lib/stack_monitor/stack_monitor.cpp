@@ -0,0 +1,103 @@
+/**
+ * @file stack_monitor.cpp
+ * @brief The thread stack monitor.
+ *
+ * This file contains definitions of the functions that paint and scan thread
+ * stacks.
+ */
+#include <stack_monitor.h>
+#include <string.h>
+
+namespace Helpers {
+namespace {
+  /** @brief The monitored stacks. */
+  monitored_stack stacks[STACK_MONITOR_SLOTS];
+} // namespace
+
+/**
+ * @brief Paint a stack and start monitoring it.
+ *
+ * This must be called before the thread using the stack is started. A stack
+ * already monitored for the same channel, such as that of a restarted
+ * thread, is replaced.
+ *
+ * @param channel_id The Channel_ID of the thread that will use the stack.
+ * @param stack The lowest address of the stack.
+ * @param size The size of the stack, in bytes.
+ * @return uint8_t* The stack, to be passed to threads.addThread().
+ */
+uint8_t *paint_stack(uint8_t channel_id, uint8_t *stack, uint32_t size) {
+  memset(stack, STACK_PAINT, size);
+  monitored_stack *slot = nullptr;
+  for (monitored_stack &monitored : stacks) {
+    if (monitored.channel_id == channel_id) {
+      slot = &monitored;
+      break;
+    }
+    if (slot == nullptr && monitored.channel_id == 0) {
+      slot = &monitored;
+    }
+  }
+  if (slot != nullptr) {
+    *slot            = monitored_stack();
+    slot->channel_id = channel_id;
+    slot->stack      = stack;
+    slot->size       = size;
+  }
+  return stack;
+}
+
+/**
+ * @brief Find how much of a painted stack has been used.
+ *
+ * The stack grows down, so the paint is searched for from its lowest
+ * address up to the first byte that has been written.
+ *
+ * @param stack The lowest address of the stack.
+ * @param size The size of the stack, in bytes.
+ * @return uint32_t The most bytes of the stack ever used.
+ */
+uint32_t stack_high_water(const uint8_t *stack, uint32_t size) {
+  uint32_t unused = 0;
+  while (unused < size && stack[unused] == STACK_PAINT) {
+    unused++;
+  }
+  return size - unused;
+}
+
+/**
+ * @brief Update the high-water mark of every monitored stack.
+ *
+ * @return uint8_t A bit for each slot whose stack has newly passed
+ * STACK_WARNING_PERCENT of its size. Each stack is only warned about once.
+ */
+uint8_t scan_stacks() {
+  uint8_t warnings = 0;
+  for (uint8_t i = 0; i < STACK_MONITOR_SLOTS; i++) {
+    monitored_stack &monitored = stacks[i];
+    if (monitored.channel_id == 0) {
+      continue;
+    }
+    monitored.high_water = stack_high_water(monitored.stack, monitored.size);
+    if (!monitored.warned && monitored.high_water * 100 >=
+                                 monitored.size * STACK_WARNING_PERCENT) {
+      monitored.warned  = true;
+      warnings         |= 1 << i;
+    }
+  }
+  return warnings;
+}
+
+/**
+ * @brief A monitored stack.
+ *
+ * @param slot The slot of the stack, up to STACK_MONITOR_SLOTS.
+ * @return const monitored_stack* The stack, or nullptr if the slot is unused.
+ */
+const monitored_stack *get_stack(uint8_t slot) {
+  if (slot >= STACK_MONITOR_SLOTS || stacks[slot].channel_id == 0) {
+    return nullptr;
+  }
+  return &stacks[slot];
+}
+} // namespace Helpers
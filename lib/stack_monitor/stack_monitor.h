@@ -0,0 +1,49 @@
+/**
+ * @file stack_monitor.h
+ * @brief The header file for the thread stack monitor.
+ *
+ * This file contains declarations for the stack monitor, which measures how
+ * much of each thread's stack has ever been used. A stack is painted with a
+ * known byte before its thread starts, and the deepest byte that has been
+ * overwritten gives the stack's high-water mark.
+ */
+#ifndef _STACK_MONITOR_H
+#define _STACK_MONITOR_H
+
+#include <stdint.h>
+
+/** @brief The number of stacks that can be monitored. */
+#define STACK_MONITOR_SLOTS   7
+/** @brief The byte a stack is painted with. */
+#define STACK_PAINT           0xA5
+/**
+ * @brief The percentage of a stack that, once used, should be warned about.
+ *
+ * The warning leaves time to give the thread a larger stack before it
+ * overflows into the memory next to it.
+ */
+#define STACK_WARNING_PERCENT 75
+
+namespace Helpers {
+/** @brief A monitored stack. */
+struct monitored_stack {
+  /** @brief The Channel_ID of the thread using the stack, or 0 if unused. */
+  uint8_t  channel_id = 0;
+  /** @brief Whether the stack has been warned about. */
+  bool     warned     = false;
+  /** @brief The lowest address of the stack, which it grows down to. */
+  uint8_t *stack      = nullptr;
+  /** @brief The size of the stack, in bytes. */
+  uint32_t size       = 0;
+  /** @brief The most bytes of the stack used, as of the last scan. */
+  uint32_t high_water = 0;
+};
+
+uint8_t               *paint_stack(uint8_t channel_id, uint8_t *stack,
+                                   uint32_t size);
+uint32_t               stack_high_water(const uint8_t *stack, uint32_t size);
+uint8_t                scan_stacks();
+const monitored_stack *get_stack(uint8_t slot);
+} // namespace Helpers
+
+#endif // _STACK_MONITOR_H
@@ -0,0 +1,157 @@
+/**
+ * @file supervisor.cpp
+ * @brief The channel supervisor.
+ *
+ * This file contains definitions of the functions that count heartbeats and
+ * find stalled channels.
+ */
+#include <supervisor.h>
+
+namespace Helpers {
+namespace {
+  /** @brief The supervised channels. */
+  supervised_channel channels[SUPERVISOR_SLOTS];
+  /**
+   * @brief The heartbeat count of each slot.
+   *
+   * They are kept apart from the slots as they are written by the channels,
+   * while the slots are only written by the supervisor.
+   */
+  volatile uint32_t  beats[SUPERVISOR_SLOTS];
+
+  /**
+   * @brief The time, in milliseconds, a channel is given before it is
+   * restarted, doubled for each restart since its last heartbeat.
+   */
+  uint32_t           backoff_deadline(const supervised_channel &channel) {
+    const uint8_t doublings = channel.retries < SUPERVISOR_MAX_BACKOFF
+                                  ? channel.retries
+                                  : SUPERVISOR_MAX_BACKOFF;
+    return channel.deadline << doublings;
+  }
+
+  /** @brief The slot of a channel, or SUPERVISOR_SLOTS if it has none. */
+  uint8_t            find_slot(uint8_t channel_id) {
+    for (uint8_t i = 0; i < SUPERVISOR_SLOTS; i++) {
+      if (channels[i].channel_id == channel_id) {
+        return i;
+      }
+    }
+    return SUPERVISOR_SLOTS;
+  }
+} // namespace
+
+/**
+ * @brief Start supervising a channel, or restart its deadline.
+ *
+ * This is called whenever the channel's thread is started. The restarts of
+ * a channel already supervised are kept.
+ *
+ * @param channel_id The Channel_ID of the channel.
+ * @param deadline The longest time, in milliseconds, allowed between
+ * heartbeats, and before the first.
+ * @param now The uptime, in milliseconds.
+ * @param essential Whether the channel is restarted however often it stalls.
+ */
+void supervise(uint8_t channel_id, uint32_t deadline, uint32_t now,
+               bool essential) {
+  uint8_t slot = find_slot(channel_id);
+  if (slot == SUPERVISOR_SLOTS) {
+    slot = find_slot(0);
+    if (slot == SUPERVISOR_SLOTS) {
+      return;
+    }
+    channels[slot]            = supervised_channel();
+    channels[slot].channel_id = channel_id;
+  }
+  channels[slot].deadline   = deadline;
+  channels[slot].essential  = essential;
+  channels[slot].seen_beats = beats[slot];
+  channels[slot].last_beat  = now;
+}
+
+/**
+ * @brief Count a heartbeat of the running channel.
+ *
+ * Each channel calls this once every pass of its loop.
+ *
+ * @param channel_id The Channel_ID of the channel.
+ */
+void heartbeat(uint8_t channel_id) {
+  const uint8_t slot = find_slot(channel_id);
+  if (slot < SUPERVISOR_SLOTS) {
+    beats[slot]++;
+  }
+}
+
+/**
+ * @brief Find a channel that has missed its heartbeat deadline.
+ *
+ * The deadline is doubled for each restart since the channel's last
+ * heartbeat, up to SUPERVISOR_MAX_BACKOFF times. A channel that is not
+ * essential and has been restarted SUPERVISOR_MAX_RESTARTS times without a
+ * heartbeat is not reported again until it has one.
+ *
+ * @param now The uptime, in milliseconds.
+ * @return uint8_t The Channel_ID of the stalled channel, or 0 if none has
+ * stalled.
+ */
+uint8_t find_stalled_channel(uint32_t now) {
+  for (uint8_t i = 0; i < SUPERVISOR_SLOTS; i++) {
+    supervised_channel &channel = channels[i];
+    if (channel.channel_id == 0) {
+      continue;
+    }
+    const uint32_t count = beats[i];
+    if (count != channel.seen_beats) {
+      channel.seen_beats = count;
+      channel.last_beat  = now;
+      channel.retries    = 0;
+    } else if (now - channel.last_beat > backoff_deadline(channel) &&
+               (channel.essential ||
+                channel.retries < SUPERVISOR_MAX_RESTARTS)) {
+      return channel.channel_id;
+    }
+  }
+  return 0;
+}
+
+/**
+ * @brief Count a restart of a channel.
+ *
+ * @param channel_id The Channel_ID of the channel.
+ * @param cause The reason it is restarted.
+ * @return true The restart is counted.
+ * @return false The channel is not essential and has been restarted
+ * SUPERVISOR_MAX_RESTARTS times without a heartbeat, or is not supervised,
+ * and must be left stopped.
+ */
+bool record_restart(uint8_t channel_id, RestartCause cause) {
+  const uint8_t slot = find_slot(channel_id);
+  if (slot == SUPERVISOR_SLOTS ||
+      (!channels[slot].essential &&
+       channels[slot].retries >= SUPERVISOR_MAX_RESTARTS)) {
+    return false;
+  }
+  channels[slot].cause = cause;
+  channels[slot].restarts++;
+  if (channels[slot].retries < UINT8_MAX) {
+    channels[slot].retries++;
+  }
+  return true;
+}
+
+/**
+ * @brief Get a supervised channel.
+ *
+ * @param slot The slot of the channel, from 0 to SUPERVISOR_SLOTS - 1.
+ * @return const supervised_channel* The channel, or nullptr if the slot is
+ * unused.
+ */
+const supervised_channel *get_supervised(uint8_t slot) {
+  if (slot >= SUPERVISOR_SLOTS || channels[slot].channel_id == 0) {
+    return nullptr;
+  }
+  return &channels[slot];
+}
+} // namespace Helpers
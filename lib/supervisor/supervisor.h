@@ -0,0 +1,75 @@
+/**
+ * @file supervisor.h
+ * @brief The header file for the channel supervisor.
+ *
+ * This file contains declarations for the channel supervisor, which notices
+ * when a channel stops making progress. Each channel counts a heartbeat once
+ * every pass of its loop, and a channel whose count has not changed within
+ * its deadline is reported as stalled, so that it can be restarted.
+ */
+#ifndef _SUPERVISOR_H
+#define _SUPERVISOR_H
+
+#include <stdint.h>
+
+/** @brief The number of channels that can be supervised. */
+#define SUPERVISOR_SLOTS        7
+/**
+ * @brief The most times a channel is restarted without a heartbeat between.
+ *
+ * A channel that stalls again straight after every restart, such as one
+ * waiting on hardware that has failed, is left alone after this many tries
+ * rather than being restarted forever. An essential channel is restarted
+ * forever.
+ */
+#define SUPERVISOR_MAX_RESTARTS 5
+/**
+ * @brief The most times a channel's deadline is doubled.
+ *
+ * Each restart without a heartbeat between doubles the time the channel is
+ * given before it is restarted again, so that a channel waiting on hardware
+ * is not kept from it by restarts.
+ */
+#define SUPERVISOR_MAX_BACKOFF  4
+
+namespace Helpers {
+/** @brief Enumeration of the reasons a channel was restarted. */
+enum class RestartCause : uint8_t {
+  /** @brief The channel has not been restarted. */
+  None,
+  /** @brief The channel missed its heartbeat deadline. */
+  Stalled,
+  /** @brief The channel's thread ended. */
+  Ended,
+};
+
+/** @brief A supervised channel. */
+struct supervised_channel {
+  /** @brief The Channel_ID of the channel, or 0 if unused. */
+  uint8_t      channel_id = 0;
+  /** @brief The reason the channel was last restarted. */
+  RestartCause cause      = RestartCause::None;
+  /** @brief The number of times the channel has been restarted. */
+  uint16_t     restarts   = 0;
+  /** @brief The restarts since the channel's last heartbeat. */
+  uint8_t      retries    = 0;
+  /** @brief Whether the channel is restarted however often it stalls. */
+  bool         essential  = false;
+  /** @brief The longest time, in milliseconds, allowed between heartbeats. */
+  uint32_t     deadline   = 0;
+  /** @brief The heartbeat count when it was last checked. */
+  uint32_t     seen_beats = 0;
+  /** @brief The time, in milliseconds, the heartbeat count last changed. */
+  uint32_t     last_beat  = 0;
+};
+
+void                      supervise(uint8_t channel_id, uint32_t deadline,
+                                    uint32_t now, bool essential);
+void                      heartbeat(uint8_t channel_id);
+uint8_t                   find_stalled_channel(uint32_t now);
+bool                      record_restart(uint8_t      channel_id,
+                                         RestartCause cause);
+const supervised_channel *get_supervised(uint8_t slot);
+} // namespace Helpers
+
+#endif // _SUPERVISOR_H
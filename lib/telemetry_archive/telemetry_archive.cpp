@@ -0,0 +1,455 @@
+/**
+ * @file telemetry_archive.cpp
+ * @brief The telemetry archive format.
+ *
+ * This file contains definitions for the ArchiveEncoder class and the archive
+ * block decoder.
+ */
+#include <string.h>
+#include <telemetry_archive.h>
+
+namespace Artemis {
+namespace Storage {
+  namespace {
+    /** @brief The offset of the deci field in a beacon. */
+    const uint16_t DECI_OFFSET    = 1;
+    /** @brief The offset of the schema version in a beacon. */
+    const uint16_t VERSION_OFFSET = 5;
+    /** @brief The offset of the first 32-bit word after the beacon header. */
+    const uint16_t WORD_OFFSET    = 6;
+
+    /** @brief Writes values of any width up to 32 bits, MSB first. */
+    class BitWriter {
+    public:
+      BitWriter(uint8_t *destination, uint32_t capacity)
+          : dst(destination), size(capacity) {}
+
+      /**
+       * @brief Write the low bits of a value.
+       *
+       * @param value The value to be written.
+       * @param bits The number of bits to be written, from 1 to 32.
+       */
+      void write(uint32_t value, uint8_t bits) {
+        if (bits < 32) {
+          value &= (1u << bits) - 1;
+        }
+        pending = (pending << bits) | value;
+        count += bits;
+        while (count >= 8) {
+          count -= 8;
+          put((uint8_t)(pending >> count));
+        }
+      }
+
+      /** @brief Write out any partial byte, padded with zeros. */
+      void finish() {
+        if (count > 0) {
+          put((uint8_t)(pending << (8 - count)));
+          count = 0;
+        }
+      }
+
+      /** @brief The number of bytes written. */
+      uint32_t written() const { return used; }
+      /** @brief Whether more bytes were written than fit. */
+      bool     overflowed() const { return overflow; }
+
+    private:
+      uint8_t *dst;
+      uint32_t size;
+      uint32_t used     = 0;
+      uint64_t pending  = 0;
+      uint8_t  count    = 0;
+      bool     overflow = false;
+
+      void     put(uint8_t byte) {
+        if (used < size) {
+          dst[used++] = byte;
+        } else {
+          overflow = true;
+        }
+      }
+    };
+
+    /** @brief Reads values written by a BitWriter. */
+    class BitReader {
+    public:
+      BitReader(const uint8_t *source, uint32_t length)
+          : src(source), size(length) {}
+
+      /**
+       * @brief Read a value.
+       *
+       * @param bits The number of bits to be read, from 1 to 32.
+       * @return uint32_t The value, or 0 past the end of the source.
+       */
+      uint32_t read(uint8_t bits) {
+        while (count < bits) {
+          if (used < size) {
+            pending = (pending << 8) | src[used++];
+          } else {
+            pending <<= 8;
+            overrun = true;
+          }
+          count += 8;
+        }
+        count -= bits;
+        const uint32_t value = (uint32_t)(pending >> count);
+        return bits < 32 ? value & ((1u << bits) - 1) : value;
+      }
+
+      /** @brief Whether more bits were read than the source holds. */
+      bool failed() const { return overrun; }
+
+    private:
+      const uint8_t *src;
+      uint32_t       size;
+      uint32_t       used    = 0;
+      uint64_t       pending = 0;
+      uint8_t        count   = 0;
+      bool           overrun = false;
+    };
+
+    uint32_t load32(const uint8_t *src) {
+      uint32_t value;
+      memcpy(&value, src, sizeof(value));
+      return value;
+    }
+
+    void store32(uint8_t *dst, uint32_t value) {
+      memcpy(dst, &value, sizeof(value));
+    }
+
+    /** @brief Encode a column of 32-bit counters as deltas of deltas. */
+    void encode_deltas(BitWriter &w, const uint8_t *records, uint8_t size,
+                       uint8_t count, uint16_t offset) {
+      uint32_t previous       = load32(&records[offset]);
+      uint32_t previous_delta = 0;
+      w.write(previous, 32);
+      for (uint8_t i = 1; i < count; i++) {
+        const uint32_t value = load32(&records[i * size + offset]);
+        const uint32_t delta = value - previous;
+        const int32_t  dod   = (int32_t)(delta - previous_delta);
+        const uint32_t zz    = ((uint32_t)dod << 1) ^ (uint32_t)(dod >> 31);
+        if (zz == 0) {
+          w.write(0b0, 1);
+        } else if (zz < (1u << 7)) {
+          w.write(0b10, 2);
+          w.write(zz, 7);
+        } else if (zz < (1u << 9)) {
+          w.write(0b110, 3);
+          w.write(zz, 9);
+        } else if (zz < (1u << 12)) {
+          w.write(0b1110, 4);
+          w.write(zz, 12);
+        } else {
+          w.write(0b1111, 4);
+          w.write(zz, 32);
+        }
+        previous       = value;
+        previous_delta = delta;
+      }
+    }
+
+    /** @brief Decode a column written by encode_deltas(). */
+    void decode_deltas(BitReader &r, uint8_t *records, uint8_t size,
+                       uint8_t count, uint16_t offset) {
+      uint32_t previous       = r.read(32);
+      uint32_t previous_delta = 0;
+      store32(&records[offset], previous);
+      for (uint8_t i = 1; i < count; i++) {
+        uint32_t zz = 0;
+        if (r.read(1) == 1) {
+          if (r.read(1) == 0) {
+            zz = r.read(7);
+          } else if (r.read(1) == 0) {
+            zz = r.read(9);
+          } else if (r.read(1) == 0) {
+            zz = r.read(12);
+          } else {
+            zz = r.read(32);
+          }
+        }
+        const uint32_t dod   = (zz >> 1) ^ (0u - (zz & 1));
+        const uint32_t delta = previous_delta + dod;
+        previous += delta;
+        previous_delta = delta;
+        store32(&records[i * size + offset], previous);
+      }
+    }
+
+    /** @brief Encode a column of 32-bit words XORed with the previous. */
+    void encode_xor(BitWriter &w, const uint8_t *records, uint8_t size,
+                    uint8_t count, uint16_t offset) {
+      uint32_t previous = load32(&records[offset]);
+      uint8_t  lead     = 0;
+      uint8_t  length   = 0;
+      w.write(previous, 32);
+      for (uint8_t i = 1; i < count; i++) {
+        const uint32_t value = load32(&records[i * size + offset]);
+        const uint32_t x     = value ^ previous;
+        previous             = value;
+        if (x == 0) {
+          w.write(0b0, 1);
+          continue;
+        }
+        const uint8_t x_lead  = __builtin_clz(x);
+        const uint8_t x_trail = __builtin_ctz(x);
+        if (length > 0 && x_lead >= lead && x_trail >= 32 - lead - length) {
+          // The changed bits fit in the previous window.
+          w.write(0b10, 2);
+          w.write(x >> (32 - lead - length), length);
+        } else {
+          lead   = x_lead;
+          length = 32 - x_lead - x_trail;
+          w.write(0b11, 2);
+          w.write(lead, 5);
+          w.write(length - 1, 5);
+          w.write(x >> x_trail, length);
+        }
+      }
+    }
+
+    /** @brief Decode a column written by encode_xor(). */
+    bool decode_xor(BitReader &r, uint8_t *records, uint8_t size,
+                    uint8_t count, uint16_t offset) {
+      uint32_t previous = r.read(32);
+      uint8_t  lead     = 0;
+      uint8_t  length   = 0;
+      store32(&records[offset], previous);
+      for (uint8_t i = 1; i < count; i++) {
+        if (r.read(1) == 1) {
+          if (r.read(1) == 1) {
+            lead   = r.read(5);
+            length = r.read(5) + 1;
+            if (lead + length > 32) {
+              return false;
+            }
+          } else if (length == 0) {
+            return false;
+          }
+          previous ^= r.read(length) << (32 - lead - length);
+        }
+        store32(&records[i * size + offset], previous);
+      }
+      return true;
+    }
+
+    /** @brief Encode a column of bytes, marking unchanged bytes with 1 bit. */
+    void encode_bytes(BitWriter &w, const uint8_t *records, uint8_t size,
+                      uint8_t count, uint16_t offset) {
+      w.write(records[offset], 8);
+      for (uint8_t i = 1; i < count; i++) {
+        const uint8_t value = records[i * size + offset];
+        if (value == records[(i - 1) * size + offset]) {
+          w.write(0b0, 1);
+        } else {
+          w.write(0b1, 1);
+          w.write(value, 8);
+        }
+      }
+    }
+
+    /** @brief Decode a column written by encode_bytes(). */
+    void decode_bytes(BitReader &r, uint8_t *records, uint8_t size,
+                      uint8_t count, uint16_t offset) {
+      records[offset] = r.read(8);
+      for (uint8_t i = 1; i < count; i++) {
+        records[i * size + offset] =
+            r.read(1) == 1 ? r.read(8) : records[(i - 1) * size + offset];
+      }
+    }
+
+    /** @brief The number of 32-bit word columns after the deci field. */
+    uint16_t word_count(uint8_t size) {
+      return size > WORD_OFFSET ? (size - WORD_OFFSET) / 4 : 0;
+    }
+
+    /** @brief The offset of the first trailing byte column. */
+    uint16_t byte_offset(uint8_t size) {
+      if (size < VERSION_OFFSET) {
+        return DECI_OFFSET;
+      }
+      return size > WORD_OFFSET ? WORD_OFFSET + 4 * word_count(size)
+                                : VERSION_OFFSET;
+    }
+  } // namespace
+
+  /**
+   * @brief Add a beacon to the archive.
+   *
+   * A block is produced when the beacon's slot fills up. A block can also be
+   * produced early, to make room, when the beacon's size differs from the
+   * others of its type or when every slot is in use by another type. The
+   * block must be taken with block() before the next call.
+   *
+   * @param record The beacon, starting with its type byte.
+   * @param size The size of the beacon. Beacons larger than
+   * ARCHIVE_MAX_RECORD_SIZE are ignored and must be stored some other way.
+   * @return true A block has been produced.
+   * @return false No block has been produced.
+   */
+  bool ArchiveEncoder::add(const uint8_t *record, uint16_t size) {
+    if (size == 0 || size > ARCHIVE_MAX_RECORD_SIZE) {
+      return false;
+    }
+
+    slot *target  = nullptr;
+    slot *empty   = nullptr;
+    slot *fullest = &slots[0];
+    for (slot &s : slots) {
+      if (s.count == 0) {
+        if (empty == nullptr) {
+          empty = &s;
+        }
+      } else if (s.type == record[0]) {
+        target = &s;
+      }
+      if (s.count > fullest->count) {
+        fullest = &s;
+      }
+    }
+
+    bool produced = false;
+    if (target != nullptr && target->record_size != size) {
+      encode(*target);
+      produced = true;
+    } else if (target == nullptr && empty != nullptr) {
+      target = empty;
+    } else if (target == nullptr) {
+      target = fullest;
+      encode(*target);
+      produced = true;
+    }
+
+    target->type        = record[0];
+    target->record_size = size;
+    memcpy(&target->records[target->count * size], record, size);
+    target->count++;
+    if (target->count == ARCHIVE_BLOCK_RECORDS) {
+      encode(*target);
+      produced = true;
+    }
+    return produced;
+  }
+
+  /**
+   * @brief Produce a block from a partially filled slot.
+   *
+   * Call repeatedly until it returns false to archive every buffered beacon,
+   * taking each block with block().
+   *
+   * @return true A block has been produced.
+   * @return false No beacons are buffered.
+   */
+  bool ArchiveEncoder::flush() {
+    for (slot &s : slots) {
+      if (s.count > 0) {
+        encode(s);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /**
+   * @brief Compress the beacons in a slot into the output block.
+   *
+   * @param s The slot to be emptied.
+   */
+  void ArchiveEncoder::encode(slot &s) {
+    archive_header header;
+    header.method      = ArchiveMethod::Columnar;
+    header.type        = s.type;
+    header.count       = s.count;
+    header.record_size = s.record_size;
+
+    const uint8_t  size     = s.record_size;
+    const uint32_t raw_size = s.count * size;
+    BitWriter      w(&output[sizeof(header)], raw_size);
+    if (size >= VERSION_OFFSET) {
+      encode_deltas(w, s.records, size, s.count, DECI_OFFSET);
+    }
+    if (size > WORD_OFFSET) {
+      encode_bytes(w, s.records, size, s.count, VERSION_OFFSET);
+    }
+    for (uint16_t i = 0; i < word_count(size); i++) {
+      encode_xor(w, s.records, size, s.count, WORD_OFFSET + 4 * i);
+    }
+    for (uint16_t offset = byte_offset(size); offset < size; offset++) {
+      encode_bytes(w, s.records, size, s.count, offset);
+    }
+    w.finish();
+
+    output_size = sizeof(header) + w.written();
+    if (w.overflowed() || w.written() >= raw_size) {
+      header.method = ArchiveMethod::Raw;
+      memcpy(&output[sizeof(header)], s.records, raw_size);
+      output_size = sizeof(header) + raw_size;
+    }
+    memcpy(output, &header, sizeof(header));
+    s.count = 0;
+  }
+
+  /**
+   * @brief Decode an archive block back into beacons.
+   *
+   * @param block A pointer to the block.
+   * @param size The size of the block.
+   * @param header The header that will carry the block's header.
+   * @param records The buffer that will carry the beacons, one after another.
+   * @param capacity The size of the buffer.
+   * @return int32_t The number of beacons decoded, or -1 if the block is
+   * invalid or does not fit in the buffer.
+   */
+  int32_t decode_archive_block(const uint8_t *block, uint16_t size,
+                               archive_header &header, uint8_t *records,
+                               uint32_t capacity) {
+    if (size < sizeof(header)) {
+      return -1;
+    }
+    memcpy(&header, block, sizeof(header));
+    const uint8_t  record_size = header.record_size;
+    const uint8_t  count       = header.count;
+    const uint32_t raw_size    = count * record_size;
+    if (record_size == 0 || raw_size > capacity) {
+      return -1;
+    }
+    block += sizeof(header);
+    size -= sizeof(header);
+
+    if (header.method == ArchiveMethod::Raw) {
+      if (size < raw_size) {
+        return -1;
+      }
+      memcpy(records, block, raw_size);
+      return count;
+    }
+    if (header.method != ArchiveMethod::Columnar || count == 0) {
+      return -1;
+    }
+
+    BitReader r(block, size);
+    for (uint8_t i = 0; i < count; i++) {
+      records[i * record_size] = header.type;
+    }
+    if (record_size >= VERSION_OFFSET) {
+      decode_deltas(r, records, record_size, count, DECI_OFFSET);
+    }
+    if (record_size > WORD_OFFSET) {
+      decode_bytes(r, records, record_size, count, VERSION_OFFSET);
+    }
+    for (uint16_t i = 0; i < word_count(record_size); i++) {
+      if (!decode_xor(r, records, record_size, count, WORD_OFFSET + 4 * i)) {
+        return -1;
+      }
+    }
+    for (uint16_t offset = byte_offset(record_size); offset < record_size;
+         offset++) {
+      decode_bytes(r, records, record_size, count, offset);
+    }
+    return r.failed() ? -1 : count;
+  }
+} // namespace Storage
+} // namespace Artemis
@@ -0,0 +1,109 @@
+/**
+ * @file telemetry_archive.h
+ * @brief The header file for the telemetry archive format.
+ *
+ * This file contains declarations for the ArchiveEncoder class and the
+ * archive block decoder. Archive blocks store beacons in compressed columns,
+ * and are decoded on the ground by the same code.
+ */
+#ifndef _TELEMETRY_ARCHIVE_H
+#define _TELEMETRY_ARCHIVE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** @brief The number of beacons collected into each archive block. */
+#define ARCHIVE_BLOCK_RECORDS   16
+/** @brief The largest beacon, in bytes, that can be archived. */
+#define ARCHIVE_MAX_RECORD_SIZE 48
+/** @brief The number of beacon types that can be collected at once. */
+#define ARCHIVE_SLOTS           8
+/** @brief The largest archive block, in bytes. */
+#define ARCHIVE_MAX_BLOCK_SIZE                                                 \
+  (sizeof(Artemis::Storage::archive_header) +                                  \
+   ARCHIVE_BLOCK_RECORDS * ARCHIVE_MAX_RECORD_SIZE)
+
+namespace Artemis {
+namespace Storage {
+  /** @brief Enumeration of the ways an archive block can be stored. */
+  enum class ArchiveMethod : uint8_t {
+    /** @brief The beacons are stored one after another, uncompressed. */
+    Raw,
+    /** @brief The beacons are stored in compressed columns. */
+    Columnar,
+  };
+
+  /** @brief The header at the start of every archive block. */
+  struct __attribute__((packed)) archive_header {
+    /** @brief How the beacons are stored. */
+    ArchiveMethod method      = ArchiveMethod::Raw;
+    /** @brief The type of every beacon in the block. */
+    uint8_t       type        = 0;
+    /** @brief The number of beacons in the block. */
+    uint8_t       count       = 0;
+    /** @brief The size, in bytes, of every beacon in the block. */
+    uint8_t       record_size = 0;
+  };
+
+  /**
+   * @brief Collects beacons into compressed archive blocks.
+   *
+   * Beacons of the same type and size are buffered, uncompressed, in a slot.
+   * When a slot holds ARCHIVE_BLOCK_RECORDS beacons, they are transposed into
+   * columns and compressed into a single block. RAM use is therefore bounded
+   * by the slots and one output block, however long the archive grows.
+   *
+   * Every beacon is treated as its beacon_header, a run of 32-bit words and
+   * any trailing bytes. The columns are compressed as follows, with the first
+   * value of each column stored in full:
+   * - deci: the delta of deltas, in a prefix code of 1, 9, 12, 16 or 36 bits.
+   *   Beacons sent at a regular interval take 1 to 9 bits.
+   * - Words: XORed with the previous value, storing only the bits that
+   *   changed, as in the Gorilla time series format. Slowly changing floats
+   *   share their sign, exponent and high mantissa bits, so take much less
+   *   than 32 bits, and unchanged values take 1 bit.
+   * - The schema version and trailing bytes: 1 bit if unchanged, otherwise 9
+   *   bits.
+   *
+   * If compression would not save space, the block is stored raw instead.
+   */
+  class ArchiveEncoder {
+  public:
+    bool           add(const uint8_t *record, uint16_t size);
+    bool           flush();
+
+    /** @brief The most recently produced block. */
+    const uint8_t *block() const { return output; }
+    /** @brief The size, in bytes, of the most recently produced block. */
+    uint16_t       block_size() const { return output_size; }
+
+  private:
+    /** @brief Beacons of one type waiting to be archived. */
+    struct slot {
+      /** @brief The type of the beacons in the slot. */
+      uint8_t type;
+      /** @brief The size of each beacon in the slot. */
+      uint8_t record_size;
+      /** @brief The number of beacons in the slot. */
+      uint8_t count = 0;
+      /** @brief The beacons, one after another. */
+      uint8_t records[ARCHIVE_BLOCK_RECORDS * ARCHIVE_MAX_RECORD_SIZE];
+    };
+
+    /** @brief The slots collecting beacons. */
+    slot     slots[ARCHIVE_SLOTS];
+    /** @brief The most recently produced block. */
+    uint8_t  output[ARCHIVE_MAX_BLOCK_SIZE];
+    /** @brief The size of the most recently produced block. */
+    uint16_t output_size = 0;
+
+    void     encode(slot &s);
+  };
+
+  int32_t decode_archive_block(const uint8_t *block, uint16_t size,
+                               archive_header &header, uint8_t *records,
+                               uint32_t capacity);
+} // namespace Storage
+} // namespace Artemis
+
+#endif // _TELEMETRY_ARCHIVE_H
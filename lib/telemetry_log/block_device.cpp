@@ -0,0 +1,123 @@
+/**
+ * @file block_device.cpp
+ * @brief The block device classes.
+ *
+ * This file contains definitions for the SD card and host file block devices.
+ */
+#include <block_device.h>
+#ifndef ARDUINO
+#include <unistd.h>
+#endif
+
+namespace Artemis {
+namespace Storage {
+#ifdef ARDUINO
+  /**
+   * @brief Open a file on the SD card, creating it if it does not exist.
+   *
+   * The SD card must already have been started with SD.begin().
+   *
+   * @param path The path of the file on the SD card.
+   * @return true The file is open for reading and writing.
+   * @return false The file could not be opened.
+   */
+  bool SDBlockDevice::open(const char *path) {
+    file = SD.open(path, FILE_WRITE);
+    return (bool)file;
+  }
+
+  /** @brief Close the file. */
+  void SDBlockDevice::close() { file.close(); }
+
+  bool SDBlockDevice::read(uint32_t offset, uint8_t *dst, size_t size) {
+    if (!file || !file.seek(offset)) {
+      return false;
+    }
+    return file.read(dst, size) == (int)size;
+  }
+
+  bool SDBlockDevice::write(uint32_t offset, const uint8_t *src, size_t size) {
+    if (!file || !file.seek(offset)) {
+      return false;
+    }
+    return file.write(src, size) == size;
+  }
+
+  uint32_t SDBlockDevice::size() { return file ? file.size() : 0; }
+
+  bool     SDBlockDevice::truncate(uint32_t size) {
+    return file && file.truncate(size);
+  }
+
+  bool SDBlockDevice::sync() {
+    if (!file) {
+      return false;
+    }
+    file.flush();
+    return true;
+  }
+#else
+  /** @brief Destroy the FileBlockDevice object, closing its file. */
+  FileBlockDevice::~FileBlockDevice() { close(); }
+
+  /**
+   * @brief Open a file on the host.
+   *
+   * @param path The path of the file.
+   * @param writable Whether the file should be opened for writing, creating
+   * it if it does not exist.
+   * @return true The file has been opened.
+   * @return false The file could not be opened.
+   */
+  bool FileBlockDevice::open(const char *path, bool writable) {
+    close();
+    file = fopen(path, writable ? "r+b" : "rb");
+    if (file == nullptr && writable) {
+      file = fopen(path, "w+b");
+    }
+    return file != nullptr;
+  }
+
+  /** @brief Close the file. */
+  void FileBlockDevice::close() {
+    if (file != nullptr) {
+      fclose(file);
+      file = nullptr;
+    }
+  }
+
+  bool FileBlockDevice::read(uint32_t offset, uint8_t *dst, size_t size) {
+    if (file == nullptr || fseek(file, offset, SEEK_SET) != 0) {
+      return false;
+    }
+    return fread(dst, 1, size, file) == size;
+  }
+
+  bool FileBlockDevice::write(uint32_t offset, const uint8_t *src,
+                              size_t size) {
+    if (file == nullptr || fseek(file, offset, SEEK_SET) != 0) {
+      return false;
+    }
+    return fwrite(src, 1, size, file) == size;
+  }
+
+  uint32_t FileBlockDevice::size() {
+    if (file == nullptr || fseek(file, 0, SEEK_END) != 0) {
+      return 0;
+    }
+    return (uint32_t)ftell(file);
+  }
+
+  bool FileBlockDevice::truncate(uint32_t size) {
+    if (file == nullptr || fflush(file) != 0) {
+      return false;
+    }
+    return ftruncate(fileno(file), size) == 0;
+  }
+
+  bool FileBlockDevice::sync() {
+    return file != nullptr && fflush(file) == 0;
+  }
+#endif
+} // namespace Storage
+} // namespace Artemis
@@ -0,0 +1,121 @@
+/**
+ * @file block_device.h
+ * @brief The header file for the block device classes.
+ *
+ * This file contains declarations for the storage interface used by the
+ * telemetry log, along with an SD card implementation for the flight software
+ * and a file-backed implementation for host builds.
+ */
+#ifndef _BLOCK_DEVICE_H
+#define _BLOCK_DEVICE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#ifdef ARDUINO
+#include <SD.h>
+#else
+#include <stdio.h>
+#endif
+
+/** @brief The size, in bytes, of a sector on the storage media. */
+#define BLOCK_DEVICE_SECTOR_SIZE 512
+
+namespace Artemis {
+/** @brief Persistent storage on the satellite. */
+namespace Storage {
+  /**
+   * @brief A byte-addressable file stored on sector-based media.
+   *
+   * Writes that start and end on a BLOCK_DEVICE_SECTOR_SIZE boundary can be
+   * passed to the media directly. Other writes may require the underlying
+   * driver to read, modify and rewrite a sector.
+   */
+  class BlockDevice {
+  public:
+    virtual ~BlockDevice() {}
+
+    /**
+     * @brief Read bytes from the device.
+     *
+     * @param offset The offset of the first byte to be read.
+     * @param dst A pointer to the buffer that will hold the bytes.
+     * @param size The number of bytes to be read.
+     * @return true All requested bytes were read.
+     * @return false The bytes could not be read.
+     */
+    virtual bool     read(uint32_t offset, uint8_t *dst, size_t size) = 0;
+
+    /**
+     * @brief Write bytes to the device.
+     *
+     * @param offset The offset of the first byte to be written.
+     * @param src A pointer to the bytes to be written.
+     * @param size The number of bytes to be written.
+     * @return true All bytes were written.
+     * @return false The bytes could not be written.
+     */
+    virtual bool     write(uint32_t offset, const uint8_t *src,
+                           size_t size)                             = 0;
+
+    /** @brief The number of bytes currently stored on the device. */
+    virtual uint32_t size()                                         = 0;
+
+    /**
+     * @brief Shorten the device.
+     *
+     * @param size The new size of the device, in bytes.
+     * @return true The device has been shortened.
+     * @return false The device could not be shortened.
+     */
+    virtual bool     truncate(uint32_t size)                        = 0;
+
+    /**
+     * @brief Commit all written bytes to the media.
+     *
+     * @return true All written bytes will survive a power loss.
+     * @return false The bytes could not be committed.
+     */
+    virtual bool     sync()                                         = 0;
+  };
+
+#ifdef ARDUINO
+  /** @brief A block device backed by a file on the SD card. */
+  class SDBlockDevice : public BlockDevice {
+  public:
+    bool     open(const char *path);
+    void     close();
+
+    bool     read(uint32_t offset, uint8_t *dst, size_t size) override;
+    bool     write(uint32_t offset, const uint8_t *src, size_t size) override;
+    uint32_t size() override;
+    bool     truncate(uint32_t size) override;
+    bool     sync() override;
+
+  private:
+    /** @brief The open file on the SD card. */
+    File file;
+  };
+#else
+  /** @brief A block device backed by a file on the host. */
+  class FileBlockDevice : public BlockDevice {
+  public:
+    ~FileBlockDevice();
+
+    bool     open(const char *path, bool writable = true);
+    void     close();
+
+    bool     read(uint32_t offset, uint8_t *dst, size_t size) override;
+    bool     write(uint32_t offset, const uint8_t *src, size_t size) override;
+    uint32_t size() override;
+    bool     truncate(uint32_t size) override;
+    bool     sync() override;
+
+  private:
+    /** @brief The open file on the host. */
+    FILE *file = nullptr;
+  };
+#endif
+} // namespace Storage
+} // namespace Artemis
+
+#endif // _BLOCK_DEVICE_H
@@ -0,0 +1,97 @@
+/**
+ * @file log_query.cpp
+ * @brief The LogQuery class.
+ *
+ * This file contains definitions for the LogQuery class.
+ */
+#include <log_query.h>
+
+namespace Artemis {
+namespace Storage {
+  /**
+   * @brief Construct a new LogQuery object.
+   *
+   * @param telemetry_log The log to be queried.
+   */
+  LogQuery::LogQuery(TelemetryLog *telemetry_log)
+      : log(telemetry_log), reader(telemetry_log) {}
+
+  /**
+   * @brief Start a page of a query.
+   *
+   * @param query The query to be run.
+   */
+  void LogQuery::begin(const log_query &query) {
+    current = query;
+    if (current.decimation == 0) {
+      current.decimation = 1;
+    }
+    phase = current.resume_phase % current.decimation;
+    reader.seek(current.resume_offset != 0 ? current.resume_offset
+                                           : log->find(current.start));
+    result.count = 0;
+    running      = true;
+  }
+
+  /**
+   * @brief Get the next record matching the query.
+   *
+   * @param header The header that will carry the record's header.
+   * @param payload A pointer that will point to the record's payload. It is
+   * valid until the next call to fill().
+   * @return int32_t 1 if a record has been returned, 0 if more bytes must be
+   * read ahead with fill(), or -1 if the page has finished and page() holds
+   * the reply.
+   */
+  int32_t LogQuery::next(TelemetryLog::record_header &header,
+                         const uint8_t              *&payload) {
+    if (!running) {
+      return -1;
+    }
+    while (true) {
+      if (result.count >= current.page_size) {
+        finish(LogPageStatus::More);
+        return -1;
+      }
+      const int32_t status = reader.next(header, payload);
+      if (status == 0) {
+        return 0;
+      }
+      if (status < 0) {
+        finish(status == -1 ? LogPageStatus::Done : LogPageStatus::Corrupted);
+        return -1;
+      }
+      if (header.timestamp < current.start) {
+        continue;
+      }
+      if (header.timestamp > current.end) {
+        finish(LogPageStatus::Done);
+        return -1;
+      }
+      const uint8_t type = header.type & ~TELEMETRY_LOG_TYPE_ARCHIVED;
+      if (current.type_mask != 0 &&
+          (type >= 32 || !(current.type_mask & (1UL << type)))) {
+        continue;
+      }
+      const bool selected = phase == 0;
+      phase               = (phase + 1) % current.decimation;
+      if (selected) {
+        result.count++;
+        return 1;
+      }
+    }
+  }
+
+  /**
+   * @brief Finish the current page and record the token for the next one.
+   *
+   * @param status How the page ended.
+   */
+  void LogQuery::finish(LogPageStatus status) {
+    running              = false;
+    result.status        = status;
+    result.resume_offset = reader.tell();
+    result.resume_phase  = phase;
+  }
+} // namespace Storage
+} // namespace Artemis
@@ -0,0 +1,115 @@
+/**
+ * @file log_query.h
+ * @brief The header file for the LogQuery class.
+ *
+ * This file contains declarations for telemetry log queries, used by the
+ * flight software to stream stored records to the ground and by the ground
+ * tools to run the same queries against a copy of the log.
+ */
+#ifndef _LOG_QUERY_H
+#define _LOG_QUERY_H
+
+#include "telemetry_log.h"
+
+namespace Artemis {
+namespace Storage {
+  /** @brief The command asking for a window of the telemetry log. */
+  struct __attribute__((packed)) log_query {
+    /** @brief The earliest record time, in seconds of log time. */
+    uint32_t start         = 0;
+    /** @brief The latest record time, in seconds of log time. */
+    uint32_t end           = UINT32_MAX;
+    /**
+     * @brief A bit per record type to be returned, or 0 for all types.
+     *
+     * Archive blocks are matched by the type of the beacons they hold.
+     */
+    uint32_t type_mask     = 0;
+    /** @brief Return one of every this many matching records. */
+    uint16_t decimation    = 1;
+    /** @brief The maximum number of records returned in this page. */
+    uint16_t page_size     = 32;
+    /** @brief Where to resume, from a previous page, or 0 to start at start. */
+    uint32_t resume_offset = 0;
+    /** @brief The decimation phase to resume with, from a previous page. */
+    uint16_t resume_phase  = 0;
+  };
+  /**<  A diagram of the struct is included below.
+   *
+   * @verbatim
+4 bytes 4 bytes 4 bytes     2 bytes      2 bytes     4 bytes         2 bytes
++-------+-----+-----------+------------+-----------+---------------+--------------+
+| start | end | type_mask | decimation | page_size | resume_offset | resume_phase |
++-------+-----+-----------+------------+-----------+---------------+--------------+
+     @endverbatim
+   */
+
+  /** @brief Enumeration of the ways a page of results can end. */
+  enum class LogPageStatus : uint8_t {
+    /** @brief The page is full, and more records may match the query. */
+    More,
+    /** @brief There are no more matching records. */
+    Done,
+    /** @brief A corrupted record was found, and the query stopped there. */
+    Corrupted,
+  };
+
+  /** @brief The reply sent after the records of a page. */
+  struct __attribute__((packed)) log_page {
+    /** @brief How the page ended. */
+    LogPageStatus status        = LogPageStatus::Done;
+    /** @brief The number of records sent in the page. */
+    uint16_t      count         = 0;
+    /** @brief The resume_offset of the query for the next page. */
+    uint32_t      resume_offset = 0;
+    /** @brief The resume_phase of the query for the next page. */
+    uint16_t      resume_phase  = 0;
+  };
+
+  /**
+   * @brief A query running over the telemetry log.
+   *
+   * Each page starts at the query's resume token, or at the time index entry
+   * before the start time, and ends when page_size records have been
+   * returned, the end time has been passed or the log runs out. The log_page
+   * reported at the end carries the token for the next page.
+   */
+  class LogQuery {
+  public:
+    LogQuery(TelemetryLog *telemetry_log);
+
+    void     begin(const log_query &query);
+    int32_t  next(TelemetryLog::record_header &header, const uint8_t *&payload);
+
+    /**
+     * @brief Read ahead from the log.
+     *
+     * @return true Bytes have been read ahead.
+     * @return false Nothing more could be read ahead.
+     */
+    bool     fill() { return reader.fill(); }
+    /** @brief Whether the current page is still running. */
+    bool     active() const { return running; }
+    /** @brief The reply for the finished page. */
+    log_page page() const { return result; }
+
+  private:
+    /** @brief The log being queried. */
+    TelemetryLog        *log;
+    /** @brief The reader positioned at the next record. */
+    TelemetryLog::Reader reader;
+    /** @brief The query being run. */
+    log_query            current;
+    /** @brief The decimation phase of the next matching record. */
+    uint16_t             phase   = 0;
+    /** @brief Whether the current page is still running. */
+    bool                 running = false;
+    /** @brief The reply for the current page. */
+    log_page             result;
+
+    void                 finish(LogPageStatus status);
+  };
+} // namespace Storage
+} // namespace Artemis
+
+#endif // _LOG_QUERY_H
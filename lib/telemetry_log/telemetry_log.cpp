@@ -0,0 +1,437 @@
+/**
+ * @file telemetry_log.cpp
+ * @brief The TelemetryLog class.
+ *
+ * This file contains definitions for the TelemetryLog class.
+ */
+#include <checksum.h>
+#include <string.h>
+#include <telemetry_log.h>
+
+namespace Artemis {
+namespace Storage {
+  /**
+   * @brief Construct a new TelemetryLog object.
+   *
+   * @param data_device The device that will hold the records.
+   * @param index_device The device that will hold the sparse time index.
+   */
+  TelemetryLog::TelemetryLog(BlockDevice *data_device,
+                             BlockDevice *index_device)
+      : data(data_device), index(index_device) {}
+
+  /**
+   * @brief Open the log, recovering from a partially written tail.
+   *
+   * The records after the last index entry are checked. The log is cut at
+   * the first record that is incomplete or fails its CRC, along with any
+   * index entries pointing past the cut. If the indexed record itself is
+   * damaged, the previous index entry is used instead.
+   *
+   * @param repair Whether the damaged tail should be removed from the devices.
+   * If false, the devices are only read, and the damaged tail is ignored.
+   * @return true The log is open and ready for appending.
+   * @return false The devices could not be read or repaired.
+   */
+  bool TelemetryLog::open(bool repair) {
+    opened          = false;
+    buffered        = 0;
+    index_buffered  = 0;
+    dropped_records = 0;
+
+    data_size       = data->size();
+    uint32_t index_bytes = index->size();
+    index_count          = index_bytes / sizeof(index_entry);
+
+    // Discard index entries that point past the end of the data.
+    index_entry entry;
+    while (index_count > 0) {
+      if (!read_index(index_count - 1, entry)) {
+        return false;
+      }
+      if (entry.offset < data_size) {
+        break;
+      }
+      index_count--;
+    }
+
+    // Walk the records after the last index entry to find the end of the log.
+    uint32_t      offset = 0;
+    record_header header;
+    while (true) {
+      uint32_t start   = 0;
+      newest_timestamp = 0;
+      if (index_count > 0) {
+        if (!read_index(index_count - 1, entry)) {
+          return false;
+        }
+        start            = entry.offset;
+        newest_timestamp = entry.timestamp;
+      }
+      offset = start;
+      while (offset < data_size && check_record(offset, header)) {
+        newest_timestamp = header.timestamp;
+        offset += record_size(header.length);
+      }
+      if (offset > start || index_count == 0) {
+        break;
+      }
+      // The indexed record itself is damaged, so fall back to the one before.
+      index_count--;
+    }
+
+    if (offset < data_size) {
+      data_size = offset;
+      if (repair && !data->truncate(data_size)) {
+        return false;
+      }
+    }
+    if (repair && index_count * sizeof(index_entry) != index_bytes &&
+        !index->truncate(index_count * sizeof(index_entry))) {
+      return false;
+    }
+
+    next_index = 0;
+    if (index_count > 0) {
+      next_index = entry.offset - entry.offset % TELEMETRY_LOG_INDEX_STRIDE +
+                   TELEMETRY_LOG_INDEX_STRIDE;
+    }
+    opened = true;
+    return true;
+  }
+
+  /**
+   * @brief Append a record to the log.
+   *
+   * The record is only copied into the RAM buffer, so this is cheap enough to
+   * call from any channel. It reaches the data device on a later flush().
+   *
+   * Timestamps must never decrease, so a timestamp older than the newest
+   * record is replaced by the newest record's timestamp.
+   *
+   * @param timestamp The time, in seconds of log time, of the record.
+   * @param type The type of the record.
+   * @param payload A pointer to the bytes of the record.
+   * @param length The number of bytes in the record.
+   * @return true The record has been added to the buffer.
+   * @return false The log is not open, the record is too large, or the buffer
+   * is full and the record was dropped.
+   */
+  bool TelemetryLog::append(uint32_t timestamp, uint8_t type,
+                            const uint8_t *payload, uint16_t length) {
+    if (!opened || length > TELEMETRY_LOG_MAX_PAYLOAD) {
+      return false;
+    }
+    const uint32_t size = record_size(length);
+    if (buffered + size > sizeof(buffer)) {
+      dropped_records++;
+      return false;
+    }
+    if (timestamp < newest_timestamp) {
+      timestamp = newest_timestamp;
+    }
+
+    const uint32_t offset = data_size + buffered;
+    if (offset >= next_index && index_buffered < TELEMETRY_LOG_INDEX_BUFFER) {
+      index_buffer[index_buffered].timestamp = timestamp;
+      index_buffer[index_buffered].offset    = offset;
+      index_buffered++;
+      next_index = offset - offset % TELEMETRY_LOG_INDEX_STRIDE +
+                   TELEMETRY_LOG_INDEX_STRIDE;
+    }
+
+    record_header header;
+    header.length    = length;
+    header.timestamp = timestamp;
+    header.type      = type;
+
+    uint8_t *dst     = &buffer[buffered];
+    memcpy(dst, &header, sizeof(header));
+    memcpy(dst + sizeof(header), payload, length);
+    const uint32_t crc = Helpers::crc32(dst, sizeof(header) + length);
+    memcpy(dst + sizeof(header) + length, &crc, sizeof(crc));
+
+    buffered += size;
+    newest_timestamp = timestamp;
+    return true;
+  }
+
+  /**
+   * @brief Write buffered records and index entries to the devices.
+   *
+   * Normally only whole sectors are written, so every write to the data device
+   * ends on a sector boundary and the partial sector at the end of the buffer
+   * stays in RAM. Index entries are written once the record they point to has
+   * reached the data device.
+   *
+   * @param force Whether the partial sector should also be written. This
+   * bounds the amount of telemetry lost on a reset, at the cost of rewriting
+   * that sector on the next flush.
+   * @return true The records have been written and committed.
+   * @return false The log is not open or a device failed. The records remain
+   * buffered and will be retried on the next flush.
+   */
+  bool TelemetryLog::flush(bool force) {
+    if (!opened) {
+      return false;
+    }
+
+    uint32_t count = buffered;
+    if (!force) {
+      uint32_t end = data_size + buffered;
+      end -= end % BLOCK_DEVICE_SECTOR_SIZE;
+      count = end > data_size ? end - data_size : 0;
+    }
+    if (count > 0) {
+      if (!data->write(data_size, buffer, count) || !data->sync()) {
+        return false;
+      }
+      data_size += count;
+      buffered -= count;
+      memmove(buffer, &buffer[count], buffered);
+    }
+
+    uint32_t entries = 0;
+    while (entries < index_buffered &&
+           index_buffer[entries].offset < data_size) {
+      entries++;
+    }
+    if (entries > 0) {
+      if (!index->write(index_count * sizeof(index_entry),
+                        (const uint8_t *)index_buffer,
+                        entries * sizeof(index_entry)) ||
+          !index->sync()) {
+        return false;
+      }
+      index_count += entries;
+      index_buffered -= entries;
+      memmove(index_buffer, &index_buffer[entries],
+              index_buffered * sizeof(index_entry));
+    }
+    return true;
+  }
+
+  /**
+   * @brief Find where to start reading for records at or after a time.
+   *
+   * The index is binary searched for the last entry older than the timestamp.
+   * Every record before that entry is also older, so reading can start there.
+   * At most one index stride of older records has to be skipped by the caller.
+   *
+   * @param timestamp The earliest time of interest.
+   * @return uint32_t The offset from which to start reading.
+   */
+  uint32_t TelemetryLog::find(uint32_t timestamp) {
+    uint32_t    low  = 0;
+    uint32_t    high = total_index_count();
+    index_entry entry;
+    while (low < high) {
+      const uint32_t middle = low + (high - low) / 2;
+      if (!read_index(middle, entry)) {
+        return 0;
+      }
+      if (entry.timestamp < timestamp) {
+        low = middle + 1;
+      } else {
+        high = middle;
+      }
+    }
+    if (low == 0 || !read_index(low - 1, entry)) {
+      return 0;
+    }
+    return entry.offset;
+  }
+
+  /**
+   * @brief Read a record from the data device.
+   *
+   * Only records that have been flushed can be read.
+   *
+   * @param offset The offset of the record. On success, it is advanced to the
+   * offset of the next record.
+   * @param header The header that will carry the record's header.
+   * @param payload The buffer that will carry the record's payload.
+   * @param max_length The size of the payload buffer. Longer payloads are
+   * truncated.
+   * @return int32_t The number of payload bytes copied, or -1 if there is no
+   * valid record at the offset.
+   */
+  int32_t TelemetryLog::read(uint32_t &offset, record_header &header,
+                             uint8_t *payload, uint16_t max_length) {
+    if (!check_record(offset, header)) {
+      return -1;
+    }
+    const uint16_t length =
+        header.length < max_length ? header.length : max_length;
+    if (length > 0 &&
+        !data->read(offset + sizeof(record_header), payload, length)) {
+      return -1;
+    }
+    offset += record_size(header.length);
+    return length;
+  }
+
+  /**
+   * @brief Check that a complete, uncorrupted record is stored at an offset.
+   *
+   * @param offset The offset of the record in the data device.
+   * @param header The header that will carry the record's header.
+   * @return true The record is complete and its CRC matches.
+   * @return false The record is incomplete, corrupted or unreadable.
+   */
+  bool TelemetryLog::check_record(uint32_t offset, record_header &header) {
+    if (offset >= data_size ||
+        data_size - offset < record_size(0) ||
+        !data->read(offset, (uint8_t *)&header, sizeof(header)) ||
+        header.magic != TELEMETRY_LOG_MAGIC ||
+        header.length > TELEMETRY_LOG_MAX_PAYLOAD ||
+        data_size - offset < record_size(header.length)) {
+      return false;
+    }
+
+    uint32_t crc      = Helpers::crc32((const uint8_t *)&header, sizeof(header));
+    uint32_t position = offset + sizeof(header);
+    uint32_t remaining = header.length;
+    uint8_t  chunk[64];
+    while (remaining > 0) {
+      const uint32_t count =
+          remaining < sizeof(chunk) ? remaining : sizeof(chunk);
+      if (!data->read(position, chunk, count)) {
+        return false;
+      }
+      crc = Helpers::crc32(chunk, count, crc);
+      position += count;
+      remaining -= count;
+    }
+
+    uint32_t stored_crc;
+    if (!data->read(position, (uint8_t *)&stored_crc, sizeof(stored_crc))) {
+      return false;
+    }
+    return stored_crc == crc;
+  }
+
+  /**
+   * @brief Read an entry of the time index.
+   *
+   * @param position The position of the entry, counting both the entries on
+   * the index device and those still buffered.
+   * @param entry The entry that will carry the result.
+   * @return true The entry has been read.
+   * @return false The entry could not be read.
+   */
+  bool TelemetryLog::read_index(uint32_t position, index_entry &entry) {
+    if (position >= index_count) {
+      if (position - index_count >= index_buffered) {
+        return false;
+      }
+      entry = index_buffer[position - index_count];
+      return true;
+    }
+    return index->read(position * sizeof(index_entry), (uint8_t *)&entry,
+                       sizeof(entry));
+  }
+
+  /** @brief The number of index entries, both stored and buffered. */
+  uint32_t TelemetryLog::total_index_count() const {
+    return index_count + index_buffered;
+  }
+
+  /**
+   * @brief Construct a new Reader object, positioned at the start of the log.
+   *
+   * @param telemetry_log The log to be read.
+   */
+  TelemetryLog::Reader::Reader(TelemetryLog *telemetry_log)
+      : log(telemetry_log) {}
+
+  /**
+   * @brief Move the reader to a record, discarding anything read ahead.
+   *
+   * @param offset The offset of the record, such as one returned by find() or
+   * tell().
+   */
+  void TelemetryLog::Reader::seek(uint32_t offset) {
+    start    = 0;
+    end      = 0;
+    position = offset;
+  }
+
+  /**
+   * @brief Read ahead from the data device into free space in the buffer.
+   *
+   * The first read after a seek ends on a sector boundary, and every read
+   * after that covers whole sectors.
+   *
+   * @return true Bytes have been read into the buffer.
+   * @return false The buffer is full, the end of the log has been reached, or
+   * the device could not be read.
+   */
+  bool TelemetryLog::Reader::fill() {
+    if (start > 0) {
+      memmove(buffer, &buffer[start], end - start);
+      end -= start;
+      start = 0;
+    }
+
+    const uint32_t space = sizeof(buffer) - end;
+    uint32_t       count =
+        BLOCK_DEVICE_SECTOR_SIZE - position % BLOCK_DEVICE_SECTOR_SIZE;
+    while (count + BLOCK_DEVICE_SECTOR_SIZE <= space) {
+      count += BLOCK_DEVICE_SECTOR_SIZE;
+    }
+    if (count > space) {
+      count = space;
+    }
+    if (position >= log->data_size) {
+      return false;
+    }
+    if (count > log->data_size - position) {
+      count = log->data_size - position;
+    }
+    if (count == 0 || !log->data->read(position, &buffer[end], count)) {
+      return false;
+    }
+    end += count;
+    position += count;
+    return true;
+  }
+
+  /**
+   * @brief Take the next record from the read-ahead buffer.
+   *
+   * @param header The header that will carry the record's header.
+   * @param payload A pointer that will point to the record's payload. It is
+   * valid until the next call to fill() or seek().
+   * @return int32_t 1 if a record has been returned, 0 if more bytes must be
+   * read ahead with fill(), -1 at the end of the log, or -2 if the record is
+   * corrupted.
+   */
+  int32_t TelemetryLog::Reader::next(record_header  &header,
+                                     const uint8_t *&payload) {
+    const uint32_t available = end - start;
+    const bool     more      = position < log->data_size;
+    if (available < sizeof(record_header)) {
+      return more ? 0 : (available == 0 ? -1 : -2);
+    }
+    memcpy(&header, &buffer[start], sizeof(header));
+    if (header.magic != TELEMETRY_LOG_MAGIC ||
+        header.length > TELEMETRY_LOG_MAX_PAYLOAD) {
+      return -2;
+    }
+    const uint32_t size = record_size(header.length);
+    if (available < size) {
+      return more ? 0 : -2;
+    }
+
+    uint32_t crc;
+    memcpy(&crc, &buffer[start + size - sizeof(crc)], sizeof(crc));
+    if (crc != Helpers::crc32(&buffer[start], size - sizeof(crc))) {
+      return -2;
+    }
+    payload = &buffer[start + sizeof(record_header)];
+    start += size;
+    return 1;
+  }
+} // namespace Storage
+} // namespace Artemis
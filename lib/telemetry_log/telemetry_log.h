@@ -0,0 +1,182 @@
+/**
+ * @file telemetry_log.h
+ * @brief The header file for the TelemetryLog class.
+ *
+ * This file contains declarations for the TelemetryLog class, an append-only
+ * log of telemetry records with a sparse time index.
+ */
+#ifndef _TELEMETRY_LOG_H
+#define _TELEMETRY_LOG_H
+
+#include "block_device.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/** @brief The number of sectors of records buffered in RAM. */
+#define TELEMETRY_LOG_BUFFER_SECTORS 4
+/** @brief The number of time index entries buffered in RAM. */
+#define TELEMETRY_LOG_INDEX_BUFFER   64
+/** @brief The spacing, in bytes of log data, between time index entries. */
+#define TELEMETRY_LOG_INDEX_STRIDE   4096
+/** @brief The largest payload, in bytes, that a record can carry. */
+#define TELEMETRY_LOG_MAX_PAYLOAD    1024
+/** @brief The marker at the start of every record. */
+#define TELEMETRY_LOG_MAGIC          0xA55A
+/** @brief The number of sectors read ahead by a TelemetryLog::Reader. */
+#define TELEMETRY_LOG_READ_SECTORS   4
+/**
+ * @brief The flag set in the type of a record holding an archive block.
+ *
+ * The remaining bits of the type are the BeaconType of the archived beacons.
+ */
+#define TELEMETRY_LOG_TYPE_ARCHIVED  0x80
+
+namespace Artemis {
+namespace Storage {
+  /**
+   * @brief An append-only log of telemetry records.
+   *
+   * Records are appended to a RAM buffer and written to the data device in
+   * whole sectors by flush(). Each record is protected by a CRC-32, so a torn
+   * write at the end of the log is detected and removed by open().
+   *
+   * Every TELEMETRY_LOG_INDEX_STRIDE bytes, the timestamp and offset of a
+   * record are added to a sparse index stored on a second device. Because
+   * timestamps never decrease, find() can binary search the index and only
+   * has to scan at most one stride of records.
+   *
+   * The log does not lock itself. Callers sharing a log between threads must
+   * hold a mutex around every call.
+   */
+  class TelemetryLog {
+  public:
+    /** @brief The header at the start of every record. */
+    struct __attribute__((packed)) record_header {
+      /** @brief The record marker, TELEMETRY_LOG_MAGIC. */
+      uint16_t magic     = TELEMETRY_LOG_MAGIC;
+      /** @brief The number of bytes in the payload. */
+      uint16_t length    = 0;
+      /** @brief The time, in seconds of log time, of the record. */
+      uint32_t timestamp = 0;
+      /** @brief The type of the record, usually a BeaconType. */
+      uint8_t  type      = 0;
+    };
+    /**<  A diagram of a complete record is included below.
+     *
+     * @verbatim
+2 bytes  2 bytes  4 bytes     1 byte  length bytes  4 bytes
++--------+--------+-----------+-------+-------------+-------+
+| magic  | length | timestamp | type  |   payload   | crc32 |
++--------+--------+-----------+-------+-------------+-------+
+       @endverbatim
+     *
+     * The CRC-32 covers the header and the payload.
+     */
+
+    /** @brief An entry in the sparse time index. */
+    struct __attribute__((packed)) index_entry {
+      /** @brief The timestamp of the indexed record. */
+      uint32_t timestamp;
+      /** @brief The offset of the indexed record in the data device. */
+      uint32_t offset;
+    };
+
+    /**
+     * @brief A sequential reader of records with read-ahead.
+     *
+     * The reader keeps a buffer of upcoming records, filled by fill() in
+     * sector-aligned reads, and parses records directly out of it. This lets
+     * the caller top up the buffer while it is otherwise waiting, such as
+     * while the radio is busy, instead of reading from the device for every
+     * record.
+     */
+    class Reader {
+    public:
+      Reader(TelemetryLog *telemetry_log);
+
+      void     seek(uint32_t offset);
+      bool     fill();
+      int32_t  next(record_header &header, const uint8_t *&payload);
+
+      /** @brief The offset of the next record to be returned by next(). */
+      uint32_t tell() const { return position - (end - start); }
+
+    private:
+      /** @brief The log being read. */
+      TelemetryLog *log;
+      /** @brief Bytes read ahead from the data device. */
+      uint8_t       buffer[TELEMETRY_LOG_READ_SECTORS * BLOCK_DEVICE_SECTOR_SIZE];
+      /** @brief The position in buffer of the next record. */
+      uint32_t      start    = 0;
+      /** @brief The position in buffer after the last byte read ahead. */
+      uint32_t      end      = 0;
+      /** @brief The offset in the data device of the next byte to read. */
+      uint32_t      position = 0;
+    };
+
+    TelemetryLog(BlockDevice *data_device, BlockDevice *index_device);
+
+    bool     open(bool repair = true);
+    bool     append(uint32_t timestamp, uint8_t type, const uint8_t *payload,
+                    uint16_t length);
+    bool     flush(bool force = false);
+    uint32_t find(uint32_t timestamp);
+    int32_t  read(uint32_t &offset, record_header &header, uint8_t *payload,
+                  uint16_t max_length);
+
+    /** @brief Whether the log has been opened successfully. */
+    bool     is_open() const { return opened; }
+    /** @brief The timestamp of the newest record in the log. */
+    uint32_t last_timestamp() const { return newest_timestamp; }
+    /** @brief The number of bytes of records written to the data device. */
+    uint32_t stored_size() const { return data_size; }
+    /** @brief The number of bytes of records waiting in the RAM buffer. */
+    uint32_t buffered_size() const { return buffered; }
+    /** @brief The number of records dropped because the buffer was full. */
+    uint32_t dropped() const { return dropped_records; }
+
+    /**
+     * @brief The total size, in bytes, of a record.
+     *
+     * @param length The number of bytes in the record's payload.
+     */
+    static constexpr uint32_t record_size(uint16_t length) {
+      return sizeof(record_header) + length + sizeof(uint32_t);
+    }
+
+  private:
+    /** @brief The device holding the records. */
+    BlockDevice *data;
+    /** @brief The device holding the sparse time index. */
+    BlockDevice *index;
+
+    /** @brief Records waiting to be written to the data device. */
+    uint8_t      buffer[TELEMETRY_LOG_BUFFER_SECTORS * BLOCK_DEVICE_SECTOR_SIZE];
+    /** @brief The number of bytes used in buffer. */
+    uint32_t     buffered = 0;
+    /** @brief Index entries waiting to be written to the index device. */
+    index_entry  index_buffer[TELEMETRY_LOG_INDEX_BUFFER];
+    /** @brief The number of entries used in index_buffer. */
+    uint32_t     index_buffered   = 0;
+
+    /** @brief The number of bytes of records on the data device. */
+    uint32_t     data_size        = 0;
+    /** @brief The number of entries on the index device. */
+    uint32_t     index_count      = 0;
+    /** @brief The offset at or after which the next index entry is due. */
+    uint32_t     next_index       = 0;
+    /** @brief The timestamp of the newest record. */
+    uint32_t     newest_timestamp = 0;
+    /** @brief The number of records dropped because the buffer was full. */
+    uint32_t     dropped_records  = 0;
+    /** @brief Whether the log has been opened successfully. */
+    bool         opened           = false;
+
+    bool         check_record(uint32_t offset, record_header &header);
+    bool         read_index(uint32_t position, index_entry &entry);
+    uint32_t     total_index_count() const;
+  };
+} // namespace Storage
+} // namespace Artemis
+
+#endif // _TELEMETRY_LOG_H
@@ -0,0 +1,139 @@
+/**
+ * @file telemetry_points.cpp
+ * @brief The telemetry point store.
+ *
+ * This file contains definitions of the functions that publish and read
+ * telemetry points.
+ */
+#include <atomic>
+#include <math.h>
+#include <string.h>
+#include <telemetry_points.h>
+
+namespace Artemis {
+namespace Telemetry {
+  namespace {
+    /**
+     * @brief The latest value of a telemetry point.
+     *
+     * The value is guarded by a sequence lock. The sequence is odd while the
+     * value is being written, and a reader that sees it change retries, so
+     * neither the writer nor a reader ever blocks on a mutex. A sequence of 0
+     * means the point has never been published.
+     */
+    struct point_slot {
+      std::atomic<uint32_t> sequence;
+      /** @brief The bits of the float value. */
+      std::atomic<uint32_t> value;
+      std::atomic<uint32_t> timestamp;
+    };
+
+    point_slot points[POINT_COUNT];
+
+    /** @brief Lets another thread run while a thread waits. */
+    void (*yield_thread)(void) = nullptr;
+
+  } // namespace
+
+  /**
+   * @brief Find the device that publishes a telemetry point.
+   *
+   * @param point The point, which must be below POINT_COUNT.
+   * @return Source The device that publishes the point.
+   */
+  Source point_source(uint16_t point) {
+    // The points are in order, so the first run that ends at or after the
+    // point holds it.
+#define TELEMETRY_POINT_SOURCE(name, count, unit, source)                      \
+  if (point <= name##_last) {                                                  \
+    return Source::source;                                                     \
+  }
+    TELEMETRY_POINTS(TELEMETRY_POINT_SOURCE)
+#undef TELEMETRY_POINT_SOURCE
+    return Source::GPS;
+  }
+
+  /**
+   * @brief Set how a thread reading a point being published lets the
+   * publishing thread run.
+   *
+   * Until this is called, read() retries without yielding.
+   *
+   * @param yield Lets another thread run.
+   */
+  void set_scheduler(void (*yield)(void)) { yield_thread = yield; }
+
+  /**
+   * @brief Publish a new value of a telemetry point.
+   *
+   * Each point must only be published by one thread, normally the driver of
+   * the sensor it comes from. Publishing never blocks.
+   *
+   * @param point The point.
+   * @param value The value, in the unit of the point.
+   * @param timestamp The uptime, in milliseconds, when the value was read.
+   */
+  void publish(uint16_t point, float value, uint32_t timestamp) {
+    if (point >= POINT_COUNT) {
+      return;
+    }
+    point_slot    &slot = points[point];
+    uint32_t       bits;
+    const uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+    memcpy(&bits, &value, sizeof(bits));
+
+    slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.value.store(bits, std::memory_order_relaxed);
+    slot.timestamp.store(timestamp, std::memory_order_relaxed);
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+  }
+
+  /**
+   * @brief Read the latest value of a telemetry point.
+   *
+   * If the point is being published, the read is retried until the value is
+   * whole, letting the publishing thread finish first.
+   *
+   * @param point The point.
+   * @param reading The latest value and when it was read.
+   * @return true The point has a value.
+   * @return false The point has never been published, or does not exist.
+   */
+  bool read(uint16_t point, point_value &reading) {
+    if (point >= POINT_COUNT) {
+      return false;
+    }
+    const point_slot &slot = points[point];
+    uint32_t          before;
+    uint32_t          bits;
+    for (;;) {
+      before = slot.sequence.load(std::memory_order_acquire);
+      if ((before & 1) == 0) {
+        bits              = slot.value.load(std::memory_order_relaxed);
+        reading.timestamp = slot.timestamp.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) == before) {
+          break;
+        }
+      }
+      if (yield_thread != nullptr) {
+        yield_thread();
+      }
+    }
+    memcpy(&reading.value, &bits, sizeof(bits));
+    return before != 0;
+  }
+
+  /**
+   * @brief Read the latest value of a telemetry point.
+   *
+   * @param point The point.
+   * @return float The value, or NaN if the point has never been published.
+   */
+  float value(uint16_t point) {
+    point_value reading;
+    return read(point, reading) ? reading.value : NAN;
+  }
+} // namespace Telemetry
+} // namespace Artemis
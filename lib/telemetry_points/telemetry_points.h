@@ -0,0 +1,83 @@
+/**
+ * @file telemetry_points.h
+ * @brief The header file for the telemetry point store.
+ *
+ * This file contains declarations of the telemetry point store, which holds
+ * the latest reading of every sensor on the satellite. Sensor drivers publish
+ * each value as they read it, and any other thread can then read it without
+ * touching the bus the sensor is on.
+ */
+#ifndef _TELEMETRY_POINTS_H
+#define _TELEMETRY_POINTS_H
+
+#include <beacon_schema.h>
+#include <stdint.h>
+
+/**
+ * @brief The telemetry points of the satellite.
+ *
+ * Each entry is POINT(name, count, unit, source). A point with a count
+ * greater than one is a run of points, one for each sensor of that kind, in
+ * the same order as the arrays of the beacons. source is the Source that
+ * publishes the point.
+ */
+#define TELEMETRY_POINTS(POINT)                                                \
+  POINT(tmp36_tempC, ARTEMIS_TEMP_SENSOR_COUNT, "degC", TemperatureSensors)    \
+  POINT(teensy_tempC, 1, "degC", TemperatureSensors)                           \
+  POINT(busvoltage, ARTEMIS_CURRENT_SENSOR_COUNT, "V", CurrentSensors)         \
+  POINT(current, ARTEMIS_CURRENT_SENSOR_COUNT, "mA", CurrentSensors)           \
+  POINT(accel, 3, "m/s^2", IMU)                                                \
+  POINT(gyro, 3, "rad/s", IMU)                                                 \
+  POINT(imutemp, 1, "degC", IMU)                                               \
+  POINT(mag, 3, "uT", Magnetometer)                                            \
+  POINT(latitude, 1, "ddmm.mmmm", GPS)                                         \
+  POINT(longitude, 1, "dddmm.mmmm", GPS)                                       \
+  POINT(speed, 1, "knots", GPS)                                                \
+  POINT(angle, 1, "deg", GPS)                                                  \
+  POINT(altitude, 1, "m", GPS)                                                 \
+  POINT(satellites, 1, "", GPS)
+
+namespace Artemis {
+/** @brief The latest telemetry of the satellite. */
+namespace Telemetry {
+  /**
+   * @brief The index of each telemetry point.
+   *
+   * A run of points is addressed from its first point, such as
+   * `Point::busvoltage + i`.
+   */
+  enum Point : uint16_t {
+#define TELEMETRY_POINT_ID(name, count, unit, source)                          \
+  name, name##_last = name + count - 1,
+    TELEMETRY_POINTS(TELEMETRY_POINT_ID)
+#undef TELEMETRY_POINT_ID
+    /** @brief The number of telemetry points. */
+    POINT_COUNT
+  };
+
+  /** @brief Enumeration of the devices that publish telemetry points. */
+  enum class Source : uint8_t {
+    TemperatureSensors,
+    CurrentSensors,
+    IMU,
+    Magnetometer,
+    GPS,
+  };
+
+  /** @brief A reading of a telemetry point. */
+  struct point_value {
+    /** @brief The value, in the unit of the point. */
+    float    value;
+    /** @brief The uptime, in milliseconds, when the value was read. */
+    uint32_t timestamp;
+  };
+
+  Source point_source(uint16_t point);
+  void   set_scheduler(void (*yield)(void));
+  void   publish(uint16_t point, float value, uint32_t timestamp);
+  bool   read(uint16_t point, point_value &reading);
+  float  value(uint16_t point);
+} // namespace Telemetry
+} // namespace Artemis
+
+#endif // _TELEMETRY_POINTS_H
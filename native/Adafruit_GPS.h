@@ -0,0 +1,39 @@
+/**
+ * @file Adafruit_GPS.h
+ * @brief A stand-in for the Adafruit GPS driver, for the native build.
+ */
+#ifndef _NATIVE_ADAFRUIT_GPS_H
+#define _NATIVE_ADAFRUIT_GPS_H
+
+#include <Arduino.h>
+
+#define PMTK_SET_NMEA_OUTPUT_RMCGGA                                            \
+  "$PMTK314,0,1,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0*28"
+#define PMTK_SET_NMEA_UPDATE_1HZ "$PMTK220,1000*1F"
+
+/** @brief The GPS, which never gets a fix. */
+class Adafruit_GPS {
+public:
+  Adafruit_GPS(HardwareSerial *ser) {}
+  bool    begin(uint32_t baud_or_i2caddr) { return true; }
+  void    sendCommand(const char *str) {}
+  size_t  available() { return 0; }
+  char    read() { return 0; }
+  bool    newNMEAreceived() { return false; }
+  char   *lastNMEA() { return nmea; }
+  bool    parse(char *nmea) { return false; }
+
+  bool    fix        = false;
+  float   latitude   = 0;
+  float   longitude  = 0;
+  float   speed      = 0;
+  float   angle      = 0;
+  float   altitude   = 0;
+  uint8_t satellites = 0;
+
+private:
+  /** @brief The last sentence received, which is always empty. */
+  char nmea[1] = {};
+};
+
+#endif // _NATIVE_ADAFRUIT_GPS_H
@@ -0,0 +1,20 @@
+/**
+ * @file Adafruit_INA219.h
+ * @brief A stand-in for the Adafruit INA219 driver, for the native build.
+ */
+#ifndef _NATIVE_ADAFRUIT_INA219_H
+#define _NATIVE_ADAFRUIT_INA219_H
+
+#include <Wire.h>
+#include <stdint.h>
+
+/** @brief A current sensor, which reads a steady load. */
+class Adafruit_INA219 {
+public:
+  Adafruit_INA219(uint8_t addr = 0x40) {}
+  bool  begin(TwoWire *wire = &Wire) { return true; }
+  float getBusVoltage_V() { return 8.0; }
+  float getCurrent_mA() { return 100.0; }
+};
+
+#endif // _NATIVE_ADAFRUIT_INA219_H
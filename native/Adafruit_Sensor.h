@@ -0,0 +1,29 @@
+/**
+ * @file Adafruit_Sensor.h
+ * @brief A stand-in for the Adafruit unified sensor library, for the native
+ * build.
+ */
+#ifndef _NATIVE_ADAFRUIT_SENSOR_H
+#define _NATIVE_ADAFRUIT_SENSOR_H
+
+#include <Wire.h>
+#include <stdint.h>
+
+/** @brief A three axis reading. */
+struct sensors_vec_t {
+  float x;
+  float y;
+  float z;
+};
+
+/** @brief A sensor reading. */
+struct sensors_event_t {
+  int32_t       sensor_id;
+  uint32_t      timestamp;
+  sensors_vec_t acceleration;
+  sensors_vec_t magnetic;
+  sensors_vec_t gyro;
+  float         temperature;
+};
+
+#endif // _NATIVE_ADAFRUIT_SENSOR_H
@@ -0,0 +1,159 @@
+/**
+ * @file Arduino.h
+ * @brief A stand-in for the Teensy's Arduino core, for the native build.
+ *
+ * This file declares the parts of the Teensy core used by the flight
+ * software, so that it can run on Linux without changes. Time is taken from
+ * std::chrono::steady_clock, pins read as low and the serial ports are byte
+ * buffers that the host can fill and drain (see HardwareSerial). The USB serial
+ * port prints to standard output.
+ */
+#ifndef _NATIVE_ARDUINO_H
+#define _NATIVE_ARDUINO_H
+
+#include <deque>
+#include <math.h>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#define LOW          0
+#define HIGH         1
+#define INPUT        0
+#define OUTPUT       1
+#define INPUT_PULLUP 2
+
+/** @brief The analog pins of the Teensy 4.1. */
+enum : uint8_t {
+  A0 = 14,
+  A1,
+  A2,
+  A3,
+  A4,
+  A5,
+  A6,
+  A7,
+  A8,
+  A9,
+  A10,
+  A11,
+  A12,
+  A13,
+  A14 = 38,
+  A15,
+  A16,
+  A17,
+};
+
+void     setup();
+void     loop();
+
+uint32_t millis();
+uint32_t micros();
+void     delay(uint32_t ms);
+void     delayMicroseconds(uint32_t us);
+void     pinMode(uint8_t pin, uint8_t mode);
+void     digitalWrite(uint8_t pin, uint8_t value);
+int      digitalRead(uint8_t pin);
+int      analogRead(uint8_t pin);
+
+/** @brief The milliseconds since it was last set. */
+class elapsedMillis {
+public:
+  elapsedMillis() : ms(millis()) {}
+  elapsedMillis(unsigned long value) : ms(millis() - value) {}
+  operator unsigned long() const { return millis() - ms; }
+  elapsedMillis &operator=(unsigned long value) {
+    ms = millis() - value;
+    return *this;
+  }
+  elapsedMillis &operator+=(unsigned long value) {
+    ms -= value;
+    return *this;
+  }
+  elapsedMillis &operator-=(unsigned long value) {
+    ms += value;
+    return *this;
+  }
+
+private:
+  /** @brief The value of millis() when this was zero. */
+  unsigned long ms;
+};
+
+/** @brief An Arduino String, which is only used for a few conversions. */
+class String : public std::string {
+public:
+  String() {}
+  String(const char *str) : std::string(str) {}
+  String(const std::string &str) : std::string(str) {}
+  explicit String(int value) : std::string(std::to_string(value)) {}
+  explicit String(unsigned int value) : std::string(std::to_string(value)) {}
+  explicit String(long value) : std::string(std::to_string(value)) {}
+  explicit String(unsigned long value)
+      : std::string(std::to_string(value)) {}
+};
+
+/**
+ * @brief A serial port.
+ *
+ * Bytes written by the flight software are kept for the host to take with
+ * take_output(), and bytes given to it with inject() are read back. A port
+ * made with an echo file, such as the USB serial port, writes to it instead.
+ */
+class HardwareSerial {
+public:
+  explicit HardwareSerial(FILE *echo = nullptr) : echo(echo) {}
+
+  void        begin(uint32_t baud) {}
+  void        end() {}
+  operator bool() const { return true; }
+
+  int         available();
+  int         peek();
+  int         read();
+  size_t      readBytes(uint8_t *buffer, size_t length);
+  size_t      readBytesUntil(char terminator, uint8_t *buffer, size_t length);
+  size_t      readBytesUntil(char terminator, char *buffer, size_t length);
+  String      readString();
+  void        clear();
+  void        flush() {}
+
+  size_t      write(uint8_t byte);
+  size_t      write(const uint8_t *buffer, size_t size);
+  size_t      write(char c) { return write((uint8_t)c); }
+  size_t      print(char c) { return write((uint8_t)c); }
+  size_t      print(const char *str);
+  size_t      println(const char *str);
+  size_t      println() { return print("\n"); }
+
+  void        inject(const uint8_t *src, size_t size);
+  void        set_echo(FILE *file);
+  std::string take_output();
+
+private:
+  /** @brief Guards the buffers against the host and the channels. */
+  std::mutex          mtx;
+  /** @brief The bytes waiting to be read. */
+  std::deque<uint8_t> rx;
+  /** @brief The bytes written, if not echoed. */
+  std::string         tx;
+  /** @brief The file written to instead of tx, if any. */
+  FILE               *echo;
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+extern HardwareSerial Serial2;
+extern HardwareSerial Serial3;
+extern HardwareSerial Serial4;
+extern HardwareSerial Serial5;
+extern HardwareSerial Serial6;
+extern HardwareSerial Serial7;
+extern HardwareSerial Serial8;
+
+#endif // _NATIVE_ARDUINO_H
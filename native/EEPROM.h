@@ -0,0 +1,44 @@
+/**
+ * @file EEPROM.h
+ * @brief A stand-in for the Teensy's EEPROM library, for the native build.
+ *
+ * This file declares the parts of the EEPROM library used by the flight
+ * software. The EEPROM is kept in memory, erased to 0xFF when the program
+ * starts, so the flight software starts as a newly programmed Teensy would.
+ */
+#ifndef _NATIVE_EEPROM_H
+#define _NATIVE_EEPROM_H
+
+#include <stdint.h>
+#include <string.h>
+
+/** @brief The size of the Teensy 4.1's emulated EEPROM, in bytes. */
+#define E2END 0x10BB
+
+/** @brief The EEPROM. */
+class EEPROMClass {
+public:
+  EEPROMClass() { memset(bytes, 0xFF, sizeof(bytes)); }
+
+  uint8_t  read(int idx) { return bytes[idx]; }
+  void     write(int idx, uint8_t value) { bytes[idx] = value; }
+  void     update(int idx, uint8_t value) { bytes[idx] = value; }
+  uint16_t length() { return sizeof(bytes); }
+
+  template <typename T> T &get(int idx, T &t) {
+    memcpy(&t, &bytes[idx], sizeof(T));
+    return t;
+  }
+  template <typename T> const T &put(int idx, const T &t) {
+    memcpy(&bytes[idx], &t, sizeof(T));
+    return t;
+  }
+
+private:
+  /** @brief The contents of the EEPROM. */
+  uint8_t bytes[E2END + 1];
+};
+
+extern EEPROMClass EEPROM;
+
+#endif // _NATIVE_EEPROM_H
@@ -0,0 +1,17 @@
+/**
+ * @file InternalTemperature.h
+ * @brief A stand-in for the InternalTemperature library, for the native
+ * build.
+ */
+#ifndef _NATIVE_INTERNALTEMPERATURE_H
+#define _NATIVE_INTERNALTEMPERATURE_H
+
+/** @brief The Teensy's temperature sensor, which reads room temperature. */
+class InternalTemperatureClass {
+public:
+  float readTemperatureC() { return 25.0; }
+};
+
+extern InternalTemperatureClass InternalTemperature;
+
+#endif // _NATIVE_INTERNALTEMPERATURE_H
@@ -0,0 +1,22 @@
+/**
+ * @file IntervalTimer.h
+ * @brief A stand-in for the Teensy's IntervalTimer, for the native build.
+ */
+#ifndef _NATIVE_INTERVALTIMER_H
+#define _NATIVE_INTERVALTIMER_H
+
+#include <stdint.h>
+
+/**
+ * @brief A periodic timer interrupt.
+ *
+ * The native build has no interrupts, so the timer never starts.
+ */
+class IntervalTimer {
+public:
+  bool begin(void (*function)(), uint32_t microseconds) { return false; }
+  void priority(uint8_t n) {}
+  void end() {}
+};
+
+#endif // _NATIVE_INTERVALTIMER_H
@@ -0,0 +1,16 @@
+/**
+ * @file RHHardwareSPI1.h
+ * @brief A stand-in for RadioHead's second SPI bus, for the native build.
+ */
+#ifndef _NATIVE_RHHARDWARESPI1_H
+#define _NATIVE_RHHARDWARESPI1_H
+
+#include <SPI.h>
+
+/** @brief A SPI bus used by a RadioHead driver. */
+class RHGenericSPI {};
+
+extern RHGenericSPI hardware_spi;
+extern RHGenericSPI hardware_spi1;
+
+#endif // _NATIVE_RHHARDWARESPI1_H
@@ -0,0 +1,53 @@
+/**
+ * @file RH_RF22.h
+ * @brief A stand-in for RadioHead's RF22 driver, for the native build.
+ *
+ * This file declares the parts of the RH_RF22 driver used by the flight
+ * software. Every radio shares one channel on the host: frames sent are kept
+ * for the host to take with take_sent(), and frames given to inject() are
+ * received.
+ */
+#ifndef _NATIVE_RH_RF22_H
+#define _NATIVE_RH_RF22_H
+
+#include <RHHardwareSPI1.h>
+#include <stdint.h>
+#include <string>
+
+#define RH_RF22_MAX_MESSAGE_LEN    255
+#define RH_RF22_RF23BP_TXPOW_28DBM 0x05
+#define RH_RF22_RF23BP_TXPOW_29DBM 0x06
+#define RH_RF22_RF23BP_TXPOW_30DBM 0x07
+
+/** @brief A RFM22 or RFM23 radio. */
+class RH_RF22 {
+public:
+  /** @brief The modem configurations used by the flight software. */
+  enum ModemConfigChoice {
+    FSK_Rb2Fd5 = 1,
+  };
+
+  RH_RF22(uint8_t slaveSelectPin = 10, uint8_t interruptPin = 2,
+          RHGenericSPI &spi = hardware_spi) {}
+
+  bool        init() { return true; }
+  void        reset() {}
+  bool        setFrequency(float centre, float afcPullInRange = 0.05) {
+    return true;
+  }
+  void        setTxPower(uint8_t power) {}
+  bool        setModemConfig(ModemConfigChoice index) { return true; }
+  bool        sleep() { return true; }
+  void        setModeIdle() {}
+
+  bool        send(const uint8_t *data, uint8_t len);
+  bool        waitPacketSent(uint16_t timeout) { return true; }
+  bool        available();
+  bool        waitAvailableTimeout(uint16_t timeout);
+  bool        recv(uint8_t *buf, uint8_t *len);
+
+  static void inject(const uint8_t *data, uint8_t len);
+  static bool take_sent(std::string &frame);
+};
+
+#endif // _NATIVE_RH_RF22_H
@@ -0,0 +1,97 @@
+/**
+ * @file SD.cpp
+ * @brief The stand-in for the Teensy's SD library.
+ *
+ * This file contains definitions of the file functions declared in the native
+ * SD.h.
+ */
+#include <SD.h>
+#include <stdlib.h>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+SDClass SD;
+
+namespace {
+/** @brief The path on the host of a path on the SD card. */
+std::string host_path(const char *path) {
+  const char *root = getenv("ARTEMIS_SD");
+  return std::string(root != nullptr ? root : "sdcard") + "/" + path;
+}
+} // namespace
+
+bool File::seek(uint64_t position) {
+  return file && fseek(file.get(), position, SEEK_SET) == 0;
+}
+
+uint64_t File::position() { return file ? ftell(file.get()) : 0; }
+
+uint64_t File::size() {
+  if (!file) {
+    return 0;
+  }
+  struct stat info;
+  fflush(file.get());
+  return fstat(fileno(file.get()), &info) == 0 ? info.st_size : 0;
+}
+
+int File::read(void *dst, size_t size) {
+  return file ? fread(dst, 1, size, file.get()) : -1;
+}
+
+size_t File::write(const void *src, size_t size) {
+  return file ? fwrite(src, 1, size, file.get()) : 0;
+}
+
+bool File::truncate(uint64_t size) {
+  return file && fflush(file.get()) == 0 &&
+         ftruncate(fileno(file.get()), size) == 0;
+}
+
+void File::flush() {
+  if (file) {
+    fflush(file.get());
+  }
+}
+
+/**
+ * @brief Start the SD card, making its directory if needed.
+ *
+ * @return true The directory exists.
+ */
+bool SDClass::begin(uint8_t cs) {
+  const std::string root = host_path("");
+  mkdir(root.c_str(), 0755);
+  struct stat info;
+  return stat(root.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+}
+
+/**
+ * @brief Open a file.
+ *
+ * As on the Teensy, FILE_WRITE creates the file if needed and starts at its
+ * end.
+ */
+File SDClass::open(const char *path, uint8_t mode) {
+  const std::string host = host_path(path);
+  if (mode == FILE_READ) {
+    return File(fopen(host.c_str(), "rb"));
+  }
+  FILE *file = fopen(host.c_str(), "r+b");
+  if (file == nullptr) {
+    file = fopen(host.c_str(), "w+b");
+  }
+  if (file != nullptr) {
+    fseek(file, 0, SEEK_END);
+  }
+  return File(file);
+}
+
+bool SDClass::exists(const char *path) {
+  return access(host_path(path).c_str(), F_OK) == 0;
+}
+
+bool SDClass::remove(const char *path) {
+  return unlink(host_path(path).c_str()) == 0;
+}
@@ -0,0 +1,59 @@
+/**
+ * @file SD.h
+ * @brief A stand-in for the Teensy's SD library, for the native build.
+ *
+ * This file declares the parts of the SD library used by the flight
+ * software. The SD card is a directory on the host, named by the ARTEMIS_SD
+ * environment variable or `sdcard` by default, which is made if it does not
+ * exist.
+ */
+#ifndef _NATIVE_SD_H
+#define _NATIVE_SD_H
+
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define FILE_READ      0
+#define FILE_WRITE     1
+/** @brief The chip select of the Teensy 4.1's built-in SD card. */
+#define BUILTIN_SDCARD 254
+
+/** @brief An open file, which is closed when its last copy is. */
+class File {
+public:
+  File() {}
+  explicit File(FILE *file) {
+    if (file != nullptr) {
+      this->file.reset(file, fclose);
+    }
+  }
+  operator bool() const { return file != nullptr; }
+
+  bool     seek(uint64_t position);
+  uint64_t position();
+  uint64_t size();
+  int      read(void *dst, size_t size);
+  size_t   write(const void *src, size_t size);
+  bool     truncate(uint64_t size);
+  void     flush();
+  void     close() { file.reset(); }
+
+private:
+  /** @brief The file on the host. */
+  std::shared_ptr<FILE> file;
+};
+
+/** @brief The SD card. */
+class SDClass {
+public:
+  bool begin(uint8_t cs);
+  File open(const char *path, uint8_t mode = FILE_READ);
+  bool exists(const char *path);
+  bool remove(const char *path);
+};
+
+extern SDClass SD;
+
+#endif // _NATIVE_SD_H
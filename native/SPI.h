@@ -0,0 +1,22 @@
+/**
+ * @file SPI.h
+ * @brief A stand-in for the Teensy's SPI library, for the native build.
+ */
+#ifndef _NATIVE_SPI_H
+#define _NATIVE_SPI_H
+
+#include <stdint.h>
+
+/** @brief A SPI bus, whose pins can be set but which does nothing. */
+class SPIClass {
+public:
+  void begin() {}
+  void setMISO(uint8_t pin) {}
+  void setMOSI(uint8_t pin) {}
+  void setSCK(uint8_t pin) {}
+};
+
+extern SPIClass SPI;
+extern SPIClass SPI1;
+
+#endif // _NATIVE_SPI_H
@@ -0,0 +1,151 @@
+/**
+ * @file TeensyThreads.cpp
+ * @brief The stand-in for TeensyThreads.
+ *
+ * This file contains definitions of the thread and mutex functions declared
+ * in the native TeensyThreads.h.
+ */
+#include "native.h"
+#include <TeensyThreads.h>
+#include <atomic>
+#include <thread>
+
+Threads threads;
+
+namespace {
+/**
+ * @brief The virtual time, in microseconds, a yield takes.
+ *
+ * A thread waiting in a loop of yields therefore lets virtual time pass.
+ */
+const uint64_t    VIRTUAL_YIELD_US      = 100;
+/** @brief The virtual time, in microseconds, between tries of a mutex. */
+const uint64_t    VIRTUAL_MUTEX_POLL_US = 100;
+
+/** @brief Thrown from delay() and yield() to stop a killed thread. */
+struct killed {};
+
+/** @brief The state of each thread, indexed by ID. */
+std::atomic<int>  states[Threads::MAX_THREADS];
+/** @brief Whether each thread has been killed, indexed by ID. */
+std::atomic<bool> kills[Threads::MAX_THREADS];
+/** @brief Guards the choice of IDs. */
+std::mutex        ids_mtx;
+/** @brief The ID of the running thread. */
+thread_local int  current_id = 0;
+
+/** @brief Start a thread in the first free ID. */
+template <typename F> int start(F function) {
+  std::lock_guard<std::mutex> lock(ids_mtx);
+  for (int id = 1; id < Threads::MAX_THREADS; id++) {
+    const int state = states[id];
+    if (state != Threads::EMPTY && state != Threads::ENDED) {
+      continue;
+    }
+    uint64_t turn = 0;
+    if (Native::virtual_clock()) {
+      turn = Native::add_virtual_thread();
+      if (turn == 0) {
+        return -1;
+      }
+    }
+    states[id] = Threads::RUNNING;
+    kills[id]  = false;
+    std::thread([id, turn, function]() {
+      current_id = id;
+      if (turn != 0) {
+        Native::enter_virtual_thread(turn);
+      }
+      try {
+        function();
+      } catch (const killed &) {
+      }
+      states[id] = Threads::ENDED;
+      if (turn != 0) {
+        Native::exit_virtual_thread();
+      }
+    }).detach();
+    return id;
+  }
+  return -1;
+}
+
+/** @brief Stop the running thread if it has been killed. */
+void check_killed() {
+  if (current_id != 0 && kills[current_id]) {
+    throw killed();
+  }
+}
+} // namespace
+
+int Threads::addThread(ThreadFunction p, void *arg, int stack_size,
+                       void *stack) {
+  return start([p, arg]() { p(arg); });
+}
+
+int Threads::addThread(ThreadFunctionNone p, int arg, int stack_size,
+                       void *stack) {
+  return start(p);
+}
+
+int Threads::getState(int id) {
+  return id >= 0 && id < MAX_THREADS ? states[id].load() : EMPTY;
+}
+
+int Threads::kill(int id) {
+  if (id <= 0 || id >= MAX_THREADS || states[id] != RUNNING) {
+    return 0;
+  }
+  kills[id]  = true;
+  states[id] = ENDING;
+  return 1;
+}
+
+int  Threads::id() { return current_id; }
+
+void Threads::delay(int millisecond) {
+  check_killed();
+  if (Native::virtual_clock()) {
+    Native::virtual_sleep(millisecond * 1000ull);
+  } else {
+    std::this_thread::sleep_for(std::chrono::milliseconds(millisecond));
+  }
+  check_killed();
+}
+
+void Threads::yield() {
+  check_killed();
+  if (Native::virtual_clock()) {
+    Native::virtual_sleep(VIRTUAL_YIELD_US);
+  } else {
+    std::this_thread::yield();
+  }
+}
+
+/**
+ * @brief Lock the mutex.
+ *
+ * On the virtual clock, the thread holding the mutex can only run once this
+ * thread sleeps, so the mutex is tried between virtual sleeps instead.
+ *
+ * @param timeout_ms The most milliseconds to wait, or 0 to wait forever.
+ * @return int 1 if the mutex is locked, or 0 if the wait timed out.
+ */
+int Threads::Mutex::lock(unsigned int timeout_ms) {
+  if (Native::virtual_clock()) {
+    const uint64_t start = Native::virtual_micros();
+    while (!mtx.try_lock()) {
+      if (timeout_ms != 0 &&
+          Native::virtual_micros() - start >= timeout_ms * 1000ull) {
+        return 0;
+      }
+      Native::virtual_sleep(VIRTUAL_MUTEX_POLL_US);
+    }
+    return 1;
+  }
+  if (timeout_ms == 0) {
+    mtx.lock();
+    return 1;
+  }
+  return mtx.try_lock_for(std::chrono::milliseconds(timeout_ms)) ? 1 : 0;
+}
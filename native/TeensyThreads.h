@@ -0,0 +1,74 @@
+/**
+ * @file TeensyThreads.h
+ * @brief A stand-in for TeensyThreads, for the native build.
+ *
+ * This file declares the parts of TeensyThreads used by the flight software,
+ * with each thread run on a std::thread. Threads are given the same small
+ * IDs as on the Teensy, with 0 for the main thread. The stack passed to
+ * addThread() is not used, and time slices are left to the host's scheduler,
+ * so threads run truly in parallel. There are as many thread IDs as on the
+ * Teensy, so a channel that would not fit there fails to start here too.
+ *
+ * A killed thread stops at its next call to delay() or yield(), which is
+ * where a channel on the Teensy would usually be switched out.
+ */
+#ifndef _NATIVE_TEENSYTHREADS_H
+#define _NATIVE_TEENSYTHREADS_H
+
+#include <chrono>
+#include <mutex>
+
+class Threads {
+public:
+  static const int EMPTY       = 0;
+  static const int RUNNING     = 1;
+  static const int ENDED       = 2;
+  static const int ENDING      = 3;
+  static const int SUSPENDED   = 4;
+  static const int MAX_THREADS = 8;
+
+  typedef void (*ThreadFunction)(void *);
+  typedef void (*ThreadFunctionNone)();
+
+  int  addThread(ThreadFunction p, void *arg = 0, int stack_size = -1,
+                 void *stack = 0);
+  int  addThread(ThreadFunctionNone p, int arg = 0, int stack_size = -1,
+                 void *stack = 0);
+  int  getState(int id);
+  int  kill(int id);
+  int  id();
+  void delay(int millisecond);
+  void yield();
+  int  setSliceMillis(int milliseconds) { return 1; }
+  int  setTimeSlice(int id, unsigned int ticks) { return 1; }
+
+  /** @brief A mutex, which is not recursive. */
+  class Mutex {
+  public:
+    int lock(unsigned int timeout_ms = 0);
+    int try_lock() { return mtx.try_lock() ? 1 : 0; }
+    int unlock() {
+      mtx.unlock();
+      return 1;
+    }
+
+  private:
+    /** @brief The host's mutex. */
+    std::timed_mutex mtx;
+  };
+
+  /** @brief Locks a mutex for the rest of its scope. */
+  class Scope {
+  public:
+    explicit Scope(Mutex &m) : mtx(m) { mtx.lock(); }
+    ~Scope() { mtx.unlock(); }
+
+  private:
+    /** @brief The locked mutex. */
+    Mutex &mtx;
+  };
+};
+
+extern Threads threads;
+
+#endif // _NATIVE_TEENSYTHREADS_H
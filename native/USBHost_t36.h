@@ -0,0 +1,15 @@
+/**
+ * @file USBHost_t36.h
+ * @brief A stand-in for the Teensy's USB host library, for the native build.
+ */
+#ifndef _NATIVE_USBHOST_T36_H
+#define _NATIVE_USBHOST_T36_H
+
+/** @brief The USB host port, which has nothing connected. */
+class USBHost {
+public:
+  void begin() {}
+  void Task() {}
+};
+
+#endif // _NATIVE_USBHOST_T36_H
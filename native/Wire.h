@@ -0,0 +1,18 @@
+/**
+ * @file Wire.h
+ * @brief A stand-in for the Teensy's Wire library, for the native build.
+ */
+#ifndef _NATIVE_WIRE_H
+#define _NATIVE_WIRE_H
+
+/** @brief An I2C bus, which the stand-in sensors answer on. */
+class TwoWire {
+public:
+  void begin() {}
+};
+
+extern TwoWire Wire;
+extern TwoWire Wire1;
+extern TwoWire Wire2;
+
+#endif // _NATIVE_WIRE_H
@@ -0,0 +1,241 @@
+/**
+ * @file arduino.cpp
+ * @brief The stand-in for the Teensy's Arduino core.
+ *
+ * This file contains definitions of the time, pin and serial functions
+ * declared in the native Arduino.h, and the program's entry point.
+ */
+#include "native.h"
+#include <Arduino.h>
+#include <chrono>
+#include <string.h>
+#include <thread>
+
+HardwareSerial Serial(stdout);
+HardwareSerial Serial1;
+HardwareSerial Serial2;
+HardwareSerial Serial3;
+HardwareSerial Serial4;
+HardwareSerial Serial5;
+HardwareSerial Serial6;
+HardwareSerial Serial7;
+HardwareSerial Serial8;
+
+/**
+ * @brief The linker symbols around the Teensy's heap.
+ *
+ * The native build has no such heap, so they are placed at the same address
+ * and the memory report of the tests channel reads it as empty.
+ */
+unsigned long        _heap_start;
+extern unsigned long _heap_end __attribute__((alias("_heap_start")));
+char                *__brkval = (char *)&_heap_start;
+
+namespace {
+/** @brief The level each digital pin was last written. */
+uint8_t                             pins[64];
+
+/** @brief The time since millis() or micros() was first called. */
+std::chrono::steady_clock::duration uptime() {
+  static const auto start = std::chrono::steady_clock::now();
+  return std::chrono::steady_clock::now() - start;
+}
+} // namespace
+
+uint32_t millis() {
+  if (Native::virtual_clock()) {
+    return Native::virtual_micros() / 1000;
+  }
+  return std::chrono::duration_cast<std::chrono::milliseconds>(uptime())
+      .count();
+}
+
+uint32_t micros() {
+  if (Native::virtual_clock()) {
+    return Native::virtual_micros();
+  }
+  return std::chrono::duration_cast<std::chrono::microseconds>(uptime())
+      .count();
+}
+
+void delay(uint32_t ms) {
+  if (Native::virtual_clock()) {
+    Native::virtual_sleep(ms * 1000ull);
+    return;
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(uint32_t us) {
+  if (Native::virtual_clock()) {
+    Native::virtual_sleep(us);
+    return;
+  }
+  std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+  pins[pin % sizeof(pins)] = value;
+}
+
+int  digitalRead(uint8_t pin) { return pins[pin % sizeof(pins)]; }
+
+/**
+ * @brief Read an analog pin.
+ *
+ * @return int The 10 bit reading of about 0.75 V that every pin gives, which
+ * the temperature sensors read as room temperature.
+ */
+int  analogRead(uint8_t pin) { return 232; }
+
+int  HardwareSerial::available() {
+  std::lock_guard<std::mutex> lock(mtx);
+  return rx.size();
+}
+
+int HardwareSerial::peek() {
+  std::lock_guard<std::mutex> lock(mtx);
+  return rx.empty() ? -1 : rx.front();
+}
+
+int HardwareSerial::read() {
+  std::lock_guard<std::mutex> lock(mtx);
+  if (rx.empty()) {
+    return -1;
+  }
+  const uint8_t byte = rx.front();
+  rx.pop_front();
+  return byte;
+}
+
+size_t HardwareSerial::readBytes(uint8_t *buffer, size_t length) {
+  std::lock_guard<std::mutex> lock(mtx);
+  size_t                      count = 0;
+  while (count < length && !rx.empty()) {
+    buffer[count++] = rx.front();
+    rx.pop_front();
+  }
+  return count;
+}
+
+/**
+ * @brief Read bytes up to a terminator, which is removed but not stored.
+ *
+ * Unlike on the Teensy, this does not wait for more bytes to arrive.
+ */
+size_t HardwareSerial::readBytesUntil(char terminator, uint8_t *buffer,
+                                      size_t length) {
+  std::lock_guard<std::mutex> lock(mtx);
+  size_t                      count = 0;
+  while (count < length && !rx.empty()) {
+    const uint8_t byte = rx.front();
+    rx.pop_front();
+    if (byte == (uint8_t)terminator) {
+      break;
+    }
+    buffer[count++] = byte;
+  }
+  return count;
+}
+
+size_t HardwareSerial::readBytesUntil(char terminator, char *buffer,
+                                      size_t length) {
+  return readBytesUntil(terminator, (uint8_t *)buffer, length);
+}
+
+/** @brief Read every byte waiting, without waiting for more. */
+String HardwareSerial::readString() {
+  std::lock_guard<std::mutex> lock(mtx);
+  String                      str(std::string(rx.begin(), rx.end()));
+  rx.clear();
+  return str;
+}
+
+void HardwareSerial::clear() {
+  std::lock_guard<std::mutex> lock(mtx);
+  rx.clear();
+}
+
+size_t HardwareSerial::write(uint8_t byte) { return write(&byte, 1); }
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) {
+  std::lock_guard<std::mutex> lock(mtx);
+  if (echo != nullptr) {
+    const size_t written = fwrite(buffer, 1, size, echo);
+    fflush(echo);
+    return written;
+  }
+  tx.append((const char *)buffer, size);
+  return size;
+}
+
+size_t HardwareSerial::print(const char *str) {
+  return write((const uint8_t *)str, strlen(str));
+}
+
+size_t HardwareSerial::println(const char *str) {
+  return print(str) + print("\n");
+}
+
+/**
+ * @brief Give the port bytes to read, as if they had been received.
+ *
+ * @param src The bytes.
+ * @param size The number of bytes.
+ */
+void HardwareSerial::inject(const uint8_t *src, size_t size) {
+  std::lock_guard<std::mutex> lock(mtx);
+  rx.insert(rx.end(), src, src + size);
+}
+
+/**
+ * @brief Write the port's output to a file as it is written, or keep it for
+ * take_output() instead.
+ *
+ * @param file The file, or nullptr to keep the output.
+ */
+void HardwareSerial::set_echo(FILE *file) {
+  std::lock_guard<std::mutex> lock(mtx);
+  echo = file;
+}
+
+/**
+ * @brief Take the bytes the port has written.
+ *
+ * @return std::string The bytes written since the last call.
+ */
+std::string HardwareSerial::take_output() {
+  std::lock_guard<std::mutex> lock(mtx);
+  std::string                 output;
+  output.swap(tx);
+  return output;
+}
+
+#ifndef LIBFUZZER
+/**
+ * @brief Run a host command if one is given, otherwise run the flight
+ * software as the Teensy's core does.
+ *
+ * A libFuzzer build has no entry point of its own, as libFuzzer provides it.
+ */
+int main(int argc, char **argv) {
+  if (argc >= 2 && strcmp(argv[1], "bench") == 0) {
+    return Native::bench(argc - 2, argv + 2);
+  }
+  if (argc >= 2 && strcmp(argv[1], "replay") == 0) {
+    return Native::replay(argc - 2, argv + 2);
+  }
+  if (argc >= 2 && strcmp(argv[1], "fuzz") == 0) {
+    return Native::fuzz(argc - 2, argv + 2);
+  }
+  if (argc >= 2 && strcmp(argv[1], "governor") == 0) {
+    return Native::governor(argc - 2, argv + 2);
+  }
+  setup();
+  for (;;) {
+    loop();
+  }
+}
+#endif
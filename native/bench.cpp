@@ -0,0 +1,248 @@
+/**
+ * @file bench.cpp
+ * @brief The packet path benchmarks.
+ *
+ * This file defines a native command that times the hot packet paths of the
+ * flight software in isolation, and prints the time, cycles and heap
+ * allocations of each operation as JSON, so that runs can be compared over
+ * time.
+ */
+#include "native.h"
+#include "artemis_devices.h"
+#include "channels/artemis_channels.h"
+#include <chrono>
+#include <heap_track.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+void route_packets();
+
+namespace Native {
+namespace {
+/** @brief The number of operations each benchmark times, unless given. */
+const uint32_t BENCH_ITERATIONS = 100000;
+/** @brief The size of the payload of the packets used. */
+const uint8_t  BENCH_PAYLOAD    = 40;
+/** @brief The number of packets queued for each batch of routing. */
+const uint8_t  BENCH_QUEUED     = 8;
+
+/** @brief The structure of a benchmark. */
+struct benchmark {
+  /** @brief The name printed in the results, and used to select it. */
+  const char *name;
+  /**
+   * @brief The number of operations timed together.
+   *
+   * This is limited by how many operations can run before the state they
+   * use, such as a queue, has to be reset.
+   */
+  uint32_t    batch;
+  /** @brief Resets the state used by a batch, outside of the timing. */
+  void (*prepare)();
+  /** @brief Runs one operation. */
+  void (*run)();
+};
+
+/** @brief The packet each operation works on. */
+PacketComm                              packet;
+/** @brief A copy of the packet, to restore it before each batch. */
+PacketComm                              original;
+/** @brief The bytes of the hexdump. */
+uint8_t                                 payload[64];
+
+Artemis::Devices::TemperatureSensors    temperature_sensors;
+Artemis::Devices::CurrentSensors        current_sensors;
+Artemis::Devices::IMU                   imu;
+Artemis::Devices::Magnetometer          magnetometer;
+Artemis::Devices::GPS                   gps;
+
+/** @brief The time now, in cycles, or 0 if they cannot be counted. */
+uint64_t cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+/** @brief The time now, in nanoseconds. */
+uint64_t nanoseconds() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+/** @brief The number of heap allocations ever made. */
+uint32_t allocations() {
+  uint32_t count = 0;
+  for (uint8_t i = 0; i < HEAP_TAGS; i++) {
+    count += Helpers::get_heap_tag((Helpers::HeapTag)i).allocs;
+  }
+  return count;
+}
+
+/** @brief Make the packet a beacon on its way to the ground. */
+void make_beacon(PacketComm &beacon) {
+  beacon.header.type     = PacketComm::TypeId::DataObcBeacon;
+  beacon.header.nodeorig = (uint8_t)NODES::TEENSY_NODE_ID;
+  beacon.header.nodedest = (uint8_t)NODES::GROUND_NODE_ID;
+  beacon.header.chanin   = 0;
+  beacon.header.chanout  = Artemis::Channels::Channel_ID::RFM23_CHANNEL;
+  beacon.data.resize(BENCH_PAYLOAD);
+  for (uint8_t i = 0; i < BENCH_PAYLOAD; i++) {
+    beacon.data[i] = i;
+  }
+}
+
+/** @brief Restore the packet. */
+void restore() { packet = original; }
+
+/** @brief Fill the main queue with beacons for the ground. */
+void queue_beacons() {
+  PacketComm beacon;
+  make_beacon(beacon);
+  for (uint8_t i = 0; i < BENCH_QUEUED; i++) {
+    PushQueue(beacon, main_queue, main_queue_mtx);
+  }
+}
+
+/** @brief Fill the main queue with pings for the Teensy. */
+void queue_pings() {
+  PacketComm ping;
+  ping.header.type     = PacketComm::TypeId::CommandObcPing;
+  ping.header.nodeorig = (uint8_t)NODES::GROUND_NODE_ID;
+  ping.header.nodedest = (uint8_t)NODES::TEENSY_NODE_ID;
+  for (uint8_t i = 0; i < BENCH_QUEUED; i++) {
+    PushQueue(ping, main_queue, main_queue_mtx);
+  }
+}
+
+/** @brief Empty the debug ring of this thread. */
+void drain_debug_ring() {
+  static uint8_t               record[DEBUG_LOG_RING_SIZE];
+  Helpers::DebugRing          &ring = Helpers::debug_ring();
+  Helpers::log_record_header   header;
+  while (ring.peek(header)) {
+    ring.read(record, sizeof(record));
+  }
+  ring.take_dropped();
+}
+
+/** @brief The benchmarks. */
+const benchmark benchmarks[] = {
+    {"queue_push_pull", 1000, restore,
+     []() {
+       PushQueue(packet, main_queue, main_queue_mtx);
+       PullQueue(packet, main_queue, main_queue_mtx);
+     }},
+    {"wrap", 1000, restore, []() { packet.Wrap(); }},
+    {"unwrap", 1000, restore, []() { packet.Unwrap(); }},
+    {"slip_packetize", 1000, restore, []() { packet.SLIPPacketize(); }},
+    {"slip_unpacketize", 1000, restore, []() { packet.SLIPUnPacketize(); }},
+    {"temperature_read", 100, nullptr,
+     []() { temperature_sensors.read(millis()); }},
+    {"current_read", 100, nullptr, []() { current_sensors.read(millis()); }},
+    {"imu_read", 100, nullptr, []() { imu.read(millis()); }},
+    {"magnetometer_read", 100, nullptr,
+     []() { magnetometer.read(millis()); }},
+    {"gps_read", 100, nullptr, []() { gps.read(millis()); }},
+    {"route_ground", BENCH_QUEUED, queue_beacons, route_packets},
+    {"route_ping", BENCH_QUEUED, queue_pings, route_packets},
+    {"print_hexdump", 8, drain_debug_ring,
+     []() {
+       Helpers::print_hexdump(Helpers::TEST, "bench: ", payload,
+                              sizeof(payload));
+     }},
+};
+
+/** @brief Run a benchmark and print its results. */
+void run(const benchmark &bench, uint32_t iterations, bool first) {
+  // A batch is run first to fill caches and queues.
+  if (bench.prepare != nullptr) {
+    bench.prepare();
+  }
+  for (uint32_t i = 0; i < bench.batch; i++) {
+    bench.run();
+  }
+
+  uint64_t ns     = 0;
+  uint64_t cycle  = 0;
+  uint32_t allocs = 0;
+  uint32_t count  = 0;
+  while (count < iterations) {
+    if (bench.prepare != nullptr) {
+      bench.prepare();
+    }
+    const uint32_t start_allocs = allocations();
+    const uint64_t start_cycles = cycles();
+    const uint64_t start_ns     = nanoseconds();
+    for (uint32_t i = 0; i < bench.batch; i++) {
+      bench.run();
+    }
+    ns     += nanoseconds() - start_ns;
+    cycle  += cycles() - start_cycles;
+    allocs += allocations() - start_allocs;
+    count  += bench.batch;
+  }
+  printf("%s\n  {\"name\": \"%s\", \"iterations\": %u, \"ns\": %.1f, "
+         "\"cycles\": %.1f, \"allocs\": %.2f}",
+         first ? "" : ",", bench.name, (unsigned)count, (double)ns / count,
+         (double)cycle / count, (double)allocs / count);
+}
+} // namespace
+
+/**
+ * @brief Time the hot packet paths.
+ *
+ * The results are printed as JSON, with the time in nanoseconds, cycles and
+ * heap allocations of each operation averaged over every iteration. Cycles
+ * are only counted on x86 hosts.
+ *
+ * @param argc The number of arguments.
+ * @param argv The name of the only benchmark to run, and the number of
+ * operations to time.
+ * @return int 0 if a benchmark ran, otherwise 1.
+ */
+int bench(int argc, char **argv) {
+  const char    *only = argc >= 1 ? argv[0] : nullptr;
+  const uint32_t iterations =
+      argc >= 2 ? strtoul(argv[1], nullptr, 0) : BENCH_ITERATIONS;
+  if (iterations == 0) {
+    fprintf(stderr, "bench: iterations must be at least 1\n");
+    return 1;
+  }
+
+  make_beacon(original);
+  original.Wrap();
+  original.SLIPPacketize();
+  for (uint8_t i = 0; i < sizeof(payload); i++) {
+    payload[i] = i;
+  }
+  temperature_sensors.setup();
+  current_sensors.setup();
+  imu.setup();
+  magnetometer.setup();
+  gps.setup();
+
+  bool first = true;
+  printf("{\"benchmarks\": [");
+  for (const benchmark &b : benchmarks) {
+    if (only != nullptr && strcmp(only, "all") != 0 &&
+        strcmp(only, b.name) != 0) {
+      continue;
+    }
+    run(b, iterations, first);
+    first = false;
+  }
+  printf("\n]}\n");
+  if (first) {
+    fprintf(stderr, "bench: unknown benchmark %s\n", only);
+    return 1;
+  }
+  return 0;
+}
+} // namespace Native
@@ -0,0 +1,127 @@
+/**
+ * @file drivers.cpp
+ * @brief The stand-ins for the Teensy's device libraries.
+ *
+ * This file contains the global device objects of the libraries stood in for
+ * by the native build, and the radio channel shared by RH_RF22 objects.
+ */
+#include "native.h"
+#include <EEPROM.h>
+#include <InternalTemperature.h>
+#include <RH_RF22.h>
+#include <Wire.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string.h>
+
+EEPROMClass              EEPROM;
+InternalTemperatureClass InternalTemperature;
+TwoWire                  Wire;
+TwoWire                  Wire1;
+TwoWire                  Wire2;
+SPIClass                 SPI;
+SPIClass                 SPI1;
+RHGenericSPI             hardware_spi;
+RHGenericSPI             hardware_spi1;
+
+namespace {
+/** @brief Guards the radio channel. */
+std::mutex              air_mtx;
+/** @brief Signalled when a frame is injected. */
+std::condition_variable air_cv;
+/** @brief The frames waiting to be received. */
+std::deque<std::string> received;
+/** @brief The frames sent. */
+std::deque<std::string> sent;
+} // namespace
+
+bool RH_RF22::send(const uint8_t *data, uint8_t len) {
+  std::lock_guard<std::mutex> lock(air_mtx);
+  sent.emplace_back((const char *)data, len);
+  return true;
+}
+
+/**
+ * @brief Check whether a frame has been received.
+ *
+ * Off the virtual clock, this waits up to a millisecond for one, so that a
+ * thread polling it between yields does not spin the host.
+ */
+bool RH_RF22::available() {
+  std::unique_lock<std::mutex> lock(air_mtx);
+  if (Native::virtual_clock()) {
+    return !received.empty();
+  }
+  return air_cv.wait_for(lock, std::chrono::milliseconds(1),
+                         []() { return !received.empty(); });
+}
+
+/**
+ * @brief Wait for a frame to be received.
+ *
+ * On the virtual clock, the radio is checked once every virtual millisecond.
+ */
+bool RH_RF22::waitAvailableTimeout(uint16_t timeout) {
+  if (Native::virtual_clock()) {
+    for (uint16_t waited = 0;; waited++) {
+      {
+        std::lock_guard<std::mutex> lock(air_mtx);
+        if (!received.empty()) {
+          return true;
+        }
+      }
+      if (waited >= timeout) {
+        return false;
+      }
+      Native::virtual_sleep(1000);
+    }
+  }
+  std::unique_lock<std::mutex> lock(air_mtx);
+  return air_cv.wait_for(lock, std::chrono::milliseconds(timeout),
+                         []() { return !received.empty(); });
+}
+
+bool RH_RF22::recv(uint8_t *buf, uint8_t *len) {
+  std::lock_guard<std::mutex> lock(air_mtx);
+  if (received.empty()) {
+    return false;
+  }
+  const std::string &frame = received.front();
+  *len                     = frame.size() < *len ? frame.size() : *len;
+  memcpy(buf, frame.data(), *len);
+  received.pop_front();
+  return true;
+}
+
+/**
+ * @brief Give the radios a frame to receive.
+ *
+ * @param data The frame.
+ * @param len The size of the frame, in bytes.
+ */
+void RH_RF22::inject(const uint8_t *data, uint8_t len) {
+  {
+    std::lock_guard<std::mutex> lock(air_mtx);
+    received.emplace_back((const char *)data, len);
+  }
+  air_cv.notify_all();
+}
+
+/**
+ * @brief Take the oldest frame sent by a radio.
+ *
+ * @param frame The frame, if there is one.
+ * @return true A frame has been taken.
+ * @return false No frames have been sent since the last was taken.
+ */
+bool RH_RF22::take_sent(std::string &frame) {
+  std::lock_guard<std::mutex> lock(air_mtx);
+  if (sent.empty()) {
+    return false;
+  }
+  frame = sent.front();
+  sent.pop_front();
+  return true;
+}
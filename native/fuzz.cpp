@@ -0,0 +1,369 @@
+/**
+ * @file fuzz.cpp
+ * @brief The fuzz targets of the received-byte parsers.
+ *
+ * This file defines a native command that gives arbitrary bytes to each of
+ * the functions that parse bytes received by the Teensy, and to the router
+ * that acts on the packets they produce. Each input is run on the virtual
+ * clock without a scheduler, so every delay it causes is measured rather than
+ * waited out, and an input that would stall a channel is treated as a crash.
+ *
+ * The targets can be run on files, or on stdin as AFL expects. When built
+ * with LIBFUZZER, they are instead run by libFuzzer, on the target named by
+ * the ARTEMIS_FUZZ_TARGET environment variable.
+ */
+#include "native.h"
+#include "artemis_devices.h"
+#include "channels/artemis_channels.h"
+#include <chrono>
+#include <RH_RF22.h>
+#include <pdu.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+void route_packets();
+
+namespace Native {
+namespace {
+/**
+ * @brief The virtual time, in microseconds, an input may take.
+ *
+ * The longest wait the flight software means to make on one input is the 5
+ * seconds given to the Raspberry Pi to start.
+ */
+const uint64_t FUZZ_STALL_US          = 10 * 1000000ull;
+/** @brief The real time, in seconds, an input may take before it is a hang. */
+const uint32_t FUZZ_TIMEOUT_SECONDS   = 10;
+/** @brief The largest input read, in bytes. */
+const size_t   FUZZ_MAX_INPUT         = 4096;
+
+using Artemis::Devices::PDU;
+/** @brief The PDU parsed by the PDU targets, on the PDU's serial port. */
+PDU            pdu(&Serial1, 115200);
+
+/** @brief The structure of a fuzz target. */
+struct target {
+  /** @brief The name used to select it. */
+  const char *name;
+  /** @brief Gives an input to the parser. */
+  void (*run)(const uint8_t *data, size_t size);
+  /** @brief Writes the valid frames the corpus starts from. */
+  void (*seed)(std::vector<std::string> &corpus);
+};
+
+/** @brief A packet from the ground to the Teensy. */
+PacketComm command(PacketComm::TypeId type, std::vector<uint8_t> data) {
+  PacketComm packet;
+  packet.header.type     = type;
+  packet.header.nodeorig = (uint8_t)NODES::GROUND_NODE_ID;
+  packet.header.nodedest = (uint8_t)NODES::TEENSY_NODE_ID;
+  packet.header.chanin   = Artemis::Channels::Channel_ID::RFM23_CHANNEL;
+  packet.header.chanout  = Artemis::Channels::Channel_ID::RFM23_CHANNEL;
+  packet.data            = data;
+  return packet;
+}
+
+/** @brief The commands the router acts on, with valid data. */
+std::vector<PacketComm> commands() {
+  return {
+      command(PacketComm::TypeId::CommandObcPing, {}),
+      command(PacketComm::TypeId::CommandEpsSwitchName,
+              {(uint8_t)PDU::PDU_SW::SW_5V_1, 1}),
+      command(PacketComm::TypeId::CommandEpsSwitchName,
+              {(uint8_t)PDU::PDU_SW::RPI, 0}),
+      command(PacketComm::TypeId::CommandEpsSwitchStatus,
+              {(uint8_t)PDU::PDU_SW::All}),
+      command(ArtemisTypeId::CommandBeaconPlan, {0}),
+      command(ArtemisTypeId::CommandLogLevel, {0, 2}),
+      command(ArtemisTypeId::CommandProfile, {}),
+      command(ArtemisTypeId::CommandLogQuery, {}),
+  };
+}
+
+/** @brief Add the commands, wrapped as the radio receives them. */
+void seed_wrapped(std::vector<std::string> &corpus) {
+  for (PacketComm &packet : commands()) {
+    packet.Wrap();
+    corpus.emplace_back(packet.wrapped.begin(), packet.wrapped.end());
+  }
+}
+
+/** @brief Add the commands, as SLIP frames from the Raspberry Pi. */
+void seed_slip(std::vector<std::string> &corpus) {
+  for (PacketComm &packet : commands()) {
+    packet.header.chanin = Artemis::Channels::Channel_ID::RPI_CHANNEL;
+    packet.Wrap();
+    packet.SLIPPacketize();
+    corpus.emplace_back(packet.packetized.begin(), packet.packetized.end());
+  }
+}
+
+/** @brief A reply from the PDU, which offsets each byte by '0'. */
+std::string pdu_reply(std::vector<uint8_t> bytes) {
+  std::string reply;
+  for (uint8_t byte : bytes) {
+    reply.push_back((char)(byte + '0'));
+  }
+  return reply;
+}
+
+/** @brief Add the PDU's reply to a ping. */
+void seed_pong(std::vector<std::string> &corpus) {
+  corpus.push_back(pdu_reply({(uint8_t)PDU::PDU_Type::DataPong, 0, 0}));
+}
+
+/** @brief Add the PDU's replies to a switch being set. */
+void seed_switch(std::vector<std::string> &corpus) {
+  corpus.push_back(pdu_reply({(uint8_t)PDU::PDU_Type::DataSwitchStatus,
+                              (uint8_t)PDU::PDU_SW::SW_5V_1, 1}));
+  corpus.push_back(pdu_reply({(uint8_t)PDU::PDU_Type::DataSwitchStatus,
+                              (uint8_t)PDU::PDU_SW::SW_5V_1, 0}));
+}
+
+/** @brief Add the PDU's replies with the state of every switch. */
+void seed_telem(std::vector<std::string> &corpus) {
+  std::vector<uint8_t> off(1 + NUMBER_OF_SWITCHES, 0);
+  std::vector<uint8_t> on(1 + NUMBER_OF_SWITCHES, 1);
+  off[0] = on[0] = (uint8_t)PDU::PDU_Type::DataSwitchTelem;
+  corpus.push_back(pdu_reply(off));
+  corpus.push_back(pdu_reply(on));
+}
+
+/** @brief The targets. */
+const target targets[] = {
+    {"rfm23",
+     [](const uint8_t *data, size_t size) {
+       RH_RF22::inject(data, size < RH_RF22_MAX_MESSAGE_LEN
+                                 ? size
+                                 : RH_RF22_MAX_MESSAGE_LEN);
+       Artemis::Channels::RFM23::receive_from_radio();
+     },
+     seed_wrapped},
+    {"rpi",
+     [](const uint8_t *data, size_t size) {
+       Serial2.inject(data, size);
+       Artemis::Channels::RPI::receive_from_pi();
+     },
+     seed_slip},
+    {"pdu_ping",
+     [](const uint8_t *data, size_t size) {
+       Serial1.inject(data, size);
+       pdu.ping();
+     },
+     seed_pong},
+    {"pdu_switch",
+     [](const uint8_t *data, size_t size) {
+       for (PDU::PDU_SW_State &state : pdu.switch_states) {
+         state = PDU::PDU_SW_State::SWITCH_OFF;
+       }
+       Serial1.inject(data, size);
+       pdu.set_switch(PDU::PDU_SW::SW_5V_1, PDU::PDU_SW_State::SWITCH_ON);
+     },
+     seed_switch},
+    {"pdu_telem",
+     [](const uint8_t *data, size_t size) {
+       Serial1.inject(data, size);
+       pdu.refresh_switch_states();
+     },
+     seed_telem},
+    {"router",
+     [](const uint8_t *data, size_t size) {
+       PacketComm packet;
+       packet.wrapped.assign(data, data + size);
+       if (packet.Unwrap()) {
+         route_packet_to_main(packet);
+         route_packets();
+       }
+     },
+     seed_wrapped},
+};
+
+/** @brief The target being run. */
+const target *selected = nullptr;
+
+/** @brief Find a target by name. */
+const target *find_target(const char *name) {
+  for (const target &t : targets) {
+    if (strcmp(t.name, name) == 0) {
+      return &t;
+    }
+  }
+  return nullptr;
+}
+
+/** @brief Prepare the flight software for the targets, once. */
+void start() {
+  // Debug messages are printed to stderr, so that stdout only has results.
+  Serial.set_echo(stderr);
+  start_virtual_clock(false);
+  Artemis::Channels::RFM23::setup();
+}
+
+/** @brief Empty a queue. */
+void drain(std::deque<PacketComm> &queue, Helpers::RecoverableMutex &mtx) {
+  PacketComm packet;
+  while (PullQueue(packet, queue, mtx)) {
+  }
+}
+
+/** @brief Undo what an input left behind, so the next starts the same. */
+void reset() {
+  drain(main_queue, main_queue_mtx);
+  drain(rfm23_queue, rfm23_queue_mtx);
+  drain(pdu_queue, pdu_queue_mtx);
+  drain(rpi_queue, rpi_queue_mtx);
+  drain(storage_queue, storage_queue_mtx);
+  std::string frame;
+  while (RH_RF22::take_sent(frame)) {
+  }
+  Serial1.clear();
+  Serial1.take_output();
+  Serial2.clear();
+  Serial2.take_output();
+}
+
+/**
+ * @brief Give an input to the selected target.
+ *
+ * @return uint64_t The virtual time, in microseconds, the input took.
+ */
+uint64_t run_input(const uint8_t *data, size_t size) {
+  const uint64_t start_us = virtual_micros();
+  selected->run(data, size);
+  reset();
+  const uint64_t taken_us = virtual_micros() - start_us;
+  if (taken_us > FUZZ_STALL_US) {
+    fprintf(stderr, "fuzz: %s stalled for %llu us on a %zu byte input\n",
+            selected->name, (unsigned long long)taken_us, size);
+    abort();
+  }
+  return taken_us;
+}
+
+/** @brief Stop an input that never returns. */
+void hang(int) {
+  static const char message[] = "fuzz: input did not return\n";
+  write(STDERR_FILENO, message, sizeof(message) - 1);
+  abort();
+}
+
+/** @brief Read a file, or stdin if path is "-". */
+bool read_input(const char *path, std::vector<uint8_t> &input) {
+  FILE *file = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+  if (file == nullptr) {
+    fprintf(stderr, "fuzz: cannot open %s\n", path);
+    return false;
+  }
+  input.resize(FUZZ_MAX_INPUT);
+  input.resize(fread(input.data(), 1, input.size(), file));
+  if (file != stdin) {
+    fclose(file);
+  }
+  return true;
+}
+
+/** @brief Write the corpus of every target to a directory. */
+int seed(const char *dir) {
+  mkdir(dir, 0755);
+  for (const target &t : targets) {
+    const std::string target_dir = std::string(dir) + "/" + t.name;
+    mkdir(target_dir.c_str(), 0755);
+    std::vector<std::string> corpus;
+    t.seed(corpus);
+    for (size_t i = 0; i < corpus.size(); i++) {
+      const std::string path = target_dir + "/" + std::to_string(i) + ".bin";
+      FILE             *file = fopen(path.c_str(), "wb");
+      if (file == nullptr) {
+        fprintf(stderr, "fuzz: cannot write %s\n", path.c_str());
+        return 1;
+      }
+      fwrite(corpus[i].data(), 1, corpus[i].size(), file);
+      fclose(file);
+    }
+  }
+  return 0;
+}
+} // namespace
+
+/**
+ * @brief Run a fuzz target on inputs, or write the corpora to start from.
+ *
+ * Each input is printed as a line of JSON with the real and virtual time it
+ * took. An input that stalls for more than FUZZ_STALL_US of virtual time, or
+ * does not return, aborts the program, so that fuzzers report it as a crash.
+ *
+ * @param argc The number of arguments.
+ * @param argv The name of the target and the files of the inputs, or stdin if
+ * none are given. Otherwise, "seed" and the directory to write the corpora
+ * to, with one directory for each target.
+ * @return int 0 if every input ran, otherwise 1.
+ */
+int fuzz(int argc, char **argv) {
+  if (argc < 1) {
+    fprintf(stderr, "usage: fuzz <target> [inputs...] | fuzz seed <dir>\n");
+    return 1;
+  }
+  if (strcmp(argv[0], "seed") == 0) {
+    if (argc < 2) {
+      fprintf(stderr, "usage: fuzz seed <dir>\n");
+      return 1;
+    }
+    return seed(argv[1]);
+  }
+  selected = find_target(argv[0]);
+  if (selected == nullptr) {
+    fprintf(stderr, "fuzz: unknown target %s\n", argv[0]);
+    return 1;
+  }
+  start();
+  signal(SIGALRM, hang);
+
+  const char *const    stdin_path[] = {"-"};
+  const char *const   *paths = argc >= 2 ? argv + 1 : stdin_path;
+  const int            count = argc >= 2 ? argc - 1 : 1;
+  std::vector<uint8_t> input;
+  for (int i = 0; i < count; i++) {
+    if (!read_input(paths[i], input)) {
+      return 1;
+    }
+    const auto start_time = std::chrono::steady_clock::now();
+    alarm(FUZZ_TIMEOUT_SECONDS);
+    const uint64_t virtual_us = run_input(input.data(), input.size());
+    alarm(0);
+    const auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - start_time)
+                        .count();
+    printf("{\"input\": \"%s\", \"size\": %zu, \"us\": %lld, "
+           "\"virtual_us\": %llu}\n",
+           paths[i], input.size(), (long long)us,
+           (unsigned long long)virtual_us);
+  }
+  return 0;
+}
+} // namespace Native
+
+#ifdef LIBFUZZER
+/** @brief Select the target named by ARTEMIS_FUZZ_TARGET for libFuzzer. */
+extern "C" int LLVMFuzzerInitialize(int *argc, char ***argv) {
+  const char *name = getenv("ARTEMIS_FUZZ_TARGET");
+  Native::selected = Native::find_target(name != nullptr ? name : "router");
+  if (Native::selected == nullptr) {
+    fprintf(stderr, "fuzz: unknown target %s\n", name);
+    abort();
+  }
+  Native::start();
+  return 0;
+}
+
+/** @brief Give an input from libFuzzer to the selected target. */
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  Native::run_input(data, size);
+  return 0;
+}
+#endif
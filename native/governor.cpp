@@ -0,0 +1,81 @@
+/**
+ * @file governor.cpp
+ * @brief The clock governor simulation.
+ *
+ * This file defines a native command that runs the clock governor on a
+ * simulated load trace, and prints the load and clock of each window as
+ * JSON, so that changes to the governor's thresholds can be checked against
+ * the same trace.
+ *
+ * Each line of the trace is one GOVERNOR_WINDOW. It holds the load, in tenths
+ * of a percent, the window's work would take at the highest clock, optionally
+ * followed by `boost` if a boost is requested at its start. Lines starting
+ * with `#` are skipped. For example:
+ * @verbatim
+# idle, then a log query
+20
+20 boost
+600
+@endverbatim
+ */
+#include "native.h"
+#include <clock_governor.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace Native {
+/**
+ * @brief Run the clock governor on a simulated load trace.
+ *
+ * The work of each window is scaled to the clock chosen for it, so a window
+ * run at a lower clock has a higher load, up to 100%. The governor then
+ * chooses the clock of the next window from that load. A boost raises the
+ * clock at the start of its window, as it does in the flight software.
+ *
+ * @param argc The number of arguments.
+ * @param argv The path of the trace.
+ * @return int 0 once the trace has been run, or 1 if it cannot be read.
+ */
+int governor(int argc, char **argv) {
+  if (argc < 1) {
+    fprintf(stderr, "usage: governor <trace>\n");
+    return 1;
+  }
+  FILE *file = fopen(argv[0], "r");
+  if (file == nullptr) {
+    fprintf(stderr, "governor: cannot open %s\n", argv[0]);
+    return 1;
+  }
+  Helpers::ClockGovernor governor;
+  const uint32_t highest = Helpers::governor_frequencies[GOVERNOR_LEVELS - 1];
+  uint32_t       now     = 0;
+  uint32_t       window  = 0;
+  char           line[128];
+  while (fgets(line, sizeof(line), file) != nullptr) {
+    char          *end;
+    const uint32_t work = strtoul(line, &end, 0);
+    if (line[0] == '#' || end == line) {
+      continue;
+    }
+    if (strstr(end, "boost") != nullptr) {
+      Helpers::request_boost(now, GOVERNOR_BOOST_TIME);
+      governor.update(0, now);
+    }
+    const uint32_t frequency = governor.frequency();
+    uint64_t       load      = (uint64_t)work * highest / frequency;
+    if (load > 1000) {
+      load = 1000;
+    }
+    now += GOVERNOR_WINDOW;
+    governor.update(load, now);
+    printf("{\"window\": %u, \"work\": %u, \"clock_mhz\": %u, \"load\": %u, "
+           "\"next_clock_mhz\": %u}\n",
+           window, work, frequency / 1000000, (uint32_t)load,
+           governor.frequency() / 1000000);
+    window++;
+  }
+  fclose(file);
+  return 0;
+}
+} // namespace Native
@@ -0,0 +1,37 @@
+/**
+ * @file heap.cpp
+ * @brief The native build's tracked operator new.
+ *
+ * This file replaces the global operator new and delete, so that the heap
+ * tracker counts allocations on the host as the allocator wrappers do on the
+ * Teensy.
+ */
+#include <heap_track.h>
+#include <new>
+#include <stdlib.h>
+
+void *operator new(size_t size) {
+  void *ptr = Helpers::track_alloc(malloc(size + HEAP_HEADER_SIZE), size);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+  return Helpers::track_alloc(malloc(size + HEAP_HEADER_SIZE), size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &tag) noexcept {
+  return operator new(size, tag);
+}
+
+void operator delete(void *ptr) noexcept { free(Helpers::track_free(ptr)); }
+
+void operator delete[](void *ptr) noexcept { operator delete(ptr); }
+
+void operator delete(void *ptr, size_t) noexcept { operator delete(ptr); }
+
+void operator delete[](void *ptr, size_t) noexcept { operator delete(ptr); }
@@ -0,0 +1,36 @@
+/**
+ * @file native.h
+ * @brief The header file for the native build's host commands.
+ *
+ * This file contains declarations of the commands the native build runs in
+ * place of the flight software, selected by its first argument, for example:
+ * @verbatim
+.pio/build/native/program bench
+@endverbatim
+ *
+ * It also declares the virtual clock, which replaces the host's clock when a
+ * trace is replayed.
+ */
+#ifndef _NATIVE_H
+#define _NATIVE_H
+
+#include <stdint.h>
+
+/** @brief Host commands of the native build. */
+namespace Native {
+int      bench(int argc, char **argv);
+int      replay(int argc, char **argv);
+int      fuzz(int argc, char **argv);
+int      governor(int argc, char **argv);
+
+bool     virtual_clock();
+void     start_virtual_clock(bool schedule = true);
+uint64_t virtual_micros();
+void     virtual_sleep(uint64_t us);
+uint64_t add_virtual_thread();
+void     enter_virtual_thread(uint64_t turn);
+void     exit_virtual_thread();
+bool     run_virtual_thread(uint64_t until_us);
+} // namespace Native
+
+#endif // _NATIVE_H
@@ -0,0 +1,210 @@
+/**
+ * @file replay.cpp
+ * @brief The packet trace replay.
+ *
+ * This file defines a native command that runs the flight software on the
+ * virtual clock, and gives it the frames of a packet trace at the times they
+ * were received. Every frame given and every frame sent is printed as a line
+ * of JSON with its virtual time, so a run can be reproduced exactly, and the
+ * latency of each reply measured the same way every time.
+ */
+#include "native.h"
+#include <Arduino.h>
+#include <RH_RF22.h>
+#include <packet_trace.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace Native {
+namespace {
+/** @brief The virtual time, in seconds, run after the last frame. */
+const uint64_t REPLAY_TAIL_SECONDS = 10;
+
+/** @brief The virtual time, in microseconds, of the last frame given. */
+uint64_t       last_ingress_us     = 0;
+/** @brief Whether a frame has been given. */
+bool           ingress             = false;
+
+/** @brief The name printed for a source. */
+const char    *source_name(Helpers::TraceSource source) {
+  switch (source) {
+    case Helpers::TraceSource::RFM23:
+      return "rfm23";
+    case Helpers::TraceSource::PDU:
+      return "pdu";
+    case Helpers::TraceSource::RPI:
+      return "rpi";
+    default:
+      return "unknown";
+  }
+}
+
+/**
+ * @brief Print a frame given to or sent by the flight software.
+ *
+ * Frames sent are printed with the virtual time since the last frame given.
+ */
+void print_frame(const char *event, Helpers::TraceSource source,
+                 const uint8_t *frame, size_t size) {
+  printf("{\"time_us\": %llu, \"event\": \"%s\", \"source\": \"%s\", "
+         "\"size\": %zu",
+         (unsigned long long)virtual_micros(), event, source_name(source),
+         size);
+  if (ingress && strcmp(event, "out") == 0) {
+    printf(", \"latency_us\": %llu",
+           (unsigned long long)(virtual_micros() - last_ingress_us));
+  }
+  printf(", \"bytes\": \"");
+  for (size_t i = 0; i < size; i++) {
+    printf("%02x", frame[i]);
+  }
+  printf("\"}\n");
+}
+
+/** @brief Print every frame sent since the last call. */
+void print_egress() {
+  std::string frame;
+  while (RH_RF22::take_sent(frame)) {
+    print_frame("out", Helpers::TraceSource::RFM23,
+                (const uint8_t *)frame.data(), frame.size());
+  }
+  frame = Serial1.take_output();
+  if (!frame.empty()) {
+    print_frame("out", Helpers::TraceSource::PDU,
+                (const uint8_t *)frame.data(), frame.size());
+  }
+  frame = Serial2.take_output();
+  if (!frame.empty()) {
+    print_frame("out", Helpers::TraceSource::RPI,
+                (const uint8_t *)frame.data(), frame.size());
+  }
+}
+
+/** @brief Give a frame to the flight software where it was received. */
+void deliver(const Helpers::trace_record_header &header,
+             const uint8_t                      *frame) {
+  switch (header.source) {
+    case Helpers::TraceSource::RFM23:
+      RH_RF22::inject(frame, header.size);
+      break;
+    case Helpers::TraceSource::PDU:
+      Serial1.inject(frame, header.size);
+      break;
+    case Helpers::TraceSource::RPI:
+      Serial2.inject(frame, header.size);
+      break;
+    case Helpers::TraceSource::Dropped:
+      fprintf(stderr, "replay: frames are missing from the trace before %llu "
+                      "us\n",
+              (unsigned long long)header.time_us);
+      return;
+    default:
+      return;
+  }
+  last_ingress_us = virtual_micros();
+  ingress         = true;
+  print_frame("in", header.source, frame, header.size);
+}
+
+/** @brief Run the flight software until the virtual time. */
+void run_until(uint64_t until_us) {
+  while (run_virtual_thread(until_us)) {
+    print_egress();
+  }
+}
+
+/** @brief Run the flight software as the Teensy's core does. */
+void run_flight_software() {
+  setup();
+  for (;;) {
+    loop();
+  }
+}
+} // namespace
+
+/**
+ * @brief Replay a packet trace through the flight software.
+ *
+ * A trace file holds the frames of every startup recorded. The frames of one
+ * startup are given to the flight software, which is started at the same
+ * time on the virtual clock, then it is run for a while longer so that the
+ * last frame can be answered.
+ *
+ * @param argc The number of arguments.
+ * @param argv The path of the trace, the index of the startup to replay, 0 by
+ * default, and the virtual seconds to run after the last frame.
+ * @return int 1 if the trace cannot be replayed. Otherwise, this does not
+ * return, and the program exits with 0.
+ */
+int replay(int argc, char **argv) {
+  if (argc < 1) {
+    fprintf(stderr, "usage: replay <trace> [startup] [seconds after]\n");
+    return 1;
+  }
+  const uint32_t startup = argc >= 2 ? strtoul(argv[1], nullptr, 0) : 0;
+  const uint64_t tail_us =
+      (argc >= 3 ? strtoull(argv[2], nullptr, 0) : REPLAY_TAIL_SECONDS) *
+      1000000;
+
+  std::vector<uint8_t> trace;
+  FILE                *file = fopen(argv[0], "rb");
+  if (file == nullptr) {
+    fprintf(stderr, "replay: cannot open %s\n", argv[0]);
+    return 1;
+  }
+  uint8_t buffer[4096];
+  size_t  size;
+  while ((size = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    trace.insert(trace.end(), buffer, buffer + size);
+  }
+  fclose(file);
+
+  Helpers::TraceReader reader(trace.data(), trace.size());
+  if (!reader.valid()) {
+    fprintf(stderr, "replay: %s is not a packet trace\n", argv[0]);
+    return 1;
+  }
+  Helpers::trace_record_header header;
+  const uint8_t               *frame;
+  uint32_t                     startups = 0;
+  bool                         found    = false;
+  while (!found && reader.next(header, frame)) {
+    found = header.source == Helpers::TraceSource::Startup &&
+            startups++ == startup;
+  }
+  if (!found) {
+    fprintf(stderr, "replay: %s has %u startups\n", argv[0],
+            (unsigned)startups);
+    return 1;
+  }
+
+  // Debug messages are printed to stderr, so that stdout only has frames.
+  Serial.set_echo(stderr);
+  start_virtual_clock();
+  const uint64_t turn = add_virtual_thread();
+  std::thread([turn]() {
+    enter_virtual_thread(turn);
+    run_flight_software();
+  }).detach();
+
+  uint64_t end_us = 0;
+  while (reader.next(header, frame) &&
+         header.source != Helpers::TraceSource::Startup) {
+    run_until(header.time_us);
+    deliver(header, frame);
+    end_us = header.time_us;
+  }
+  run_until(end_us + tail_us);
+
+  // The flight software's threads never return, so the program ends without
+  // destroying the objects they are still using.
+  fflush(stdout);
+  fflush(stderr);
+  _exit(0);
+}
+} // namespace Native
@@ -0,0 +1,182 @@
+/**
+ * @file virtual_clock.cpp
+ * @brief The virtual clock of the native build.
+ *
+ * When the virtual clock is started, time only passes when every thread of
+ * the flight software is asleep, and the threads run one at a time: the one
+ * due to wake first runs until it sleeps again, then the next. Ties are
+ * broken by the order in which the threads went to sleep. The flight
+ * software therefore runs the same way every time it is given the same
+ * input, however the host schedules its threads.
+ *
+ * The threads are woken by the host program, which calls run_virtual_thread()
+ * until the virtual time reaches the next event it wants to deliver.
+ *
+ * The clock can also be started without a scheduler, for a host program that
+ * calls the flight software's functions directly on one thread. Sleeping then
+ * only moves the virtual time forward, and no threads can be started.
+ */
+#include "native.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+
+namespace Native {
+namespace {
+/** @brief A thread waiting for its turn to run. */
+struct sleeper {
+  /** @brief The virtual time, in microseconds, the thread is due to wake. */
+  uint64_t wake_us;
+  /** @brief The turn given to the thread when it went to sleep. */
+  uint64_t turn;
+
+  bool     operator<(const sleeper &other) const {
+    return wake_us != other.wake_us ? wake_us < other.wake_us
+                                        : turn < other.turn;
+  }
+};
+
+/** @brief Whether the virtual clock has been started. */
+std::atomic<bool>       started{false};
+/** @brief Whether threads are scheduled, rather than sleeping instantly. */
+bool                    scheduled = true;
+/** @brief Guards the state of the virtual clock. */
+std::mutex              clock_mtx;
+/** @brief Signalled when a thread sleeps, wakes or exits. */
+std::condition_variable clock_cv;
+/** @brief The virtual time, in microseconds. */
+uint64_t                now_us    = 0;
+/** @brief The turn given to the next thread to sleep. */
+uint64_t                next_turn = 1;
+/** @brief The turn of the thread allowed to run. */
+uint64_t                running   = 0;
+/** @brief Whether a thread is running. */
+bool                    busy      = false;
+/** @brief The threads waiting for their turn, in the order they will run. */
+std::set<sleeper>       sleepers;
+
+/**
+ * @brief Wait for a turn to run.
+ *
+ * @param lock The lock on clock_mtx.
+ * @param turn The turn.
+ */
+void wait_turn(std::unique_lock<std::mutex> &lock, uint64_t turn) {
+  clock_cv.wait(lock, [turn]() { return running == turn; });
+}
+} // namespace
+
+/**
+ * @brief Whether the virtual clock has been started.
+ *
+ * @return true Time is kept by the virtual clock.
+ * @return false Time is kept by the host's clock.
+ */
+bool virtual_clock() { return started; }
+
+/**
+ * @brief Start the virtual clock at 0, before any thread is started.
+ *
+ * @param schedule Whether to schedule threads, or to only move the virtual
+ * time forward when the calling thread sleeps.
+ */
+void start_virtual_clock(bool schedule) {
+  scheduled = schedule;
+  started   = true;
+}
+
+/**
+ * @brief The virtual time.
+ *
+ * @return uint64_t The time, in microseconds since the clock started.
+ */
+uint64_t virtual_micros() {
+  std::lock_guard<std::mutex> lock(clock_mtx);
+  return now_us;
+}
+
+/**
+ * @brief Sleep until the virtual time has passed, and it is this thread's
+ * turn.
+ *
+ * @param us The time to sleep, in microseconds.
+ */
+void virtual_sleep(uint64_t us) {
+  std::unique_lock<std::mutex> lock(clock_mtx);
+  if (!scheduled) {
+    now_us += us;
+    return;
+  }
+  const uint64_t turn = next_turn++;
+  sleepers.insert({now_us + us, turn});
+  busy = false;
+  clock_cv.notify_all();
+  wait_turn(lock, turn);
+}
+
+/**
+ * @brief Add a thread, which waits for its first turn at the current time.
+ *
+ * This is called by the thread starting it, so that the new thread's turn
+ * does not depend on when the host starts it.
+ *
+ * @return uint64_t The turn the new thread must pass to
+ * enter_virtual_thread(), or 0 if threads are not scheduled.
+ */
+uint64_t add_virtual_thread() {
+  std::lock_guard<std::mutex> lock(clock_mtx);
+  if (!scheduled) {
+    return 0;
+  }
+  const uint64_t turn = next_turn++;
+  sleepers.insert({now_us, turn});
+  return turn;
+}
+
+/**
+ * @brief Wait for the first turn of a thread added by add_virtual_thread().
+ *
+ * @param turn The thread's turn.
+ */
+void enter_virtual_thread(uint64_t turn) {
+  std::unique_lock<std::mutex> lock(clock_mtx);
+  wait_turn(lock, turn);
+}
+
+/** @brief End the turn of a thread that is exiting. */
+void exit_virtual_thread() {
+  std::lock_guard<std::mutex> lock(clock_mtx);
+  busy = false;
+  clock_cv.notify_all();
+}
+
+/**
+ * @brief Run the next thread due to wake, until it sleeps or exits.
+ *
+ * @param until_us The latest virtual time, in microseconds, at which a thread
+ * may be woken.
+ * @return true A thread ran.
+ * @return false No thread is due by until_us, and the virtual time is now
+ * until_us.
+ */
+bool run_virtual_thread(uint64_t until_us) {
+  std::unique_lock<std::mutex> lock(clock_mtx);
+  if (sleepers.empty() || sleepers.begin()->wake_us > until_us) {
+    if (until_us > now_us) {
+      now_us = until_us;
+    }
+    return false;
+  }
+  const sleeper next = *sleepers.begin();
+  sleepers.erase(sleepers.begin());
+  if (next.wake_us > now_us) {
+    now_us = next.wake_us;
+  }
+  running = next.turn;
+  busy    = true;
+  clock_cv.notify_all();
+  clock_cv.wait(lock, []() { return !busy; });
+  return true;
+}
+} // namespace Native
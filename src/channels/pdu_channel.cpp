@@ -9,6 +9,7 @@
 #include "channels/artemis_channels.h"
 #include <SD.h>
 #include <pdu.h>
+#include <supervisor.h>
 
 namespace Artemis {
 namespace Channels {
@@ -55,13 +56,13 @@ namespace Channels {
       // Ensure PDU is communicating with Teensy
       while (!pdu.ping()) {
         print_debug(Helpers::PDU, "Unable to ping PDU");
-        threads.delay(PDU_RETRY_INTERVAL);
+        threads.delay(Parameters::get(Parameters::PduRetryInterval));
       }
       print_debug(Helpers::PDU, "PDU connection established");
 
       while (!pdu.refresh_switch_states()) {
         print_debug(Helpers::PDU, "Unable to refresh PDU switch states");
-        threads.delay(PDU_RETRY_INTERVAL);
+        threads.delay(Parameters::get(Parameters::PduRetryInterval));
       }
       print_debug(Helpers::PDU, "PDU switch states refreshed");
       threads.delay(100);
@@ -89,22 +90,26 @@ namespace Channels {
     /**
      * @brief Deployment sequence.
      *
-     * @todo SD is begun twice. is this needed?
-     *
      * @todo try storing burnwire complete and deployment separately.
      * deployed.txt should only be written after DEPLOYMENT_LENGTH.
      */
     void deploy() {
-      if (SD.begin(BUILTIN_SDCARD)) {
-        if (!SD.exists("/deployed.txt")) {
-          deploymentmode = true;
-          threads.delay(DEPLOYMENT_DELAY);
+      bool deployed;
+      {
+        Helpers::MutexScope lock(sd_mtx);
+        deployed = !sdcardready || SD.exists("/deployed.txt");
+      }
+      if (!deployed) {
+        deploymentmode = true;
+        Helpers::heartbeat(Channel_ID::PDU_CHANNEL);
+        threads.delay(DEPLOYMENT_DELAY);
 
-          print_debug(Helpers::PDU, "Starting Deployment Sequence");
-          deploy_burn_wire();
+        print_debug(Helpers::PDU, "Starting Deployment Sequence");
+        deploy_burn_wire();
 
-          SD.begin(BUILTIN_SDCARD);
-          File file = SD.open("/deployed.txt", FILE_WRITE);
+        {
+          Helpers::MutexScope lock(sd_mtx);
+          File           file = SD.open("/deployed.txt", FILE_WRITE);
           if (file) {
             file.close();
             print_debug(Helpers::PDU, "Deployment recorded on SD card.");
@@ -112,16 +117,17 @@ namespace Channels {
             print_debug(Helpers::PDU, "Error opening file");
             return;
           }
+        }
 
-          elapsedMillis timeElapsed;
-          while (timeElapsed <= DEPLOYMENT_LENGTH) {
-            handle_queue();
-            regulate_temperature();
-            threads.delay(DEPLOYMENT_LOOP_INTERVAL);
-          }
-        } else {
-          print_debug(Helpers::PDU, "Satellite was already deployed");
+        elapsedMillis timeElapsed;
+        while (timeElapsed <= DEPLOYMENT_LENGTH) {
+          handle_queue();
+          regulate_temperature();
+          Helpers::heartbeat(Channel_ID::PDU_CHANNEL);
+          threads.delay(DEPLOYMENT_LOOP_INTERVAL);
         }
+      } else if (sdcardready) {
+        print_debug(Helpers::PDU, "Satellite was already deployed");
       }
       deploymentmode = false;
     }
@@ -150,6 +156,7 @@ namespace Channels {
         handle_queue();
         regulate_temperature();
         update_watchdog_timer();
+        Helpers::heartbeat(Channel_ID::PDU_CHANNEL);
         threads.delay(100);
       }
     }
@@ -186,14 +193,18 @@ namespace Channels {
     void test_communicating_with_pdu() {
       startTime = millis();
       while (!pdu.ping() &&
-             (millis() - startTime) < PDU_COMMUNICATION_TIMEOUT) {
+             (millis() - startTime) <
+                 Parameters::get(Parameters::PduCommunicationTimeout)) {
         print_debug_rapid(Helpers::PDU,
                           "Failed to ping PDU. Waiting to retry.");
-        threads.delay(PDU_RETRY_INTERVAL);
+        threads.delay(Parameters::get(Parameters::PduRetryInterval));
       }
-      if ((millis() - startTime) >= PDU_COMMUNICATION_TIMEOUT) {
+      if ((millis() - startTime) >=
+          Parameters::get(Parameters::PduCommunicationTimeout)) {
         print_debug(Helpers::PDU, "Timed out trying to ping PDU");
+        complete_command(packet, Commands::AckResult::Timeout);
       } else {
+        complete_command(packet, Commands::AckResult::Ok);
         packet.header.nodedest = packet.header.nodeorig;
         packet.header.nodeorig = (uint8_t)NODES::TEENSY_NODE_ID;
         route_packet_to_main(packet);
@@ -202,35 +213,59 @@ namespace Channels {
 
     /** @brief Helper function to set a switch on the PDU. */
     void set_switch_on_pdu() {
+      if (packet.data.size() < 2) {
+        print_debug(Helpers::PDU, "Switch command too short");
+        complete_command(packet, Commands::AckResult::BadLength);
+        return;
+      }
       PDU::PDU_SW       switchID    = (PDU::PDU_SW)packet.data[0];
-      PDU::PDU_SW_State switchState = (PDU::PDU_SW_State)packet.data[1];
+      PDU::PDU_SW_State switchState = packet.data[1] != 0
+                                          ? PDU::PDU_SW_State::SWITCH_ON
+                                          : PDU::PDU_SW_State::SWITCH_OFF;
 
       startTime                     = millis();
       while (!pdu.set_switch(switchID, switchState) &&
-             (millis() - startTime) < PDU_COMMUNICATION_TIMEOUT) {
+             (millis() - startTime) <
+                 Parameters::get(Parameters::PduCommunicationTimeout)) {
         print_debug_rapid(Helpers::PDU,
                           "Failed to set switch on PDU. Waiting to retry.");
-        threads.delay(PDU_RETRY_INTERVAL);
+        threads.delay(Parameters::get(Parameters::PduRetryInterval));
       }
-      if ((millis() - startTime) >= PDU_COMMUNICATION_TIMEOUT) {
+      if ((millis() - startTime) >=
+          Parameters::get(Parameters::PduCommunicationTimeout)) {
         print_debug(Helpers::PDU, "Timed out trying to set switch");
+        complete_command(packet, Commands::AckResult::Timeout);
+      } else {
+        complete_command(packet, Commands::AckResult::Ok);
       }
     }
 
-    /** @brief Helper function to report status of all switches on PDU. */
+    /**
+     * @brief Helper function to report status of all switches on PDU.
+     *
+     * This also follows a switch command, which has been completed by then.
+     */
     void report_pdu_switch_status() {
       startTime = millis();
       while (!pdu.refresh_switch_states() &&
-             (millis() - startTime) < PDU_COMMUNICATION_TIMEOUT) {
+             (millis() - startTime) <
+                 Parameters::get(Parameters::PduCommunicationTimeout)) {
         print_debug_rapid(
             Helpers::PDU,
             "Failed to refresh PDU switch states. Waiting to retry.");
-        threads.delay(PDU_RETRY_INTERVAL);
+        threads.delay(Parameters::get(Parameters::PduRetryInterval));
       }
-      if ((millis() - startTime) >= PDU_COMMUNICATION_TIMEOUT) {
+      if ((millis() - startTime) >=
+          Parameters::get(Parameters::PduCommunicationTimeout)) {
         print_debug(Helpers::PDU,
                     "Timed out trying to refresh PDU switch states");
+        if (packet.header.type == PacketComm::TypeId::CommandEpsSwitchStatus) {
+          complete_command(packet, Commands::AckResult::Timeout);
+        }
       } else {
+        if (packet.header.type == PacketComm::TypeId::CommandEpsSwitchStatus) {
+          complete_command(packet, Commands::AckResult::Ok);
+        }
         Devices::Switches::switchbeacon beacon;
         beacon.deci = uptime;
         for (int i = 0; i < NUMBER_OF_SWITCHES; i++) {
@@ -247,18 +282,19 @@ namespace Channels {
         memcpy(packet.data.data(), &beacon, sizeof(beacon));
 
         route_packet_to_main(packet);
+        STORAGE::store_beacon(packet);
       }
     }
 
     /** @brief Helper function to regulate the satellite's temperature. */
     void regulate_temperature() {
-      if (heaterinterval > HEATER_CHECK_INTERVAL) {
+      if (heaterinterval > Parameters::get(Parameters::HeaterCheckInterval)) {
         heaterinterval     = 0;
         int   reading      = analogRead(A6);
         float voltage      = reading * MV_PER_ADC_UNIT;
         float temperatureF = (voltage - OFFSET_F) / MV_PER_DEGREE_F;
         float temperatureC = (temperatureF - 32) * 5 / 9;
-        if (temperatureC <= heater_threshold) {
+        if (temperatureC <= Parameters::get(Parameters::HeaterThreshold)) {
           pdu.set_heater(PDU::PDU_SW_State::SWITCH_ON);
           print_debug(Helpers::PDU, "Heater turned on");
         } else {
@@ -6,6 +6,7 @@
  */
 #include "channels/artemis_channels.h"
 #include <rfm23.h>
+#include <supervisor.h>
 
 namespace Artemis {
 namespace Channels {
@@ -48,11 +49,17 @@ namespace Channels {
      * @brief The RFM23 setup function.
      *
      * This function is run once, when the channel is started. It connects to
-     * the RFM23 over a SPI connection.
+     * the RFM23 over a SPI connection, on the frequency last given to
+     * set_frequency().
      */
     void setup() {
       print_debug(Helpers::RFM23, "RFM23 channel starting...");
+      config.tx_power = Parameters::get(Parameters::RadioTxPower);
+      // The channel counts a heartbeat between tries, so that it is only
+      // restarted if a try hangs.
       while (!radio.init(config, &spi1_mtx)) {
+        Helpers::heartbeat(Channel_ID::RFM23_CHANNEL);
+        threads.delay(RFM23_INIT_RETRY_INTERVAL);
       }
     }
 
@@ -66,6 +73,8 @@ namespace Channels {
       while (true) {
         receive_from_radio();
         handle_queue();
+        update_tx_power();
+        Helpers::heartbeat(Channel_ID::RFM23_CHANNEL);
         threads.delay(10);
       }
     }
@@ -94,15 +103,28 @@ namespace Channels {
      */
     void handle_queue() {
       if (PullQueue(packet, rfm23_queue, rfm23_queue_mtx)) {
-        switch (packet.header.type) {
+        switch ((uint16_t)packet.header.type) {
           print_debug(Helpers::RFM23, "Pulled packet of type ",
                       (uint16_t)packet.header.type, " from queue.");
-          case PacketComm::TypeId::DataObcBeacon:
-          case PacketComm::TypeId::DataObcPong:
-          case PacketComm::TypeId::DataEpsResponse:
-          case PacketComm::TypeId::DataRadioResponse:
-          case PacketComm::TypeId::DataAdcsResponse:
-          case PacketComm::TypeId::DataObcResponse: {
+          case (uint16_t)PacketComm::TypeId::DataObcBeacon:
+          case (uint16_t)PacketComm::TypeId::DataObcPong:
+          case (uint16_t)PacketComm::TypeId::DataEpsResponse:
+          case (uint16_t)PacketComm::TypeId::DataRadioResponse:
+          case (uint16_t)PacketComm::TypeId::DataAdcsResponse:
+          case (uint16_t)PacketComm::TypeId::DataObcResponse:
+          case (uint16_t)ArtemisTypeId::DataLogRecord:
+          case (uint16_t)ArtemisTypeId::DataLogPage:
+          case (uint16_t)ArtemisTypeId::DataLogFragment:
+          case (uint16_t)ArtemisTypeId::DataBeaconPlan:
+          case (uint16_t)ArtemisTypeId::DataLogLevels:
+          case (uint16_t)ArtemisTypeId::DataProfile:
+          case (uint16_t)ArtemisTypeId::DataSchedule:
+          case (uint16_t)ArtemisTypeId::DataLogTime:
+          case (uint16_t)ArtemisTypeId::DataSequence:
+          case (uint16_t)ArtemisTypeId::DataCommandAck:
+          case (uint16_t)ArtemisTypeId::DataAckBitmap:
+          case (uint16_t)ArtemisTypeId::DataParameter:
+          case (uint16_t)ArtemisTypeId::DataFirmware: {
             if (!radio.send(packet)) {
               print_debug(
                   Helpers::RFM23,
@@ -119,6 +141,30 @@ namespace Channels {
         }
       }
     }
+
+    /**
+     * @brief Helper function to apply a change of the transmit power
+     * parameter.
+     *
+     * The frequency is only applied when the channel starts.
+     */
+    void update_tx_power() {
+      const uint8_t power = Parameters::get(Parameters::RadioTxPower);
+      if (power != config.tx_power) {
+        config.tx_power = power;
+        radio.set_tx_power(power);
+      }
+    }
+
+    /**
+     * @brief Set the frequency the radio is started on.
+     *
+     * The frequency is only read by setup(), so the channel is stopped while
+     * it is changed, and started again to apply it.
+     *
+     * @param frequency The frequency, in MHz.
+     */
+    void set_frequency(uint16_t frequency) { config.freq = frequency; }
   } // namespace RFM23
 } // namespace Channels
 } // namespace Artemis
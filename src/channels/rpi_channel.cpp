@@ -6,6 +6,8 @@
  */
 #include "channels/artemis_channels.h"
 #include <pdu.h>
+#include <profiler.h>
+#include <supervisor.h>
 
 namespace Artemis {
 namespace Channels {
@@ -64,6 +66,7 @@ namespace Channels {
         }
         receive_from_pi();
         handle_queue();
+        Helpers::heartbeat(Channel_ID::RPI_CHANNEL);
         threads.delay(100);
       }
     }
@@ -89,34 +92,39 @@ namespace Channels {
         uint8_t inChar = Serial2.read();
         // If it is our magic character,
         if(inChar == 0xC0){
-          // Create a large buffer for the incoming packet.
-          uint8_t readBuffer[2048];
-          // Clear the buffer.
-          memset(readBuffer, 0, sizeof(readBuffer));
+          // Make room in the packet's packetized vector for a large packet.
+          // The bytes are read straight into the vector, rather than into a
+          // buffer on this channel's stack, which would need another 2 KB.
+          packet.packetized.resize(2048);
           // Read the packet's bytes in from the serial connection.
           // Note that this reads everything between the start and end flags 
           // (each of which are 0xC0), but does not include those flags.
-          // Therefore, write these incoming bytes to the buffer starting from 
-          // the *second* position in the array (index 1), and cap the maximum
-          // number of bytes to read to be the size of the buffer plus both 
-          // flags.
-          size_t readBytes = Serial2.readBytesUntil((SLIP_FEND), &readBuffer[1], (size_t)2046);
-          // Resize the packetized copy of the packet to be the number of bytes 
-          // read in, plus the start and end flags.
-          packet.packetized.resize(readBytes + 2);
+          // Therefore, write these incoming bytes to the vector starting from 
+          // the *second* position (index 1), and cap the maximum number of
+          // bytes to read to be the size of the vector less both flags.
+          size_t readBytes = Serial2.readBytesUntil((SLIP_FEND), &packet.packetized[1], (size_t)2046);
           // Manually add the start...
-          readBuffer[0] = 0xC0;
-          // ...and end flags to the buffer at the appropriate places, "capping
-          // off" the received data.
-          readBuffer[readBytes + 1] = 0xC0;
-          // Copy the packet in the buffer to the actual packet, in the 
-          // packetized vector for further processing.
-          memcpy(packet.packetized.data(), &readBuffer[0], readBytes + 2);
+          packet.packetized[0] = 0xC0;
+          // ...and end flags to the vector at the appropriate places,
+          // "capping off" the received data.
+          packet.packetized[readBytes + 1] = 0xC0;
+          // Shrink the packetized vector to the number of bytes read in, plus
+          // the start and end flags, for further processing.
+          packet.packetized.resize(readBytes + 2);
+          Helpers::trace_ingress(Helpers::TraceSource::RPI,
+                                 packet.packetized.data(),
+                                 packet.packetized.size());
           
           // Invoke the micro-cosmos SLIPUnPacketize. This assumes that the 
           // packet's packetized vector has the start and end flags, as well as 
           // a CRC checksum at the end.
-          if(!packet.SLIPUnPacketize()){
+          bool unpacketized;
+          {
+            Helpers::ProfileScope profile(
+                Helpers::ProfileZone::SLIPUnPacketize);
+            unpacketized = packet.SLIPUnPacketize();
+          }
+          if(!unpacketized){
             print_debug(Helpers::RPI, "Failed to SLIP unpacketize incoming packet");
             return;
           }
@@ -148,7 +156,8 @@ namespace Channels {
                     (uint16_t)packet.header.type, " from Raspberry Pi queue.");
         switch (packet.header.type) {
           case PacketComm::TypeId::CommandEpsSwitchName: {
-            if ((PDU::PDU_SW)packet.data[0] == PDU::PDU_SW::RPI &&
+            if (packet.data.size() >= 2 &&
+                (PDU::PDU_SW)packet.data[0] == PDU::PDU_SW::RPI &&
                 packet.data[1] == 0) {
               shut_down_pi();
             }
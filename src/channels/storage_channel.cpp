@@ -0,0 +1,776 @@
+/**
+ * @file storage_channel.cpp
+ * @brief The storage channel.
+ *
+ * The definition of the storage channel.
+ */
+#include "artemisbeacons.h"
+#include "channels/artemis_channels.h"
+#include "helpers.h"
+#include <SD.h>
+#include <clock_governor.h>
+#include <firmware_stage.h>
+#include <log_query.h>
+#include <supervisor.h>
+#include <telemetry_log.h>
+#ifdef TELEMETRY_ARCHIVE
+#include <telemetry_archive.h>
+#endif
+
+namespace Artemis {
+namespace Channels {
+  /** @brief The storage channel. */
+  namespace STORAGE {
+    using Artemis::Storage::firmware_status;
+    using Artemis::Storage::FirmwareAction;
+    using Artemis::Storage::FirmwareStage;
+    using Artemis::Storage::FirmwareState;
+#if !defined(__IMXRT1062__)
+    using Artemis::Storage::DeviceTarget;
+#endif
+    using Artemis::Storage::log_page;
+    using Artemis::Storage::log_query;
+    using Artemis::Storage::LogQuery;
+    using Artemis::Storage::SDBlockDevice;
+    using Artemis::Storage::StageResult;
+    using Artemis::Storage::TelemetryLog;
+#ifdef TELEMETRY_ARCHIVE
+    using Artemis::Storage::archive_header;
+    using Artemis::Storage::ArchiveEncoder;
+#endif
+#define BEACON_SCHEMA_TYPE(id, type, name, fields)                             \
+  static_assert(id < 8 * sizeof(log_query::type_mask),                         \
+                #type " has no bit in the log query mask");
+#define BEACON_SCHEMA_COMPACT_TYPE(id, type, name, source, fields)             \
+  BEACON_SCHEMA_TYPE(id, type, name, fields)
+    ARTEMIS_BEACONS(BEACON_SCHEMA_TYPE)
+    ARTEMIS_COMPACT_BEACONS(BEACON_SCHEMA_COMPACT_TYPE)
+#undef BEACON_SCHEMA_COMPACT_TYPE
+#undef BEACON_SCHEMA_TYPE
+    /** @brief The packet used throughout the channel. */
+    PacketComm     packet;
+    /** @brief The file holding the telemetry log's records. */
+    SDBlockDevice  log_data;
+    /** @brief The file holding the telemetry log's time index. */
+    SDBlockDevice  log_index;
+    /** @brief The telemetry log on the SD card. */
+    TelemetryLog   telemetry_log(&log_data, &log_index);
+    /** @brief The mutex for the telemetry log. */
+    Helpers::RecoverableMutex log_mtx;
+    /** @brief The log query being streamed to the ground. */
+    LogQuery       query(&telemetry_log);
+    /** @brief The query as received, used for the time of each record. */
+    log_query      query_command;
+    /** @brief The node that sent the log query being streamed. */
+    uint8_t        query_node         = (uint8_t)NODES::GROUND_NODE_ID;
+    /** @brief The time of the record being sent in fragments. */
+    uint32_t       fragment_timestamp = 0;
+    /** @brief The length of the record being sent in fragments. */
+    uint16_t       fragment_length    = 0;
+    /** @brief The payload of the record being sent in fragments. */
+    uint8_t        fragment_payload[TELEMETRY_LOG_MAX_PAYLOAD];
+    /** @brief The index of the next fragment to be sent. */
+    uint8_t        fragment_index     = 0;
+    /** @brief The number of fragments in the record being sent. */
+    uint8_t        fragment_count     = 0;
+    /** @brief The file holding the firmware staging area. */
+    SDBlockDevice  firmware_file;
+    /** @brief The firmware image being uploaded. */
+    FirmwareStage  firmware(&firmware_file);
+#if !defined(__IMXRT1062__)
+    /** @brief The file firmware images are installed to. */
+    SDBlockDevice  install_file;
+    /** @brief Where firmware images are installed. */
+    DeviceTarget   firmware_target(&install_file);
+#endif
+    /** @brief The time in milliseconds since the image was activated. */
+    elapsedMillis  installtime;
+#ifdef TELEMETRY_ARCHIVE
+    /** @brief The encoder compressing beacons into archive blocks. */
+    ArchiveEncoder archive;
+    /** @brief The time in milliseconds since the archive was fully flushed. */
+    elapsedMillis  archivetime;
+#endif
+#ifdef PACKET_TRACE
+    /** @brief The file the packet trace is written to. */
+    File           trace_file;
+    /** @brief The time in milliseconds since the trace was written out. */
+    elapsedMillis  traceinterval;
+#endif
+    /**
+     * @brief The log time, in seconds, at which the Teensy was started.
+     *
+     * Log time continues from the newest record in the log, so it keeps
+     * increasing across resets, and is only ever moved forward.
+     */
+    uint32_t       log_epoch     = 0;
+    /** @brief Whether the ground has set the log time since startup. */
+    bool           log_time_set  = false;
+    /** @brief The time in milliseconds since the Teensy was started. */
+    uint64_t       uptime_ms     = 0;
+    /** @brief The value of millis() when uptime_ms was last updated. */
+    uint32_t       last_millis   = 0;
+    /** @brief The time in milliseconds since the log was last flushed. */
+    elapsedMillis  flushinterval;
+    /** @brief The time in milliseconds since the log was fully written out. */
+    elapsedMillis  buffertime;
+
+    uint32_t       log_time();
+
+    /**
+     * @brief The top-level channel definition.
+     *
+     * This is the function that defines the storage channel. Like an Arduino
+     * script, it has a setup() function that is run once, then loop() runs
+     * forever.
+     */
+    void           storage_channel() {
+      setup();
+      loop();
+    }
+
+    /**
+     * @brief The storage setup function.
+     *
+     * This function is run once, when the channel is started. It opens the
+     * telemetry log on the SD card and recovers any record left partially
+     * written by a reset.
+     */
+    void setup() {
+      print_debug(Helpers::STORAGE, "Storage channel starting...");
+      Helpers::MutexScope sd_lock(sd_mtx);
+      if (!sdcardready) {
+        print_debug(Helpers::STORAGE, "SD card not available");
+        return;
+      }
+#ifdef PACKET_TRACE
+      open_packet_trace();
+#endif
+      if (!firmware_file.open(FIRMWARE_STAGE_PATH)) {
+        print_debug(Helpers::STORAGE, "Failed to open firmware staging area");
+      } else if (firmware.open()) {
+        print_debug(Helpers::STORAGE, "Firmware upload found with ",
+                    firmware.received(), " of ", firmware.chunks(), " chunks");
+      }
+#if !defined(__IMXRT1062__)
+      if (!install_file.open(FIRMWARE_INSTALL_PATH)) {
+        print_debug(Helpers::STORAGE, "Failed to open firmware install file");
+      }
+#endif
+      if (!log_data.open(TELEMETRY_LOG_DATA_PATH) ||
+          !log_index.open(TELEMETRY_LOG_INDEX_PATH)) {
+        print_debug(Helpers::STORAGE, "Failed to open telemetry log files");
+        return;
+      }
+
+      Helpers::MutexScope lock(log_mtx);
+      if (!telemetry_log.open()) {
+        print_debug(Helpers::STORAGE, "Failed to recover telemetry log");
+        return;
+      }
+      // After a restart of the channel, log time is already past the newest
+      // record, and is left as it is.
+      const uint32_t now = log_time();
+      if (now <= telemetry_log.last_timestamp()) {
+        log_epoch += telemetry_log.last_timestamp() + 1 - now;
+      }
+      print_debug(Helpers::STORAGE, "Telemetry log opened with ",
+                  telemetry_log.stored_size(), " bytes, log time ",
+                  log_time());
+    }
+
+    /**
+     * @brief The storage loop function.
+     *
+     * This function runs in an infinite loop after setup() completes. It
+     * streams log queries to the radio, writes buffered telemetry to the SD
+     * card, and prepares and installs firmware images.
+     */
+    void loop() {
+      while (true) {
+        handle_queue();
+        stream_log_query();
+        update_firmware();
+        if (flushinterval >= TELEMETRY_LOG_FLUSH_INTERVAL) {
+          flush_log();
+        }
+#ifdef PACKET_TRACE
+        if (traceinterval >= PACKET_TRACE_FLUSH_INTERVAL) {
+          write_packet_trace();
+        }
+#endif
+        Helpers::heartbeat(Channel_ID::STORAGE_CHANNEL);
+        threads.delay(query.active() || firmware.growing() ? 10 : 100);
+      }
+    }
+
+    /**
+     * @brief Helper function to handle packet queue.
+     *
+     * This is a helper function called in loop() that checks for packets
+     * addressed to the storage channel.
+     */
+    void handle_queue() {
+      if (PullQueue(packet, storage_queue, storage_queue_mtx)) {
+        print_debug(Helpers::STORAGE, "Pulled packet of type ",
+                    (uint16_t)packet.header.type, " from queue.");
+        switch ((uint16_t)packet.header.type) {
+          case (uint16_t)ArtemisTypeId::CommandLogQuery: {
+            start_log_query();
+            break;
+          }
+          case (uint16_t)ArtemisTypeId::CommandFirmware: {
+            handle_firmware();
+            break;
+          }
+          default:
+            break;
+        }
+      }
+    }
+
+    /**
+     * @brief Helper function to start a page of a log query.
+     *
+     * The packet carries a log_query. A new query replaces any query still
+     * being streamed. Buffered telemetry is written out first so that the
+     * newest records can be returned.
+     */
+    void start_log_query() {
+      if (packet.data.size() < sizeof(log_query)) {
+        print_debug(Helpers::STORAGE, "Log query too short");
+        complete_command(packet, Commands::AckResult::BadLength);
+        return;
+      }
+      memcpy(&query_command, packet.data.data(), sizeof(log_query));
+      query_node = packet.header.nodeorig;
+
+      Helpers::MutexScope sd_lock(sd_mtx);
+      Helpers::MutexScope lock(log_mtx);
+      if (!telemetry_log.is_open()) {
+        print_debug(Helpers::STORAGE, "Telemetry log not available");
+        complete_command(packet, Commands::AckResult::DeviceError);
+        return;
+      }
+      complete_command(packet, Commands::AckResult::Ok);
+      telemetry_log.flush(true);
+      buffertime     = 0;
+      fragment_count = 0;
+      query.begin(query_command);
+      query.fill();
+    }
+
+    /**
+     * @brief Helper function to stream records of a log query to the radio.
+     *
+     * Records are sent while the RFM23 queue has room for them. While the
+     * radio is busy, the time is used to read ahead from the SD card instead,
+     * so the next records are ready as soon as the queue drains. The clock is
+     * kept high while a query is streamed.
+     */
+    void stream_log_query() {
+      if (!query.active()) {
+        return;
+      }
+      Helpers::request_boost(millis(), GOVERNOR_BOOST_TIME);
+      Helpers::MutexScope sd_lock(sd_mtx);
+      Helpers::MutexScope lock(log_mtx);
+
+      TelemetryLog::record_header header;
+      const uint8_t              *payload;
+      while (rfm23_queue.size() <
+             Parameters::get(Parameters::QueueSize) / 2) {
+        if (fragment_index < fragment_count) {
+          send_log_fragment();
+          continue;
+        }
+        const int32_t status = query.next(header, payload);
+        if (status == 0) {
+          if (!query.fill()) {
+            break;
+          }
+        } else if (status > 0) {
+          send_log_record(header, payload);
+        } else {
+          send_log_page();
+          return;
+        }
+      }
+      query.fill();
+    }
+
+    /**
+     * @brief Helper function to send a telemetry log record to the radio.
+     *
+     * The packet carries the record's time as 2 bytes of seconds after the
+     * query's start time, saturating at 0xFFFF, followed by the record's
+     * payload. This keeps the largest beacons within a radio packet.
+     *
+     * Records too large for one packet are copied aside, to be sent by
+     * send_log_fragment() as the RFM23 queue drains.
+     *
+     * @param header The header of the record.
+     * @param payload The payload of the record.
+     */
+    void send_log_record(const TelemetryLog::record_header &header,
+                         const uint8_t                     *payload) {
+      const uint32_t elapsed = header.timestamp - query_command.start;
+      const uint16_t delta   = elapsed > 0xFFFF ? 0xFFFF : elapsed;
+
+      if (sizeof(delta) + header.length > TELEMETRY_LOG_RECORD_DATA) {
+        const uint16_t fragment_size = TELEMETRY_LOG_RECORD_DATA - 4;
+        fragment_timestamp = header.timestamp;
+        fragment_length    = header.length;
+        fragment_index     = 0;
+        fragment_count = (header.length + fragment_size - 1) / fragment_size;
+        memcpy(fragment_payload, payload, header.length);
+        return;
+      }
+
+      packet.header.type     = ArtemisTypeId::DataLogRecord;
+      packet.header.nodeorig = (uint8_t)NODES::TEENSY_NODE_ID;
+      packet.header.nodedest = query_node;
+      packet.header.chanin   = 0;
+      packet.header.chanout  = Channel_ID::RFM23_CHANNEL;
+      packet.data.resize(sizeof(delta) + header.length);
+      memcpy(packet.data.data(), &delta, sizeof(delta));
+      memcpy(packet.data.data() + sizeof(delta), payload, header.length);
+      route_packet_to_rfm23(packet);
+    }
+
+    /**
+     * @brief Helper function to send the next fragment of a large record.
+     *
+     * The packet carries the record's time as in send_log_record(), the index
+     * of the fragment, the number of fragments, then the fragment's part of
+     * the payload.
+     */
+    void send_log_fragment() {
+      const uint16_t fragment_size = TELEMETRY_LOG_RECORD_DATA - 4;
+      const uint32_t elapsed       = fragment_timestamp - query_command.start;
+      const uint16_t delta         = elapsed > 0xFFFF ? 0xFFFF : elapsed;
+      const uint16_t offset        = fragment_index * fragment_size;
+      const uint16_t length =
+          min(fragment_size, (uint16_t)(fragment_length - offset));
+
+      packet.header.type     = ArtemisTypeId::DataLogFragment;
+      packet.header.nodeorig = (uint8_t)NODES::TEENSY_NODE_ID;
+      packet.header.nodedest = query_node;
+      packet.header.chanin   = 0;
+      packet.header.chanout  = Channel_ID::RFM23_CHANNEL;
+      packet.data.resize(sizeof(delta) + 2 + length);
+      memcpy(packet.data.data(), &delta, sizeof(delta));
+      packet.data[sizeof(delta)]     = fragment_index;
+      packet.data[sizeof(delta) + 1] = fragment_count;
+      memcpy(packet.data.data() + sizeof(delta) + 2, &fragment_payload[offset],
+             length);
+      route_packet_to_rfm23(packet);
+      fragment_index++;
+    }
+
+    /**
+     * @brief Helper function to send the end of a page of a log query.
+     *
+     * The packet carries a log_page, with the resume token for the next page.
+     */
+    void send_log_page() {
+      const log_page page    = query.page();
+
+      packet.header.type     = ArtemisTypeId::DataLogPage;
+      packet.header.nodeorig = (uint8_t)NODES::TEENSY_NODE_ID;
+      packet.header.nodedest = query_node;
+      packet.header.chanin   = 0;
+      packet.header.chanout  = Channel_ID::RFM23_CHANNEL;
+      packet.data.resize(sizeof(page));
+      memcpy(packet.data.data(), &page, sizeof(page));
+      route_packet_to_rfm23(packet);
+      print_debug(Helpers::STORAGE, "Log query page sent with ", page.count,
+                  " records");
+    }
+
+    /**
+     * @brief Helper function to upload, check or install a firmware image.
+     *
+     * The packet carries a Storage::FirmwareAction and its operands. Each
+     * chunk is written straight to the SD card, and is only acknowledged, so
+     * that a chunk that is lost is found from the status. Every other action
+     * is answered with the status of the upload.
+     */
+    void handle_firmware() {
+      if (packet.data.empty()) {
+        print_debug(Helpers::STORAGE, "Firmware command too short");
+        complete_command(packet, Commands::AckResult::BadLength);
+        return;
+      }
+      const uint8_t  node         = packet.header.nodeorig;
+      const size_t   size         = packet.data.size();
+      const uint8_t *data         = packet.data.data();
+      uint16_t       window_start = 0;
+      StageResult    result;
+
+      Helpers::request_boost(millis(), GOVERNOR_BOOST_TIME);
+      Helpers::MutexScope sd_lock(sd_mtx);
+      switch ((FirmwareAction)data[0]) {
+        case FirmwareAction::Begin: {
+          uint32_t image_size;
+          uint16_t chunk_size;
+          uint32_t image_crc;
+          if (size < 11) {
+            print_debug(Helpers::STORAGE, "Firmware begin too short");
+            complete_command(packet, Commands::AckResult::BadLength);
+            return;
+          }
+          memcpy(&image_size, data + 1, sizeof(image_size));
+          memcpy(&chunk_size, data + 5, sizeof(chunk_size));
+          memcpy(&image_crc, data + 7, sizeof(image_crc));
+          result = firmware.begin(image_size, chunk_size, image_crc);
+          break;
+        }
+        case FirmwareAction::Write: {
+          uint16_t index;
+          uint32_t crc;
+          if (size < 8) {
+            print_debug(Helpers::STORAGE, "Firmware chunk too short");
+            complete_command(packet, Commands::AckResult::BadLength);
+            return;
+          }
+          memcpy(&index, data + 1, sizeof(index));
+          memcpy(&crc, data + 3, sizeof(crc));
+          result = firmware.write(index, crc, data + 7, size - 7);
+          if (result != StageResult::Ok) {
+            print_debug(Helpers::STORAGE, "Failed to write firmware chunk ",
+                        index);
+          }
+          complete_firmware_command(result);
+          return;
+        }
+        case FirmwareAction::Verify: {
+          result = firmware.verify();
+          break;
+        }
+        case FirmwareAction::Activate: {
+#if defined(__IMXRT1062__)
+          // Images are only staged until they can be booted from a known-good
+          // image to fall back to.
+          result = StageResult::NotSupported;
+#else
+          result      = firmware.activate();
+          installtime = 0;
+#endif
+          break;
+        }
+        case FirmwareAction::Abort: {
+          result = firmware.abort();
+          break;
+        }
+        case FirmwareAction::Status: {
+          if (size >= 3) {
+            memcpy(&window_start, data + 1, sizeof(window_start));
+          }
+          result = StageResult::Ok;
+          break;
+        }
+        default: {
+          print_debug(Helpers::STORAGE, "Invalid firmware action");
+          complete_command(packet, Commands::AckResult::BadValue);
+          return;
+        }
+      }
+      if (result != StageResult::Ok) {
+        print_debug(Helpers::STORAGE, "Firmware action ", (uint16_t)data[0],
+                    " failed with ", (uint16_t)result);
+      }
+      complete_firmware_command(result);
+      report_firmware_status(node, window_start);
+    }
+
+    /**
+     * @brief Helper function to complete a firmware command with the result
+     * of changing the staging area.
+     *
+     * @param result The result.
+     */
+    void complete_firmware_command(StageResult result) {
+      switch (result) {
+        case StageResult::Ok:
+          complete_command(packet, Commands::AckResult::Ok);
+          break;
+        case StageResult::BadSize:
+          complete_command(packet, Commands::AckResult::BadLength);
+          break;
+        case StageResult::DeviceError:
+          complete_command(packet, Commands::AckResult::DeviceError);
+          break;
+        case StageResult::NotReady:
+          complete_command(packet, Commands::AckResult::NoSpace);
+          break;
+        case StageResult::NotSupported:
+          complete_command(packet, Commands::AckResult::UnknownCommand);
+          break;
+        default:
+          complete_command(packet, Commands::AckResult::BadValue);
+          break;
+      }
+    }
+
+    /**
+     * @brief Helper function to grow the firmware staging area, and to
+     * install an activated image.
+     *
+     * The staging area is grown a step each pass, so that the SD card is only
+     * held briefly. Off the Teensy, an image is installed
+     * FIRMWARE_INSTALL_DELAY after it is activated, or after startup if a
+     * reset came first.
+     */
+    void update_firmware() {
+      if (firmware.growing()) {
+        Helpers::MutexScope sd_lock(sd_mtx);
+        if (firmware.grow() != StageResult::Ok) {
+          print_debug(Helpers::STORAGE, "Failed to grow firmware staging area");
+        }
+      }
+#if !defined(__IMXRT1062__)
+      if (firmware.state() == FirmwareState::Activated &&
+          installtime >= FIRMWARE_INSTALL_DELAY) {
+        install_firmware();
+      }
+#endif
+    }
+
+#if !defined(__IMXRT1062__)
+    /**
+     * @brief Helper function to install the activated firmware image to the
+     * install file.
+     *
+     * The image cannot be booted, so it is left to be activated again. The
+     * channel counts a heartbeat as each chunk is copied, as copying a large
+     * image takes longer than its deadline.
+     */
+    void install_firmware() {
+      Helpers::print_log<Helpers::LogLevel::Warning>(
+          Helpers::STORAGE, "Installing firmware image");
+      Helpers::MutexScope sd_lock(sd_mtx);
+      const StageResult   result = firmware.install(firmware_target, []() {
+        Helpers::heartbeat(Channel_ID::STORAGE_CHANNEL);
+      });
+      if (result == StageResult::NotSupported) {
+        print_debug(Helpers::STORAGE, "Firmware image installed to ",
+                    FIRMWARE_INSTALL_PATH);
+        return;
+      }
+      Helpers::print_log<Helpers::LogLevel::Error>(
+          Helpers::STORAGE, "Failed to install firmware image with ",
+          (uint16_t)result);
+    }
+#endif
+
+    /**
+     * @brief Helper function to send the status of the firmware upload.
+     *
+     * The SD card's mutex must be held.
+     *
+     * @param node The node to report to.
+     * @param window_start The first chunk whose arrival is shown.
+     */
+    void report_firmware_status(uint8_t node, uint16_t window_start) {
+      firmware_status status;
+      if (!firmware.status(window_start, status)) {
+        print_debug(Helpers::STORAGE, "Failed to read firmware upload");
+        return;
+      }
+      packet.header.type     = ArtemisTypeId::DataFirmware;
+      packet.header.nodeorig = (uint8_t)NODES::TEENSY_NODE_ID;
+      packet.header.nodedest = node;
+      packet.header.chanin   = 0;
+      packet.header.chanout  = Channel_ID::RFM23_CHANNEL;
+      packet.data.resize(sizeof(status));
+      memcpy(packet.data.data(), &status, sizeof(status));
+      route_packet_to_rfm23(packet);
+    }
+
+    /**
+     * @brief Helper function to write buffered telemetry to the SD card.
+     *
+     * Only whole sectors are written, unless telemetry has been waiting in RAM
+     * for longer than TELEMETRY_LOG_MAX_BUFFER_TIME.
+     */
+    void flush_log() {
+      flushinterval = 0;
+      Helpers::MutexScope sd_lock(sd_mtx);
+      Helpers::MutexScope lock(log_mtx);
+      log_time();
+      if (!telemetry_log.is_open()) {
+        return;
+      }
+      bool force = buffertime >= TELEMETRY_LOG_MAX_BUFFER_TIME;
+#ifdef TELEMETRY_ARCHIVE
+      if (archivetime >= TELEMETRY_LOG_MAX_BUFFER_TIME) {
+        while (archive.flush()) {
+          store_archive_block();
+        }
+        archivetime = 0;
+        force       = true;
+      }
+#endif
+      if (!telemetry_log.flush(force)) {
+        print_debug(Helpers::STORAGE, "Failed to write telemetry log");
+        return;
+      }
+      if (force || telemetry_log.buffered_size() == 0) {
+        buffertime = 0;
+      }
+    }
+
+    /**
+     * @brief Store a beacon in the telemetry log.
+     *
+     * The beacon is only copied into RAM, so this can be called from any
+     * channel. Its BeaconType is used as the record type.
+     *
+     * With TELEMETRY_ARCHIVE, beacons are instead collected by the archive
+     * encoder, and only the compressed blocks are stored.
+     *
+     * @param packet The packet carrying the beacon.
+     */
+    void store_beacon(PacketComm &packet) {
+      if (packet.data.empty()) {
+        return;
+      }
+      Helpers::MutexScope lock(log_mtx);
+#ifdef TELEMETRY_ARCHIVE
+      if (packet.data.size() <= ARCHIVE_MAX_RECORD_SIZE) {
+        if (archive.add(packet.data.data(), packet.data.size())) {
+          store_archive_block();
+        }
+        return;
+      }
+#endif
+      if (!telemetry_log.append(log_time(), packet.data[0], packet.data.data(),
+                                packet.data.size())) {
+        print_debug_rapid(Helpers::STORAGE, "Failed to store beacon");
+      }
+    }
+
+#ifdef TELEMETRY_ARCHIVE
+    /**
+     * @brief Helper function to store the archive encoder's latest block.
+     *
+     * The record type is the BeaconType of the archived beacons with
+     * TELEMETRY_LOG_TYPE_ARCHIVED set. This must be called with log_mtx held.
+     */
+    void store_archive_block() {
+      archive_header header;
+      memcpy(&header, archive.block(), sizeof(header));
+      if (!telemetry_log.append(log_time(),
+                                TELEMETRY_LOG_TYPE_ARCHIVED | header.type,
+                                archive.block(), archive.block_size())) {
+        print_debug_rapid(Helpers::STORAGE, "Failed to store archive block");
+      }
+    }
+#endif
+
+#ifdef PACKET_TRACE
+    /**
+     * @brief Helper function to open the packet trace on the SD card.
+     *
+     * Each startup's frames are appended to the same file, after the
+     * TraceSource::Startup record written by setup(). This must be called with
+     * sd_mtx held.
+     */
+    void open_packet_trace() {
+      trace_file = SD.open(PACKET_TRACE_PATH, FILE_WRITE);
+      if (!trace_file) {
+        print_debug(Helpers::STORAGE, "Failed to open packet trace");
+        return;
+      }
+      if (trace_file.size() == 0) {
+        Helpers::trace_file_header header;
+        trace_file.write(&header, sizeof(header));
+      }
+    }
+
+    /** @brief Helper function to write the traced frames to the SD card. */
+    void write_packet_trace() {
+      traceinterval               = 0;
+      Helpers::TraceBuffer &trace = Helpers::take_packet_trace();
+      if (trace.size() == 0) {
+        return;
+      }
+      Helpers::MutexScope sd_lock(sd_mtx);
+      if (!trace_file) {
+        return;
+      }
+      if (trace_file.write(trace.data(), trace.size()) != trace.size()) {
+        print_debug(Helpers::STORAGE, "Failed to write packet trace");
+      }
+      trace_file.flush();
+    }
+#endif
+
+    /**
+     * @brief Helper function to get the current log time.
+     *
+     * millis() wraps after about 49 days, so the uptime is accumulated into a
+     * 64-bit counter. This must be called with log_mtx held, and is called at
+     * least once per TELEMETRY_LOG_FLUSH_INTERVAL by flush_log().
+     *
+     * @return uint32_t The current log time, in seconds.
+     */
+    uint32_t log_time() {
+      const uint32_t now = millis();
+      uptime_ms += (uint32_t)(now - last_millis);
+      last_millis = now;
+      return log_epoch + (uint32_t)(uptime_ms / SECONDS);
+    }
+
+    /**
+     * @brief Get the current log time, to the millisecond.
+     *
+     * This can be called from any channel. Until the telemetry log has been
+     * opened, log time counts from 0 at startup.
+     *
+     * @return uint64_t The current log time, in milliseconds.
+     */
+    uint64_t log_time_ms() {
+      Helpers::MutexScope lock(log_mtx);
+      log_time();
+      return (uint64_t)log_epoch * SECONDS + uptime_ms;
+    }
+
+    /**
+     * @brief Move the log time forward, such as to the ground's clock.
+     *
+     * Records are found by their time, so log time is never moved back. Once
+     * set, the log time counts as synced until the next startup.
+     *
+     * @param seconds The new log time, in seconds.
+     * @return true The log time was set.
+     * @return false The new log time is before the current one.
+     */
+    bool set_log_time(uint32_t seconds) {
+      Helpers::MutexScope lock(log_mtx);
+      const uint32_t      now = log_time();
+      if (seconds < now) {
+        return false;
+      }
+      log_epoch    += seconds - now;
+      log_time_set  = true;
+      return true;
+    }
+
+    /**
+     * @brief Whether the log time has been set since startup.
+     *
+     * Until then, log time runs on from the newest record in the log, which
+     * is behind the ground's clock by however long the Teensy was off.
+     *
+     * @return true The log time has been set.
+     * @return false It has not.
+     */
+    bool log_time_synced() {
+      Helpers::MutexScope lock(log_mtx);
+      return log_time_set;
+    }
+  } // namespace STORAGE
+} // namespace Channels
+} // namespace Artemis
@@ -5,20 +5,25 @@
  * The definition of the tests channel.
  */
 #include "channels/artemis_channels.h"
+#include <cpu_monitor.h>
+#include <heap_track.h>
 #include <pdu.h>
+#include <supervisor.h>
 
 namespace Artemis {
 namespace Channels {
   /** @brief The tests channel. */
   namespace TEST {
     /** @brief The packet used throughout the tests. */
-    PacketComm    packet;
+    PacketComm       packet;
     /** @brief The time since the Raspberry Pi has been turned on. */
-    elapsedMillis piShutdownTimer = 0;
+    elapsedMillis    piShutdownTimer = 0;
     /** @brief Whether the Raspberry Pi is off. */
-    bool          piIsOff         = false;
+    bool             piIsOff         = false;
     /** @brief The number of packets transmitted by the RFM23. */
-    uint32_t      packet_count    = 0;
+    uint32_t         packet_count    = 0;
+    /** @brief The CPU load of each thread since the last report. */
+    Helpers::CpuLoad cpu_load;
 
     /**
      * @brief The top-level channel definition.
@@ -27,7 +32,7 @@ namespace Channels {
      * script, it has a setup() function that is run once, then loop() runs
      * forever.
      */
-    void          test_channel() {
+    void             test_channel() {
       setup();
       loop();
     }
@@ -51,6 +56,7 @@ namespace Channels {
         report_threads_status();
         report_memory_usage();
         report_queue_size();
+        Helpers::heartbeat(Channel_ID::TEST_CHANNEL);
 
         //turn_on_rpi();
         threads.delay(500);
@@ -196,16 +202,28 @@ namespace Channels {
       route_packet_to_main(packet);
     }
 
-    /** @brief Report on the status of all currently running threads. */
+    /**
+     * @brief Report on the status of all currently running threads.
+     *
+     * The share of the processor each thread used since the last report is
+     * given in tenths of a percent.
+     */
     void report_threads_status() {
+      cpu_load.update();
       for (auto &t : thread_list) {
         Helpers::print_debug(Helpers::TEST, "thread_id:", t.thread_id,
                              " channel_id:", (int)t.channel_id,
-                             " state:", threads.getState(t.thread_id));
+                             " state:", threads.getState(t.thread_id),
+                             " cpu:", cpu_load.permille(t.thread_id));
       }
     }
 
-    /** @brief Report on the current memory utilization. */
+    /**
+     * @brief Report on the current memory utilization.
+     *
+     * The bytes held by each HeapTag and the largest free block are printed
+     * as well, as the top of the heap says nothing about the holes in it.
+     */
     void report_memory_usage() {
       long  totalMemory = &_heap_end - &_heap_start;
       long  freeMemory  = &_heap_end - (unsigned long *)__brkval;
@@ -215,6 +233,19 @@ namespace Channels {
       Helpers::print_debug(Helpers::TEST, "Memory usage: ", usedMemory, "/",
                            totalMemory, " bytes (", memoryUtilization,
                            "% utilization)");
+      Helpers::print_debug(Helpers::TEST, "Heap: ", Helpers::heap_live(),
+                           " bytes live, ", Helpers::heap_peak(), " peak, ",
+                           Helpers::heap_free(), " free, largest block ",
+                           Helpers::heap_largest_free(), ", ",
+                           Helpers::heap_failures(), " failed allocations");
+      for (uint8_t i = 0; i < HEAP_TAGS; i++) {
+        const Helpers::heap_tag_stats &tag =
+            Helpers::get_heap_tag((Helpers::HeapTag)i);
+        Helpers::print_debug(Helpers::TEST, "Heap tag ", (int)i, ": ",
+                             tag.live.load(), " bytes live, ",
+                             tag.allocs.load(), " allocations, ",
+                             tag.frees.load(), " frees");
+      }
     }
 
     /** @brief Report on the size of each of the queues. */
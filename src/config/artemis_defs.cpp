@@ -6,6 +6,9 @@
  * satellite.
  */
 #include "config/artemis_defs.h"
+#include "channels/artemis_channels.h"
+#include <heap_track.h>
+#include <helpers.h>
 
 /**
  * @brief The list of active threads.
@@ -24,30 +27,38 @@ std::map<string, NODES>      NodeType = {
 };
 
 /** @brief The packet queue for the main channel. */
-std::deque<PacketComm> main_queue;
+std::deque<PacketComm>    main_queue;
 /** @brief The packet queue for the RFM23 channel. */
-std::deque<PacketComm> rfm23_queue;
+std::deque<PacketComm>    rfm23_queue;
 /** @brief The packet queue for the PDU channel. */
-std::deque<PacketComm> pdu_queue;
+std::deque<PacketComm>    pdu_queue;
 /** @brief The packet queue for the Raspberry Pi channel. */
-std::deque<PacketComm> rpi_queue;
+std::deque<PacketComm>    rpi_queue;
+/** @brief The packet queue for the storage channel. */
+std::deque<PacketComm>    storage_queue;
 
 /** @brief The mutex for the main channel's packet queue. */
-Threads::Mutex         main_queue_mtx;
+Helpers::RecoverableMutex main_queue_mtx;
 /** @brief The mutex for the RFM23 channel's packet queue. */
-Threads::Mutex         rfm23_queue_mtx;
+Helpers::RecoverableMutex rfm23_queue_mtx;
 /** @brief The mutex for the PDU channel's packet queue. */
-Threads::Mutex         pdu_queue_mtx;
+Helpers::RecoverableMutex pdu_queue_mtx;
 /** @brief The mutex for the Raspberry Pi channel's packet queue. */
-Threads::Mutex         rpi_queue_mtx;
+Helpers::RecoverableMutex rpi_queue_mtx;
+/** @brief The mutex for the storage channel's packet queue. */
+Helpers::RecoverableMutex storage_queue_mtx;
 
 /** @brief The mutex for the SPI1 interface. */
-Threads::Mutex         spi1_mtx;
+Helpers::RecoverableMutex spi1_mtx;
 /** @brief The mutex for the I2C1 interface. */
-Threads::Mutex         i2c1_mtx;
+Helpers::RecoverableMutex i2c1_mtx;
+/** @brief The mutex for the built-in SD card. */
+Helpers::RecoverableMutex sd_mtx;
 
 /** @brief Whether the satellite is in deployment mode. */
-bool                   deploymentmode = false;
+bool                      deploymentmode = false;
+/** @brief Whether the built-in SD card has been started successfully. */
+bool                      sdcardready    = false;
 
 /**
  * @brief Kill a running thread.
@@ -59,7 +70,7 @@ bool                   deploymentmode = false;
  * killed.
  * @return false The target Channel_ID has not been found in the thread_list.
  */
-bool                   kill_thread(uint8_t target_channel_id) {
+bool                      kill_thread(uint8_t target_channel_id) {
   for (auto thread_list_iterator = thread_list.begin();
        thread_list_iterator != thread_list.end(); thread_list_iterator++) {
     if (thread_list_iterator->channel_id == target_channel_id) {
@@ -74,16 +85,18 @@ bool                   kill_thread(uint8_t target_channel_id) {
  * @brief Push a packet into a queue.
  *
  * This is a helper function to push a packet into a queue of packets. It will
- * push out the first packet in the queue if the queue is too large.
+ * push out the first packets in the queue if the queue is too large, which
+ * can be more than one after the queue size parameter is lowered.
  *
  * @param packet The packet object that will be pushed into the queue.
  * @param queue The queue of packets to be pulled from.
  * @param mtx The mutex used to lock the queue.
  */
 void PushQueue(PacketComm &packet, std::deque<PacketComm> &queue,
-               Threads::Mutex &mtx) {
-  Threads::Scope lock(mtx);
-  if (queue.size() == MAXQUEUESIZE) {
+               Helpers::RecoverableMutex &mtx) {
+  Helpers::MutexScope lock(mtx);
+  while (queue.size() >=
+         Artemis::Parameters::get(Artemis::Parameters::QueueSize)) {
     queue.pop_front();
   }
   queue.push_back(packet);
@@ -102,8 +115,8 @@ void PushQueue(PacketComm &packet, std::deque<PacketComm> &queue,
  * @return false The queue does not contain any packets.
  */
 bool PullQueue(PacketComm &packet, std::deque<PacketComm> &queue,
-               Threads::Mutex &mtx) {
-  Threads::Scope lock(mtx);
+               Helpers::RecoverableMutex &mtx) {
+  Helpers::MutexScope lock(mtx);
   if (queue.size() > 0) {
     packet = queue.front();
     queue.pop_front();
@@ -128,3 +141,75 @@ void route_packet_to_pdu(PacketComm packet) {
 void route_packet_to_rpi(PacketComm packet) {
   PushQueue(packet, rpi_queue, rpi_queue_mtx);
 }
+/** @brief Wrapper function to send a packet to the storage channel. */
+void route_packet_to_storage(PacketComm packet) {
+  PushQueue(packet, storage_queue, storage_queue_mtx);
+}
+
+/** @brief The acknowledgments of commands, waiting to be sent. */
+Artemis::Commands::AckCollector ack_collector;
+/** @brief The mutex for the acknowledgments of commands. */
+Helpers::RecoverableMutex       ack_mtx;
+
+/**
+ * @brief Queue the acknowledgment of a command that has been handled.
+ *
+ * @param ack The acknowledgment.
+ */
+void report_ack(const Artemis::Commands::command_ack &ack) {
+  Helpers::MutexScope lock(ack_mtx);
+  ack_collector.report(ack, millis());
+}
+/**
+ * @brief Acknowledge a command as accepted, to be completed by the channel it
+ * is handed to.
+ *
+ * @param ack The acknowledgment.
+ */
+void accept_command(const Artemis::Commands::command_ack &ack) {
+  Helpers::MutexScope lock(ack_mtx);
+  ack_collector.track(ack, millis());
+}
+/**
+ * @brief Complete a command that was handed to a channel, if it came from the
+ * ground.
+ *
+ * Channels call this once they have run a command.
+ *
+ * @param command The command, with its header as it was received.
+ * @param result The result of the command.
+ */
+void complete_command(const PacketComm            &command,
+                      Artemis::Commands::AckResult result) {
+  if (command.header.nodeorig != (uint8_t)NODES::GROUND_NODE_ID) {
+    return;
+  }
+  Helpers::MutexScope lock(ack_mtx);
+  ack_collector.complete((uint16_t)command.header.type, result, millis());
+}
+/**
+ * @brief Send the acknowledgments that are due to the ground.
+ *
+ * Accepted commands that have not been completed in ACK_PENDING_TIMEOUT are
+ * failed first.
+ */
+void send_acks() {
+  Helpers::MutexScope            lock(ack_mtx);
+  PacketComm                     packet;
+  Artemis::Commands::command_ack records[ACK_FRAME_RECORDS];
+  size_t                         size;
+  ack_collector.expire(millis());
+  while (ack_collector.due(millis())) {
+    const Artemis::Commands::AckFrame frame =
+        ack_collector.next_frame((uint8_t *)records, size);
+    packet.header.type     = frame == Artemis::Commands::AckFrame::Bitmap
+                                 ? ArtemisTypeId::DataAckBitmap
+                                 : ArtemisTypeId::DataCommandAck;
+    packet.header.nodeorig = (uint8_t)NODES::TEENSY_NODE_ID;
+    packet.header.nodedest = (uint8_t)NODES::GROUND_NODE_ID;
+    packet.header.chanin   = 0;
+    packet.header.chanout  = Artemis::Channels::Channel_ID::RFM23_CHANNEL;
+    packet.data.assign((uint8_t *)records, (uint8_t *)records + size);
+    route_packet_to_rfm23(packet);
+  }
+}
@@ -6,6 +6,7 @@
  */
 #include "artemis_devices.h"
 #include "channels/artemis_channels.h"
+#include <profiler.h>
 
 namespace Artemis {
 namespace Devices {
@@ -34,20 +35,44 @@ namespace Devices {
   }
 
   /**
-   * @brief Reads the satellite's current sensors.
+   * @brief Samples the satellite's current sensors.
    *
-   * This method of the CurrentSensors class reads the current sensor values,
-   * stores them in two beacons (currentbeacon1 and currentbeacon2), and
-   * transmits those beacons to the ground.
+   * This method of the CurrentSensors class reads the current sensor values
+   * and publishes them to the telemetry point store, without transmitting
+   * them.
    *
    * @param uptime The time, in milliseconds, since the Teensy has been
    * powered on.
    */
-  void CurrentSensors::read(uint32_t uptime) {
+  void CurrentSensors::sample(uint32_t uptime) {
+    Helpers::ProfileScope profile(Helpers::ProfileZone::CurrentRead);
     if (!currentSetup) {
       setup();
     }
 
+    uint16_t i = 0;
+    for (auto &it : current_sensors) {
+      Telemetry::publish(Telemetry::busvoltage + i,
+                         it.second->getBusVoltage_V(), uptime);
+      Telemetry::publish(Telemetry::current + i, it.second->getCurrent_mA(),
+                         uptime);
+      i++;
+    }
+  }
+
+  /**
+   * @brief Reads the satellite's current sensors.
+   *
+   * This method of the CurrentSensors class samples the current sensors,
+   * stores the values in two beacons (currentbeacon1 and currentbeacon2), and
+   * transmits those beacons to the ground.
+   *
+   * @param uptime The time, in milliseconds, since the Teensy has been
+   * powered on.
+   */
+  void CurrentSensors::read(uint32_t uptime) {
+    sample(uptime);
+
     PacketComm     packet;
     currentbeacon1 beacon1;
     currentbeacon2 beacon2;
@@ -55,33 +80,31 @@ namespace Devices {
     packet.header.nodedest = (uint8_t)NODES::GROUND_NODE_ID;
     packet.header.type     = PacketComm::TypeId::DataObcBeacon;
 
-    for (auto &it : current_sensors) {
-      const int i = std::distance(current_sensors.begin(),
-                                  current_sensors.find(it.first));
+    for (int i = 0; i < ARTEMIS_CURRENT_SENSOR_COUNT; i++) {
       if (i < ARTEMIS_CURRENT_BEACON_1_COUNT) {
-        beacon1.busvoltage[i] = (current_sensors[it.first]->getBusVoltage_V());
-        beacon1.current[i]    = (current_sensors[it.first]->getCurrent_mA());
+        beacon1.busvoltage[i] = Telemetry::value(Telemetry::busvoltage + i);
+        beacon1.current[i]    = Telemetry::value(Telemetry::current + i);
       } else {
         beacon2.busvoltage[i - ARTEMIS_CURRENT_BEACON_1_COUNT] =
-            (current_sensors[it.first]->getBusVoltage_V());
+            Telemetry::value(Telemetry::busvoltage + i);
         beacon2.current[i - ARTEMIS_CURRENT_BEACON_1_COUNT] =
-            (current_sensors[it.first]->getCurrent_mA());
+            Telemetry::value(Telemetry::current + i);
       }
     }
 
     beacon1.deci = uptime;
-    packet.data.resize(sizeof(beacon1));
-    memcpy(packet.data.data(), &beacon1, sizeof(beacon1));
+    set_beacon_data(packet, beacon1);
     packet.header.chanin  = 0;
     packet.header.chanout = Artemis::Channels::Channel_ID::RFM23_CHANNEL;
     route_packet_to_rfm23(packet);
+    Artemis::Channels::STORAGE::store_beacon(packet);
 
     beacon2.deci = uptime;
-    packet.data.resize(sizeof(beacon2));
-    memcpy(packet.data.data(), &beacon2, sizeof(beacon2));
+    set_beacon_data(packet, beacon2);
     packet.header.chanin  = 0;
     packet.header.chanout = Artemis::Channels::Channel_ID::RFM23_CHANNEL;
     route_packet_to_rfm23(packet);
+    Artemis::Channels::STORAGE::store_beacon(packet);
   }
 }
 }
\ No newline at end of file
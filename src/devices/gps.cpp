@@ -6,6 +6,7 @@
  */
 #include "artemis_devices.h"
 #include "channels/artemis_channels.h"
+#include <profiler.h>
 
 namespace Artemis {
 namespace Devices {
@@ -54,60 +55,61 @@ namespace Devices {
     }
   }
   /**
-   * @brief Reads the satellite's GPS data.
+   * @brief Samples the satellite's GPS data.
    *
-   * This method of the GPS class reads the last known GPS data, stores it in
-   * a gpsbeacon, and transmits that beacon to ground.
+   * This method of the GPS class publishes the last known GPS data to the
+   * telemetry point store, without transmitting it. Without a fix, every
+   * value is published as 0.
    *
    * @param uptime The time, in milliseconds, since the Teensy has been
    * powered on.
    */
-  void GPS::read(uint32_t uptime) {
+  void GPS::sample(uint32_t uptime) {
+    Helpers::ProfileScope profile(Helpers::ProfileZone::GPSRead);
     if (!gpsSetup) {
       setup();
     }
 
+    const bool fix = gps->fix;
+    Telemetry::publish(Telemetry::latitude, fix ? gps->latitude : 0, uptime);
+    Telemetry::publish(Telemetry::longitude, fix ? gps->longitude : 0, uptime);
+    Telemetry::publish(Telemetry::speed, fix ? gps->speed : 0, uptime);
+    Telemetry::publish(Telemetry::angle, fix ? gps->angle : 0, uptime);
+    Telemetry::publish(Telemetry::altitude, fix ? gps->altitude : 0, uptime);
+    Telemetry::publish(Telemetry::satellites, fix ? gps->satellites : 0,
+                       uptime);
+  }
+
+  /**
+   * @brief Reads the satellite's GPS data.
+   *
+   * This method of the GPS class samples the GPS, stores its data in a
+   * gpsbeacon, and transmits that beacon to ground.
+   *
+   * @param uptime The time, in milliseconds, since the Teensy has been
+   * powered on.
+   */
+  void GPS::read(uint32_t uptime) {
+    sample(uptime);
+
     PacketComm packet;
     gpsbeacon  beacon;
-    beacon.deci = uptime;
+    beacon.deci            = uptime;
+    beacon.latitude        = Telemetry::value(Telemetry::latitude);
+    beacon.longitude       = Telemetry::value(Telemetry::longitude);
+    beacon.speed           = Telemetry::value(Telemetry::speed);
+    beacon.angle           = Telemetry::value(Telemetry::angle);
+    beacon.altitude        = Telemetry::value(Telemetry::altitude);
+    beacon.satellites      = Telemetry::value(Telemetry::satellites);
 
-    if (gps->fix) {
-      // beacon.hour = gps->hour;
-      // beacon.minute = gps->minute;
-      // beacon.seconds = gps->seconds;
-      // beacon.milliseconds = gps->milliseconds;
-      // beacon.day = gps->day;
-      // beacon.month = gps->month;
-      // beacon.year = gps->year;
-      beacon.latitude   = gps->latitude;
-      beacon.longitude  = gps->longitude;
-      beacon.speed      = gps->speed;
-      beacon.angle      = gps->angle;
-      beacon.altitude   = gps->altitude;
-      beacon.satellites = gps->satellites;
-    } else {
-      // beacon.hour = 0;
-      // beacon.minute = 0;
-      // beacon.seconds = 0;
-      // beacon.milliseconds = 0;
-      // beacon.day = 0;
-      // beacon.month = 0;
-      // beacon.year = 0;
-      beacon.latitude   = 0;
-      beacon.longitude  = 0;
-      beacon.speed      = 0;
-      beacon.angle      = 0;
-      beacon.altitude   = 0;
-      beacon.satellites = 0;
-    }
     packet.header.nodeorig = (uint8_t)NODES::TEENSY_NODE_ID;
     packet.header.nodedest = (uint8_t)NODES::GROUND_NODE_ID;
     packet.header.type     = PacketComm::TypeId::DataObcBeacon;
-    packet.data.resize(sizeof(beacon));
-    memcpy(packet.data.data(), &beacon, sizeof(beacon));
+    set_beacon_data(packet, beacon);
     packet.header.chanin  = 0;
     packet.header.chanout = Artemis::Channels::Channel_ID::RFM23_CHANNEL;
     route_packet_to_rfm23(packet);
+    Artemis::Channels::STORAGE::store_beacon(packet);
   }
 }
 }
\ No newline at end of file
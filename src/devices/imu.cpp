@@ -6,6 +6,7 @@
  */
 #include "artemis_devices.h"
 #include "channels/artemis_channels.h"
+#include <profiler.h>
 
 namespace Artemis {
 namespace Devices {
@@ -29,26 +30,22 @@ namespace Devices {
   }
 
   /**
-   * @brief Reads the satellite's IMU.
+   * @brief Samples the satellite's IMU.
    *
-   * This method of the IMU class reads the IMU's values, stores it in an
-   * imubeacon, and transmits that beacon to the ground.
+   * This method of the IMU class reads the IMU's values and publishes them to
+   * the telemetry point store, without transmitting them.
    *
    * @param uptime The time, in milliseconds, since the Teensy has been
    * powered on.
-   * @return true The IMU has been successfully read and a packet carrying the
-   * reading has been queued for transmission.
+   * @return true The IMU has been successfully read.
    * @return false The IMU could not be read.
    */
-  bool IMU::read(uint32_t uptime) {
+  bool IMU::sample(uint32_t uptime) {
+    Helpers::ProfileScope profile(Helpers::ProfileZone::IMURead);
     if (!imuSetup) {
       setup();
     }
 
-    PacketComm packet;
-    imubeacon  beacon;
-    beacon.deci = uptime;
-
     sensors_event_t accel;
     sensors_event_t gyro;
     sensors_event_t temp;
@@ -56,22 +53,52 @@ namespace Devices {
       return false;
     }
 
-    beacon.accelx          = (accel.acceleration.x);
-    beacon.accely          = (accel.acceleration.y);
-    beacon.accelz          = (accel.acceleration.z);
-    beacon.gyrox           = (gyro.gyro.x);
-    beacon.gyroy           = (gyro.gyro.y);
-    beacon.gyroz           = (gyro.gyro.z);
-    beacon.imutemp         = (temp.temperature);
+    Telemetry::publish(Telemetry::accel + 0, accel.acceleration.x, uptime);
+    Telemetry::publish(Telemetry::accel + 1, accel.acceleration.y, uptime);
+    Telemetry::publish(Telemetry::accel + 2, accel.acceleration.z, uptime);
+    Telemetry::publish(Telemetry::gyro + 0, gyro.gyro.x, uptime);
+    Telemetry::publish(Telemetry::gyro + 1, gyro.gyro.y, uptime);
+    Telemetry::publish(Telemetry::gyro + 2, gyro.gyro.z, uptime);
+    Telemetry::publish(Telemetry::imutemp, temp.temperature, uptime);
+    return true;
+  }
+
+  /**
+   * @brief Reads the satellite's IMU.
+   *
+   * This method of the IMU class samples the IMU, stores its values in an
+   * imubeacon, and transmits that beacon to the ground.
+   *
+   * @param uptime The time, in milliseconds, since the Teensy has been
+   * powered on.
+   * @return true The IMU has been successfully read and a packet carrying the
+   * reading has been queued for transmission.
+   * @return false The IMU could not be read.
+   */
+  bool IMU::read(uint32_t uptime) {
+    if (!sample(uptime)) {
+      return false;
+    }
+
+    PacketComm packet;
+    imubeacon  beacon;
+    beacon.deci            = uptime;
+    beacon.accelx          = Telemetry::value(Telemetry::accel + 0);
+    beacon.accely          = Telemetry::value(Telemetry::accel + 1);
+    beacon.accelz          = Telemetry::value(Telemetry::accel + 2);
+    beacon.gyrox           = Telemetry::value(Telemetry::gyro + 0);
+    beacon.gyroy           = Telemetry::value(Telemetry::gyro + 1);
+    beacon.gyroz           = Telemetry::value(Telemetry::gyro + 2);
+    beacon.imutemp         = Telemetry::value(Telemetry::imutemp);
 
     packet.header.nodeorig = (uint8_t)NODES::TEENSY_NODE_ID;
     packet.header.nodedest = (uint8_t)NODES::GROUND_NODE_ID;
     packet.header.type     = PacketComm::TypeId::DataObcBeacon;
-    packet.data.resize(sizeof(beacon));
-    memcpy(packet.data.data(), &beacon, sizeof(beacon));
+    set_beacon_data(packet, beacon);
     packet.header.chanin  = 0;
     packet.header.chanout = Artemis::Channels::Channel_ID::RFM23_CHANNEL;
     route_packet_to_rfm23(packet);
+    Artemis::Channels::STORAGE::store_beacon(packet);
 
     return true;
   }
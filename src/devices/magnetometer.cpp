@@ -6,6 +6,7 @@
  */
 #include "artemis_devices.h"
 #include "channels/artemis_channels.h"
+#include <profiler.h>
 
 namespace Artemis {
 namespace Devices {
@@ -29,42 +30,64 @@ namespace Devices {
   }
 
   /**
-   * @brief Reads the satellite's magnetometer.
+   * @brief Samples the satellite's magnetometer.
    *
-   * This method of the Magnetometer class reads the magnetometer's values,
-   * stores it in a magbeacon, and transmits that beacon to the ground.
+   * This method of the Magnetometer class reads the magnetometer's values and
+   * publishes them to the telemetry point store, without transmitting them.
    *
    * @param uptime The time, in milliseconds, since the Teensy has been
    * powered on.
-   * @return true The magnetometer has been successfully read and a packet
-   * carrying the reading has been queued for transmission.
+   * @return true The magnetometer has been successfully read.
    * @return false The magnetometer could not be read or hasn't been set up.
    */
-  bool Magnetometer::read(uint32_t uptime) {
+  bool Magnetometer::sample(uint32_t uptime) {
+    Helpers::ProfileScope profile(Helpers::ProfileZone::MagnetometerRead);
     if (!magnetometerSetup) {
       setup();
     }
 
-    PacketComm packet;
-    magbeacon  beacon;
-    beacon.deci = uptime;
-
     sensors_event_t event;
     if (!magnetometer->getEvent(&event) || !magnetometerSetup) {
       return false;
     }
-    beacon.magx            = (event.magnetic.x);
-    beacon.magy            = (event.magnetic.y);
-    beacon.magz            = (event.magnetic.z);
+    Telemetry::publish(Telemetry::mag + 0, event.magnetic.x, uptime);
+    Telemetry::publish(Telemetry::mag + 1, event.magnetic.y, uptime);
+    Telemetry::publish(Telemetry::mag + 2, event.magnetic.z, uptime);
+    return true;
+  }
+
+  /**
+   * @brief Reads the satellite's magnetometer.
+   *
+   * This method of the Magnetometer class samples the magnetometer, stores
+   * its values in a magbeacon, and transmits that beacon to the ground.
+   *
+   * @param uptime The time, in milliseconds, since the Teensy has been
+   * powered on.
+   * @return true The magnetometer has been successfully read and a packet
+   * carrying the reading has been queued for transmission.
+   * @return false The magnetometer could not be read or hasn't been set up.
+   */
+  bool Magnetometer::read(uint32_t uptime) {
+    if (!sample(uptime)) {
+      return false;
+    }
+
+    PacketComm packet;
+    magbeacon  beacon;
+    beacon.deci            = uptime;
+    beacon.magx            = Telemetry::value(Telemetry::mag + 0);
+    beacon.magy            = Telemetry::value(Telemetry::mag + 1);
+    beacon.magz            = Telemetry::value(Telemetry::mag + 2);
 
     packet.header.nodeorig = (uint8_t)NODES::TEENSY_NODE_ID;
     packet.header.nodedest = (uint8_t)NODES::GROUND_NODE_ID;
     packet.header.type     = PacketComm::TypeId::DataObcBeacon;
-    packet.data.resize(sizeof(beacon));
-    memcpy(packet.data.data(), &beacon, sizeof(beacon));
+    set_beacon_data(packet, beacon);
     packet.header.chanin  = 0;
     packet.header.chanout = Artemis::Channels::Channel_ID::RFM23_CHANNEL;
     route_packet_to_rfm23(packet);
+    Artemis::Channels::STORAGE::store_beacon(packet);
 
     return true;
   }
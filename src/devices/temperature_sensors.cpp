@@ -6,6 +6,7 @@
  */
 #include "artemis_devices.h"
 #include "channels/artemis_channels.h"
+#include <profiler.h>
 
 namespace Artemis {
 namespace Devices {
@@ -22,11 +23,11 @@ namespace Devices {
   }
 
   /**
-   * @brief Reads the satellite's temperature sensors.
+   * @brief Samples the satellite's temperature sensors.
    *
    * This method of the TemperatureSensors class reads the temperature sensor
-   * values, stores them in a temperaturebeacon, and transmits that beacon to
-   * the ground.
+   * values and publishes them to the telemetry point store, without
+   * transmitting them.
    *
    * The temperature sensors are read as an analog voltage, then converted to
    * a temperature in Celsius. The Teensy's internal temperature sensor is also
@@ -35,30 +36,50 @@ namespace Devices {
    * @param uptime The time, in milliseconds, since the Teensy has been
    * powered on.
    */
-  void TemperatureSensors::read(uint32_t uptime) {
-    PacketComm        packet;
-    temperaturebeacon beacon;
-    beacon.deci = uptime;
-
+  void TemperatureSensors::sample(uint32_t uptime) {
+    Helpers::ProfileScope profile(Helpers::ProfileZone::TemperatureRead);
+    uint16_t              i = 0;
     for (auto &it : temp_sensors) {
       const int   reading      = analogRead(it.second);
       float       voltage      = reading * MV_PER_ADC_UNIT;
       const float temperatureF = (voltage - OFFSET_F) / MV_PER_DEGREE_F;
-      beacon.tmp36_tempC[std::distance(temp_sensors.begin(),
-                                       temp_sensors.find(it.first))] =
-          (temperatureF - 32) * 5 / 9;
+      Telemetry::publish(Telemetry::tmp36_tempC + i,
+                         (temperatureF - 32) * 5 / 9, uptime);
+      i++;
     }
+    Telemetry::publish(Telemetry::teensy_tempC,
+                       InternalTemperature.readTemperatureC(), uptime);
+  }
+
+  /**
+   * @brief Reads the satellite's temperature sensors.
+   *
+   * This method of the TemperatureSensors class samples the temperature
+   * sensors, stores the values in a temperaturebeacon, and transmits that
+   * beacon to the ground.
+   *
+   * @param uptime The time, in milliseconds, since the Teensy has been
+   * powered on.
+   */
+  void TemperatureSensors::read(uint32_t uptime) {
+    sample(uptime);
 
-    beacon.teensy_tempC    = InternalTemperature.readTemperatureC();
+    PacketComm        packet;
+    temperaturebeacon beacon;
+    beacon.deci = uptime;
+    for (int i = 0; i < ARTEMIS_TEMP_SENSOR_COUNT; i++) {
+      beacon.tmp36_tempC[i] = Telemetry::value(Telemetry::tmp36_tempC + i);
+    }
+    beacon.teensy_tempC    = Telemetry::value(Telemetry::teensy_tempC);
 
     packet.header.nodeorig = (uint8_t)NODES::TEENSY_NODE_ID;
     packet.header.nodedest = (uint8_t)NODES::GROUND_NODE_ID;
     packet.header.type     = PacketComm::TypeId::DataObcBeacon;
-    packet.data.resize(sizeof(beacon));
-    memcpy(packet.data.data(), &beacon, sizeof(beacon));
+    set_beacon_data(packet, beacon);
     packet.header.chanin  = 0;
     packet.header.chanout = Artemis::Channels::Channel_ID::RFM23_CHANNEL;
     route_packet_to_rfm23(packet);
+    Artemis::Channels::STORAGE::store_beacon(packet);
   }
 }
 }
\ No newline at end of file
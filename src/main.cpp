@@ -9,23 +9,30 @@
 #include "artemisbeacons.h"
 #include "channels/artemis_channels.h"
 #include "helpers.h"
+#include "main/main_channel.h"
 #include <Arduino.h>
+#include <EEPROM.h>
 #include <USBHost_t36.h>
+#include <beacon_plan.h>
+#include <clock_governor.h>
+#include <cyclic_executive.h>
+#include <heap_track.h>
 #include <pdu.h>
+#include <profiler.h>
 #include <support/configCosmosKernel.h>
 #include <vector>
 
-// For setting Teensy Clock Frequency (only for Teensy 4.0 and 4.1)
-#if defined(__IMXRT1062__)
-extern "C" uint32_t set_arm_clock(uint32_t frequency);
-#endif
-
 void setup_connections();
 void setup_devices();
-void setup_threads();
+void load_beacon_plan();
+void run_executive();
 
 void beacon_artemis_devices();
 void beacon_if_deployed();
+void send_planned_beacon(uint8_t entry);
+void sample_points(const Artemis::Beacons::beacon_plan_entry &plan_entry);
+void send_heap_beacon();
+void send_executive_beacon();
 void route_packets();
 
 void route_packet_to_ground();
@@ -34,6 +41,19 @@ void send_pong_reply();
 void enable_rpi();
 void report_rpi_enabled();
 void update_pdu_switches();
+void handle_beacon_plan();
+void report_beacon_plan_entry(uint8_t entry, uint8_t node);
+void handle_log_level();
+void handle_log_time();
+void handle_profile();
+void print_profile();
+void begin_command();
+void forward_command(bool tracked);
+void end_command();
+void time_command();
+
+PacketComm    packet;
+elapsedMillis uptime;
 
 namespace {
 using namespace Artemis;
@@ -42,34 +62,81 @@ Devices::Magnetometer       magnetometer;
 Devices::CurrentSensors     current_sensors;
 Devices::GPS                gps;
 Devices::TemperatureSensors temperature_sensors;
-PacketComm                  packet;
 USBHost                     usb;
-elapsedMillis               uptime;
 
 // Deployment variables
-elapsedMillis               deploymentbeacon;
-// const unsigned long readInterval = 300 * SECONDS; // Flight
-const unsigned long         readInterval = 20 * SECONDS; // Testing
+Beacons::BeaconScheduler    beacon_scheduler;
+
+// The acknowledgment of the command from the ground being routed, if any
+Commands::command_ack       current_ack;
+bool                        acknowledging  = false;
+// Whether the command is completed by the channel it is handed to
+bool                        tracking       = false;
+uint32_t                    command_start  = 0;
+// The number given to the next command from the ground
+uint16_t                    command_number = 0;
+
+#ifdef CYCLIC_EXECUTIVE
+// The tasks of the main channel, run by the cyclic executive
+enum class MainTask : uint8_t {
+  RoutePackets,
+  SampleGPS,
+  SendBeacons,
+  SuperviseChannels,
+  MonitorStacks,
+  GovernClock,
+};
+
+// The main channel's schedule, with the slots in order of their offsets
+const Helpers::executive_slot schedule[] = {
+    { 0,  1, 0,      (uint8_t)MainTask::RoutePackets},
+    {10,  1, 0,         (uint8_t)MainTask::SampleGPS},
+    {20,  1, 0,       (uint8_t)MainTask::SendBeacons},
+    {50,  1, 0,      (uint8_t)MainTask::RoutePackets},
+    {60,  1, 0, (uint8_t)MainTask::SuperviseChannels},
+    {70, 10, 0,     (uint8_t)MainTask::MonitorStacks},
+    {80,  1, 0,       (uint8_t)MainTask::GovernClock},
+};
+Helpers::CyclicExecutive executive(schedule,
+                                   sizeof(schedule) / sizeof(schedule[0]));
+#endif
 } // namespace
 
+#ifdef CYCLIC_EXECUTIVE
+static_assert((uint8_t)MainTask::GovernClock < ARTEMIS_EXECUTIVE_BEACON_COUNT,
+              "Every task of the main channel must fit in the executive "
+              "beacon");
+#endif
+
 /**
  * @brief Main setup function.
  *
  * This function is run once, when the Teensy is started. It initializes the
  * various sensors and connections on the Teensy.
  *
- * The frequency of the Teensy's processor is also set here. Allowed
- * frequencies in MHz are: 24, 150, 396, 450, 528, 600.
+ * The frequency of the Teensy's processor is also set here, to the highest
+ * the clock governor uses. Allowed frequencies in MHz are: 24, 150, 396, 450,
+ * 528, 600.
  */
 void setup() {
 #if defined(__IMXRT1062__)
-  set_arm_clock(450000000);
+  set_arm_clock(Helpers::governor_frequencies[GOVERNOR_LEVELS - 1]);
 #endif
+  Telemetry::set_scheduler([]() { threads.yield(); });
+  Helpers::set_heap_thread([]() -> uint8_t { return threads.id(); });
+  Helpers::trace_ingress(Helpers::TraceSource::Startup, nullptr, 0);
   setup_connections();
   delay(3 * SECONDS);
   setup_devices();
+  load_parameters();
+  load_beacon_plan();
+  load_command_schedule();
+  load_sequences();
   setup_threads();
   threads.delay(5 * SECONDS);
+#ifdef CYCLIC_EXECUTIVE
+  executive.start(uptime);
+#endif
   Helpers::print_debug(Helpers::MAIN, "Teensy Flight Software Setup Complete");
 }
 
@@ -79,14 +146,75 @@ void setup() {
  * This function runs in an infinite loop after setup() completes. It routes
  * packets among the various channels and periodically creates beacon packets
  * when in deployment mode. It also runs tests if they are enabled.
+ *
+ * With the CYCLIC_EXECUTIVE build flag, the same work is instead run at fixed
+ * times by the cyclic executive.
  */
 void loop() {
+#ifdef CYCLIC_EXECUTIVE
+  run_executive();
+#else
   beacon_if_deployed();
+  run_command_schedule();
+  run_sequence();
   route_packets();
+  send_acks();
   gps.update();
+  supervise_channels();
+  monitor_stacks();
+  govern_clock();
   threads.delay(100);
+#endif
 }
 
+#ifdef CYCLIC_EXECUTIVE
+/**
+ * @brief Helper function to run the next task of the main channel's schedule
+ * once it is due.
+ *
+ * The main channel sleeps until then. The time each task takes is kept by the
+ * executive, and sent in the executive beacon.
+ */
+void run_executive() {
+  const int8_t slot = executive.next(uptime);
+  if (slot < 0) {
+    threads.delay(executive.wait(uptime));
+    return;
+  }
+  const uint32_t start = micros();
+  switch ((MainTask)executive.task(slot)) {
+    case MainTask::RoutePackets: {
+      run_command_schedule();
+      run_sequence();
+      route_packets();
+      send_acks();
+      break;
+    }
+    case MainTask::SampleGPS: {
+      gps.update();
+      break;
+    }
+    case MainTask::SendBeacons: {
+      beacon_if_deployed();
+      break;
+    }
+    case MainTask::SuperviseChannels: {
+      supervise_channels();
+      break;
+    }
+    case MainTask::MonitorStacks: {
+      monitor_stacks();
+      break;
+    }
+    case MainTask::GovernClock: {
+      govern_clock();
+      break;
+    }
+  }
+  executive.finish(slot, micros() - start, uptime);
+}
+#endif
+
 /** @brief Helper function to set up connections on the Teensy. */
 void setup_connections() {
   Helpers::connect_serial_debug(115200);
@@ -110,42 +238,9 @@ void setup_devices() {
   if (!gps.setup()) {
     print_debug(Helpers::MAIN, "Failed to setup GPS");
   }
-}
-
-/** @brief Helper function to set up threads on the Teensy. */
-void setup_threads() {
-  if (threads.setSliceMillis(10) != 1) {
-    print_debug(Helpers::MAIN,
-                "Failed to assign computing time to all threads");
-  }
-
-  int thread_id = 0;
-  if ((thread_id =
-           threads.addThread(Channels::RFM23::rfm23_channel, 0, 4096)) == -1) {
-    print_debug(Helpers::MAIN, "Failed to start rfm23_channel");
-  } else {
-    thread_list.push_back({thread_id, Channels::Channel_ID::RFM23_CHANNEL});
-  }
-  if ((thread_id = threads.addThread(Channels::PDU::pdu_channel, 0, 8192)) ==
-      -1) {
-    print_debug(Helpers::MAIN, "Failed to start pdu_channel");
-  } else {
-    thread_list.push_back({thread_id, Channels::Channel_ID::PDU_CHANNEL});
-  }
-  if ((thread_id = threads.addThread(Channels::RPI::rpi_channel, 0, 4096)) ==
-      -1) {
-    print_debug(Helpers::MAIN, "Failed to start rpi_channel");
-  } else {
-    thread_list.push_back({thread_id, Channels::Channel_ID::RPI_CHANNEL});
-  }
-#ifdef TESTS
-  if ((thread_id = threads.addThread(Channels::TEST::test_channel, 0, 4096)) ==
-      -1) {
-    print_debug(Helpers::MAIN, "Failed to start test_channel");
-  } else {
-    thread_list.push_back({thread_id, Channels::Channel_ID::TEST_CHANNEL});
+  if (!(sdcardready = SD.begin(BUILTIN_SDCARD))) {
+    print_debug(Helpers::MAIN, "Failed to setup SD card");
   }
-#endif
 }
 
 /** @brief Helper function to poll Artemis devices for their readings. */
@@ -161,46 +256,240 @@ void beacon_artemis_devices() {
   gps.read(uptime);
 }
 
-/** @brief Helper function to beacon Artemis devices if in deployment mode. */
+/**
+ * @brief Helper function to load the beacon plan.
+ *
+ * The plan saved in EEPROM is used if it is whole. Otherwise, the default plan
+ * sends every device beacon each read interval.
+ */
+void load_beacon_plan() {
+  Beacons::beacon_plan plan;
+  EEPROM.get(BEACON_PLAN_EEPROM_ADDRESS, plan);
+  if (!Beacons::check_beacon_plan(plan)) {
+    print_debug(Helpers::MAIN, "Using the default beacon plan");
+    Beacons::default_beacon_plan(
+        plan, Parameters::get(Parameters::ReadInterval) / SECONDS);
+  }
+  beacon_scheduler.set_plan(plan, uptime);
+}
+
+/**
+ * @brief Helper function to beacon Artemis devices if in deployment mode.
+ *
+ * During deployment mode, beacons are sent as the beacon plan schedules them.
+ * At most one beacon is sent each time this is called.
+ */
 void beacon_if_deployed() {
-  // During deployment mode send beacons every 5 minutes for 2 weeks.
   if (deploymentmode) {
-    // Check if it's time to read the sensors
-    if (deploymentbeacon >= readInterval) {
-      Helpers::print_debug(Helpers::MAIN, "Deployment beacons sending");
-      beacon_artemis_devices();
+    const int8_t entry = beacon_scheduler.next(uptime);
+    if (entry >= 0) {
+      send_planned_beacon(entry);
+    }
+  }
+}
+
+/**
+ * @brief Helper function to send a beacon of the beacon plan.
+ *
+ * @param entry The number of the entry of the beacon plan.
+ */
+void send_planned_beacon(uint8_t entry) {
+  const Beacons::beacon_plan_entry &plan_entry =
+      beacon_scheduler.get_plan().entries[entry];
+  switch (plan_entry.beacon) {
+    case Devices::BeaconType::TemperatureBeacon: {
+      temperature_sensors.read(uptime);
+      break;
+    }
+    // Both current beacons are sent by the same read.
+    case Devices::BeaconType::CurrentBeacon1:
+    case Devices::BeaconType::CurrentBeacon2: {
+      current_sensors.read(uptime);
+      break;
+    }
+    case Devices::BeaconType::IMUBeacon: {
+      if (!imu.read(uptime)) {
+        print_debug(Helpers::MAIN, "Failed to read IMU");
+      }
+      break;
+    }
+    case Devices::BeaconType::MagnetometerBeacon: {
+      if (!magnetometer.read(uptime)) {
+        print_debug(Helpers::MAIN, "Failed to read magnetometer");
+      }
+      break;
+    }
+    case Devices::BeaconType::GPSBeacon: {
+      gps.read(uptime);
+      break;
+    }
+    case Devices::BeaconType::SwitchBeacon: {
       update_pdu_switches();
-      // Reset the timer
-      deploymentbeacon = 0;
+      break;
+    }
+    case Devices::BeaconType::PointBeacon: {
+      sample_points(plan_entry);
+      send_local_beacon(Beacons::make_point_beacon(plan_entry, entry, uptime));
+      break;
+    }
+    case Devices::BeaconType::StackBeacon: {
+      send_stack_beacon();
+      break;
+    }
+    case Devices::BeaconType::HeapBeacon: {
+      send_heap_beacon();
+      break;
+    }
+    case Devices::BeaconType::CpuBeacon: {
+      send_cpu_beacon();
+      break;
+    }
+    case Devices::BeaconType::RestartBeacon: {
+      send_restart_beacon();
+      break;
+    }
+#ifdef CYCLIC_EXECUTIVE
+    case Devices::BeaconType::ExecutiveBeacon: {
+      send_executive_beacon();
+      break;
+    }
+#endif
+    default: {
+      break;
+    }
+  }
+}
+
+/**
+ * @brief Helper function to sample the devices of a point beacon.
+ *
+ * Each device is sampled once, however many of its points are in the beacon.
+ *
+ * @param plan_entry The entry of the beacon plan.
+ */
+void sample_points(const Beacons::beacon_plan_entry &plan_entry) {
+  uint8_t sampled = 0;
+  for (uint8_t i = 0; i < plan_entry.count; i++) {
+    const Telemetry::Source source =
+        Telemetry::point_source(plan_entry.points[i]);
+    if (sampled & (1 << (uint8_t)source)) {
+      continue;
     }
+    sampled |= 1 << (uint8_t)source;
+    sample_source(source);
   }
 }
 
+/**
+ * @brief Helper function to sample a device, publishing its telemetry points.
+ *
+ * @param source The device.
+ */
+void sample_source(Telemetry::Source source) {
+  switch (source) {
+    case Telemetry::Source::TemperatureSensors: {
+      temperature_sensors.sample(uptime);
+      break;
+    }
+    case Telemetry::Source::CurrentSensors: {
+      current_sensors.sample(uptime);
+      break;
+    }
+    case Telemetry::Source::IMU: {
+      if (!imu.sample(uptime)) {
+        print_debug(Helpers::MAIN, "Failed to read IMU");
+      }
+      break;
+    }
+    case Telemetry::Source::Magnetometer: {
+      if (!magnetometer.sample(uptime)) {
+        print_debug(Helpers::MAIN, "Failed to read magnetometer");
+      }
+      break;
+    }
+    case Telemetry::Source::GPS: {
+      gps.sample(uptime);
+      break;
+    }
+  }
+}
+
+/**
+ * @brief Helper function to send a heap beacon.
+ *
+ * The allocation counts of each HeapTag wrap around at 65535, so only their
+ * change from one beacon to the next is meaningful.
+ */
+void send_heap_beacon() {
+  Beacons::heapbeacon beacon;
+  beacon.live    = Helpers::heap_live();
+  beacon.peak    = Helpers::heap_peak();
+  beacon.free    = Helpers::heap_free();
+  beacon.largest = Helpers::heap_largest_free();
+  for (uint8_t i = 0; i < ARTEMIS_HEAP_BEACON_COUNT; i++) {
+    beacon.allocs[i] = Helpers::get_heap_tag((Helpers::HeapTag)i).allocs;
+  }
+  beacon.deci = uptime;
+  send_local_beacon(beacon);
+}
+
+#ifdef CYCLIC_EXECUTIVE
+/**
+ * @brief Helper function to send an executive beacon.
+ *
+ * The tasks are in the order of MainTask.
+ */
+void send_executive_beacon() {
+  Beacons::executivebeacon beacon;
+  beacon.skipped = executive.skipped();
+  for (uint8_t i = 0; i < ARTEMIS_EXECUTIVE_BEACON_COUNT; i++) {
+    const Helpers::executive_task &task = executive.get_task(i);
+    beacon.worst[i]                     = task.worst_us;
+    beacon.overruns[i]                  = task.overruns;
+  }
+  beacon.deci = uptime;
+  send_local_beacon(beacon);
+}
+#endif
+
 /** @brief Helper function to route packets. */
 void route_packets() {
   if (PullQueue(packet, main_queue, main_queue_mtx)) {
+    Helpers::ProfileScope profile(Helpers::ProfileZone::RoutePackets);
+    observe_sequence((uint16_t)packet.header.type);
     if (packet.header.nodedest == (uint8_t)NODES::GROUND_NODE_ID) {
       route_packet_to_ground();
     } else if (packet.header.nodedest == (uint8_t)NODES::RPI_NODE_ID) {
+      begin_command();
+      forward_command(false);
       ensure_rpi_is_powered();
       route_packet_to_rpi(packet);
+      end_command();
     } else if (packet.header.nodedest == (uint8_t)NODES::TEENSY_NODE_ID) {
-      switch (packet.header.type) {
-        case PacketComm::TypeId::CommandObcPing: {
+      begin_command();
+      switch ((uint16_t)packet.header.type) {
+        case (uint16_t)PacketComm::TypeId::CommandObcPing: {
           send_pong_reply();
           break;
         }
-        case PacketComm::TypeId::CommandEpsCommunicate: {
+        case (uint16_t)PacketComm::TypeId::CommandEpsCommunicate: {
+          forward_command(true);
           route_packet_to_pdu(packet);
           break;
         }
-        case PacketComm::TypeId::CommandEpsSwitchName: {
+        case (uint16_t)PacketComm::TypeId::CommandEpsSwitchName: {
+          if (packet.data.size() < 2) {
+            print_debug(Helpers::MAIN, "Switch command too short");
+            reject_command(Commands::AckResult::BadLength);
+            break;
+          }
           Devices::PDU::PDU_SW switchid = (Devices::PDU::PDU_SW)packet.data[0];
           switch (switchid) {
             case Devices::PDU::PDU_SW::RPI: {
               if (packet.data[1] == 0) {
+                forward_command(false);
                 route_packet_to_rpi(packet);
-              } else if (packet.data[2] == 1) {
+              } else if (packet.data.size() > 2 && packet.data[2] == 1) {
                 enable_rpi();
                 threads.delay(5 * SECONDS);
               } else {
@@ -209,13 +498,19 @@ void route_packets() {
               break;
             }
             default: {
+              forward_command(true);
               route_packet_to_pdu(packet);
               break;
             }
           }
           break;
         }
-        case PacketComm::TypeId::CommandEpsSwitchStatus: {
+        case (uint16_t)PacketComm::TypeId::CommandEpsSwitchStatus: {
+          if (packet.data.empty()) {
+            print_debug(Helpers::MAIN, "Switch status command too short");
+            reject_command(Commands::AckResult::BadLength);
+            break;
+          }
           Devices::PDU::PDU_SW switchid = (Devices::PDU::PDU_SW)packet.data[0];
           switch (switchid) {
             case Devices::PDU::PDU_SW::RPI: {
@@ -223,21 +518,58 @@ void route_packets() {
               break;
             }
             default: {
+              forward_command(true);
               route_packet_to_pdu(packet);
               break;
             }
           }
           break;
         }
-        case PacketComm::TypeId::CommandObcSendBeacon: {
+        case (uint16_t)PacketComm::TypeId::CommandObcSendBeacon: {
           beacon_artemis_devices();
           update_pdu_switches();
           break;
         }
+        case (uint16_t)ArtemisTypeId::CommandLogQuery:
+        case (uint16_t)ArtemisTypeId::CommandFirmware: {
+          forward_command(true);
+          route_packet_to_storage(packet);
+          break;
+        }
+        case (uint16_t)ArtemisTypeId::CommandBeaconPlan: {
+          handle_beacon_plan();
+          break;
+        }
+        case (uint16_t)ArtemisTypeId::CommandLogLevel: {
+          handle_log_level();
+          break;
+        }
+        case (uint16_t)ArtemisTypeId::CommandProfile: {
+          handle_profile();
+          break;
+        }
+        case (uint16_t)ArtemisTypeId::CommandSchedule: {
+          handle_schedule();
+          break;
+        }
+        case (uint16_t)ArtemisTypeId::CommandLogTime: {
+          handle_log_time();
+          break;
+        }
+        case (uint16_t)ArtemisTypeId::CommandSequence: {
+          handle_sequence();
+          break;
+        }
+        case (uint16_t)ArtemisTypeId::CommandParameter: {
+          handle_parameters();
+          break;
+        }
         default: {
+          reject_command(Commands::AckResult::UnknownCommand);
           break;
         }
       }
+      end_command();
     }
   }
 }
@@ -258,14 +590,31 @@ void route_packet_to_ground() {
 /**
  * @brief Helper function to ensure the Raspberry Pi is powered.
  *
+ * The Raspberry Pi is only turned on if the battery voltage in the telemetry
+ * point store is high enough.
+ *
  * @todo This should still function if the current sensors are not enabled via
  * build flags.
  */
 void ensure_rpi_is_powered() {
   if (!digitalRead(UART6_RX)) {
-    float curr_V =
-        current_sensors.current_sensors["battery_board"]->getBusVoltage_V();
-    if (curr_V >= 7.0) {
+    const auto sensor = current_sensors.current_sensors.find("battery_board");
+    if (sensor == current_sensors.current_sensors.end()) {
+      print_debug(Helpers::MAIN, "No battery current sensor");
+      update_pdu_switches();
+      return;
+    }
+    // Only go to the current sensor if its last reading is out of date.
+    const uint16_t battery =
+        Telemetry::busvoltage +
+        std::distance(current_sensors.current_sensors.begin(), sensor);
+    Telemetry::point_value voltage;
+    if (!Telemetry::read(battery, voltage) ||
+        uptime - voltage.timestamp >
+            Parameters::get(Parameters::ReadInterval)) {
+      current_sensors.sample(uptime);
+    }
+    if (Telemetry::value(battery) >= 7.0) {
       enable_rpi();
       threads.delay(5 * SECONDS);
     } else {
@@ -287,16 +636,20 @@ void send_pong_reply() {
   route_packet_to_ground();
 }
 
-/** @brief Helper function to enable the Raspberry Pi. */
+/**
+ * @brief Helper function to enable the Raspberry Pi.
+ *
+ * The Raspberry Pi channel is started if it is not already running.
+ */
 void enable_rpi() {
   Helpers::print_debug(Helpers::MAIN, "Turning on RPi");
   digitalWrite(RPI_ENABLE, HIGH);
-  int thread_id = 0;
-  if ((thread_id = threads.addThread(Channels::RPI::rpi_channel)) == -1) {
-    print_debug(Helpers::MAIN, "Failed to start rpi_channel");
-  } else {
-    thread_list.push_back({thread_id, Channels::Channel_ID::RPI_CHANNEL});
+  for (const thread_struct &thread : thread_list) {
+    if (thread.channel_id == Channels::Channel_ID::RPI_CHANNEL) {
+      return;
+    }
   }
+  launch_channel(Channels::Channel_ID::RPI_CHANNEL);
 }
 
 /** @brief Helper function to report if the Raspberry Pi is enabled. */
@@ -312,9 +665,274 @@ void report_rpi_enabled() {
 /** @brief Helper function to request PDU switch state update. */
 void update_pdu_switches() {
   packet.header.type     = PacketComm::TypeId::CommandEpsSwitchStatus;
-  packet.header.nodeorig = (uint8_t)NODES::GROUND_NODE_ID;
+  packet.header.nodeorig = (uint8_t)NODES::TEENSY_NODE_ID;
   packet.header.nodedest = (uint8_t)NODES::TEENSY_NODE_ID;
   packet.data.clear();
   packet.data.push_back((uint8_t)Artemis::Devices::PDU::PDU_SW::All);
   route_packet_to_pdu(packet);
 }
+
+/**
+ * @brief Helper function to change or report the beacon plan.
+ *
+ * The packet carries a beacon_plan_update. If it only carries the entry
+ * number, that entry is reported without being changed. Changes are saved to
+ * EEPROM so that they survive a reset, and the changed entries are reported.
+ */
+void handle_beacon_plan() {
+  if (packet.data.empty()) {
+    reject_command(Commands::AckResult::BadLength);
+    return;
+  }
+  const uint8_t               node = packet.header.nodeorig;
+  Beacons::beacon_plan_update update;
+  update.entry = packet.data[0];
+
+  if (update.entry == BEACON_PLAN_DEFAULT) {
+    Beacons::beacon_plan plan;
+    Beacons::default_beacon_plan(
+        plan, Parameters::get(Parameters::ReadInterval) / SECONDS);
+    beacon_scheduler.set_plan(plan, uptime);
+    EEPROM.put(BEACON_PLAN_EEPROM_ADDRESS, beacon_scheduler.get_plan());
+    for (uint8_t i = 0; i < BEACON_PLAN_ENTRIES; i++) {
+      report_beacon_plan_entry(i, node);
+    }
+    return;
+  }
+  if (update.entry >= BEACON_PLAN_ENTRIES) {
+    print_debug(Helpers::MAIN, "No such beacon plan entry");
+    reject_command(Commands::AckResult::BadValue);
+    return;
+  }
+  if (packet.data.size() >= sizeof(update)) {
+    memcpy(&update, packet.data.data(), sizeof(update));
+    if (beacon_scheduler.set_entry(update.entry, update.plan_entry, uptime)) {
+      EEPROM.put(BEACON_PLAN_EEPROM_ADDRESS, beacon_scheduler.get_plan());
+    } else {
+      print_debug(Helpers::MAIN, "Invalid beacon plan entry");
+      reject_command(Commands::AckResult::BadValue);
+    }
+  }
+  report_beacon_plan_entry(update.entry, node);
+}
+
+/**
+ * @brief Helper function to report an entry of the beacon plan.
+ *
+ * @param entry The number of the entry.
+ * @param node The node that asked for the entry.
+ */
+void report_beacon_plan_entry(uint8_t entry, uint8_t node) {
+  Beacons::beacon_plan_update update;
+  update.entry           = entry;
+  update.plan_entry      = beacon_scheduler.get_plan().entries[entry];
+  packet.header.type     = ArtemisTypeId::DataBeaconPlan;
+  packet.header.nodeorig = (uint8_t)NODES::TEENSY_NODE_ID;
+  packet.header.nodedest = node;
+  packet.data.resize(sizeof(update));
+  memcpy(packet.data.data(), &update, sizeof(update));
+  route_packet_to_rfm23(packet);
+}
+
+/**
+ * @brief Helper function to change or report the runtime log levels.
+ *
+ * The packet carries a channel's Short_Name, or 0 for every channel, and the
+ * new Helpers::LogLevel. The levels of every channel are reported, whether
+ * they changed or not. Levels below the build's log floor have no effect.
+ */
+void handle_log_level() {
+  if (packet.data.size() >= 2 &&
+      !Helpers::set_log_level(packet.data[0],
+                              (Helpers::LogLevel)packet.data[1])) {
+    print_debug(Helpers::MAIN, "Invalid log level");
+    reject_command(Commands::AckResult::BadValue);
+  }
+  packet.header.type     = ArtemisTypeId::DataLogLevels;
+  packet.header.nodedest = packet.header.nodeorig;
+  packet.header.nodeorig = (uint8_t)NODES::TEENSY_NODE_ID;
+  packet.data.resize(DEBUG_LOG_CHANNELS);
+  for (uint8_t i = 0; i < DEBUG_LOG_CHANNELS; i++) {
+    packet.data[i] = (uint8_t)Helpers::log_levels[i].load();
+  }
+  route_packet_to_rfm23(packet);
+}
+
+/**
+ * @brief Helper function to report or move forward the log time.
+ *
+ * The packet carries the new log time, in seconds, if it is to be moved. The
+ * log time is reported to the node that sent the command either way, so the
+ * ground can see how far it is from its own clock.
+ */
+void handle_log_time() {
+  if (!packet.data.empty()) {
+    uint32_t seconds;
+    if (packet.data.size() < sizeof(seconds)) {
+      print_debug(Helpers::MAIN, "Log time command too short");
+      reject_command(Commands::AckResult::BadLength);
+    } else {
+      memcpy(&seconds, packet.data.data(), sizeof(seconds));
+      if (!Channels::STORAGE::set_log_time(seconds)) {
+        print_debug(Helpers::MAIN, "Log time cannot be moved back");
+        reject_command(Commands::AckResult::BadValue);
+      }
+    }
+  }
+  const uint64_t now     = Channels::STORAGE::log_time_ms();
+  packet.header.type     = ArtemisTypeId::DataLogTime;
+  packet.header.nodedest = packet.header.nodeorig;
+  packet.header.nodeorig = (uint8_t)NODES::TEENSY_NODE_ID;
+  packet.data.resize(sizeof(now));
+  memcpy(packet.data.data(), &now, sizeof(now));
+  route_packet_to_rfm23(packet);
+}
+
+/**
+ * @brief Helper function to report, reset or print the profiler's times.
+ *
+ * The packet carries a Helpers::ProfileAction. Reports are sent to the node
+ * that asked for them, one DataProfile packet for each zone.
+ */
+void handle_profile() {
+  const Helpers::ProfileAction action =
+      packet.data.empty() ? Helpers::ProfileAction::Report
+                          : (Helpers::ProfileAction)packet.data[0];
+  switch (action) {
+    case Helpers::ProfileAction::Report: {
+      packet.header.type     = ArtemisTypeId::DataProfile;
+      packet.header.nodedest = packet.header.nodeorig;
+      packet.header.nodeorig = (uint8_t)NODES::TEENSY_NODE_ID;
+      for (uint8_t i = 0; i < Helpers::PROFILE_ZONE_COUNT; i++) {
+        const Helpers::profile_report report =
+            Helpers::make_profile_report((Helpers::ProfileZone)i);
+        packet.data.resize(sizeof(report));
+        memcpy(packet.data.data(), &report, sizeof(report));
+        route_packet_to_rfm23(packet);
+      }
+      break;
+    }
+    case Helpers::ProfileAction::Reset: {
+      Helpers::reset_profile();
+      break;
+    }
+    case Helpers::ProfileAction::Print: {
+      print_profile();
+      break;
+    }
+    default: {
+      print_debug(Helpers::MAIN, "Invalid profile action");
+      reject_command(Commands::AckResult::BadValue);
+      break;
+    }
+  }
+}
+
+/**
+ * @brief Helper function to start the acknowledgment of the command being
+ * routed.
+ *
+ * Only commands from the ground are acknowledged, and each is given the next
+ * command number. This includes the scheduled commands, which are released
+ * with the ground as their origin.
+ */
+void begin_command() {
+  acknowledging = packet.header.nodeorig == (uint8_t)NODES::GROUND_NODE_ID;
+  if (!acknowledging) {
+    return;
+  }
+  current_ack.number  = command_number++;
+  current_ack.type    = (uint16_t)packet.header.type;
+  current_ack.status  = Commands::AckStatus::Executed;
+  current_ack.result  = Commands::AckResult::Ok;
+  current_ack.time_ms = 0;
+  tracking            = false;
+  command_start       = millis();
+}
+
+/**
+ * @brief Helper function to acknowledge the command being routed as handed to
+ * another channel.
+ *
+ * A tracked command is handed to the acknowledgment collector here, before
+ * the packet is queued, as the channel may complete it straight away.
+ *
+ * @param tracked Whether the channel completes the command, as the PDU and
+ * storage channels do. Commands handed to the Raspberry Pi are not.
+ */
+void forward_command(bool tracked) {
+  current_ack.status = Commands::AckStatus::Accepted;
+  tracking           = tracked;
+  if (acknowledging && tracking) {
+    time_command();
+    accept_command(current_ack);
+  }
+}
+
+/**
+ * @brief Helper function to acknowledge the command being routed as rejected.
+ *
+ * @param result Why the command was not run.
+ */
+void reject_command(Commands::AckResult result) {
+  current_ack.status = Commands::AckStatus::Rejected;
+  current_ack.result = result;
+}
+
+/**
+ * @brief Helper function to acknowledge the command being routed as failed.
+ *
+ * @param result Why the command did not succeed.
+ */
+void fail_command(Commands::AckResult result) {
+  current_ack.status = Commands::AckStatus::Failed;
+  current_ack.result = result;
+}
+
+/**
+ * @brief Helper function to queue the acknowledgment of the command routed.
+ *
+ * They are sent to the ground a few at a time by send_acks().
+ */
+void end_command() {
+  if (!acknowledging) {
+    return;
+  }
+  acknowledging = false;
+  if (!tracking) {
+    time_command();
+    report_ack(current_ack);
+  }
+}
+
+/**
+ * @brief Helper function to record the time taken so far by the command being
+ * routed in its acknowledgment.
+ */
+void time_command() {
+  const uint32_t elapsed = millis() - command_start;
+  current_ack.time_ms    = elapsed > UINT16_MAX ? UINT16_MAX : elapsed;
+}
+
+/**
+ * @brief Helper function to print the profiler's times to the debug serial
+ * port.
+ *
+ * Times are printed in nanoseconds. Each line of the histogram gives the
+ * lowest time of its bin and the number of runs in it.
+ */
+void print_profile() {
+  for (uint8_t i = 0; i < Helpers::PROFILE_ZONE_COUNT; i++) {
+    const Helpers::ProfileZone    zone  = (Helpers::ProfileZone)i;
+    const Helpers::profile_stats &stats = Helpers::get_profile(zone);
+    print_debug(Helpers::MAIN, Helpers::profile_zone_name(zone),
+                ": calls=", stats.calls, " total=", stats.total,
+                " max=", stats.max);
+    for (uint8_t bin = 0; bin < PROFILE_BINS; bin++) {
+      if (stats.histogram[bin] > 0) {
+        print_debug(Helpers::MAIN, "  >=", bin == 0 ? 0 : 1ul << bin, ": ",
+                    stats.histogram[bin]);
+      }
+    }
+  }
+}
@@ -0,0 +1,215 @@
+/**
+ * @file parameters.cpp
+ * @brief The main channel's handling of the parameter table.
+ *
+ * This file contains the part of the main channel that loads the parameter
+ * table from EEPROM, changes, reports and saves it for the ground, and tries
+ * new radio frequencies until the ground confirms them.
+ */
+#include "main/main_channel.h"
+#include <EEPROM.h>
+#include <beacon_plan.h>
+
+void report_parameters(const uint8_t *ids, size_t count, uint8_t node);
+void restart_radio(uint16_t frequency);
+
+namespace {
+using namespace Artemis;
+// The frequency the radio is on, and while the ground tries a new one, the
+// frequency to go back to unless it is confirmed in time
+uint16_t radio_frequency   = 0;
+bool     radio_trial       = false;
+uint16_t radio_fallback    = 0;
+uint32_t radio_trial_start = 0;
+} // namespace
+
+static_assert(sizeof(Beacons::beacon_plan) <= PARAMETER_EEPROM_ADDRESS,
+              "The beacon plan must not overlap the parameter table in EEPROM");
+
+/**
+ * @brief Helper function to load the parameter table.
+ *
+ * The table saved in EEPROM is used if it is whole and every value is in
+ * range. Otherwise, every parameter keeps its default.
+ */
+void load_parameters() {
+  Parameters::parameter_image image;
+  EEPROM.get(PARAMETER_EEPROM_ADDRESS, image);
+  if (!Parameters::load(image)) {
+    print_debug(Helpers::MAIN, "Using the default parameters");
+  }
+  radio_frequency = Parameters::get(Parameters::RadioFrequency);
+  Channels::RFM23::set_frequency(radio_frequency);
+}
+
+/**
+ * @brief Helper function to report, change or save the parameter table.
+ *
+ * The packet carries a Parameters::ParameterAction and its operands. Changes
+ * take effect straight away, and are saved to EEPROM only by Commit, so that
+ * a change that cuts the link is undone by a reset. A radio frequency is only
+ * saved once the ground has confirmed it can hear the radio on it. The
+ * entries of a Set are applied in order, up to the first that is invalid.
+ * Every action but Commit is answered with the parameters' values.
+ */
+void handle_parameters() {
+  if (packet.data.empty()) {
+    print_debug(Helpers::MAIN, "Parameter command too short");
+    reject_command(Commands::AckResult::BadLength);
+    return;
+  }
+  const uint8_t  node = packet.header.nodeorig;
+  const size_t   size = packet.data.size();
+  const uint8_t *data = packet.data.data();
+  switch ((Parameters::ParameterAction)data[0]) {
+    case Parameters::ParameterAction::Get: {
+      for (size_t i = 1; i < size; i++) {
+        if (data[i] >= Parameters::PARAMETER_COUNT) {
+          print_debug(Helpers::MAIN, "No parameter ", (uint16_t)data[i]);
+          reject_command(Commands::AckResult::BadValue);
+          return;
+        }
+      }
+      report_parameters(size > 1 ? data + 1 : nullptr, size - 1, node);
+      break;
+    }
+    case Parameters::ParameterAction::Set: {
+      if ((size - 1) % sizeof(Parameters::parameter_entry) != 0) {
+        print_debug(Helpers::MAIN, "Parameter entries cut short");
+        reject_command(Commands::AckResult::BadLength);
+        return;
+      }
+      for (size_t offset = 1; offset < size;
+           offset += sizeof(Parameters::parameter_entry)) {
+        Parameters::parameter_entry entry;
+        memcpy(&entry, data + offset, sizeof(entry));
+        if (!Parameters::set(entry.id, entry.value)) {
+          print_debug(Helpers::MAIN, "Invalid parameter ", (uint16_t)entry.id);
+          reject_command(Commands::AckResult::BadValue);
+          return;
+        }
+      }
+      report_parameters(nullptr, 0, node);
+      break;
+    }
+    case Parameters::ParameterAction::Commit: {
+      if (radio_trial) {
+        print_debug(Helpers::MAIN, "Radio frequency not yet confirmed");
+        reject_command(Commands::AckResult::BadValue);
+        return;
+      }
+      // Outside a trial, the radio is on the last frequency confirmed, or
+      // loaded at startup, whatever RadioFrequency has since been set to.
+      Parameters::parameter_entry radio;
+      radio.id    = (uint8_t)Parameters::ParameterId::RadioFrequency;
+      radio.value = radio_frequency;
+      Parameters::parameter_image image;
+      Parameters::seal(image, &radio);
+      EEPROM.put(PARAMETER_EEPROM_ADDRESS, image);
+      break;
+    }
+    case Parameters::ParameterAction::Reset: {
+      Parameters::reset();
+      report_parameters(nullptr, 0, node);
+      break;
+    }
+    case Parameters::ParameterAction::TryRadio: {
+      // A frequency tried after another is still unconfirmed goes back to
+      // the last confirmed one.
+      if (!radio_trial) {
+        radio_fallback = radio_frequency;
+      }
+      radio_trial       = true;
+      radio_trial_start = uptime;
+      restart_radio(Parameters::get(Parameters::RadioFrequency));
+      break;
+    }
+    case Parameters::ParameterAction::ConfirmRadio: {
+      if (!radio_trial) {
+        print_debug(Helpers::MAIN, "No radio frequency is being tried");
+        reject_command(Commands::AckResult::BadValue);
+        return;
+      }
+      radio_trial = false;
+      break;
+    }
+    default: {
+      print_debug(Helpers::MAIN, "Invalid parameter action");
+      reject_command(Commands::AckResult::BadValue);
+      break;
+    }
+  }
+}
+
+/**
+ * @brief Helper function to report the values of parameters.
+ *
+ * Each DataParameter packet carries as many Parameters::parameter_entry
+ * values as fit in a radio packet.
+ *
+ * @param ids The ParameterIds of the parameters, or nullptr for every
+ * parameter. Ids that do not exist are skipped.
+ * @param count The number of ids.
+ * @param node The node that asked for the parameters.
+ */
+void report_parameters(const uint8_t *ids, size_t count, uint8_t node) {
+  PacketComm report;
+  report.header.type     = ArtemisTypeId::DataParameter;
+  report.header.nodeorig = (uint8_t)NODES::TEENSY_NODE_ID;
+  report.header.nodedest = node;
+  if (ids == nullptr) {
+    count = Parameters::PARAMETER_COUNT;
+  }
+  for (size_t i = 0; i < count; i++) {
+    Parameters::parameter_entry entry;
+    entry.id = ids == nullptr ? i : ids[i];
+    if (entry.id >= Parameters::PARAMETER_COUNT) {
+      continue;
+    }
+    entry.value = Parameters::get_raw(entry.id);
+    if (report.data.size() + sizeof(entry) > TELEMETRY_LOG_RECORD_DATA) {
+      route_packet_to_rfm23(report);
+      report.data.clear();
+    }
+    report.data.insert(report.data.end(), (const uint8_t *)&entry,
+                       (const uint8_t *)&entry + sizeof(entry));
+  }
+  if (!report.data.empty()) {
+    route_packet_to_rfm23(report);
+  }
+}
+
+/**
+ * @brief Helper function to start the radio again on a frequency.
+ *
+ * Packets waiting to be sent are kept, and are sent on the new frequency.
+ *
+ * @param frequency The frequency, in MHz.
+ */
+void restart_radio(uint16_t frequency) {
+  print_debug(Helpers::MAIN, "Restarting the radio on ", frequency, " MHz");
+  stop_channel(Channels::Channel_ID::RFM23_CHANNEL);
+  radio_frequency = frequency;
+  Channels::RFM23::set_frequency(frequency);
+  launch_channel(Channels::Channel_ID::RFM23_CHANNEL);
+}
+
+/**
+ * @brief Helper function to end a trial of a radio frequency that the ground
+ * has not confirmed in time.
+ *
+ * The RadioFrequency parameter is put back as well, so that it reports the
+ * frequency the radio is on.
+ */
+void check_radio_trial() {
+  if (!radio_trial || uptime - radio_trial_start < RADIO_TRIAL_TIMEOUT) {
+    return;
+  }
+  radio_trial = false;
+  Helpers::print_log<Helpers::LogLevel::Warning>(
+      Helpers::MAIN, "Radio frequency ", radio_frequency,
+      " MHz was not confirmed");
+  Parameters::set((uint8_t)Parameters::ParameterId::RadioFrequency,
+                  radio_fallback);
+  restart_radio(radio_fallback);
+}
@@ -0,0 +1,439 @@
+/**
+ * @file scheduling.cpp
+ * @brief The main channel's command schedule and sequences.
+ *
+ * This file contains the part of the main channel that keeps the time-tagged
+ * commands and the command sequences uploaded from the ground on the SD card,
+ * and sends their commands to the main channel as they come due.
+ */
+#include "main/main_channel.h"
+#include <checksum.h>
+#include <command_schedule.h>
+#include <command_sequence.h>
+
+void save_command_schedule();
+void restart_listing();
+void report_scheduled_command(
+    const Artemis::Commands::scheduled_command *command, uint8_t node);
+void report_sequence_status(uint8_t node);
+
+namespace {
+using namespace Artemis;
+// Time-tagged commands from the ground, kept on the SD card
+Commands::CommandSchedule command_schedule;
+Storage::SDBlockDevice    schedule_file;
+// The next command of the schedule to be listed, and the node listing it.
+// The index is COMMAND_SCHEDULE_SIZE when no listing is being sent.
+uint8_t                   list_index = COMMAND_SCHEDULE_SIZE;
+uint8_t                   list_node  = 0;
+
+// Command sequences from the ground, kept on the SD card
+Commands::sequence_slot   sequences[SEQUENCE_SLOTS];
+Commands::SequenceEngine  sequence_engine;
+Storage::SDBlockDevice    sequence_file;
+// The node that started the sequence running, told when it ends
+uint8_t                   sequence_node        = 0;
+// The instruction whose telemetry point was last sampled, and when
+uint16_t                  sampled_position     = 0;
+uint32_t                  last_sequence_sample = 0;
+} // namespace
+
+/**
+ * @brief Helper function to load the command schedule.
+ *
+ * The schedule saved on the SD card is used if it is whole. Otherwise, the
+ * schedule starts empty. No command is sent until the ground has set the log
+ * time with CommandLogTime, as log time only runs on from the newest record
+ * in the log after a reset. Commands that came due while the Teensy was off
+ * are then sent at once.
+ */
+void load_command_schedule() {
+  static Commands::command_schedule_image stored;
+  Helpers::MutexScope                     lock(sd_mtx);
+  if (!sdcardready || !schedule_file.open(COMMAND_SCHEDULE_PATH)) {
+    print_debug(Helpers::MAIN, "Failed to open the command schedule");
+    return;
+  }
+  if (!schedule_file.read(0, (uint8_t *)&stored, sizeof(stored)) ||
+      !command_schedule.load(stored)) {
+    print_debug(Helpers::MAIN, "Starting with an empty command schedule");
+    return;
+  }
+  print_debug(Helpers::MAIN, "Loaded ", (uint16_t)command_schedule.size(),
+              " scheduled commands");
+}
+
+/**
+ * @brief Helper function to save the command schedule to the SD card.
+ *
+ * The whole schedule is rewritten, and is discarded at startup if a reset
+ * cuts the write short.
+ */
+void save_command_schedule() {
+  const Commands::command_schedule_image &image = command_schedule.seal();
+  Helpers::MutexScope                     lock(sd_mtx);
+  if (!schedule_file.write(0, (const uint8_t *)&image, sizeof(image)) ||
+      !schedule_file.sync()) {
+    print_debug(Helpers::MAIN, "Failed to save the command schedule");
+  }
+}
+
+/**
+ * @brief Helper function to send scheduled commands once they are due, and
+ * to continue a listing of the schedule.
+ *
+ * Due commands are sent to the main channel as if they had come from the
+ * ground, and are routed like any other packet. They are held until the log
+ * time has been synced to the ground's clock. They are sent while the main
+ * channel's queue has room for them, so a burst of commands due together is
+ * not dropped. Listed commands are likewise sent while the RFM23's queue has
+ * room.
+ */
+void run_command_schedule() {
+  bool released = false;
+  if (command_schedule.size() > 0 && Channels::STORAGE::log_time_synced()) {
+    const uint64_t              now = Channels::STORAGE::log_time_ms();
+    Commands::scheduled_command command;
+    while (main_queue.size() < Parameters::get(Parameters::QueueSize) / 2 &&
+           command_schedule.pop_due(now, command)) {
+      PacketComm scheduled;
+      scheduled.header.type     = (PacketComm::TypeId)command.tag.type;
+      scheduled.header.nodeorig = (uint8_t)NODES::GROUND_NODE_ID;
+      scheduled.header.nodedest = command.tag.node;
+      scheduled.header.chanin   = 0;
+      scheduled.header.chanout  = Channels::Channel_ID::RFM23_CHANNEL;
+      scheduled.data.assign(command.data, command.data + command.tag.size);
+      route_packet_to_main(scheduled);
+      print_debug(Helpers::MAIN, "Sent scheduled command ", command.id);
+      released = true;
+    }
+  }
+  if (released) {
+    save_command_schedule();
+    restart_listing();
+  }
+  while (list_index < command_schedule.size() &&
+         rfm23_queue.size() < Parameters::get(Parameters::QueueSize) / 2) {
+    report_scheduled_command(&command_schedule.get(list_index++), list_node);
+  }
+  if (list_index >= command_schedule.size()) {
+    list_index = COMMAND_SCHEDULE_SIZE;
+  }
+}
+
+/**
+ * @brief Helper function to start a listing of the command schedule again
+ * after the schedule has changed, if one is being sent.
+ *
+ * The commands are listed in heap order, which a change can rearrange.
+ */
+void restart_listing() {
+  if (list_index < COMMAND_SCHEDULE_SIZE) {
+    list_index = 0;
+  }
+}
+
+/**
+ * @brief Helper function to change or report the command schedule.
+ *
+ * The packet carries a Commands::ScheduleAction. Each command added is
+ * reported with the id it was given. A listing is sent a few commands at a
+ * time by run_command_schedule(), and starts again from the first command if
+ * the schedule changes before it ends. Other actions only report the number
+ * of commands left. Changes are saved to the SD card so that they survive a
+ * reset.
+ */
+void handle_schedule() {
+  if (packet.data.empty()) {
+    print_debug(Helpers::MAIN, "Schedule command too short");
+    reject_command(Commands::AckResult::BadLength);
+    return;
+  }
+  const uint8_t node = packet.header.nodeorig;
+  const size_t  size = packet.data.size();
+  switch ((Commands::ScheduleAction)packet.data[0]) {
+    case Commands::ScheduleAction::Add: {
+      for (size_t offset = 1; offset < size;) {
+        Commands::scheduled_command command;
+        const size_t                used = Commands::read_scheduled_command(
+            packet.data.data() + offset, size - offset, command);
+        if (used == 0) {
+          print_debug(Helpers::MAIN, "Invalid scheduled command");
+          reject_command(Commands::AckResult::BadValue);
+          break;
+        }
+        offset += used;
+        const int32_t id = command_schedule.add(command);
+        if (id < 0) {
+          print_debug(Helpers::MAIN, "Command schedule full");
+          reject_command(Commands::AckResult::NoSpace);
+          break;
+        }
+        command.id = id;
+        report_scheduled_command(&command, node);
+      }
+      break;
+    }
+    case Commands::ScheduleAction::Delete: {
+      for (size_t offset = 1; offset + sizeof(uint16_t) <= size;
+           offset += sizeof(uint16_t)) {
+        uint16_t id;
+        memcpy(&id, packet.data.data() + offset, sizeof(id));
+        if (!command_schedule.remove(id)) {
+          print_debug(Helpers::MAIN, "No scheduled command ", id);
+          reject_command(Commands::AckResult::BadValue);
+        }
+      }
+      report_scheduled_command(nullptr, node);
+      break;
+    }
+    case Commands::ScheduleAction::List: {
+      if (command_schedule.size() == 0) {
+        report_scheduled_command(nullptr, node);
+      } else {
+        list_index = 0;
+        list_node  = node;
+      }
+      return;
+    }
+    case Commands::ScheduleAction::Clear: {
+      command_schedule.clear();
+      report_scheduled_command(nullptr, node);
+      break;
+    }
+    default: {
+      print_debug(Helpers::MAIN, "Invalid schedule action");
+      reject_command(Commands::AckResult::BadValue);
+      return;
+    }
+  }
+  restart_listing();
+  save_command_schedule();
+}
+
+/**
+ * @brief Helper function to report a command of the command schedule.
+ *
+ * The DataSchedule packet carries the number of commands in the schedule,
+ * followed by the command's id, tag and data.
+ *
+ * @param command The command, or nullptr to only report the number of
+ * commands.
+ * @param node The node that asked for the command.
+ */
+void report_scheduled_command(const Commands::scheduled_command *command,
+                              uint8_t                            node) {
+  PacketComm report;
+  report.header.type     = ArtemisTypeId::DataSchedule;
+  report.header.nodeorig = (uint8_t)NODES::TEENSY_NODE_ID;
+  report.header.nodedest = node;
+  report.data.resize(1 + sizeof(Commands::scheduled_command));
+  report.data[0] = command_schedule.size();
+  size_t size    = 1;
+  if (command != nullptr) {
+    size += Commands::write_scheduled_command(*command, report.data.data() + 1);
+  }
+  report.data.resize(size);
+  route_packet_to_rfm23(report);
+}
+
+/**
+ * @brief Helper function to load the command sequences.
+ *
+ * Each sequence saved on the SD card is kept if it is whole and can be run.
+ */
+void load_sequences() {
+  Helpers::MutexScope lock(sd_mtx);
+  if (!sdcardready || !sequence_file.open(COMMAND_SEQUENCE_PATH)) {
+    print_debug(Helpers::MAIN, "Failed to open the command sequences");
+    return;
+  }
+  for (uint8_t i = 0; i < SEQUENCE_SLOTS; i++) {
+    Commands::sequence_slot &slot = sequences[i];
+    if (!sequence_file.read(i * sizeof(slot), (uint8_t *)&slot,
+                            sizeof(slot)) ||
+        slot.length > SEQUENCE_SIZE ||
+        Helpers::crc32(slot.code, slot.length) != slot.crc ||
+        !Commands::check_sequence(slot.code, slot.length)) {
+      slot.length = 0;
+    }
+  }
+}
+
+/**
+ * @brief Helper function to run the command sequence, if one is running.
+ *
+ * Commands are sent to the main channel from the Teensy, so replies addressed
+ * back to it can be waited for. They are sent while the main channel's queue
+ * has room for them. The device of a telemetry point is sampled before an
+ * instruction reads the point, and every SEQUENCE_SAMPLE_INTERVAL while the
+ * sequence waits on it. The node that started the sequence is told when it
+ * ends.
+ */
+void run_sequence() {
+  if (sequence_engine.state() != Commands::SequenceState::Running) {
+    return;
+  }
+  Commands::sequence_command command;
+  while (main_queue.size() < Parameters::get(Parameters::QueueSize) / 2) {
+    if (!sequence_engine.step(uptime, command)) {
+      const int32_t point = sequence_engine.point();
+      if (point < 0 || (sequence_engine.position() == sampled_position &&
+                        uptime - last_sequence_sample <
+                            SEQUENCE_SAMPLE_INTERVAL)) {
+        break;
+      }
+      sample_source(Telemetry::point_source(point));
+      sampled_position     = sequence_engine.position();
+      last_sequence_sample = uptime;
+      continue;
+    }
+    PacketComm sent;
+    sent.header.type     = (PacketComm::TypeId)command.type;
+    sent.header.nodeorig = (uint8_t)NODES::TEENSY_NODE_ID;
+    sent.header.nodedest = command.node;
+    sent.header.chanin   = 0;
+    sent.header.chanout  = Channels::Channel_ID::RFM23_CHANNEL;
+    sent.data.assign(command.data, command.data + command.size);
+    route_packet_to_main(sent);
+  }
+  if (sequence_engine.state() != Commands::SequenceState::Running) {
+    report_sequence_status(sequence_node);
+  }
+}
+
+/**
+ * @brief Helper function to tell the sequence engine of a packet that reached
+ * the main channel, which the sequence running may be waiting for.
+ *
+ * @param type The PacketComm::TypeId of the packet.
+ */
+void observe_sequence(uint16_t type) { sequence_engine.observe(type); }
+
+/**
+ * @brief Helper function to upload, start, stop or report command sequences.
+ *
+ * The packet carries a Commands::SequenceAction and its operands. A sequence
+ * is uploaded in parts with Write, then checked against its length and CRC
+ * and saved to the SD card with Commit. Writing to the slot of the sequence
+ * running stops it. Every action is answered with the state of the engine.
+ */
+void handle_sequence() {
+  if (packet.data.empty()) {
+    print_debug(Helpers::MAIN, "Sequence command too short");
+    reject_command(Commands::AckResult::BadLength);
+    return;
+  }
+  const uint8_t node = packet.header.nodeorig;
+  const size_t  size = packet.data.size();
+  const Commands::SequenceAction action =
+      (Commands::SequenceAction)packet.data[0];
+  const uint8_t slot = size > 1 ? packet.data[1] : 0;
+  if ((action == Commands::SequenceAction::Write ||
+       action == Commands::SequenceAction::Commit ||
+       action == Commands::SequenceAction::Start) &&
+      (size < 2 || slot >= SEQUENCE_SLOTS)) {
+    print_debug(Helpers::MAIN, "No such sequence slot");
+    reject_command(Commands::AckResult::BadValue);
+    return;
+  }
+  switch (action) {
+    case Commands::SequenceAction::Write: {
+      uint16_t offset;
+      if (size < 4) {
+        print_debug(Helpers::MAIN, "Sequence write too short");
+        reject_command(Commands::AckResult::BadLength);
+        return;
+      }
+      memcpy(&offset, packet.data.data() + 2, sizeof(offset));
+      if (offset + size - 4 > SEQUENCE_SIZE) {
+        print_debug(Helpers::MAIN, "Sequence write too long");
+        reject_command(Commands::AckResult::BadLength);
+        return;
+      }
+      if (sequence_engine.slot() == slot) {
+        sequence_engine.stop();
+      }
+      sequences[slot].length = 0;
+      memcpy(sequences[slot].code + offset, packet.data.data() + 4, size - 4);
+      break;
+    }
+    case Commands::SequenceAction::Commit: {
+      Commands::sequence_slot &sequence = sequences[slot];
+      uint16_t                 length;
+      uint32_t                 crc;
+      if (size < 8) {
+        print_debug(Helpers::MAIN, "Sequence commit too short");
+        reject_command(Commands::AckResult::BadLength);
+        return;
+      }
+      memcpy(&length, packet.data.data() + 2, sizeof(length));
+      memcpy(&crc, packet.data.data() + 4, sizeof(crc));
+      if (length > SEQUENCE_SIZE ||
+          Helpers::crc32(sequence.code, length) != crc ||
+          !Commands::check_sequence(sequence.code, length)) {
+        print_debug(Helpers::MAIN, "Invalid sequence");
+        reject_command(Commands::AckResult::BadValue);
+        break;
+      }
+      sequence.length = length;
+      sequence.crc    = crc;
+      Helpers::MutexScope lock(sd_mtx);
+      if (!sequence_file.write(slot * sizeof(sequence),
+                               (const uint8_t *)&sequence, sizeof(sequence)) ||
+          !sequence_file.sync()) {
+        print_debug(Helpers::MAIN, "Failed to save the command sequence");
+        fail_command(Commands::AckResult::DeviceError);
+      }
+      break;
+    }
+    case Commands::SequenceAction::Start: {
+      if (sequences[slot].length == 0) {
+        print_debug(Helpers::MAIN, "No sequence in slot ", (uint16_t)slot);
+        reject_command(Commands::AckResult::BadValue);
+        break;
+      }
+      sequence_engine.start(slot, sequences[slot].code,
+                            sequences[slot].length);
+      sequence_node    = node;
+      sampled_position = SEQUENCE_SIZE;
+      break;
+    }
+    case Commands::SequenceAction::Stop: {
+      sequence_engine.stop();
+      break;
+    }
+    case Commands::SequenceAction::Status: {
+      break;
+    }
+    default: {
+      print_debug(Helpers::MAIN, "Invalid sequence action");
+      reject_command(Commands::AckResult::BadValue);
+      return;
+    }
+  }
+  report_sequence_status(node);
+}
+
+/**
+ * @brief Helper function to report the state of the sequence engine.
+ *
+ * @param node The node to report to.
+ */
+void report_sequence_status(uint8_t node) {
+  Commands::sequence_status status;
+  status.slot     = sequence_engine.slot();
+  status.state    = (uint8_t)sequence_engine.state();
+  status.position = sequence_engine.position();
+  status.result   = sequence_engine.result();
+  for (uint8_t i = 0; i < SEQUENCE_SLOTS; i++) {
+    status.lengths[i] = sequences[i].length;
+  }
+  PacketComm report;
+  report.header.type     = ArtemisTypeId::DataSequence;
+  report.header.nodeorig = (uint8_t)NODES::TEENSY_NODE_ID;
+  report.header.nodedest = node;
+  report.data.resize(sizeof(status));
+  memcpy(report.data.data(), &status, sizeof(status));
+  route_packet_to_rfm23(report);
+}
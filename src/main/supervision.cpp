@@ -0,0 +1,478 @@
+/**
+ * @file supervision.cpp
+ * @brief The main channel's supervision of the other channels.
+ *
+ * This file contains the part of the main channel that starts the other
+ * channels, restarts those that end or stall, watches their stacks and share
+ * of the processor, and scales the processor's clock with the load.
+ */
+#include "main/main_channel.h"
+#include <clock_governor.h>
+#include <cpu_monitor.h>
+#include <stack_monitor.h>
+#include <supervisor.h>
+
+template <size_t N>
+int  start_channel(void (*channel)(), uint8_t channel_id, uint8_t (&stack)[N],
+                   const char *name, unsigned int time_slice,
+                   uint32_t deadline);
+void restart_channel(uint8_t channel_id, Helpers::RestartCause cause);
+void clear_channel_queue(uint8_t channel_id);
+void scan_stacks();
+void start_clock_governor();
+void set_cpu_clock(uint32_t frequency);
+
+namespace {
+using namespace Artemis;
+// Thread stacks, painted so that their use can be measured
+alignas(8) uint8_t     rfm23_stack[RFM23_STACK_SIZE];
+alignas(8) uint8_t     pdu_stack[PDU_STACK_SIZE];
+alignas(8) uint8_t     rpi_stack[RPI_STACK_SIZE];
+alignas(8) uint8_t     storage_stack[STORAGE_STACK_SIZE];
+#ifdef TESTS
+alignas(8) uint8_t     test_stack[TEST_STACK_SIZE];
+#endif
+#ifdef DEBUG_LOG_ENABLED
+alignas(8) uint8_t     debug_log_stack[DEBUG_LOG_STACK_SIZE];
+#endif
+#if defined(__IMXRT1062__)
+alignas(8) uint8_t     idle_stack[IDLE_STACK_SIZE];
+#endif
+uint32_t               last_stack_scan = 0;
+// The share of the processor each thread used since the last CPU beacon
+Helpers::CpuLoad       cpu_load;
+
+// Processor clock scaling, only done where the idle thread can run
+Helpers::ClockGovernor governor;
+bool                   governing            = false;
+uint32_t               last_governor_update = 0;
+uint32_t               last_busy_us         = 0;
+} // namespace
+
+/**
+ * @brief Helper function to set up threads on the Teensy.
+ *
+ * Each thread is given the time slice of its priority, and the running
+ * thread starts being sampled so that the CPU beacon can report the share of
+ * the processor each one uses.
+ */
+void setup_threads() {
+  if (threads.setSliceMillis(10) != 1 ||
+      threads.setTimeSlice(threads.id(), MAIN_TIME_SLICE) != 1) {
+    print_debug(Helpers::MAIN,
+                "Failed to assign computing time to all threads");
+  }
+  if (!Helpers::start_cpu_monitor()) {
+    print_debug(Helpers::MAIN, "Failed to start the CPU monitor");
+  }
+  start_clock_governor();
+
+  launch_channel(Channels::Channel_ID::RFM23_CHANNEL);
+  launch_channel(Channels::Channel_ID::PDU_CHANNEL);
+  launch_channel(Channels::Channel_ID::RPI_CHANNEL);
+  launch_channel(Channels::Channel_ID::STORAGE_CHANNEL);
+#ifdef TESTS
+  launch_channel(Channels::Channel_ID::TEST_CHANNEL);
+#endif
+#ifdef DEBUG_LOG_ENABLED
+  launch_channel(Channels::Channel_ID::DEBUG_LOG_CHANNEL);
+#endif
+}
+
+/**
+ * @brief Helper function to start a channel by its Channel_ID.
+ *
+ * @param channel_id The Channel_ID of the channel.
+ * @return int The thread ID of the channel, or -1 if it failed to start.
+ */
+int launch_channel(uint8_t channel_id) {
+  switch (channel_id) {
+    case Channels::Channel_ID::RFM23_CHANNEL: {
+      return start_channel(Channels::RFM23::rfm23_channel, channel_id,
+                           rfm23_stack, "rfm23_channel", RFM23_TIME_SLICE,
+                           RFM23_HEARTBEAT_DEADLINE);
+    }
+    case Channels::Channel_ID::PDU_CHANNEL: {
+      return start_channel(Channels::PDU::pdu_channel, channel_id, pdu_stack,
+                           "pdu_channel", PDU_TIME_SLICE,
+                           PDU_HEARTBEAT_DEADLINE);
+    }
+    case Channels::Channel_ID::RPI_CHANNEL: {
+      return start_channel(Channels::RPI::rpi_channel, channel_id, rpi_stack,
+                           "rpi_channel", RPI_TIME_SLICE,
+                           RPI_HEARTBEAT_DEADLINE);
+    }
+    case Channels::Channel_ID::STORAGE_CHANNEL: {
+      return start_channel(Channels::STORAGE::storage_channel, channel_id,
+                           storage_stack, "storage_channel",
+                           STORAGE_TIME_SLICE, STORAGE_HEARTBEAT_DEADLINE);
+    }
+#ifdef TESTS
+    case Channels::Channel_ID::TEST_CHANNEL: {
+      return start_channel(Channels::TEST::test_channel, channel_id,
+                           test_stack, "test_channel", TEST_TIME_SLICE,
+                           TEST_HEARTBEAT_DEADLINE);
+    }
+#endif
+#ifdef DEBUG_LOG_ENABLED
+    case Channels::Channel_ID::DEBUG_LOG_CHANNEL: {
+      return start_channel(Helpers::debug_log_channel, channel_id,
+                           debug_log_stack, "debug_log_channel",
+                           DEBUG_LOG_TIME_SLICE, DEBUG_LOG_HEARTBEAT_DEADLINE);
+    }
+#endif
+    default: {
+      return -1;
+    }
+  }
+}
+
+/**
+ * @brief The number of threads started, including the main thread.
+ *
+ * @return int The number of threads.
+ */
+constexpr int thread_count() {
+  int count = 5;
+#ifdef TESTS
+  count++;
+#endif
+#ifdef DEBUG_LOG_ENABLED
+  count++;
+#endif
+#if defined(__IMXRT1062__)
+  count++;
+#endif
+  return count;
+}
+
+static_assert(thread_count() <= Threads::MAX_THREADS,
+              "Every thread must fit in TeensyThreads' MAX_THREADS");
+static_assert((uint8_t)Helpers::HeapTag::DebugLog ==
+                  Channels::Channel_ID::DEBUG_LOG_CHANNEL,
+              "Each channel's HeapTag must match its Channel_ID");
+static_assert((uint8_t)Helpers::TraceSource::RPI ==
+                  Channels::Channel_ID::RPI_CHANNEL,
+              "Each channel's TraceSource must match its Channel_ID");
+static_assert(2 * Parameters::definition(Parameters::PduCommunicationTimeout)
+                          .maximum <
+                  PDU_HEARTBEAT_DEADLINE,
+              "The PDU channel must not be restarted while it waits on the "
+              "PDU for a switch command and the report after it");
+static_assert(PDU_HEARTBEAT_DEADLINE > DEPLOYMENT_DELAY + BURN_WIRE_ON_TIME &&
+                  PDU_HEARTBEAT_DEADLINE > DEPLOYMENT_LOOP_INTERVAL,
+              "The PDU channel must not be restarted during deployment");
+
+/**
+ * @brief Helper function to start a channel on a monitored stack.
+ *
+ * The stack is painted before the channel starts, so that monitor_stacks()
+ * can measure how much of it the channel uses. The channel's heap allocations
+ * are counted under the HeapTag of the same value as its Channel_ID, and it is
+ * supervised from the time it starts.
+ *
+ * @tparam N The size of the stack, in bytes.
+ * @param channel The function of the channel.
+ * @param channel_id The Channel_ID of the channel.
+ * @param stack The stack of the channel.
+ * @param name The name of the channel, for debug messages.
+ * @param time_slice The time slice of the channel, in milliseconds.
+ * @param deadline The heartbeat deadline of the channel, in milliseconds.
+ * @return int The thread ID of the channel, or -1 if it failed to start.
+ */
+template <size_t N>
+int start_channel(void (*channel)(), uint8_t channel_id, uint8_t (&stack)[N],
+                  const char *name, unsigned int time_slice,
+                  uint32_t deadline) {
+  const int thread_id = threads.addThread(
+      channel, 0, N, Helpers::paint_stack(channel_id, stack, N));
+  if (thread_id == -1) {
+    print_debug(Helpers::MAIN, "Failed to start ", name);
+  } else {
+    threads.setTimeSlice(thread_id, time_slice);
+    Helpers::set_thread_heap_tag(thread_id, (Helpers::HeapTag)channel_id);
+    thread_list.push_back({thread_id, channel_id});
+    // The radio is the only way to reach the satellite, so it is never left
+    // stopped.
+    Helpers::supervise(channel_id, deadline, uptime,
+                       channel_id == Channels::Channel_ID::RFM23_CHANNEL);
+  }
+  return thread_id;
+}
+
+/**
+ * @brief Helper function to restart channels that have ended or stalled.
+ *
+ * At most one channel is restarted each time this is called. The radio is
+ * also put back on its previous frequency if a trial of a new one has run
+ * out.
+ */
+void supervise_channels() {
+  check_radio_trial();
+  for (const thread_struct &thread : thread_list) {
+    if (threads.getState(thread.thread_id) == Threads::ENDED) {
+      restart_channel(thread.channel_id, Helpers::RestartCause::Ended);
+      return;
+    }
+  }
+  const uint8_t stalled = Helpers::find_stalled_channel(uptime);
+  if (stalled != 0) {
+    restart_channel(stalled, Helpers::RestartCause::Stalled);
+  }
+}
+
+/**
+ * @brief Helper function to kill a channel and start it again.
+ *
+ * The mutexes the channel was holding when it was killed are unlocked, and
+ * its packet queue is emptied so that it starts as it did at boot. A channel
+ * that has already been restarted SUPERVISOR_MAX_RESTARTS times without a
+ * heartbeat is left stopped, unless it is essential.
+ *
+ * @param channel_id The Channel_ID of the channel.
+ * @param cause The reason the channel is restarted.
+ */
+void restart_channel(uint8_t channel_id, Helpers::RestartCause cause) {
+  stop_channel(channel_id);
+  if (!Helpers::record_restart(channel_id, cause)) {
+    Helpers::print_log<Helpers::LogLevel::Warning>(
+        Helpers::MAIN, "Channel ", (uint16_t)channel_id, " is left stopped");
+    return;
+  }
+  Helpers::print_log<Helpers::LogLevel::Warning>(
+      Helpers::MAIN, "Restarting channel ", (uint16_t)channel_id,
+      cause == Helpers::RestartCause::Stalled ? " after it stalled"
+                                              : " after it ended");
+  clear_channel_queue(channel_id);
+  launch_channel(channel_id);
+  send_restart_beacon();
+}
+
+/**
+ * @brief Helper function to kill a channel, and unlock the mutexes it was
+ * holding.
+ *
+ * @param channel_id The Channel_ID of the channel.
+ */
+void stop_channel(uint8_t channel_id) {
+  int thread_id = -1;
+  for (const thread_struct &thread : thread_list) {
+    if (thread.channel_id == channel_id) {
+      thread_id = thread.thread_id;
+    }
+  }
+  kill_thread(channel_id);
+  const uint8_t recovered = Helpers::recover_mutexes(thread_id);
+  if (recovered > 0) {
+    Helpers::print_log<Helpers::LogLevel::Warning>(
+        Helpers::MAIN, "Unlocked ", (uint16_t)recovered,
+        " mutexes held by channel ", (uint16_t)channel_id);
+  }
+}
+
+/**
+ * @brief Helper function to empty the packet queue of a channel.
+ *
+ * @param channel_id The Channel_ID of the channel.
+ */
+void clear_channel_queue(uint8_t channel_id) {
+  switch (channel_id) {
+    case Channels::Channel_ID::RFM23_CHANNEL: {
+      Helpers::MutexScope lock(rfm23_queue_mtx);
+      rfm23_queue.clear();
+      break;
+    }
+    case Channels::Channel_ID::PDU_CHANNEL: {
+      Helpers::MutexScope lock(pdu_queue_mtx);
+      pdu_queue.clear();
+      break;
+    }
+    case Channels::Channel_ID::RPI_CHANNEL: {
+      Helpers::MutexScope lock(rpi_queue_mtx);
+      rpi_queue.clear();
+      break;
+    }
+    case Channels::Channel_ID::STORAGE_CHANNEL: {
+      Helpers::MutexScope lock(storage_queue_mtx);
+      storage_queue.clear();
+      break;
+    }
+    default: {
+      break;
+    }
+  }
+}
+
+/**
+ * @brief Helper function to scan thread stacks every STACK_SCAN_INTERVAL.
+ */
+void monitor_stacks() {
+  if (uptime - last_stack_scan < STACK_SCAN_INTERVAL) {
+    return;
+  }
+  last_stack_scan = uptime;
+  scan_stacks();
+}
+
+/**
+ * @brief Helper function to scan thread stacks.
+ *
+ * A warning is printed the first time a stack passes STACK_WARNING_PERCENT of
+ * its size. Every scan must go through here, since a stack is only reported
+ * by the scan that first finds it past the limit.
+ */
+void scan_stacks() {
+  const uint8_t warnings = Helpers::scan_stacks();
+  for (uint8_t i = 0; i < STACK_MONITOR_SLOTS; i++) {
+    if (warnings & (1 << i)) {
+      const Helpers::monitored_stack *stack = Helpers::get_stack(i);
+      Helpers::print_log<Helpers::LogLevel::Warning>(
+          Helpers::MAIN, "Channel ", (uint16_t)stack->channel_id,
+          " has used ", stack->high_water, " of its ", stack->size,
+          " byte stack");
+    }
+  }
+}
+
+/**
+ * @brief Helper function to start the idle thread, which the clock governor
+ * measures the load with.
+ *
+ * The clock is only scaled on the Teensy. On the host, the idle thread would
+ * spin on one of the host's cores.
+ */
+void start_clock_governor() {
+#if defined(__IMXRT1062__)
+  const int thread_id =
+      threads.addThread(Helpers::idle_thread, 0, IDLE_STACK_SIZE, idle_stack);
+  if (thread_id == -1) {
+    print_debug(Helpers::MAIN, "Failed to start the clock governor");
+    return;
+  }
+  threads.setTimeSlice(thread_id, IDLE_TIME_SLICE);
+  last_busy_us         = Helpers::get_busy_us();
+  last_governor_update = uptime;
+  governing            = true;
+#endif
+}
+
+/**
+ * @brief Helper function to let the clock governor choose the processor's
+ * clock every GOVERNOR_WINDOW.
+ *
+ * The load of a window is the share of it the idle thread counted as busy. A
+ * boost raises the clock straight away, without waiting for the window to
+ * end.
+ */
+void govern_clock() {
+  if (!governing) {
+    return;
+  }
+  const uint32_t window = uptime - last_governor_update;
+  if (window < GOVERNOR_WINDOW &&
+      !(Helpers::boosted(uptime) && governor.level() < GOVERNOR_LEVELS - 1)) {
+    return;
+  }
+  const uint32_t busy_us = Helpers::get_busy_us();
+  // Busy microseconds in each millisecond are tenths of a percent
+  uint32_t       load    = window == 0 ? 0 : (busy_us - last_busy_us) / window;
+  if (load > 1000) {
+    load = 1000;
+  }
+  last_busy_us             = busy_us;
+  last_governor_update     = uptime;
+  const uint32_t frequency = governor.frequency();
+  governor.update(load, uptime);
+  if (governor.frequency() != frequency) {
+    set_cpu_clock(governor.frequency());
+  }
+}
+
+/**
+ * @brief Helper function to change the processor's clock between transfers.
+ *
+ * The UARTs, SPI and I2C are clocked from roots that set_arm_clock() leaves
+ * alone, so their baud rate divisors stay right at every step. A transfer
+ * must still not be cut by the change, so the bytes waiting to go out to the
+ * PDU and the Raspberry Pi are sent first, and the SPI1 and I2C1 mutexes are
+ * held while the clock changes.
+ *
+ * @param frequency The frequency, in Hz.
+ */
+void set_cpu_clock(uint32_t frequency) {
+  Helpers::MutexScope spi_lock(spi1_mtx);
+  Helpers::MutexScope i2c_lock(i2c1_mtx);
+  Serial1.flush();
+  Serial2.flush();
+#if defined(__IMXRT1062__)
+  set_arm_clock(frequency);
+#endif
+  print_debug(Helpers::MAIN, "Clock set to ", frequency / 1000000, " MHz");
+}
+
+/**
+ * @brief Helper function to send a stack beacon.
+ *
+ * The stacks are scanned first, so the beacon carries their latest
+ * high-water marks.
+ */
+void send_stack_beacon() {
+  scan_stacks();
+  Beacons::stackbeacon beacon;
+  for (uint8_t i = 0; i < ARTEMIS_STACK_BEACON_COUNT; i++) {
+    const Helpers::monitored_stack *stack = Helpers::get_stack(i);
+    if (stack != nullptr) {
+      beacon.channel[i] = stack->channel_id;
+      beacon.used[i]    = stack->high_water;
+      beacon.size[i]    = stack->size;
+    }
+  }
+  beacon.deci = uptime;
+  send_local_beacon(beacon);
+}
+
+/**
+ * @brief Helper function to send a CPU beacon.
+ *
+ * The main thread is sent as channel 0, followed by the channels. A thread
+ * waiting in threads.delay() still runs briefly to check the time, so the
+ * share of an idle thread is small but not 0.
+ */
+void send_cpu_beacon() {
+  cpu_load.update();
+  Beacons::cpubeacon beacon;
+  beacon.samples    = cpu_load.samples();
+  beacon.channel[0] = 0;
+  beacon.load[0]    = cpu_load.permille(threads.id());
+  uint8_t i         = 1;
+  for (const thread_struct &thread : thread_list) {
+    if (i == ARTEMIS_CPU_BEACON_COUNT) {
+      break;
+    }
+    beacon.channel[i] = thread.channel_id;
+    beacon.load[i]    = cpu_load.permille(thread.thread_id);
+    i++;
+  }
+  beacon.deci = uptime;
+  send_local_beacon(beacon);
+}
+
+/**
+ * @brief Helper function to send a restart beacon.
+ *
+ * The cause of each channel is a Helpers::RestartCause. A restart beacon is
+ * also sent whenever a channel is restarted.
+ */
+void send_restart_beacon() {
+  Beacons::restartbeacon beacon;
+  for (uint8_t i = 0; i < ARTEMIS_RESTART_BEACON_COUNT; i++) {
+    const Helpers::supervised_channel *channel = Helpers::get_supervised(i);
+    if (channel != nullptr) {
+      beacon.channel[i]  = channel->channel_id;
+      beacon.restarts[i] = channel->restarts;
+      beacon.cause[i]    = (uint8_t)channel->cause;
+    }
+  }
+  beacon.deci = uptime;
+  send_local_beacon(beacon);
+}